@@ -0,0 +1,589 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "circuit-solver/circuit.h"
+#include "circuit-solver/generators/circuit_generator.h"
+
+using namespace std;
+
+// замеры времени этапов обновления и расчета схемы на синтетических схемах растущего
+// размера (лестницы, квадратные сетки, случайные разреженные и планарные сетки,
+// схемы наподобие энергосистем, звезды)
+// каждый этап выполняется с новыми объектами repeat раз, в отчет идет наименьшее время;
+// семейство перестает расти, если следующий размер (даже при линейном росте времени)
+// не уложится в бюджет времени
+// результаты выводятся в JSON; в режиме сравнения (--compare) они сверяются с
+// сохраненным результатом, и этапы, ставшие медленнее порога, отмечаются регрессией;
+// с --max-exponent проверяется и рост времени этапов с размером схемы: показатель
+// степени между соседними размерами больше заданного тоже считается регрессией (так
+// квадратичный этап не прячется за бюджетом, отсекающим большие размеры)
+// запуск: circuit_bench [--families ladder,grid,planar,power,mesh,star] [--max 1000000]
+//                       [--repeat 3] [--budget 60] [--formulation branch|mna]
+//                       [--output results.json] [--compare baseline.json]
+//                       [--threshold 0.25] [--min-time 0.0001] [--max-exponent 1.5]
+
+namespace
+{
+const vector<string> STAGES = { "parse", "pin_matrix", "nodes", "branches", "inc_matrix",
+                                "loops", "equations", "solve" };                        // этапы в порядке выполнения
+
+struct Options                                                                          // параметры запуска
+{
+    vector<string> families = { "ladder", "grid", "planar", "power", "mesh", "star" };  // семейства схем
+    size_t maxSize = 1000000;                                                           // наибольший размер (количество элементов)
+    size_t repeat = 3;                                                                  // количество повторов этапа
+    double budget = 60.0;                                                               // предельное время замеров одного размера (с)
+    string formulation = "branch";                                                      // способ составления уравнений
+    string output;                                                                      // файл для результатов (пустой - стандартный вывод)
+    string compare;                                                                     // файл сохраненных результатов для сравнения
+    double threshold = 0.25;                                                            // допустимое относительное замедление
+    double minTime = 1e-4;                                                              // время, меньше которого этапы не сравниваются (с)
+    double maxExponent = 0.0;                                                           // допустимый показатель роста времени (0 - без проверки)
+};
+
+struct Result                                                                           // замер одного этапа
+{
+    string family;                                                                      // семейство схемы
+    size_t size = 0;                                                                    // заданный размер
+    size_t elements = 0;                                                                // фактическое количество элементов
+    string stage;                                                                       // этап
+    double seconds = 0.0;                                                               // наименьшее время (с)
+};
+
+// построение элементов по списку ребер между узлами: элемент ребра соединяет узлы
+// from (пин 2 * i) и to (пин 2 * i + 1), а пины одного узла связываются в цепочку -
+// каждый пин соединяется с предыдущим пином узла
+struct Edge
+{
+    size_t from;
+    size_t to;
+    CS::Element::Type type;
+    double value;
+};
+
+CS::ElemVect buildElements(size_t nodeCount, const vector<Edge>& edges)
+{
+    vector<int> lastPin(nodeCount, -1);                                                 // последний пин каждого узла
+    CS::ElemVect elements;
+    elements.reserve(edges.size());
+
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        int pins[2] = { static_cast<int>(2 * i), static_cast<int>(2 * i + 1) };
+        size_t nodes[2] = { edges[i].from, edges[i].to };
+        int linked[2];
+
+        for (size_t side = 0; side < 2; side++)
+        {
+            linked[side] = lastPin[nodes[side]];
+            lastPin[nodes[side]] = pins[side];
+        }
+
+        elements.emplace_back(edges[i].type, edges[i].value, linked[0], linked[1]);
+    }
+
+    return elements;
+}
+
+// случайная разреженная сетка: случайное остовное дерево, дополненное случайными
+// ребрами до средней степени узла около трех (у каждого узла не меньше двух ребер),
+// и источник напряжения между двумя узлами
+CS::ElemVect makeMesh(size_t size)
+{
+    size_t nodeCount = max<size_t>(size * 2 / 3, 3);
+    mt19937_64 random(nodeCount);
+    vector<Edge> edges = { { 0, nodeCount - 1, CS::Element::Type::E, 10.0 } };
+    vector<size_t> degrees(nodeCount, 0);
+    degrees[0] = degrees[nodeCount - 1] = 1;
+
+    auto addResistor = [&](size_t from, size_t to)
+    {
+        edges.push_back({ from, to, CS::Element::Type::R, 1.0 + random() % 100 / 10.0 });
+        degrees[from]++;
+        degrees[to]++;
+    };
+
+    for (size_t node = 1; node < nodeCount; node++)                                     // остовное дерево
+    {
+        addResistor(random() % node, node);
+    }
+
+    for (size_t node = 0; node < nodeCount; node++)                                     // висячие узлы
+    {
+        while (degrees[node] < 2)
+        {
+            size_t other = random() % nodeCount;
+
+            if (other != node)
+            {
+                addResistor(node, other);
+            }
+        }
+    }
+
+    while (edges.size() < size)                                                         // случайные хорды
+    {
+        size_t from = random() % nodeCount;
+        size_t to = random() % nodeCount;
+
+        if (from != to)
+        {
+            addResistor(from, to);
+        }
+    }
+
+    return buildElements(nodeCount, edges);
+}
+
+// звезда: центральный узел соединен с общим узлом множеством параллельных лучей из
+// двух последовательных сопротивлений, источник напряжения - между центром и общим узлом
+CS::ElemVect makeStar(size_t size)
+{
+    size_t rays = max<size_t>((size - 1) / 2, 1);
+    vector<Edge> edges = { { 0, 1, CS::Element::Type::E, 10.0 } };
+
+    for (size_t i = 0; i < rays; i++)
+    {
+        edges.push_back({ 0, 2 + i, CS::Element::Type::R, 1.0 + i % 3 });
+        edges.push_back({ 2 + i, 1, CS::Element::Type::R, 2.0 + i % 5 });
+    }
+
+    return buildElements(rays + 2, edges);
+}
+
+// построение схемы семейства: стандартные семейства строит CS::CircuitGenerator
+// (с постоянным seed, чтобы замеры разных запусков были сравнимы)
+CS::ElemVect makeFamily(const string& family, size_t size)
+{
+    if (family == "mesh")
+    {
+        return makeMesh(size);
+    }
+    else if (family == "star")
+    {
+        return makeStar(size);
+    }
+
+    CS::ElemVect elements;
+    CS::CircuitGenerator(1).generate(family, size, elements);
+
+    return elements;
+}
+
+// текстовое описание схемы в формате Circuit (для замера разбора)
+string toText(const CS::ElemVect& elements)
+{
+    ostringstream os;
+    os << setprecision(17);
+
+    for (const CS::Element& element : elements)
+    {
+        os << (element.getType() == CS::Element::Type::R ? "R " :
+               element.getType() == CS::Element::Type::E ? "E " : "J ") << element.getValue();
+
+        for (size_t side = 0; side < 2; side++)
+        {
+            int pin = element.getLinkedPin(side);
+            os << ' ';
+            pin < 0 ? os << "none" : os << pin;
+        }
+
+        os << '\n';
+    }
+
+    return os.str();
+}
+
+double seconds(chrono::steady_clock::time_point first, chrono::steady_clock::time_point last)
+{
+    return chrono::duration<double>(last - first).count();
+}
+
+// замер всех этапов на одной схеме: этапы выполняются по порядку с новыми объектами,
+// для каждого этапа запоминается наименьшее время из repeat повторов
+// возвращает время по этапам
+map<string, double> measure(const CS::ElemVect& source, const Options& options)
+{
+    map<string, double> best;
+    string text = toText(source);
+    bool branch = options.formulation == "branch";
+
+    for (size_t attempt = 0; attempt < options.repeat; attempt++)
+    {
+        map<string, double> times;
+        auto now = [] { return chrono::steady_clock::now(); };
+
+        auto start = now();
+        CS::ElemVect parsed;
+        CS::NetlistParser().parse(string_view(text), parsed);
+        times["parse"] = seconds(start, now());
+
+        CS::Elements elements;
+
+        for (const CS::Element& element : parsed)
+        {
+            elements.add(element);
+        }
+
+        CS::PinMatrix pinMatrix;
+        CS::Nodes nodes;
+        CS::Branches branches;
+        CS::IncMatrix incMatrix;
+        CS::Loops loops;
+        CS::Equations equations;
+        CS::MnaEquations mnaEquations;
+
+        start = now();
+        pinMatrix.update(elements);
+        times["pin_matrix"] = seconds(start, now());
+
+        start = now();
+        nodes.update(pinMatrix);
+        times["nodes"] = seconds(start, now());
+
+        start = now();
+        branches.update(pinMatrix, nodes, elements);
+        times["branches"] = seconds(start, now());
+
+        start = now();
+        incMatrix.update(nodes, branches, elements);
+        times["inc_matrix"] = seconds(start, now());
+
+        if (branch)                                                                     // контуры нужны только уравнениям Кирхгофа
+        {
+            start = now();
+            loops.update(incMatrix);
+            times["loops"] = seconds(start, now());
+
+            start = now();
+            equations.update(incMatrix, loops, branches, elements);
+            times["equations"] = seconds(start, now());
+        }
+        else
+        {
+            start = now();
+            mnaEquations.update(nodes, branches, incMatrix, elements);
+            times["equations"] = seconds(start, now());
+        }
+
+        CS::Circuit circuit;                                                            // расчет: разложение и решение после update
+
+        for (const CS::Element& element : parsed)
+        {
+            circuit.add(element);
+        }
+
+        circuit.setFormulation(options.formulation);
+        circuit.update();
+
+        start = now();
+        circuit.solve();
+        times["solve"] = seconds(start, now());
+
+        for (const auto& [stage, time] : times)
+        {
+            best[stage] = attempt ? min(best[stage], time) : time;
+        }
+    }
+
+    return best;
+}
+
+void writeJson(ostream& os, const vector<Result>& results, const Options& options)
+{
+    os << "{\n  \"version\": 1,\n  \"formulation\": \"" << options.formulation
+       << "\",\n  \"repeat\": " << options.repeat << ",\n  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        os << "    {\"family\": \"" << result.family << "\", \"size\": " << result.size
+           << ", \"elements\": " << result.elements << ", \"stage\": \"" << result.stage
+           << "\", \"seconds\": " << setprecision(6) << result.seconds << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    os << "  ]\n}\n";
+}
+
+// чтение результатов, записанных writeJson (разбираются только объекты массива results)
+vector<Result> readJson(const string& path)
+{
+    ifstream input(path);
+
+    if (!input)
+    {
+        throw runtime_error("Cannot open file: " + path);
+    }
+
+    string text((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    size_t position = text.find("\"results\"");
+    vector<Result> results;
+
+    auto field = [](const string& object, const string& key) -> string
+    {
+        size_t start = object.find("\"" + key + "\"");
+
+        if (start == string::npos)
+        {
+            throw runtime_error("Missing field: " + key);
+        }
+
+        start = object.find(':', start) + 1;
+        start = object.find_first_not_of(" \t\n\"", start);
+        size_t end = object.find_first_of(",}\"", start);
+
+        return object.substr(start, end - start);
+    };
+
+    while (position != string::npos && (position = text.find('{', position)) != string::npos)
+    {
+        size_t end = text.find('}', position);
+        string object = text.substr(position, end - position + 1);
+
+        Result result;
+        result.family = field(object, "family");
+        result.size = stoull(field(object, "size"));
+        result.elements = stoull(field(object, "elements"));
+        result.stage = field(object, "stage");
+        result.seconds = stod(field(object, "seconds"));
+        results.push_back(result);
+
+        position = end;
+    }
+
+    return results;
+}
+
+// сравнение с сохраненными результатами: этап считается регрессией, если он стал
+// медленнее больше чем на threshold и хотя бы один из замеров не меньше minTime
+// возвращает количество регрессий
+size_t compare(const vector<Result>& results, const vector<Result>& baseline, const Options& options)
+{
+    map<tuple<string, size_t, string>, double> base;
+    size_t regressions = 0;
+
+    for (const Result& result : baseline)
+    {
+        base[{ result.family, result.size, result.stage }] = result.seconds;
+    }
+
+    cerr << left << setw(8) << "family" << setw(10) << "size" << setw(12) << "stage"
+         << setw(14) << "baseline" << setw(14) << "current" << "ratio\n";
+
+    for (const Result& result : results)
+    {
+        auto found = base.find({ result.family, result.size, result.stage });
+
+        if (found == base.end())
+        {
+            continue;
+        }
+
+        double ratio = found->second > 0.0 ? result.seconds / found->second : 1.0;
+        bool regression = ratio > 1.0 + options.threshold &&
+                          max(result.seconds, found->second) >= options.minTime;
+        regressions += regression;
+
+        cerr << left << setw(8) << result.family << setw(10) << result.size << setw(12) << result.stage
+             << setw(14) << found->second << setw(14) << result.seconds << fixed << setprecision(2)
+             << ratio << defaultfloat << setprecision(6) << (regression ? "  REGRESSION" : "") << "\n";
+    }
+
+    return regressions;
+}
+
+// проверка роста времени этапов: для соседних размеров одного семейства показатель
+// log(t2 / t1) / log(n2 / n1) сравнивается с maxExponent (короткие замеры, меньше
+// minTime, не проверяются - в них велика погрешность)
+// возвращает количество этапов, растущих быстрее допустимого
+size_t checkGrowth(const vector<Result>& results, const Options& options)
+{
+    map<pair<string, string>, const Result*> previous;
+    size_t regressions = 0;
+
+    for (const Result& result : results)
+    {
+        const Result*& last = previous[{ result.family, result.stage }];
+
+        if (last && last->elements < result.elements &&
+            min(last->seconds, result.seconds) >= options.minTime)
+        {
+            double exponent = log(result.seconds / last->seconds) /
+                              log(static_cast<double>(result.elements) / last->elements);
+
+            if (exponent > options.maxExponent)
+            {
+                cerr << result.family << " " << result.stage << ": time grows as size^" << fixed
+                     << setprecision(2) << exponent << defaultfloat << setprecision(6) << " ("
+                     << last->elements << " -> " << result.elements << " elements)  SUPERLINEAR\n";
+                regressions++;
+            }
+        }
+
+        last = &result;
+    }
+
+    return regressions;
+}
+
+vector<string> split(const string& list)
+{
+    vector<string> items;
+    stringstream stream(list);
+
+    for (string item; getline(stream, item, ',');)
+    {
+        items.push_back(item);
+    }
+
+    return items;
+}
+
+Options parseOptions(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string name = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            throw invalid_argument("Missing value for " + name);
+        }
+
+        string value = argv[++i];
+
+        if (name == "--families")
+        {
+            options.families = split(value);
+        }
+        else if (name == "--max")
+        {
+            options.maxSize = static_cast<size_t>(stod(value));
+        }
+        else if (name == "--repeat")
+        {
+            options.repeat = max<size_t>(stoull(value), 1);
+        }
+        else if (name == "--budget")
+        {
+            options.budget = stod(value);
+        }
+        else if (name == "--formulation")
+        {
+            options.formulation = value;
+        }
+        else if (name == "--output")
+        {
+            options.output = value;
+        }
+        else if (name == "--compare")
+        {
+            options.compare = value;
+        }
+        else if (name == "--threshold")
+        {
+            options.threshold = stod(value);
+        }
+        else if (name == "--min-time")
+        {
+            options.minTime = stod(value);
+        }
+        else if (name == "--max-exponent")
+        {
+            options.maxExponent = stod(value);
+        }
+        else
+        {
+            throw invalid_argument("Unknown option: " + name);
+        }
+    }
+
+    if (options.formulation != "branch" && options.formulation != "mna")
+    {
+        throw invalid_argument("Unknown formulation: " + options.formulation);
+    }
+
+    return options;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        Options options = parseOptions(argc, argv);
+        vector<Result> results;
+
+        for (const string& family : options.families)
+        {
+            for (size_t size = 10; size <= options.maxSize; size *= 10)
+            {
+                CS::ElemVect elements = makeFamily(family, size);
+                map<string, double> times = measure(elements, options);
+                double total = 0.0;
+
+                for (const string& stage : STAGES)
+                {
+                    if (times.count(stage))
+                    {
+                        results.push_back({ family, size, elements.size(), stage, times[stage] });
+                        total += times[stage];
+                    }
+                }
+
+                cerr << family << " " << elements.size() << " elements: " << total << " s\n";
+
+                if (10 * total * options.repeat > options.budget)                       // следующий размер (в 10 раз больше) не уложится в бюджет
+                {
+                    cerr << family << ": budget exceeded, larger sizes skipped\n";
+                    break;
+                }
+            }
+        }
+
+        if (options.output.empty())
+        {
+            writeJson(cout, results, options);
+        }
+        else
+        {
+            ofstream output(options.output);
+            writeJson(output, results, options);
+        }
+
+        size_t regressions = options.maxExponent > 0.0 ? checkGrowth(results, options) : 0;
+
+        if (!options.compare.empty())
+        {
+            regressions += compare(results, readJson(options.compare), options);
+        }
+
+        if (!options.compare.empty() || options.maxExponent > 0.0)
+        {
+            cerr << regressions << " regression(s)\n";
+            return regressions ? 1 : 0;
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 2;
+    }
+
+    return 0;
+}
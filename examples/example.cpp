@@ -31,5 +31,11 @@ int main()
     ofs_middle << middle_circuit;
     ofs_complex << complex_circuit;
 
+    for (CS::Circuit* circuit : { &simple_circuit, &middle_circuit, &complex_circuit })
+    {
+        circuit->solve();
+        cout << circuit->getSparseSolver().getReport();
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/compiled_circuit.h"
+#include "circuit-solver/equation_system/rank_one_update.h"
+#include "circuit-solver/analysis/thread_pool.h"
+
+namespace CS
+{
+// класс для анализа отключений (N-1): расчет токов всех ветвей при изменении значения
+// одного элемента - обрыве или закорачивании сопротивления, новом значении элемента
+// левая часть раскладывается один раз (в базовом режиме), а каждый вариант считается
+// по формуле Шермана-Моррисона: изменение системы имеет ранг один (см. RankOneUpdate)
+// A * x' + scale * u * (v^T * x' + c) = b + db, поэтому
+// x' = y - f * z, где y = x + A^-1 * db, z = A^-1 * u,
+// f = scale * (v^T * y + c) / (1 + scale * v^T * z) (при бесконечном scale - предел
+// (v^T * y + c) / (v^T * z)), т.е. вариант стоит одного-двух решений по готовому
+// разложению вместо построения и разложения системы заново
+// если знаменатель обращается в ноль, изменение разделяет схему (например, обрыв ветви-
+// моста отделяет часть схемы): при нулевом токе через разделяемое сечение отделенная
+// часть просто "повисает", и токи находятся без нее (Status::Islanded), иначе вариант
+// не имеет решения (Status::Infeasible)
+// варианты независимы и считаются параллельно в пуле потоков; результат - отчет
+// с вариантами, упорядоченными по наибольшей загрузке ветвей
+//////////////////////////////////////////////////////////////////////////////////////////
+class Contingency
+{
+public:
+    struct Case                                                                         // вариант - новое значение одного элемента
+    {
+        size_t element = 0;                                                             // номер элемента
+        double value = 0.0;                                                             // новое значение (бесконечность - обрыв)
+    };
+
+    enum class Status                                                                   // исход варианта
+    {
+        Solved,                                                                         // токи найдены
+        Islanded,                                                                       // часть схемы отделена, токи найдены без нее
+        Infeasible                                                                      // решения нет (токи - NaN)
+    };
+
+    struct Outcome                                                                      // итог варианта для отчета
+    {
+        size_t index = 0;                                                               // номер варианта
+        Case change;                                                                    // вариант
+        Status status = Status::Solved;                                                 // исход
+        size_t branch = RankOneUpdate::NONE;                                            // наиболее загруженная ветвь
+        double current = 0.0;                                                           // ее ток
+        double loading = 0.0;                                                           // ее загрузка (отношение тока к допустимому)
+    };
+
+    struct Report                                                                       // отчет по вариантам
+    {
+        std::vector<Outcome> outcomes;                                                  // итоги по убыванию загрузки (сначала варианты без решения)
+        size_t overloadCount = 0;                                                       // количество вариантов с загрузкой больше единицы
+
+        friend std::ostream& operator<<(std::ostream& os, const Report& report);        // перегрузка оператора вывода в поток
+    };
+
+    explicit Contingency(Circuit& circuit);                                             // конструктор с параметрами (компилирует схему)
+    explicit Contingency(std::shared_ptr<const CompiledCircuit> circuit);               // конструктор с параметрами (по скомпилированной схеме)
+    const CompiledCircuit& getCircuit() const;                                          // геттер скомпилированной схемы
+    const DoubleVect& getBaseCurrents() const;                                          // геттер токов ветвей в базовом режиме
+    void setLimits(const DoubleVect& limits);                                           // метод задания допустимых токов ветвей
+    std::vector<Case> getOutages() const;                                               // метод получения вариантов с обрывом каждого сопротивления
+    std::vector<Case> getShorts() const;                                                // метод получения вариантов с закорачиванием каждого сопротивления
+    DoubleVect solve(const Case& change, Status& status) const;                         // метод расчета токов ветвей в варианте
+    Report run(const std::vector<Case>& cases, ThreadPool& pool,
+               size_t grain = 4) const;                                                 // метод параллельного расчета вариантов
+
+private:
+    static constexpr double TOLERANCE = 1e-9;                                           // относительный порог вырожденности изменения
+
+    std::shared_ptr<const CompiledCircuit> circuit;                                     // скомпилированная схема (разложение базового режима)
+    DoubleVect baseSolution;                                                            // решение системы в базовом режиме
+    DoubleVect baseCurrents;                                                            // токи ветвей в базовом режиме
+    DoubleVect limits;                                                                  // допустимые токи ветвей (пустой - базовые токи)
+
+    void initialize();                                                                  // метод расчета базового режима
+    std::vector<Case> getResistorCases(double value) const;                             // метод получения вариантов для всех сопротивлений
+    Outcome evaluate(size_t index, const Case& change) const;                           // метод расчета варианта и его загрузки
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами: компилирует схему (см. CompiledCircuit) и рассчитывает
+// базовый режим при текущих значениях элементов
+// при вырожденной системе или несовпадении количества уравнений и неизвестных
+// выбрасывает исключение std::runtime_error
+inline Contingency::Contingency(Circuit& circuit) :
+    circuit{ std::make_shared<const CompiledCircuit>(circuit) }
+{
+    initialize();
+}
+
+// конструктор с параметрами: базовый режим - номинальные значения скомпилированной схемы
+// принимает на вход: скомпилированную схему (может одновременно использоваться
+// другими объектами)
+inline Contingency::Contingency(std::shared_ptr<const CompiledCircuit> circuit) :
+    circuit{ std::move(circuit) }
+{
+    if (!this->circuit)
+    {
+        throw std::invalid_argument("Compiled circuit is not set");
+    }
+
+    initialize();
+}
+
+// геттер скомпилированной схемы
+inline const CompiledCircuit& Contingency::getCircuit() const
+{
+    return *circuit;
+}
+
+// геттер токов ветвей в базовом режиме
+inline const DoubleVect& Contingency::getBaseCurrents() const
+{
+    return baseCurrents;
+}
+
+// метод задания допустимых токов ветвей (по модулю), по которым считается загрузка;
+// пока допустимые токи не заданы, загрузка считается относительно базовых токов
+// (ветви с нулевым допустимым током в загрузке не учитываются)
+// принимает на вход: допустимые токи по номерам ветвей (пустой вектор - базовые токи)
+// при несовпадении размера с количеством ветвей выбрасывает исключение
+// std::invalid_argument
+inline void Contingency::setLimits(const DoubleVect& limits)
+{
+    if (!limits.empty() && limits.size() != circuit->getBranchCount())
+    {
+        throw std::invalid_argument("Limit count does not match branch count");
+    }
+
+    this->limits = limits;
+}
+
+// метод получения вариантов с обрывом (бесконечным значением) каждого сопротивления
+inline std::vector<Contingency::Case> Contingency::getOutages() const
+{
+    return getResistorCases(std::numeric_limits<double>::infinity());
+}
+
+// метод получения вариантов с закорачиванием (нулевым значением) каждого сопротивления
+inline std::vector<Contingency::Case> Contingency::getShorts() const
+{
+    return getResistorCases(0.0);
+}
+
+// метод расчета токов всех ветвей в варианте (остальные элементы сохраняют
+// базовые значения)
+// принимает на вход:
+// 1) вариант (для источников - конечное значение)
+// 2) переменная для исхода варианта
+// возвращает вектор токов ветвей (при Status::Infeasible - NaN)
+// при неверном номере элемента выбрасывает исключение std::invalid_argument
+inline DoubleVect Contingency::solve(const Case& change, Status& status) const
+{
+    if (change.element >= circuit->getElementCount())
+    {
+        throw std::invalid_argument("Invalid element index: " + std::to_string(change.element));
+    }
+
+    const SparseLUSolver& solver = circuit->getSolver();
+    const DoubleVect& nominalValues = circuit->getNominalValues();
+    DoubleVect infeasible(circuit->getBranchCount(), std::numeric_limits<double>::quiet_NaN());
+
+    RankOneUpdate update;
+    circuit->getRankOneUpdate(change.element, nominalValues, change.value, update);
+
+    DoubleVect solution = baseSolution;                                                 // y = x + A^-1 * db
+    status = Status::Solved;
+
+    if (!update.rightChange.empty())
+    {
+        solver.solve(update.rightChange);
+
+        for (size_t i = 0; i < solution.size(); i++)
+        {
+            solution[i] += update.rightChange[i];
+        }
+    }
+
+    bool infinite = std::isinf(update.scale);
+    double flow = 0.0;                                                                  // f = scale * (v^T * x' + c)
+
+    if (update.scale != 0.0 && !update.column.empty())
+    {
+        DoubleVect& column = update.column;                                             // z = A^-1 * u
+        solver.solve(column);
+
+        double product = 0.0;                                                           // v^T * z
+        double voltage = update.offset;                                                 // v^T * y + c
+        double weightSum = 0.0;
+        double columnScale = 0.0;
+        double solutionScale = 0.0;
+
+        for (size_t k = 0; k < update.rows.size(); k++)
+        {
+            product += update.weights[k] * column[update.rows[k]];
+            voltage += update.weights[k] * solution[update.rows[k]];
+            weightSum += std::fabs(update.weights[k]);
+        }
+
+        for (size_t i = 0; i < column.size(); i++)
+        {
+            columnScale = std::max(columnScale, std::fabs(column[i]));
+            solutionScale = std::max(solutionScale, std::fabs(solution[i]));
+        }
+
+        double denominator = infinite ? product : 1.0 + update.scale * product;
+        double magnitude = infinite ? weightSum * columnScale : 1.0 + std::fabs(update.scale * product);
+
+        if (std::fabs(denominator) <= TOLERANCE * magnitude)                            // изменение разделяет схему
+        {
+            bool balanced = std::fabs(voltage) <= TOLERANCE * (weightSum * solutionScale + std::fabs(update.offset));
+
+            if (!balanced || (infinite && update.branch != RankOneUpdate::NONE))        // ток через сечение или закорачивание без
+            {                                                                           // определенного тока - решения нет
+                status = Status::Infeasible;
+                return infeasible;
+            }
+
+            status = Status::Islanded;                                                  // отделенная часть "повисает": f = 0
+        }
+        else
+        {
+            flow = infinite ? voltage / product : update.scale * voltage / denominator;
+
+            for (size_t i = 0; i < solution.size(); i++)
+            {
+                solution[i] -= flow * column[i];
+            }
+        }
+    }
+    else if (infinite && update.branch != RankOneUpdate::NONE)                          // закорачивание ветви, замкнутой на узел
+    {
+        status = Status::Infeasible;
+        return infeasible;
+    }
+
+    DoubleVect values = nominalValues;
+    values[change.element] = change.value;
+
+    DoubleVect currents = circuit->getBranchCurrents(solution, values, circuit->getSourceValues(values));
+
+    if (infinite && update.branch != RankOneUpdate::NONE)                               // ток закороченной ветви (бесконечная проводимость) -
+    {                                                                                   // предел G' * (v^T * x' + c)
+        currents[update.branch] = flow;
+    }
+
+    return currents;
+}
+
+// метод параллельного расчета вариантов и составления отчета
+// принимает на вход:
+// 1) варианты
+// 2) пул потоков
+// 3) количество вариантов в одной порции работы потока
+// при неверных номерах элементов выбрасывает исключение std::invalid_argument
+inline Contingency::Report Contingency::run(const std::vector<Case>& cases, ThreadPool& pool,
+                                            size_t grain) const
+{
+    for (const Case& change : cases)
+    {
+        if (change.element >= circuit->getElementCount())
+        {
+            throw std::invalid_argument("Invalid element index: " + std::to_string(change.element));
+        }
+    }
+
+    Report report;
+    report.outcomes = std::vector<Outcome>(cases.size());
+
+    pool.parallelFor(cases.size(), grain, [&](size_t, size_t first, size_t last)         // варианты не зависят друг от друга, итог каждого -
+    {                                                                                   // в своей позиции отчета
+        for (size_t i = first; i < last; i++)
+        {
+            report.outcomes[i] = evaluate(i, cases[i]);
+        }
+    });
+
+    std::stable_sort(report.outcomes.begin(), report.outcomes.end(),
+                     [](const Outcome& a, const Outcome& b) { return a.loading > b.loading; });
+
+    for (const Outcome& outcome : report.outcomes)
+    {
+        report.overloadCount += outcome.loading > 1.0;
+    }
+
+    return report;
+}
+
+// метод расчета базового режима: решение системы и токи ветвей при номинальных
+// значениях (разложение уже выполнено при компиляции схемы)
+inline void Contingency::initialize()
+{
+    const DoubleVect& nominalValues = circuit->getNominalValues();
+    DoubleVect sourceValues = circuit->getSourceValues(nominalValues);
+
+    circuit->evaluateRight(nominalValues, sourceValues, baseSolution);
+    circuit->getSolver().solve(baseSolution);
+    baseCurrents = circuit->getBranchCurrents(baseSolution, nominalValues, sourceValues);
+}
+
+// метод получения вариантов с заданным значением для каждого сопротивления схемы
+// принимает на вход: новое значение
+inline std::vector<Contingency::Case> Contingency::getResistorCases(double value) const
+{
+    std::vector<Case> cases;
+
+    for (size_t i = 0; i < circuit->getElementCount(); i++)
+    {
+        if (circuit->getElementType(i) == Element::Type::R)
+        {
+            cases.push_back({ i, value });
+        }
+    }
+
+    return cases;
+}
+
+// метод расчета варианта и поиска наиболее загруженной ветви
+// (вариант без решения получает бесконечную загрузку)
+// принимает на вход:
+// 1) номер варианта
+// 2) вариант
+inline Contingency::Outcome Contingency::evaluate(size_t index, const Case& change) const
+{
+    Outcome outcome;
+    outcome.index = index;
+    outcome.change = change;
+
+    DoubleVect currents = solve(change, outcome.status);
+
+    if (outcome.status == Status::Infeasible)
+    {
+        outcome.current = std::numeric_limits<double>::quiet_NaN();
+        outcome.loading = std::numeric_limits<double>::infinity();
+        return outcome;
+    }
+
+    double baseScale = 0.0;                                                             // малые базовые токи - погрешность, а не допустимый ток
+
+    for (double current : baseCurrents)
+    {
+        baseScale = std::max(baseScale, std::fabs(current));
+    }
+
+    for (size_t b = 0; b < currents.size(); b++)
+    {
+        double limit = limits.empty() ? std::fabs(baseCurrents[b]) : std::fabs(limits[b]);
+
+        if (limit == 0.0 || (limits.empty() && limit <= TOLERANCE * baseScale))
+        {
+            continue;
+        }
+
+        double loading = std::fabs(currents[b]) / limit;
+
+        if (outcome.branch == RankOneUpdate::NONE || loading > outcome.loading)
+        {
+            outcome.branch = b;
+            outcome.current = currents[b];
+            outcome.loading = loading;
+        }
+    }
+
+    return outcome;
+}
+
+// перегрузка оператора вывода отчета в поток: по строке на вариант в порядке
+// убывания загрузки
+inline std::ostream& operator<<(std::ostream& os, const Contingency::Report& report)
+{
+    using namespace std;
+
+    os << "Анализ отключений (вариантов: " << report.outcomes.size()
+       << ", с перегрузкой: " << report.overloadCount << "):\n\n";
+
+    os << "вариант   элемент      значение   ветвь           ток    загрузка   исход\n";
+
+    for (const Contingency::Outcome& outcome : report.outcomes)
+    {
+        const char* status = outcome.status == Contingency::Status::Solved ? "решен" :
+                             outcome.status == Contingency::Status::Islanded ? "отделение" : "нет решения";
+
+        os << setw(7) << outcome.index << setw(10) << outcome.change.element
+           << setw(14) << outcome.change.value;
+
+        if (outcome.branch == RankOneUpdate::NONE)
+        {
+            os << setw(8) << '-' << setw(14) << '-';
+        }
+        else
+        {
+            os << setw(8) << outcome.branch << setw(14) << outcome.current;
+        }
+
+        os << setw(12) << outcome.loading << "   " << status << '\n';                 // название исхода - последним (ширина кириллицы в
+    }                                                                                   // байтах не совпадает с шириной на экране)
+
+    return os;
+}
+
+} // namespace CS
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "circuit-solver/common.h"
+
+// замеры этапов расчета включаются макросом CS_PROFILING (например, опцией CMake
+// CIRCUIT_SOLVER_PROFILING); без него макрос CS_PROFILE_SCOPE пуст, а схема не хранит
+// замеров, так что замеры не стоят ничего
+// выделения памяти считаются, только если в одной единице трансляции программы перед
+// подключением библиотеки определен еще и CS_PROFILING_ALLOCATIONS: в ней глобальные
+// operator new и operator delete заменяются считающими (поддерживаются платформы с
+// malloc_usable_size или malloc_size); при сборке через CMake такая единица - это
+// src/allocation_counter.cpp, подключаемая ко всем программам опцией профилирования
+#if defined(CS_PROFILING)
+#define CS_PROFILE_CONCAT_IMPL(first, second) first##second
+#define CS_PROFILE_CONCAT(first, second) CS_PROFILE_CONCAT_IMPL(first, second)
+#define CS_PROFILE_SCOPE(profiler, name) \
+    ::CS::ProfileScope CS_PROFILE_CONCAT(profileScope, __LINE__)((profiler), (name))
+#else
+#define CS_PROFILE_SCOPE(profiler, name)
+#endif
+
+namespace CS
+{
+// класс для счетчиков выделения памяти всей программы (всеми потоками): сколько
+// байт выделено всего, сколько занято сейчас и наибольшее занятое с последнего
+// сброса; счетчики изменяет замененный operator new (см. CS_PROFILING_ALLOCATIONS)
+//////////////////////////////////////////////////////////////////////////////////////////
+class AllocationCounter
+{
+public:
+    static void allocate(size_t size);                                                  // метод учета выделения
+    static void release(size_t size);                                                   // метод учета освобождения
+    static size_t getAllocated();                                                       // геттер количества выделенных байт (всего)
+    static size_t getCurrent();                                                         // геттер количества занятых байт
+    static size_t getPeak();                                                            // геттер наибольшего количества занятых байт
+    static size_t resetPeak();                                                          // метод сброса наибольшего количества к текущему
+    static void restorePeak(size_t peak);                                               // метод восстановления наибольшего количества после сброса
+
+private:
+    static inline std::atomic<size_t> allocated{ 0 };                                   // выделено байт всего
+    static inline std::atomic<size_t> current{ 0 };                                     // занято байт сейчас
+    static inline std::atomic<size_t> peak{ 0 };                                        // наибольшее занятое с последнего сброса
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// класс для замеров этапов расчета схемы: для каждого этапа - количество
+// выполнений, суммарное время, выделенные байты и наибольший прирост занятой памяти,
+// а также последовательность выполнений (для трассы Chrome) и размеры структур
+// последнего обновления схемы
+// выделенные байты включают выделения всех потоков программы за время этапа
+//////////////////////////////////////////////////////////////////////////////////////////
+class Profiler
+{
+public:
+    static constexpr size_t MAX_EVENTS = 1 << 16;                                       // наибольшее количество хранимых выполнений этапов
+
+    struct Stage                                                                        // итоги этапа
+    {
+        std::string name;                                                               // название этапа
+        size_t calls = 0;                                                               // количество выполнений
+        double seconds = 0.0;                                                           // суммарное время (с)
+        size_t allocated = 0;                                                           // выделено байт за все выполнения
+        size_t peak = 0;                                                                // наибольший прирост занятой памяти за выполнение
+    };
+
+    struct Event                                                                        // одно выполнение этапа
+    {
+        const char* name = nullptr;                                                     // название этапа
+        size_t depth = 0;                                                               // вложенность в другие этапы
+        double start = 0.0;                                                             // начало от создания объекта (с)
+        double seconds = 0.0;                                                           // длительность (с)
+        size_t allocated = 0;                                                           // выделено байт
+        size_t peak = 0;                                                                // наибольший прирост занятой памяти
+    };
+
+    struct Counts                                                                       // размеры структур после обновления схемы
+    {
+        size_t pins = 0;                                                                // количество пинов
+        size_t nodes = 0;                                                               // количество узлов
+        size_t branches = 0;                                                            // количество ветвей
+        size_t loops = 0;                                                               // количество контуров
+        size_t nonZeros = 0;                                                            // коэффициентов левой части системы
+        SizeVect loopLengths;                                                           // количество контуров по числу ветвей в них
+    };
+
+    const std::vector<Stage>& getStages() const;                                        // геттер итогов этапов (в порядке первого завершения)
+    const Stage* getStage(const std::string& name) const;                               // геттер итогов этапа по названию (или nullptr)
+    const std::vector<Event>& getEvents() const;                                        // геттер выполнений этапов
+    size_t getDroppedEventCount() const;                                                // геттер количества не сохраненных выполнений
+    const Counts& getCounts() const;                                                    // геттер размеров структур
+    void setCounts(Counts counts);                                                      // сеттер размеров структур
+    void clear();                                                                       // метод очистки замеров
+    std::string toJson() const;                                                         // метод вывода замеров в JSON
+    std::string toChromeTrace() const;                                                  // метод вывода выполнений в формате трассы Chrome
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point origin = Clock::now();                                            // начало отсчета времени выполнений
+    std::vector<Stage> stages;                                                          // итоги этапов
+    std::vector<Event> events;                                                          // выполнения этапов
+    size_t droppedEventCount = 0;                                                       // выполнения сверх MAX_EVENTS
+    size_t depth = 0;                                                                   // текущая вложенность этапов
+    Counts counts;                                                                      // размеры структур
+
+    void record(const Event& event);                                                    // метод учета выполнения этапа
+
+    friend class ProfileScope;
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// класс для замера одного выполнения этапа: замер идет от создания объекта до его
+// уничтожения (в том числе при исключении)
+//////////////////////////////////////////////////////////////////////////////////////////
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const char* name);                                 // конструктор с параметрами
+    ~ProfileScope();                                                                    // деструктор (учитывает выполнение)
+    ProfileScope(const ProfileScope&) = delete;                                         // замер не копируется
+    ProfileScope& operator=(const ProfileScope&) = delete;                              //
+
+private:
+    Profiler& profiler;                                                                 // объект для замеров
+    Profiler::Event event;                                                              // замеряемое выполнение
+    Profiler::Clock::time_point start;                                                  // время начала
+    size_t allocated;                                                                   // выделено байт к началу
+    size_t current;                                                                     // занято байт к началу
+    size_t outerPeak;                                                                   // наибольшее занятое до сброса в начале
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод учета выделения памяти
+// принимает на вход: размер выделенного блока в байтах
+inline void AllocationCounter::allocate(size_t size)
+{
+    allocated.fetch_add(size, std::memory_order_relaxed);
+    size_t now = current.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t known = peak.load(std::memory_order_relaxed);
+
+    while (now > known && !peak.compare_exchange_weak(known, now, std::memory_order_relaxed))
+    {
+    }
+}
+
+// метод учета освобождения памяти
+// принимает на вход: размер освобожденного блока в байтах
+inline void AllocationCounter::release(size_t size)
+{
+    current.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// геттер количества байт, выделенных за все время работы программы
+inline size_t AllocationCounter::getAllocated()
+{
+    return allocated.load(std::memory_order_relaxed);
+}
+
+// геттер количества занятых байт
+inline size_t AllocationCounter::getCurrent()
+{
+    return current.load(std::memory_order_relaxed);
+}
+
+// геттер наибольшего количества занятых байт с последнего сброса
+inline size_t AllocationCounter::getPeak()
+{
+    return peak.load(std::memory_order_relaxed);
+}
+
+// метод сброса наибольшего количества занятых байт к текущему (в начале этапа)
+// возвращает наибольшее количество до сброса (для restorePeak)
+inline size_t AllocationCounter::resetPeak()
+{
+    return peak.exchange(current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// метод восстановления наибольшего количества после сброса (в конце этапа): так
+// вложенный этап не скрывает от внешнего наибольшее занятое до его начала
+// принимает на вход: значение, возвращенное resetPeak
+inline void AllocationCounter::restorePeak(size_t outer)
+{
+    size_t known = peak.load(std::memory_order_relaxed);
+
+    while (outer > known && !peak.compare_exchange_weak(known, outer, std::memory_order_relaxed))
+    {
+    }
+}
+
+// геттер итогов этапов в порядке их первого завершения (вложенные этапы - раньше
+// внешних)
+inline const std::vector<Profiler::Stage>& Profiler::getStages() const
+{
+    return stages;
+}
+
+// геттер итогов этапа по названию
+// принимает на вход: название этапа
+// возвращает nullptr, если этап не выполнялся
+inline const Profiler::Stage* Profiler::getStage(const std::string& name) const
+{
+    for (const Stage& stage : stages)
+    {
+        if (stage.name == name)
+        {
+            return &stage;
+        }
+    }
+
+    return nullptr;
+}
+
+// геттер выполнений этапов в порядке их завершения (не больше MAX_EVENTS первых)
+inline const std::vector<Profiler::Event>& Profiler::getEvents() const
+{
+    return events;
+}
+
+// геттер количества выполнений, не сохраненных сверх MAX_EVENTS (в итогах этапов
+// они учтены)
+inline size_t Profiler::getDroppedEventCount() const
+{
+    return droppedEventCount;
+}
+
+// геттер размеров структур после последнего обновления схемы
+inline const Profiler::Counts& Profiler::getCounts() const
+{
+    return counts;
+}
+
+// сеттер размеров структур
+// принимает на вход: размеры структур
+inline void Profiler::setCounts(Counts counts)
+{
+    this->counts = std::move(counts);
+}
+
+// метод очистки замеров (размеры структур сохраняются)
+inline void Profiler::clear()
+{
+    stages.clear();
+    events.clear();
+    droppedEventCount = 0;
+    origin = Clock::now();
+}
+
+// метод вывода итогов этапов и размеров структур в JSON:
+// {"stages": [{"name", "calls", "seconds", "allocated", "peak"}, ...],
+//  "counts": {"pins", "nodes", "branches", "loops", "nonzeros",
+//             "loop_lengths": [{"length", "count"}, ...]}}
+inline std::string Profiler::toJson() const
+{
+    std::ostringstream os;
+    os << std::setprecision(9) << "{\n  \"stages\": [";
+
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const Stage& stage = stages[i];
+        os << (i ? "," : "") << "\n    {\"name\": \"" << stage.name << "\", \"calls\": " << stage.calls
+           << ", \"seconds\": " << stage.seconds << ", \"allocated\": " << stage.allocated
+           << ", \"peak\": " << stage.peak << "}";
+    }
+
+    os << "\n  ],\n  \"counts\": {\"pins\": " << counts.pins << ", \"nodes\": " << counts.nodes
+       << ", \"branches\": " << counts.branches << ", \"loops\": " << counts.loops
+       << ", \"nonzeros\": " << counts.nonZeros << ", \"loop_lengths\": [";
+
+    bool first = true;
+
+    for (size_t length = 0; length < counts.loopLengths.size(); length++)
+    {
+        if (counts.loopLengths[length])
+        {
+            os << (first ? "" : ", ") << "{\"length\": " << length << ", \"count\": "
+               << counts.loopLengths[length] << "}";
+            first = false;
+        }
+    }
+
+    os << "]}\n}\n";
+
+    return os.str();
+}
+
+// метод вывода выполнений этапов в формате трассы Chrome (chrome://tracing, Perfetto):
+// выполнения - события "X" с выделенными байтами в args, размеры структур -
+// событие счетчиков "C" в конце трассы
+inline std::string Profiler::toChromeTrace() const
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+    double end = 0.0;
+
+    for (const Event& event : events)
+    {
+        os << "\n  {\"name\": \"" << event.name << "\", \"cat\": \"circuit\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+           << ", \"ts\": " << event.start * 1e6 << ", \"dur\": " << event.seconds * 1e6
+           << ", \"args\": {\"allocated\": " << event.allocated << ", \"peak\": " << event.peak << "}},";
+        end = std::max(end, event.start + event.seconds);
+    }
+
+    os << "\n  {\"name\": \"structure\", \"cat\": \"circuit\", \"ph\": \"C\", \"pid\": 1, \"tid\": 1"
+       << ", \"ts\": " << end * 1e6 << ", \"args\": {\"pins\": " << counts.pins
+       << ", \"nodes\": " << counts.nodes << ", \"branches\": " << counts.branches
+       << ", \"loops\": " << counts.loops << ", \"nonzeros\": " << counts.nonZeros << "}}"
+       << "\n], \"displayTimeUnit\": \"ms\"}\n";
+
+    return os.str();
+}
+
+// метод учета выполнения этапа в итогах и в последовательности выполнений
+// принимает на вход: выполнение этапа
+inline void Profiler::record(const Event& event)
+{
+    auto stage = std::find_if(stages.begin(), stages.end(),
+                              [&](const Stage& stage) { return stage.name == event.name; });
+
+    if (stage == stages.end())
+    {
+        stages.push_back(Stage{ event.name });
+        stage = stages.end() - 1;
+    }
+
+    stage->calls++;
+    stage->seconds += event.seconds;
+    stage->allocated += event.allocated;
+    stage->peak = std::max(stage->peak, event.peak);
+
+    if (events.size() < MAX_EVENTS)
+    {
+        events.push_back(event);
+    }
+    else
+    {
+        droppedEventCount++;
+    }
+}
+
+// конструктор с параметрами: начинает замер
+// принимает на вход:
+// 1) объект для замеров
+// 2) название этапа (строка должна существовать, пока существуют замеры)
+inline ProfileScope::ProfileScope(Profiler& profiler, const char* name) :
+    profiler{ profiler }
+{
+    event.name = name;
+    event.depth = profiler.depth++;
+    allocated = AllocationCounter::getAllocated();
+    current = AllocationCounter::getCurrent();
+    outerPeak = AllocationCounter::resetPeak();
+    start = Profiler::Clock::now();
+}
+
+// деструктор: заканчивает замер и учитывает выполнение
+inline ProfileScope::~ProfileScope()
+{
+    Profiler::Clock::time_point finish = Profiler::Clock::now();
+    event.start = std::chrono::duration<double>(start - profiler.origin).count();
+    event.seconds = std::chrono::duration<double>(finish - start).count();
+    event.allocated = AllocationCounter::getAllocated() - allocated;
+    event.peak = AllocationCounter::getPeak() - std::min(current, AllocationCounter::getPeak());
+    AllocationCounter::restorePeak(outerPeak);
+    profiler.depth--;
+
+    try
+    {
+        profiler.record(event);
+    }
+    catch (const std::bad_alloc&)                                                       // замер не должен прерывать расчет
+    {
+    }
+}
+
+} // namespace CS
+
+#if defined(CS_PROFILING) && defined(CS_PROFILING_ALLOCATIONS)
+// считающие замены глобальных operator new и operator delete (определяются в одной
+// единице трансляции): все варианты (обычные, с размером, nothrow, с выравниванием)
+// выделяют память malloc или posix_memalign и освобождают free, а размер блока
+// и при выделении, и при освобождении берется у распределителя памяти
+// (malloc_usable_size), поэтому указатели не смещаются и перед блоком ничего не
+// хранится; считается полный размер блока вместе с запасом распределителя
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__unix__)
+#include <malloc.h>
+#else
+#error "CS_PROFILING_ALLOCATIONS requires malloc_usable_size or malloc_size"
+#endif
+
+namespace CS
+{
+// функция получения размера блока, выделенного malloc или posix_memalign
+inline size_t getAllocationSize(void* pointer)
+{
+#if defined(__APPLE__)
+    return malloc_size(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+}
+
+// функция выделения блока с учетом в AllocationCounter
+// принимает на вход:
+// 1) размер блока в байтах
+// 2) выравнивание (0 - выравнивание malloc)
+// возвращает nullptr, если памяти нет
+inline void* allocateCounted(size_t size, size_t alignment)
+{
+    void* pointer = nullptr;
+
+    if (!alignment)
+    {
+        pointer = std::malloc(size ? size : 1);
+    }
+    else if (posix_memalign(&pointer, std::max(alignment, sizeof(void*)), size ? size : 1))
+    {
+        pointer = nullptr;
+    }
+
+    if (pointer)
+    {
+        AllocationCounter::allocate(getAllocationSize(pointer));
+    }
+
+    return pointer;
+}
+
+// функция выделения блока с учетом в AllocationCounter (для operator new)
+// при нехватке памяти выбрасывает исключение std::bad_alloc
+inline void* allocateCountedOrThrow(size_t size, size_t alignment)
+{
+    void* pointer = allocateCounted(size, alignment);
+
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+// функция освобождения блока, выделенного allocateCounted, с учетом в AllocationCounter
+inline void releaseCounted(void* pointer) noexcept
+{
+    if (pointer)
+    {
+        AllocationCounter::release(getAllocationSize(pointer));
+        std::free(pointer);
+    }
+}
+} // namespace CS
+
+void* operator new(std::size_t size) { return CS::allocateCountedOrThrow(size, 0); }
+void* operator new[](std::size_t size) { return CS::allocateCountedOrThrow(size, 0); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CS::allocateCounted(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CS::allocateCounted(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return CS::allocateCountedOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return CS::allocateCountedOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CS::allocateCounted(size, static_cast<size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CS::allocateCounted(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer) noexcept { CS::releaseCounted(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { CS::releaseCounted(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { CS::releaseCounted(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CS::releaseCounted(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CS::releaseCounted(pointer); }
+#endif
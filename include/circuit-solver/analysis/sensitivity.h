@@ -0,0 +1,235 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/compiled_circuit.h"
+#include "circuit-solver/solve_context.h"
+
+namespace CS
+{
+// класс для анализа чувствительности: производные токов выбранных ветвей по значениям
+// выбранных элементов (сопротивлений и источников) при текущих значениях
+// система left(p) * x = right(p) дифференцируется по параметру p:
+// dx/dp = left^-1 * r(p), где r(p) = d(right - left * x) / dp при неизменном x;
+// коэффициент системы - знак, умноженный на значение по индексу (или единица), поэтому
+// d(left)/dp и d(right)/dp берутся прямо по индексам значений и знакам коэффициентов
+// используется уже готовое разложение левой части, а производные считаются одним из
+// двух способов:
+// - прямым (Direct): по одному решению left * dx = r(p) на каждый параметр
+// - сопряженным (Adjoint): по одному решению left^T * adjoint = c на каждый ток, где
+//   c - производная тока по решению; тогда dI/dp = adjoint^T * r(p) + явная
+//   производная, и производные по всем параметрам получаются за один проход
+//   по коэффициентам
+// по умолчанию (Auto) выбирается способ с меньшим количеством решений
+//////////////////////////////////////////////////////////////////////////////////////////
+class Sensitivity
+{
+public:
+    enum class Method                                                                   // способ вычисления производных
+    {
+        Auto,                                                                           // по меньшему количеству решений
+        Direct,                                                                         // решение на каждый параметр
+        Adjoint                                                                         // решение транспонированной системы на каждый ток
+    };
+
+    struct Result                                                                       // матрица производных (якобиан)
+    {
+        SizeVect branches;                                                              // номера ветвей (строки)
+        SizeVect elements;                                                              // номера элементов (столбцы)
+        DoubleVect derivatives;                                                         // производные по строкам: dI[branches[i]] / dp[elements[j]]
+        DoubleVect currents;                                                            // токи всех ветвей, при которых вычислены производные
+        Method method = Method::Auto;                                                   // примененный способ
+
+        double operator() (size_t row, size_t column) const;                            // геттер производной тока строки row по параметру столбца column
+    };
+
+    explicit Sensitivity(Circuit& circuit);                                             // конструктор с параметрами (компилирует схему)
+    explicit Sensitivity(std::shared_ptr<const CompiledCircuit> circuit);               // конструктор с параметрами (по скомпилированной схеме)
+    SolveContext& getContext();                                                         // геттер контекста расчета (значения элементов)
+    Result compute(const SizeVect& branches, const SizeVect& elements,
+                   Method method = Method::Auto);                                       // метод вычисления производных
+
+private:
+    SolveContext context;                                                               // контекст расчета: значения элементов и разложение
+
+    void computeDirect(Result& result);                                                 // метод вычисления производных прямым способом
+    void computeAdjoint(Result& result);                                                // метод вычисления производных сопряженным способом
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// геттер производной тока ветви branches[row] по значению элемента elements[column]
+inline double Sensitivity::Result::operator()(size_t row, size_t column) const
+{
+    return derivatives[row * elements.size() + column];
+}
+
+// конструктор с параметрами: компилирует схему (см. CompiledCircuit), значения
+// элементов - текущие значения схемы
+// при вырожденной системе или несовпадении количества уравнений и неизвестных
+// выбрасывает исключение std::runtime_error
+inline Sensitivity::Sensitivity(Circuit& circuit) :
+    context{ std::make_shared<const CompiledCircuit>(circuit) } {}
+
+// конструктор с параметрами
+// принимает на вход: скомпилированную схему (может одновременно использоваться
+// другими объектами)
+inline Sensitivity::Sensitivity(std::shared_ptr<const CompiledCircuit> circuit) :
+    context{ std::move(circuit) } {}
+
+// геттер контекста расчета: через него задаются значения элементов, при которых
+// вычисляются производные
+inline SolveContext& Sensitivity::getContext()
+{
+    return context;
+}
+
+// метод вычисления производных токов выбранных ветвей по значениям выбранных элементов
+// при текущих значениях элементов контекста
+// принимает на вход:
+// 1) номера ветвей (в порядке списка ветвей, как в Circuit::solve)
+// 2) номера элементов-параметров
+// 3) способ вычисления
+// при неверных номерах выбрасывает исключение std::invalid_argument,
+// при вырожденной системе - std::runtime_error
+inline Sensitivity::Result Sensitivity::compute(const SizeVect& branches, const SizeVect& elements,
+                                                Method method)
+{
+    const CompiledCircuit& circuit = context.getCircuit();
+
+    for (size_t branch : branches)
+    {
+        if (branch >= circuit.getBranchCount())
+        {
+            throw std::invalid_argument("Invalid branch index: " + std::to_string(branch));
+        }
+    }
+
+    for (size_t element : elements)
+    {
+        if (element >= circuit.getElementCount())
+        {
+            throw std::invalid_argument("Invalid element index: " + std::to_string(element));
+        }
+    }
+
+    Result result;
+    result.branches = branches;
+    result.elements = elements;
+    result.derivatives = DoubleVect(branches.size() * elements.size(), 0.0);
+    result.currents = context.solve();                                                  // решение и разложение при текущих значениях
+
+    if (method == Method::Auto)                                                         // решений меньше при меньшем из количеств
+    {
+        method = branches.size() <= elements.size() ? Method::Adjoint : Method::Direct;
+    }
+
+    result.method = method;
+
+    if (method == Method::Adjoint)
+    {
+        computeAdjoint(result);
+    }
+    else
+    {
+        computeDirect(result);
+    }
+
+    return result;
+}
+
+// метод вычисления производных прямым способом: для каждого параметра решается
+// left * dx = r(p), затем производные токов собираются по их градиентам
+// принимает на вход: результат с номерами ветвей и элементов (заполняются производные)
+inline void Sensitivity::computeDirect(Result& result)
+{
+    const CompiledCircuit& circuit = context.getCircuit();
+    const DoubleVect& values = context.getValues();
+    const DoubleVect& solution = context.getSolution();
+    size_t columnCount = result.elements.size();
+
+    SizeMatr nonZeros(result.branches.size());                                          // ненулевые производные токов по решению
+    std::vector<DoubleVect> weights(result.branches.size());                            //
+    DoubleVect bySolution;
+    DoubleVect byElements;
+
+    for (size_t i = 0; i < result.branches.size(); i++)                                 // градиенты токов (явные производные - сразу в результат)
+    {
+        circuit.getCurrentGradient(result.branches[i], solution, values, bySolution, byElements);
+
+        for (size_t j = 0; j < columnCount; j++)
+        {
+            result.derivatives[i * columnCount + j] = byElements[result.elements[j]];
+        }
+
+        for (size_t k = 0; k < bySolution.size(); k++)
+        {
+            if (bySolution[k] != 0.0)
+            {
+                nonZeros[i].push_back(k);
+                weights[i].push_back(bySolution[k]);
+            }
+        }
+    }
+
+    DoubleVect residual;
+
+    for (size_t j = 0; j < columnCount; j++)                                            // по решению на каждый параметр
+    {
+        residual.assign(solution.size(), 0.0);
+        circuit.addElementResidual(result.elements[j], values, solution, residual);
+        context.getSolver().solve(residual);                                            // производная решения по параметру
+
+        for (size_t i = 0; i < result.branches.size(); i++)
+        {
+            for (size_t k = 0; k < nonZeros[i].size(); k++)
+            {
+                result.derivatives[i * columnCount + j] += weights[i][k] * residual[nonZeros[i][k]];
+            }
+        }
+    }
+}
+
+// метод вычисления производных сопряженным способом: для каждого тока решается
+// left^T * adjoint = c (c - производная тока по решению), после чего производные
+// по всем элементам получаются одним проходом по коэффициентам системы
+// (токи ветвей с источниками тока от решения не зависят - решение не требуется)
+// принимает на вход: результат с номерами ветвей и элементов (заполняются производные)
+inline void Sensitivity::computeAdjoint(Result& result)
+{
+    const CompiledCircuit& circuit = context.getCircuit();
+    const DoubleVect& values = context.getValues();
+    const DoubleVect& solution = context.getSolution();
+    size_t columnCount = result.elements.size();
+
+    DoubleVect adjoint;
+    DoubleVect derivatives;
+
+    for (size_t i = 0; i < result.branches.size(); i++)
+    {
+        circuit.getCurrentGradient(result.branches[i], solution, values, adjoint, derivatives);
+
+        bool dependent = false;                                                         // зависит ли ток от решения
+
+        for (double weight : adjoint)
+        {
+            dependent = dependent || weight != 0.0;
+        }
+
+        if (dependent)
+        {
+            context.getSolver().solveTransposed(adjoint);
+            circuit.addAdjointDerivatives(adjoint, values, solution, derivatives);
+        }
+
+        for (size_t j = 0; j < columnCount; j++)
+        {
+            result.derivatives[i * columnCount + j] = derivatives[result.elements[j]];
+        }
+    }
+}
+
+} // namespace CS
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/compiled_circuit.h"
+#include "circuit-solver/solve_context.h"
+#include "circuit-solver/analysis/thread_pool.h"
+
+namespace CS
+{
+// класс для многовариантного расчета схемы (разброс параметров методом Монте-Карло,
+// перебор значений параметров)
+// расчет ведется по скомпилированной схеме (CompiledCircuit), которая не изменяется,
+// поэтому варианты считаются параллельно: каждый поток пула создает свой контекст
+// расчета (SolveContext) и для каждого варианта выполняет только численное
+// разложение с прежней структурой, прямой и обратный ход
+// значения варьируемых параметров передаются по столбцам (structure of arrays):
+// значение параметра p в варианте s хранится в values[p * sampleCount + s]
+// результат также хранится по столбцам: ток ветви b в варианте s хранится
+// в currents[b * sampleCount + s]
+//////////////////////////////////////////////////////////////////////////////////////////
+class Sweep
+{
+public:
+    struct Result                                                                       // результат расчета вариантов
+    {
+        size_t sampleCount = 0;                                                         // количество вариантов
+        size_t branchCount = 0;                                                         // количество ветвей
+        DoubleVect currents;                                                            // токи ветвей по столбцам (ветвь за ветвью)
+        SizeVect failedSamples;                                                         // номера вариантов с вырожденной системой (токи - NaN)
+
+        double operator() (size_t sample, size_t branch) const;                         // геттер тока ветви в варианте
+        const double* column(size_t branch) const;                                      // геттер столбца токов ветви по всем вариантам
+    };
+
+    explicit Sweep(Circuit& circuit);                                                   // конструктор с параметрами (компилирует схему)
+    explicit Sweep(std::shared_ptr<const CompiledCircuit> circuit);                     // конструктор с параметрами (по скомпилированной схеме)
+    const CompiledCircuit& getCircuit() const;                                          // геттер скомпилированной схемы
+    Result run(const SizeVect& parameters, const DoubleVect& values,
+               ThreadPool& pool, size_t grain = 16) const;                              // метод параллельного расчета вариантов
+
+private:
+    struct Workspace                                                                    // рабочие данные одного потока
+    {
+        std::unique_ptr<SolveContext> context;                                          // контекст расчета (создается первой порцией потока)
+        SizeVect failedSamples;                                                         // варианты с вырожденной системой
+    };
+
+    std::shared_ptr<const CompiledCircuit> circuit;                                     // скомпилированная схема
+
+    void solveSample(SolveContext& context, const SizeVect& parameters,
+                     const DoubleVect& values, size_t sample,
+                     Result& result) const;                                             // метод расчета одного варианта
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// геттер тока ветви branch в варианте sample
+inline double Sweep::Result::operator()(size_t sample, size_t branch) const
+{
+    return currents[branch * sampleCount + sample];
+}
+
+// геттер столбца токов ветви по всем вариантам (sampleCount значений подряд)
+inline const double* Sweep::Result::column(size_t branch) const
+{
+    return currents.data() + branch * sampleCount;
+}
+
+// конструктор с параметрами: компилирует схему (см. CompiledCircuit)
+// при вырожденной системе или несовпадении количества уравнений и неизвестных
+// выбрасывает исключение std::runtime_error
+inline Sweep::Sweep(Circuit& circuit) :
+    circuit{ std::make_shared<const CompiledCircuit>(circuit) } {}
+
+// конструктор с параметрами
+// принимает на вход: скомпилированную схему (может одновременно использоваться
+// другими объектами)
+inline Sweep::Sweep(std::shared_ptr<const CompiledCircuit> circuit) :
+    circuit{ std::move(circuit) }
+{
+    if (!this->circuit)
+    {
+        throw std::invalid_argument("Compiled circuit is not set");
+    }
+}
+
+// геттер скомпилированной схемы
+inline const CompiledCircuit& Sweep::getCircuit() const
+{
+    return *circuit;
+}
+
+// метод параллельного расчета вариантов: в каждом варианте значения параметров
+// заменяют номинальные, остальные элементы сохраняют номинальные значения
+// если среди параметров нет сопротивлений, левая часть не меняется, и разложение
+// не повторяется - вариант считается прямым и обратным ходом (см. SolveContext)
+// вариант с вырожденной системой не прерывает расчет: его токи равны NaN, а номер
+// попадает в Result::failedSamples
+// принимает на вход:
+// 1) номера элементов-параметров
+// 2) значения параметров по столбцам (parameters.size() * количество вариантов)
+// 3) пул потоков
+// 4) количество вариантов в одной порции работы потока
+// при неверных номерах или размере массива значений выбрасывает исключение
+// std::invalid_argument
+inline Sweep::Result Sweep::run(const SizeVect& parameters, const DoubleVect& values,
+                                ThreadPool& pool, size_t grain) const
+{
+    if (parameters.empty() || values.size() % parameters.size())
+    {
+        throw std::invalid_argument("Sample values do not match parameter count");
+    }
+
+    for (size_t parameter : parameters)
+    {
+        if (parameter >= circuit->getElementCount())
+        {
+            throw std::invalid_argument("Invalid element index: " + std::to_string(parameter));
+        }
+    }
+
+    Result result;
+    result.sampleCount = values.size() / parameters.size();
+    result.branchCount = circuit->getBranchCount();
+    result.currents = DoubleVect(result.branchCount * result.sampleCount);
+
+    std::vector<Workspace> workspaces(pool.size());                                     // рабочие данные по номерам потоков
+
+    pool.parallelFor(result.sampleCount, grain, [&](size_t worker, size_t first, size_t last)
+    {
+        Workspace& workspace = workspaces[worker];
+
+        if (!workspace.context)                                                         // первая порция потока - создаем контекст
+        {
+            workspace.context = std::make_unique<SolveContext>(circuit);
+        }
+
+        for (size_t sample = first; sample < last; sample++)
+        {
+            try
+            {
+                solveSample(*workspace.context, parameters, values, sample, result);
+            }
+            catch (const std::runtime_error&)                                           // вырожденная система
+            {
+                workspace.failedSamples.push_back(sample);
+
+                for (size_t b = 0; b < result.branchCount; b++)
+                {
+                    result.currents[b * result.sampleCount + sample] = std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+        }
+    });
+
+    for (const Workspace& workspace : workspaces)                                       // собираем номера вырожденных вариантов
+    {
+        result.failedSamples.insert(result.failedSamples.end(),
+                                    workspace.failedSamples.begin(), workspace.failedSamples.end());
+    }
+
+    std::sort(result.failedSamples.begin(), result.failedSamples.end());
+
+    return result;
+}
+
+// метод расчета одного варианта
+// принимает на вход:
+// 1) контекст расчета потока
+// 2) номера элементов-параметров
+// 3) значения параметров по столбцам
+// 4) номер варианта
+// 5) результат, в столбцы которого записываются токи ветвей варианта
+// при вырожденной системе выбрасывает исключение std::runtime_error
+inline void Sweep::solveSample(SolveContext& context, const SizeVect& parameters,
+                               const DoubleVect& values, size_t sample,
+                               Result& result) const
+{
+    size_t sampleCount = result.sampleCount;
+
+    for (size_t p = 0; p < parameters.size(); p++)                                      // подставляем значения параметров варианта
+    {
+        context.setElementValue(parameters[p], values[p * sampleCount + sample]);
+    }
+
+    DoubleVect currents = context.solve();
+
+    for (size_t b = 0; b < currents.size(); b++)
+    {
+        result.currents[b * sampleCount + sample] = currents[b];
+    }
+}
+
+} // namespace CS
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CS
+{
+// класс для представления пула потоков с перехватом работы (work stealing)
+// пул выполняет параллельные циклы по диапазону индексов: диапазон делится поровну
+// между потоками, каждый поток берет индексы из начала своей части порциями
+// заданного размера, а закончив свою часть, забирает половину оставшейся части
+// другого потока; так нагрузка выравнивается, даже если итерации неравноценны
+// вызывающий поток участвует в работе как поток с номером 0
+// номер потока передается в тело цикла, чтобы каждый поток пользовался своими
+// рабочими буферами без синхронизации
+//////////////////////////////////////////////////////////////////////////////////////////
+class ThreadPool
+{
+public:
+    using Body = std::function<void(size_t worker, size_t first, size_t last)>;         // тело цикла: номер потока и порция индексов [first, last)
+
+    explicit ThreadPool(size_t threadCount = 0);                                        // конструктор с параметрами (0 - по числу ядер)
+    ~ThreadPool();                                                                      // деструктор (останавливает потоки)
+    ThreadPool(const ThreadPool&) = delete;                                             // пул не копируется
+    ThreadPool& operator=(const ThreadPool&) = delete;                                  //
+    size_t size() const;                                                                // геттер количества потоков (с вызывающим)
+    void parallelFor(size_t count, size_t grain, const Body& body);                     // метод параллельного выполнения цикла
+
+private:
+    struct Range                                                                        // оставшаяся часть диапазона потока
+    {
+        std::mutex mutex;                                                               // защищает границы части
+        size_t first = 0;                                                               // первый невыполненный индекс
+        size_t last = 0;                                                                // индекс за последним
+    };
+
+    std::vector<std::thread> threads;                                                   // рабочие потоки (без вызывающего)
+    std::vector<std::unique_ptr<Range>> ranges;                                         // части диапазона по номерам потоков
+    std::mutex mutex;                                                                   // защищает состояние задания
+    std::condition_variable started;                                                    // сигнал о новом задании (или остановке)
+    std::condition_variable finished;                                                   // сигнал о завершении работы потоками
+    const Body* body = nullptr;                                                         // тело текущего цикла
+    size_t grain = 1;                                                                   // размер порции индексов
+    size_t generation = 0;                                                              // номер текущего задания
+    size_t activeCount = 0;                                                             // количество потоков, еще не закончивших задание
+    bool stopping = false;                                                              // признак остановки пула
+    std::atomic<bool> failed{ false };                                                  // признак исключения в теле цикла
+    std::exception_ptr error;                                                           // первое исключение из тела цикла
+
+    void loop(size_t worker);                                                           // метод ожидания и выполнения заданий рабочим потоком
+    void run(size_t worker);                                                            // метод выполнения порций текущего задания
+    bool take(size_t worker, size_t& first, size_t& last);                              // метод получения порции из своей части
+    bool steal(size_t worker);                                                          // метод перехвата половины части другого потока
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами
+// принимает на вход: количество потоков вместе с вызывающим (0 - по количеству
+// аппаратных потоков)
+inline ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (!threadCount)
+    {
+        threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        ranges.push_back(std::make_unique<Range>());
+    }
+
+    for (size_t i = 1; i < threadCount; i++)                                            // поток 0 - вызывающий
+    {
+        threads.emplace_back(&ThreadPool::loop, this, i);
+    }
+}
+
+// деструктор: останавливает рабочие потоки и дожидается их завершения
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    started.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// геттер количества потоков (вместе с вызывающим)
+inline size_t ThreadPool::size() const
+{
+    return ranges.size();
+}
+
+// метод параллельного выполнения цикла по индексам [0, count): тело вызывается
+// для порций не больше grain индексов, каждая порция выполняется ровно один раз
+// метод возвращает управление, когда все потоки закончили работу; если тело цикла
+// выбросило исключение, оставшиеся порции пропускаются, а первое исключение
+// выбрасывается повторно в вызывающем потоке
+// принимает на вход:
+// 1) количество индексов
+// 2) размер порции (0 воспринимается как 1)
+// 3) тело цикла
+inline void ThreadPool::parallelFor(size_t count, size_t grain, const Body& body)
+{
+    if (!count)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (size_t i = 0; i < size(); i++)                                             // делим диапазон поровну
+        {
+            std::lock_guard<std::mutex> rangeLock(ranges[i]->mutex);
+            ranges[i]->first = count * i / size();
+            ranges[i]->last = count * (i + 1) / size();
+        }
+
+        this->body = &body;
+        this->grain = std::max<size_t>(grain, 1);
+        failed = false;
+        error = nullptr;
+        activeCount = threads.size();
+        generation++;
+    }
+
+    started.notify_all();
+    run(0);                                                                             // вызывающий поток работает наравне с остальными
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return activeCount == 0; });
+    this->body = nullptr;
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// метод ожидания и выполнения заданий рабочим потоком
+// принимает на вход: номер потока
+inline void ThreadPool::loop(size_t worker)
+{
+    size_t seen = 0;                                                                    // номер последнего выполненного задания
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&] { return stopping || generation != seen; });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            seen = generation;
+        }
+
+        run(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (--activeCount == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+// метод выполнения порций текущего задания: сначала из своей части, затем -
+// перехваченных у других потоков; завершается, когда перехватывать нечего
+// принимает на вход: номер потока
+inline void ThreadPool::run(size_t worker)
+{
+    size_t first = 0;
+    size_t last = 0;
+
+    while (take(worker, first, last) || (steal(worker) && take(worker, first, last)))
+    {
+        if (failed)                                                                     // после исключения порции только выбираются
+        {
+            continue;
+        }
+
+        try
+        {
+            (*body)(worker, first, last);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+
+            failed = true;
+        }
+    }
+}
+
+// метод получения порции из начала своей части диапазона
+// принимает на вход:
+// 1) номер потока
+// 2) переменные для границ порции
+// возвращает false, если своя часть пуста
+inline bool ThreadPool::take(size_t worker, size_t& first, size_t& last)
+{
+    Range& range = *ranges[worker];
+    std::lock_guard<std::mutex> lock(range.mutex);
+
+    if (range.first == range.last)
+    {
+        return false;
+    }
+
+    first = range.first;
+    last = std::min(range.last, range.first + grain);
+    range.first = last;
+
+    return true;
+}
+
+// метод перехвата работы: у первого (по кругу от своего номера) потока с непустой
+// частью забирается ее вторая половина (или вся часть, если она не больше порции),
+// которая становится своей частью потока
+// принимает на вход: номер потока
+// возвращает false, если все части пусты
+inline bool ThreadPool::steal(size_t worker)
+{
+    for (size_t k = 1; k < size(); k++)
+    {
+        Range& victim = *ranges[(worker + k) % size()];
+        size_t first = 0;
+        size_t last = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            size_t remaining = victim.last - victim.first;
+
+            if (!remaining)
+            {
+                continue;
+            }
+
+            first = remaining <= grain ? victim.first : victim.first + remaining / 2;
+            last = victim.last;
+            victim.last = first;
+        }
+
+        Range& range = *ranges[worker];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.first = first;
+        range.last = last;
+
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace CS
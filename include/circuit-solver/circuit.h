@@ -6,18 +6,48 @@
 #include "circuit-solver/circuit_configuration/branches.h"
 #include "circuit-solver/circuit_configuration/inc_matrix.h"
 #include "circuit-solver/circuit_configuration/loops.h"
+#include "circuit-solver/circuit_configuration/topology_cache.h"
 #include "circuit-solver/equation_system/equations.h"
+#include "circuit-solver/equation_system/mna_equations.h"
+#include "circuit-solver/equation_system/lu_solver.h"
+#include "circuit-solver/equation_system/sparse_lu_solver.h"
+#include "circuit-solver/equation_system/transfer_matrix.h"
+#include "circuit-solver/netlist/netlist_parser.h"
+#include "circuit-solver/analysis/profiler.h"
 
-#include <boost/algorithm/string.hpp>
-#include <sstream>
+#include <algorithm>
+#include <numeric>
 #include <stdexcept>
 
 namespace CS
 {
 // класс для представления электрической схемы
+// схему можно редактировать поэлементно (addElement, removeElement, reconnectPin):
+// изменения копятся до следующего update, который обновляет группы пинов, узлы,
+// ветви, контуры, матрицу инцидентности и строки системы уравнений только в
+// окрестности измененных пинов (add и ввод из потока требуют полного обновления),
+// а если структура системы при этом не расширилась, следующее разложение сохраняет
+// символьный анализ (см. updatePatch)
+// расчет отслеживает, какие этапы устарели: изменение топологии требует update
+// (solve вызывает его сам), изменение сопротивлений - только численного разложения
+// с прежней структурой, изменение источников - только прямого и обратного хода
+// (или умножения на матрицу передачи, если она построена)
 //////////////////////////////////////////////////////////////////////////////////////////
 class Circuit
 {
+public:
+    enum class Formulation                                                              // способ составления системы уравнений
+    {
+        Branch,                                                                         // токи ветвей по законам Кирхгофа (через контуры)
+        Nodal                                                                           // модифицированный метод узловых потенциалов
+    };
+
+    enum class SolverType                                                               // способ решения системы уравнений
+    {
+        Dense,                                                                          // плотное LU-разложение
+        Sparse                                                                          // разреженное LU-разложение
+    };
+
 private:                                                                                // префикс m указывает на то, что переменная является членом класса
     Elements elements;                                                                  // объект для списка элементов
     PinMatrix pinMatrix;                                                                // объект для матрицы соединений пинов
@@ -26,145 +56,1193 @@ private:
     IncMatrix incMatrix;                                                                // объект для матрицы инцидентности
     Loops loops;                                                                        // объект для контуров
     Equations equations;                                                                // объект для системы уравнений
+    MnaEquations mnaEquations;                                                          // объект для системы узловых уравнений
+    LUSolver solver;                                                                    // объект для LU-разложения левой части системы уравнений
+    SparseLUSolver sparseSolver;                                                        // объект для разреженного LU-разложения левой части
+    Formulation formulation = Formulation::Branch;                                      // способ составления системы уравнений
+    SolverType solverType = SolverType::Sparse;                                         // способ решения системы уравнений
+    bool patternChanged = true;                                                         // признак изменения структуры системы после update
+    bool entriesChanged = false;                                                        // признак перестановки коэффициентов без новых позиций
+    bool valuesChanged = true;                                                          // признак устаревшего численного разложения левой части
+    bool sourcesChanged = true;                                                         // признак устаревшей правой части (значений источников)
+    DoubleVect currents;                                                                // токи ветвей, найденные последним solve
+    bool currentsValid = false;                                                         // признак соответствия токов текущей системе и разложению
+    TransferMatrix transferMatrix;                                                      // матрица передачи от источников к токам ветвей
+    bool transferChanged = true;                                                        // признак устаревшей матрицы передачи
+    bool fullUpdateNeeded = true;                                                       // признак необходимости полного обновления схемы
+    bool loopsValid = false;                                                            // признак соответствия контуров текущим ветвям
+    SizeVect touchedPins;                                                               // пины, соединения которых изменены после update
+    SizeVect changedBranches;                                                           // номера ветвей, измененных последним update
+    SizeVect changedUnknowns;                                                           // номера неизвестных системы, измененных последним update
+    TopologyCache topologyCache;                                                        // кэш топологии на диске (по умолчанию отключен)
+#if defined(CS_PROFILING)
+    Profiler profiler;                                                                  // замеры этапов расчета
+#endif
 
     size_t currentSourceCount = 0;                                                      // счетчик источников тока
     size_t voltageSourceCount = 0;                                                      // счетчик источников напряжения
 
 public:
     void add(const Element& element);                                                   // метод добавления в схему нового элемента
+    void add(const ElemVect& list);                                                     // метод добавления в схему всех элементов списка
+    size_t addElement(const Element& element);                                          // метод добавления элемента с частичным обновлением схемы
+    void removeElement(size_t index);                                                   // метод удаления элемента с частичным обновлением схемы
+    void reconnectPin(size_t pin, int linkedPin);                                       // метод изменения соединения пина с частичным обновлением схемы
+    void load(const std::string& path);                                                 // метод чтения элементов схемы из файла
+    void load(const std::string& path, ThreadPool& pool);                               // метод параллельного чтения элементов схемы из файла
+    void loadBinary(const std::string& path);                                           // метод чтения элементов схемы из двоичного файла
     void update();                                                                      // метод обновления схемы
+    DoubleVect solve();                                                                 // метод расчета токов ветвей схемы
+    const TransferMatrix& getTransferMatrix();                                          // геттер матрицы передачи от источников к токам ветвей
+    DoubleVect getSourceValues() const;                                                 // геттер значений источников по столбцам правой части системы
+    const LUSolver& getSolver() const;                                                  // геттер разложения левой части системы уравнений
+    const SparseLUSolver& getSparseSolver() const;                                      // геттер разреженного разложения левой части
+    const Elements& getElements() const;                                                // геттер списка элементов
+    Formulation getFormulation() const;                                                 // геттер способа составления системы уравнений
+    const Equations& getEquations() const;                                              // геттер системы уравнений по законам Кирхгофа
+    const MnaEquations& getMnaEquations() const;                                        // геттер системы узловых уравнений
+    void setFormulation(const std::string& name);                                       // метод выбора способа составления уравнений по названию
+    void setSolver(const std::string& name);                                            // метод выбора способа решения по названию
+    void setOrdering(const std::string& name);                                          // метод выбора упорядочения разреженного разложения по названию
+    SparseLUSolver::Ordering getOrdering() const;                                       // геттер упорядочения разреженного разложения
+    void setLoopMethod(const std::string& name);                                        // метод выбора способа поиска контуров по названию
+    void setTopologyCache(const std::string& directory);                                // метод выбора каталога кэша топологии
+    const TopologyCache& getTopologyCache() const;                                      // геттер кэша топологии
     void setElementValue(size_t index, double value);                                   // метод изменения значения элемента
+    const SizeVect& getChangedBranches() const;                                         // геттер номеров ветвей, измененных последним update
+    const SizeVect& getChangedUnknowns() const;                                         // геттер номеров неизвестных системы, измененных последним update
+    const Profiler& getProfiler() const;                                                // геттер замеров этапов расчета
+    void clearProfiler();                                                               // метод очистки замеров этапов расчета
     friend std::ostream& operator<<(std::ostream& os, const Circuit& circuit);          // перегрузка оператора вывода в поток
-    friend std::istream& operator>>(std::ostream& is, Circuit& circuit);                // перегрузка оператора ввода из потока
+    friend std::istream& operator>>(std::istream& is, Circuit& circuit);                // перегрузка оператора ввода из потока
+
+private:
+    bool isLeftChanged() const;                                                         // метод проверки, нужно ли раскладывать левую часть заново
+    void factorize();                                                                   // метод разложения левой части системы
+    void evaluateRight(const DoubleVect& sourceValues, DoubleVect& rightPart) const;    // метод вычисления правой части системы
+    void substitute(DoubleVect& rightPart) const;                                       // метод решения системы по готовому разложению
+    DoubleVect getBranchCurrents(const DoubleVect& solution,
+                                 const DoubleVect& sourceValues) const;                 // метод получения токов ветвей по решению системы
+    void updateFull();                                                                  // метод полного обновления схемы
+    void updatePatch();                                                                 // метод частичного обновления схемы после редактирования
+    void updateEquations(bool patch);                                                   // метод обновления контуров и системы уравнений
+    uint32_t getTopologyVariant() const;                                                // метод получения варианта построения для кэша топологии
+    void saveTopology(BinaryWriter& writer) const;                                      // метод записи результатов обновления в двоичный буфер
+    void loadTopology(BinaryReader& reader);                                            // метод чтения результатов обновления из двоичного буфера
+    void checkLinkedPin(int linkedPin) const;                                           // метод проверки номера пина, с которым соединяется пин
+    void countElement(Element::Type type, int increment);                               // метод изменения счетчиков источников
+    void factorizeDense(const SparseMatrix& left, const DoubleVect& values);            // метод плотного LU-разложения левой части
+    void factorizeSparse(const SparseMatrix& left, const DoubleVect& values);           // метод разреженного LU-разложения левой части
+#if defined(CS_PROFILING)
+    void countStructures();                                                             // метод записи размеров структур в замеры
+#endif
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
 // метод добавления нового элемента в схему (перегрузка)
+// следующий update строит схему заново
 inline void Circuit::add(const Element& element)
 {
     elements.add(element);                                                              // добавляем элемент в список элементов
+    countElement(element.getType(), 1);                                                 // инкрементируем соответствующий счетчик
+    fullUpdateNeeded = true;
+}
 
-    switch (element.getType())                                                          // в зависимости от типа элемента
+// метод добавления в схему всех элементов списка (например, построенного
+// CircuitGenerator): элементы добавляются в конец, как при add для каждого из них
+// принимает на вход: список элементов
+inline void Circuit::add(const ElemVect& list)
+{
+    size_t count = elements.size();
+
+    elements.add(list);
+
+    for (size_t i = count; i < elements.size(); i++)
     {
-    case Element::Type::J:                                                              // инкрементируем соответствующий счетчик
-        currentSourceCount++;
-        break;
-    case Element::Type::E:                                                              // 
-        voltageSourceCount++;
+        countElement(elements[i].getType(), 1);
+    }
+
+    fullUpdateNeeded = true;
+}
+
+// метод добавления элемента в схему с частичным обновлением: элемент занимает место
+// удаленного элемента (если такое есть) или добавляется в конец списка, а следующий
+// update обновляет схему частично (см. updatePatch)
+// пины элемента могут быть соединены только с существующими пинами неудаленных
+// элементов (иначе выбрасывается исключение std::invalid_argument)
+// возвращает индекс элемента в списке элементов схемы
+inline size_t Circuit::addElement(const Element& element)
+{
+    checkLinkedPin(element.getLinkedPin(0));                                            // проверяем соединения до изменения схемы
+    checkLinkedPin(element.getLinkedPin(1));                                            //
+
+    size_t index = elements.insert(element);                                            // занимаем свободное место или добавляем в конец
+    countElement(element.getType(), 1);
+
+    touchedPins.push_back(index * 2);                                                   // соединения пинов элемента появились
+    touchedPins.push_back(index * 2 + 1);                                               //
+
+    return index;
+}
+
+// метод удаления элемента из схемы с частичным обновлением
+// пины, соединенные с удаляемым элементом, остаются соединенными между собой:
+// пины, ссылавшиеся на пин элемента, перенаправляются на пин, с которым он был
+// соединен (или на первый из них); пин элемента, соединенный со вторым пином того же
+// элемента, рассматривается вместе с ним
+// индекс за пределами списка или удаленного элемента игнорируется
+// принимает на вход: индекс элемента в списке элементов схемы
+inline void Circuit::removeElement(size_t index)
+{
+    if (index >= elements.size() || elements.isRemoved(index))                          // если элемента нет
+    {
+        return;                                                                         // игнорируем
+    }
+
+    size_t pins[2] = { index * 2, index * 2 + 1 };                                      // пины удаляемого элемента
+    bool shorted = elements[index].getLinkedPin(0) == static_cast<int>(pins[1]) ||      // пины элемента соединены между собой
+                   elements[index].getLinkedPin(1) == static_cast<int>(pins[0]);        //
+    SizeVect candidates;                                                                // пины, которые могут ссылаться на пины элемента
+
+    if (fullUpdateNeeded)                                                               // группы пинов еще не построены - перебираем все пины
+    {
+        candidates.resize(elements.size() * 2);
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+    else                                                                                // иначе - группы пинов элемента и измененные пины
+    {
+        for (size_t pin : pins)
+        {
+            if (pin < pinMatrix.size())
+            {
+                SizeRange groupPins = pinMatrix.getGroupPins(pinMatrix.getGroup(pin));
+                candidates.insert(candidates.end(), groupPins.begin(), groupPins.end());
+            }
+        }
+
+        candidates.insert(candidates.end(), touchedPins.begin(), touchedPins.end());
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    for (size_t side = 0; side < 2; side++)                                             // обрабатываем пины элемента (соединенные между собой - вместе)
+    {
+        if (shorted && side == 1)
+        {
+            break;
+        }
+
+        SizeVect unit = shorted ? SizeVect{ pins[0], pins[1] } : SizeVect{ pins[side] };
+        SizeVect linkers;                                                               // пины, ссылающиеся на пины unit
+        SizeVect targets;                                                               // пины вне unit, на которые ссылаются пины unit
+
+        auto inUnit = [&unit](int pin)
+        {
+            return std::find(unit.begin(), unit.end(), static_cast<size_t>(pin)) != unit.end();
+        };
+
+        for (size_t pin : candidates)
+        {
+            if (!inUnit(static_cast<int>(pin)) &&
+                inUnit(elements[pin / 2].getLinkedPin(pin)))
+            {
+                linkers.push_back(pin);
+            }
+        }
+
+        for (size_t pin : unit)
+        {
+            int linkedPin = elements[pin / 2].getLinkedPin(pin);
+
+            if (linkedPin >= 0 && !inUnit(linkedPin) &&
+                std::find(targets.begin(), targets.end(), linkedPin) == targets.end())
+            {
+                targets.push_back(linkedPin);
+            }
+        }
+
+        if (linkers.empty() && targets.empty())                                         // пины ни с чем не соединены
+        {
+            continue;
+        }
+
+        size_t hub = targets.empty() ? linkers.front() : targets.front();               // пин, к которому присоединяются остальные
+
+        for (size_t pin : linkers)                                                      // перенаправляем ссылки на пин hub
+        {
+            elements[pin / 2].setLinkedPin(pin, pin == hub ? -1 : static_cast<int>(hub));
+            touchedPins.push_back(pin);
+        }
+
+        if (targets.size() > 1)                                                         // второй пин, на который ссылался элемент, соединяется с hub
+        {                                                                               // через свободную ссылку одного из этих пинов
+            size_t other = targets[1];
+
+            if (elements[other / 2].getLinkedPin(other) < 0)
+            {
+                elements[other / 2].setLinkedPin(other, static_cast<int>(hub));
+            }
+            else if (elements[hub / 2].getLinkedPin(hub) < 0)
+            {
+                elements[hub / 2].setLinkedPin(hub, static_cast<int>(other));
+            }
+            else
+            {
+                throw std::runtime_error("Element " + std::to_string(index) +
+                                         " cannot be removed without breaking connections");
+            }
+        }
+
+        touchedPins.insert(touchedPins.end(), targets.begin(), targets.end());
     }
+
+    countElement(elements[index].getType(), -1);
+    elements.remove(index);                                                             // на месте элемента остается ни с чем не соединенная заглушка
+    touchedPins.push_back(pins[0]);
+    touchedPins.push_back(pins[1]);
+}
+
+// метод изменения соединения пина с частичным обновлением схемы
+// принимает на вход:
+// 1) номер пина
+// 2) номер пина, с которым он соединяется (-1 - разорвать соединение)
+// при несуществующем пине или пине удаленного элемента выбрасывает исключение
+// std::invalid_argument
+inline void Circuit::reconnectPin(size_t pin, int linkedPin)
+{
+    if (pin >= elements.size() * 2 || elements.isRemoved(pin / 2))
+    {
+        throw std::invalid_argument("Unknown pin: " + std::to_string(pin));
+    }
+
+    checkLinkedPin(linkedPin);
+
+    if (linkedPin == static_cast<int>(pin))
+    {
+        throw std::invalid_argument("Pin " + std::to_string(pin) + " cannot be linked to itself");
+    }
+
+    int oldLinkedPin = elements[pin / 2].getLinkedPin(pin);                             // прежний соседний пин тоже пересчитывается
+
+    if (oldLinkedPin >= 0)
+    {
+        touchedPins.push_back(oldLinkedPin);
+    }
+
+    elements[pin / 2].setLinkedPin(pin, linkedPin);
+    touchedPins.push_back(pin);
 }
 
 // метод изменения значения элемента с индексом index в списке элементов схемы
+// структура системы не меняется: изменение сопротивления делает устаревшим численное
+// разложение, изменение источника - только правую часть системы
 inline void Circuit::setElementValue(size_t index, double value)
 {
-    if (index >= elements.size())                                                       // если индекс за пределами списка
+    if (index >= elements.size() || elements.isRemoved(index))                          // если индекс за пределами списка (или элемент удален)
     {
         return;                                                                         // игнорируем
     }
+
+    if (elements[index].getValue() == value)                                            // значение не изменилось
+    {
+        return;
+    }
+
     elements[index].setValue(value);                                                    // изменяем значение элемента
+
+    if (elements[index].getType() == Element::Type::R)                                  // сопротивление входит в левую часть системы
+    {
+        valuesChanged = true;
+    }
+    else                                                                                // источник - только в правую
+    {
+        sourcesChanged = true;
+    }
 }
 
 // перегрузка оператора вывода в поток
 inline std::ostream& operator<<(std::ostream& os, const Circuit& circuit)
 {
-    return os << circuit.pinMatrix << circuit.nodes 
-              << circuit.branches << circuit.incMatrix
-              << circuit.loops << circuit.equations;
+    os << circuit.pinMatrix << circuit.nodes
+       << circuit.branches << circuit.incMatrix;
+
+    switch (circuit.formulation)                                                        // выводим структуры выбранного способа составления уравнений
+    {
+    case Circuit::Formulation::Branch:
+        os << circuit.loops;
+        return circuit.equations.print(os, circuit.elements);
+    case Circuit::Formulation::Nodal:
+        return circuit.mnaEquations.print(os, circuit.elements);
+    }
+
+    return os;
 }
 
-// перегрузка оператора ввода из потока
+// перегрузка оператора ввода из потока: элементы добавляются в схему после разбора
+// всего потока (см. NetlistParser)
+// при ошибке разбора выбрасывает исключение std::runtime_error с номером строки
+// (схема при этом не изменяется)
 inline std::istream& operator>>(std::istream& is, Circuit& circuit)
 {
-    std::string line;
+    ElemVect elements;
+    NetlistParser().parse(is, elements);
 
-    for (int lineCount = 1; std::getline(is, line); lineCount++)
+    for (const Element& element : elements)
     {
-        boost::algorithm::trim(line);
-        boost::algorithm::to_lower(line);
+        circuit.add(element);
+    }
 
-        if (line.empty() || line.front() == '#')
-        {
-            continue;
-        }
+    return is;
+}
+
+// метод чтения элементов схемы из файла (файл отображается в память, см. NetlistParser)
+// элементы добавляются в схему, как при вводе из потока
+// принимает на вход: путь к файлу
+// если файл не открывается или содержит ошибку, выбрасывает исключение
+// std::runtime_error (схема при этом не изменяется)
+inline void Circuit::load(const std::string& path)
+{
+    ElemVect parsed;
+    NetlistParser().parseFile(path, parsed);
+
+    for (const Element& element : parsed)
+    {
+        add(element);
+    }
+}
 
-        std::istringstream iss(line);
+// метод параллельного чтения элементов схемы из файла (для больших файлов: части
+// файла разбираются потоками пула, результат тот же, что и у load без пула)
+// принимает на вход:
+// 1) путь к файлу
+// 2) пул потоков
+// если файл не открывается или содержит ошибку, выбрасывает исключение
+// std::runtime_error (схема при этом не изменяется)
+inline void Circuit::load(const std::string& path, ThreadPool& pool)
+{
+    ElemVect parsed;
+    NetlistParser().parseFile(path, parsed, pool);
+
+    for (const Element& element : parsed)
+    {
+        add(element);
+    }
+}
+
+// метод чтения элементов схемы из двоичного файла (см. BinaryNetlist): файл
+// отображается в память, и элементы добавляются в схему без разбора текста
+// принимает на вход: путь к файлу
+// если файл не открывается или не является двоичным описанием схемы, выбрасывает
+// исключение std::runtime_error (схема при этом не изменяется)
+inline void Circuit::loadBinary(const std::string& path)
+{
+    BinaryNetlist netlist(path);
+    size_t count = elements.size();
 
-        Element::Type type;
+    elements.add(netlist);
 
-        std::string typeString; 
-        if (!(iss >> typeString))
+    for (size_t i = count; i < elements.size(); i++)
+    {
+        countElement(elements[i].getType(), 1);
+    }
+
+    fullUpdateNeeded = true;
+}
+
+// метод обновления схемы:
+// если после последнего update схема только редактировалась поэлементно
+// (addElement, removeElement, reconnectPin), обновляется частично; если схема не
+// менялась, ничего не делает; иначе строится заново
+inline void Circuit::update()
+{
+    if (!fullUpdateNeeded && touchedPins.empty())                                       // топология не менялась
+    {
+        return;
+    }
+
+    CS_PROFILE_SCOPE(profiler, "update");
+    bool patch = !fullUpdateNeeded;                                                     // есть только поэлементные изменения
+
+    fullUpdateNeeded = true;                                                            // при исключении следующий update будет полным
+
+    if (patch)
+    {
+        updatePatch();
+    }
+    else
+    {
+        updateFull();
+    }
+
+    touchedPins.clear();
+    fullUpdateNeeded = false;
+    valuesChanged = true;                                                               // коэффициенты системы изменились
+    currentsValid = false;                                                              // токи прошлого solve относятся к прежней схеме
+
+#if defined(CS_PROFILING)
+    countStructures();
+#endif
+}
+
+// метод полного обновления схемы (все ветви считаются измененными)
+// если задан каталог кэша топологии (см. setTopologyCache) и в нем есть результаты
+// для тех же соединений, они читаются вместо вычисления, иначе вычисленные результаты
+// записываются в кэш
+inline void Circuit::updateFull()
+{
+    TopologyCache::Key key;
+    bool cached = false;                                                                // прочитаны ли результаты из кэша
+
+    if (topologyCache.isEnabled())
+    {
+        CS_PROFILE_SCOPE(profiler, "topology_cache");
+        key = TopologyCache::getKey(elements, getTopologyVariant());
+        std::string payload;
+
+        if (topologyCache.read(key, payload))
         {
-            throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+            try
+            {
+                BinaryReader reader(payload);
+                loadTopology(reader);
+                cached = reader.atEnd();
+            }
+            catch (const std::runtime_error&)                                           // содержимое не разобрано - строим заново
+            {
+            }
+
+            if (!cached)
+            {
+                topologyCache.countMiss();
+            }
         }
+    }
 
-        if (typeString == "resistance" || typeString == "r")
+    if (cached)
+    {
+        loopsValid = formulation == Formulation::Branch;                                // контуры прочитаны вместе с системой
+    }
+    else
+    {
+        {
+            CS_PROFILE_SCOPE(profiler, "pin_matrix");
+            pinMatrix.update(elements);                                                 // обновляем матрицу пинов
+        }
         {
-            type = Element::Type::R;
+            CS_PROFILE_SCOPE(profiler, "nodes");
+            nodes.update(pinMatrix);                                                    // обновляем узлы и все, что с ними связано
         }
-        else if (typeString == "current_source" || typeString == "j")
         {
-            type = Element::Type::J;
+            CS_PROFILE_SCOPE(profiler, "branches");
+            branches.update(pinMatrix, nodes, elements);                                // обновляем ветви и все, что с ними связано
         }
-        else if (typeString == "voltage_source" || typeString == "e")
         {
-            type = Element::Type::E;
+            CS_PROFILE_SCOPE(profiler, "inc_matrix");
+            incMatrix.update(nodes, branches, elements);                                // обновляем матрицу инцидентности
         }
-        else
+
+        loopsValid = false;                                                             // контуры строятся заново
+        updateEquations(false);
+
+        if (topologyCache.isEnabled())
         {
-            throw std::runtime_error("Unknown element type: " + typeString);
+            CS_PROFILE_SCOPE(profiler, "topology_cache");
+            BinaryWriter writer;
+            saveTopology(writer);
+            topologyCache.write(key, writer.getBuffer());                               // ошибка записи не мешает расчету
         }
+    }
+
+    changedBranches = SizeVect(branches.size());
+    std::iota(changedBranches.begin(), changedBranches.end(), 0);
+    changedUnknowns = SizeVect(formulation == Formulation::Branch ? equations.size() : mnaEquations.size());
+    std::iota(changedUnknowns.begin(), changedUnknowns.end(), 0);
+    patternChanged = true;                                                              // структура системы построена заново
+}
+
+// метод частичного обновления схемы после поэлементного редактирования:
+// группы пинов пересчитываются только для затронутых пинов, узлы и ветви - только
+// проходящие через пересчитанные группы, контуры - только содержащие измененные
+// ветви; остальные сохраняют номера (освободившиеся места занимают последние), так
+// что матрица инцидентности и система уравнений пересчитываются только в строках и
+// столбцах измененных узлов, ветвей и контуров
+// если в системе не появилось новых позиций коэффициентов, символьный анализ
+// разреженного разложения сохраняется (коэффициенты сопоставляются прежним позициям,
+// см. SparseLUSolver::remap), и следующее разложение - только численное
+// время обновления растет с размером правки, кроме линейных проходов без поиска:
+// сборки значений левой части (ее все равно вычисляет разложение), переноса
+// неизмененных строк системы и (для уравнений Кирхгофа) проверки контуров
+inline void Circuit::updatePatch()
+{
+    {
+        CS_PROFILE_SCOPE(profiler, "pin_matrix");
+        pinMatrix.patch(elements, touchedPins);                                         // пересчитываем группы затронутых пинов
+    }
+    {
+        CS_PROFILE_SCOPE(profiler, "nodes");
+        nodes.patch(pinMatrix);                                                         // пересчитываем узлы пересчитанных групп
+    }
+    {
+        CS_PROFILE_SCOPE(profiler, "branches");
+        branches.patch(pinMatrix, nodes, elements);                                     // заново трассируем только затронутые ветви
+    }
+    {
+        CS_PROFILE_SCOPE(profiler, "inc_matrix");
+        incMatrix.patch(nodes, branches, elements);                                     // пересчитываем строки и столбцы матрицы инцидентности
+    }
+
+    updateEquations(true);
 
-        double value;
-        
-        if (!(iss >> value))
+    changedBranches.clear();
+
+    for (size_t branch : branches.getChangedBranches())                                 // места за концом списка ветвей не сообщаются
+    {
+        if (branch < branches.size())
         {
-            throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+            changedBranches.push_back(branch);
         }
+    }
 
-        int linkedPins[2];
+    bool grown = formulation == Formulation::Branch ? equations.isPatternChanged() :
+                                                      mnaEquations.isPatternChanged();
+    changedUnknowns = formulation == Formulation::Branch ? equations.getChangedUnknowns() :
+                                                           mnaEquations.getChangedUnknowns();
+    patternChanged = patternChanged || grown;                                           // расширение до разложения не забывается
+    entriesChanged = true;
+}
 
-        std::string linkedPinString[2];
+// метод обновления контуров и системы уравнений выбранным способом
+// контуры, построенные при предыдущем обновлении, обновляются частично
+// принимает на вход: признак частичного обновления (система уравнений построена
+// предыдущим обновлением и обновляется частично)
+inline void Circuit::updateEquations(bool patch)
+{
+    switch (formulation)                                                                // строим систему уравнений выбранным способом
+    {
+    case Formulation::Branch:
+        {
+            CS_PROFILE_SCOPE(profiler, "loops");
 
-        for (size_t i = 0; i < 2; i++)
+            if (loopsValid)                                                             // обновляем контуры
+            {
+                loops.patch(incMatrix, branches);
+            }
+            else
+            {
+                loops.update(incMatrix);
+            }
+        }
         {
-            if (!(iss >> linkedPinString[i]))
+            CS_PROFILE_SCOPE(profiler, "equations");
+
+            if (patch && loopsValid)                                                    // обновляем систему уравнений
+            {
+                equations.patch(incMatrix, loops, branches, elements);
+            }
+            else
             {
-                throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+                equations.update(incMatrix, loops, branches, elements);
             }
+        }
 
-            if (linkedPinString[i] == "none")
+        loopsValid = true;
+        break;
+    case Formulation::Nodal:                                                            // контуры для узловых уравнений не нужны
+        loopsValid = false;
+        {
+            CS_PROFILE_SCOPE(profiler, "equations");
+
+            if (patch)                                                                  // обновляем систему узловых уравнений
             {
-                linkedPins[i] = -1;
+                mnaEquations.patch(nodes, branches, incMatrix, elements);
             }
             else
             {
-                try
-                {
-                    linkedPins[i] = std::stoi(linkedPinString[i]);
-                }
-                catch(const std::exception& e)
-                {
-                    throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount) + "\n" + e.what());
-                }
+                mnaEquations.update(nodes, branches, incMatrix, elements);
             }
         }
-        
-        circuit.add(Element(type, value, linkedPins[0], linkedPins[1]));
     }
-    
-    return is;
 }
 
-// метод обновления схемы
-inline void Circuit::update()
+// метод получения варианта построения для кэша топологии: способ составления
+// уравнений и (для уравнений Кирхгофа) способ поиска контуров
+inline uint32_t Circuit::getTopologyVariant() const
+{
+    uint32_t variant = static_cast<uint32_t>(formulation);
+
+    if (formulation == Formulation::Branch)
+    {
+        variant |= static_cast<uint32_t>(loops.getMethod()) << 8;
+    }
+
+    return variant;
+}
+
+// метод записи результатов полного обновления в двоичный буфер (для кэша топологии):
+// группы пинов, узлы, ветви, матрица инцидентности и система уравнений выбранным
+// способом (для уравнений Кирхгофа - вместе с контурами)
+// принимает на вход: буфер для записи
+inline void Circuit::saveTopology(BinaryWriter& writer) const
+{
+    pinMatrix.save(writer);
+    nodes.save(writer);
+    branches.save(writer);
+    incMatrix.save(writer);
+
+    if (formulation == Formulation::Branch)
+    {
+        loops.save(writer);
+        equations.save(writer);
+    }
+    else
+    {
+        mnaEquations.save(writer);
+    }
+}
+
+// метод чтения результатов полного обновления из двоичного буфера, записанного
+// методом saveTopology при том же варианте построения
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void Circuit::loadTopology(BinaryReader& reader)
+{
+    pinMatrix.load(reader);
+    nodes.load(reader);
+    branches.load(reader);
+    incMatrix.load(reader);
+
+    if (formulation == Formulation::Branch)
+    {
+        loops.load(reader);
+        equations.load(reader);
+    }
+    else
+    {
+        mnaEquations.load(reader);
+    }
+}
+
+// геттер номеров ветвей (элементов вектора токов, см. solve), состав или номера
+// которых изменил последний update; после полного обновления - все ветви
+inline const SizeVect& Circuit::getChangedBranches() const
+{
+    return changedBranches;
+}
+
+// геттер номеров неизвестных системы уравнений, смысл которых изменил последний
+// update: для уравнений Кирхгофа - токи измененных ветвей, для узловых - потенциалы
+// измененных узлов (всех, если сменился базисный узел) и токи ветвей без
+// сопротивлений с новыми номерами; после полного обновления - все неизвестные
+inline const SizeVect& Circuit::getChangedUnknowns() const
+{
+    return changedUnknowns;
+}
+
+// геттер замеров этапов расчета (update и его этапов, разложения, прямого и обратного
+// хода, построения матрицы передачи) и размеров структур после последнего update
+// замеры ведутся, только если библиотека собрана с CS_PROFILING (см. profiler.h),
+// иначе возвращаются пустые замеры
+inline const Profiler& Circuit::getProfiler() const
+{
+#if defined(CS_PROFILING)
+    return profiler;
+#else
+    static const Profiler empty;
+    return empty;
+#endif
+}
+
+// метод очистки замеров этапов расчета (без CS_PROFILING ничего не делает)
+inline void Circuit::clearProfiler()
+{
+#if defined(CS_PROFILING)
+    profiler.clear();
+#endif
+}
+
+#if defined(CS_PROFILING)
+// метод записи в замеры размеров структур после update: количества пинов, узлов,
+// ветвей, контуров, коэффициентов левой части системы и распределения контуров по
+// количеству ветвей
+inline void Circuit::countStructures()
+{
+    Profiler::Counts counts;
+    counts.pins = pinMatrix.size();
+    counts.nodes = nodes.size();
+    counts.branches = branches.size();
+
+    switch (formulation)
+    {
+    case Formulation::Branch:
+        counts.loops = loops.size();
+        counts.nonZeros = equations.left().nonZeros();
+
+        for (size_t i = 0; i < loops.size(); i++)
+        {
+            size_t length = loops[i].size();
+
+            if (counts.loopLengths.size() <= length)
+            {
+                counts.loopLengths.resize(length + 1, 0);
+            }
+
+            counts.loopLengths[length]++;
+        }
+
+        break;
+    case Formulation::Nodal:
+        counts.nonZeros = mnaEquations.left().nonZeros();
+    }
+
+    profiler.setCounts(std::move(counts));
+}
+#endif
+
+// метод проверки номера пина, с которым соединяется пин: пин должен существовать
+// и принадлежать неудаленному элементу (-1 - пин ни с чем не соединяется)
+// иначе выбрасывает исключение std::invalid_argument
+inline void Circuit::checkLinkedPin(int linkedPin) const
+{
+    if (linkedPin >= static_cast<int>(elements.size() * 2) ||
+        (linkedPin >= 0 && elements.isRemoved(linkedPin / 2)))
+    {
+        throw std::invalid_argument("Unknown linked pin: " + std::to_string(linkedPin));
+    }
+}
+
+// метод изменения счетчиков источников при добавлении (increment = 1)
+// или удалении (increment = -1) элемента
+inline void Circuit::countElement(Element::Type type, int increment)
+{
+    switch (type)                                                                       // в зависимости от типа элемента
+    {
+    case Element::Type::J:                                                              // изменяем соответствующий счетчик
+        currentSourceCount += increment;
+        break;
+    case Element::Type::E:                                                              //
+        voltageSourceCount += increment;
+        break;
+    case Element::Type::R:
+        break;
+    }
+}
+
+// метод расчета токов ветвей схемы:
+// вычисляет значения коэффициентов системы, составленной выбранным способом (см. setFormulation),
+// и решает ее выбранным способом (см. setSolver)
+// выполняются только устаревшие этапы расчета:
+// - после изменения топологии (или выбора способа расчета) - update и полное разложение
+// - после изменения сопротивлений - численное разложение с прежней структурой
+//   (разреженное разложение повторяет лишь численный этап)
+// - после изменения только источников - прямой и обратный ход с прежним разложением,
+//   а если построена матрица передачи (см. getTransferMatrix) - умножение на нее
+// - если ничего не менялось, возвращаются токи, найденные в прошлый раз (update или
+//   разложение, выполненные после прошлого solve, например getTransferMatrix, делают
+//   эти токи устаревшими)
+// возвращает вектор токов всех ветвей в порядке списка ветвей: сначала
+// найденные неизвестные токи, затем токи ветвей с источниками тока
+// (направления токов соответствуют ориентации матрицы инцидентности)
+inline DoubleVect Circuit::solve()
+{
+    update();                                                                           // применяем изменения топологии, если они есть
+
+    CS_PROFILE_SCOPE(profiler, "solve");
+    bool leftChanged = isLeftChanged();                                                 // левую часть нужно разложить заново
+
+    if (!leftChanged && !sourcesChanged && currentsValid)                               // ничего не менялось
+    {
+        return currents;
+    }
+
+    DoubleVect sourceValues = getSourceValues();                                        // значения источников по столбцам правой части
+
+    if (!leftChanged && !transferChanged)                                               // изменились только источники, матрица передачи готова
+    {
+        currents = transferMatrix.apply(sourceValues);
+        sourcesChanged = false;
+        currentsValid = true;
+        return currents;
+    }
+
+    if (leftChanged)                                                                    // левая часть изменилась - раскладываем ее заново
+    {
+        factorize();
+    }
+
+    DoubleVect rightPart;                                                               // правая часть системы, затем решение
+    {
+        CS_PROFILE_SCOPE(profiler, "substitute");
+        evaluateRight(sourceValues, rightPart);
+        substitute(rightPart);                                                          // прямой и обратный ход
+    }
+
+    currents = getBranchCurrents(rightPart, sourceValues);
+    sourcesChanged = false;
+    currentsValid = true;
+
+    return currents;
+}
+
+// метод получения матрицы передачи от источников к токам ветвей (см. TransferMatrix):
+// левая часть раскладывается один раз, затем столбец матрицы - токи ветвей при единичном
+// значении одного источника - находится прямым и обратным ходом для каждого источника
+// матрица строится при первом вызове и строится заново только после изменения
+// топологии или сопротивлений; пока она не устарела, solve после изменения источников
+// вычисляет токи умножением на нее
+inline const TransferMatrix& Circuit::getTransferMatrix()
+{
+    update();                                                                           // применяем изменения топологии, если они есть
+
+    if (isLeftChanged())                                                                // раскладываем левую часть, если нужно
+    {
+        factorize();
+    }
+
+    if (!transferChanged)                                                               // матрица не устарела
+    {
+        return transferMatrix;
+    }
+
+    CS_PROFILE_SCOPE(profiler, "transfer_matrix");
+
+    size_t sourceCount = getSourceValues().size();                                      // количество источников (столбцов матрицы)
+    size_t branchCount = branches.size();                                               // количество ветвей (строк матрицы)
+    DoubleVect values(sourceCount * branchCount);                                       // столбцы матрицы подряд
+    DoubleVect sourceValues(sourceCount, 0.0);                                          // единичный вектор источников
+    DoubleVect rightPart;
+
+    for (size_t j = 0; j < sourceCount; j++)                                            // решаем систему для каждого источника
+    {
+        sourceValues[j] = 1.0;
+
+        evaluateRight(sourceValues, rightPart);
+        substitute(rightPart);
+        DoubleVect column = getBranchCurrents(rightPart, sourceValues);
+        std::copy(column.begin(), column.end(), values.begin() + j * branchCount);
+
+        sourceValues[j] = 0.0;
+    }
+
+    transferMatrix.update(std::move(values), branchCount, sourceCount);
+    transferChanged = false;
+
+    return transferMatrix;
+}
+
+// метод получения текущих значений источников схемы по столбцам правой части системы
+// (сначала источники тока, затем источники напряжения - в порядке списка элементов);
+// в этом порядке задаются значения источников для матрицы передачи
+// вызывается после метода update
+inline DoubleVect Circuit::getSourceValues() const
+{
+    switch (formulation)
+    {
+    case Formulation::Branch:
+        return equations.getSourceValues(elements);
+    case Formulation::Nodal:
+        return mnaEquations.getSourceValues(elements);
+    }
+
+    return DoubleVect();
+}
+
+// метод проверки, нужно ли раскладывать левую часть заново (структура системы
+// важна только для разреженного разложения)
+inline bool Circuit::isLeftChanged() const
+{
+    return valuesChanged || (patternChanged && solverType == SolverType::Sparse);
+}
+
+// метод разложения левой части системы выбранным способом при текущих значениях
+// сопротивлений; матрица передачи после этого устаревает
+// при несовпадении количества уравнений и неизвестных выбрасывает исключение
+// std::runtime_error
+inline void Circuit::factorize()
+{
+    CS_PROFILE_SCOPE(profiler, "factorize");
+    size_t unknownCurrentCount = equations.getUnknownCurrentCount();                    // количество неизвестных токов ветвей
+
+    if (formulation == Formulation::Branch &&                                           // если количество уравнений не совпадает с количеством неизвестных
+        equations.size() != unknownCurrentCount)                                        // (например, найдены не все независимые контуры), систему решить нельзя
+    {
+        throw std::runtime_error("Equation count " + std::to_string(equations.size()) +
+                                 " does not match unknown current count " +
+                                 std::to_string(unknownCurrentCount));
+    }
+
+    const SparseMatrix& left = formulation == Formulation::Branch ?                     // левая часть системы выбранного способа
+                               equations.left() : mnaEquations.left();                  //
+    DoubleVect values;                                                                  // значения коэффициентов левой части
+
+    switch (formulation)                                                                // вычисляем значения коэффициентов
+    {
+    case Formulation::Branch:
+        equations.evaluateLeft(elements, values);
+        break;
+    case Formulation::Nodal:
+        mnaEquations.evaluateLeft(elements, values);
+    }
+
+    switch (solverType)                                                                 // раскладываем левую часть выбранным способом
+    {
+    case SolverType::Dense:
+        factorizeDense(left, values);
+        break;
+    case SolverType::Sparse:
+        factorizeSparse(left, values);
+    }
+
+    valuesChanged = false;
+    transferChanged = true;
+    currentsValid = false;                                                              // токи найдены с прежним разложением
+}
+
+// метод вычисления правой части системы выбранного способа
+// принимает на вход:
+// 1) значения источников по столбцам правой части (см. getSourceValues)
+// 2) вектор для правой части системы
+inline void Circuit::evaluateRight(const DoubleVect& sourceValues, DoubleVect& rightPart) const
+{
+    switch (formulation)
+    {
+    case Formulation::Branch:
+        equations.evaluateRight(sourceValues, rightPart);
+        break;
+    case Formulation::Nodal:
+        mnaEquations.evaluateRight(elements, sourceValues, rightPart);
+    }
+}
+
+// метод решения системы по готовому разложению (прямой и обратный ход)
+// принимает на вход: правую часть системы, которая заменяется решением
+inline void Circuit::substitute(DoubleVect& rightPart) const
+{
+    switch (solverType)
+    {
+    case SolverType::Dense:
+        solver.solve(rightPart);
+        break;
+    case SolverType::Sparse:
+        sparseSolver.solve(rightPart);
+    }
+}
+
+// метод получения токов всех ветвей по решению системы выбранного способа
+// принимает на вход:
+// 1) решение системы
+// 2) значения источников по столбцам правой части (см. getSourceValues)
+inline DoubleVect Circuit::getBranchCurrents(const DoubleVect& solution,
+                                             const DoubleVect& sourceValues) const
+{
+    switch (formulation)
+    {
+    case Formulation::Branch:
+        return equations.getBranchCurrents(solution, sourceValues);
+    case Formulation::Nodal:
+        return mnaEquations.getBranchCurrents(solution, elements, sourceValues);
+    }
+
+    return DoubleVect();
+}
+
+// метод плотного LU-разложения левой части:
+// переводит разреженную левую часть в плотную матрицу (построчно, в непрерывном массиве)
+// и раскладывает ее заново при каждом вызове
+// принимает на вход:
+// 1) левую часть системы (структуру)
+// 2) значения коэффициентов левой части
+inline void Circuit::factorizeDense(const SparseMatrix& left, const DoubleVect& values)
+{
+    size_t size = left.rows();                                                          // размер системы уравнений
+
+    DoubleVect matrix(size * size, 0.0);                                                // плотная матрица левой части (построчно)
+
+    for (size_t i = 0; i < size; i++)                                                   // перебираем уравнения
+    {
+        for (size_t k = left.getRowOffsets()[i]; k < left.getRowOffsets()[i + 1]; k++)  // расставляем ненулевые коэффициенты при неизвестных
+        {                                                                               // (коэффициенты одного столбца суммируются)
+            matrix[i * size + left.getColumns()[k]] += values[k];
+        }
+    }
+
+    solver.factorize(std::move(matrix), size);                                          // раскладываем левую часть
+}
+
+// метод разреженного LU-разложения левой части:
+// символьный анализ (упорядочение и структура) выполняется только после update,
+// расширившего структуру системы; если update только переставил коэффициенты или
+// убрал часть их (см. updatePatch), они сопоставляются прежнему анализу, и, как
+// при изменении одних значений, повторяется лишь численное разложение с прежней
+// структурой
+// принимает на вход:
+// 1) левую часть системы (структуру)
+// 2) значения коэффициентов левой части
+inline void Circuit::factorizeSparse(const SparseMatrix& left, const DoubleVect& values)
+{
+    if (patternChanged || !sparseSolver.isFactorized() ||                               // если структура системы изменилась (или разложения еще нет)
+        (entriesChanged && !sparseSolver.remap(left)))                                  //
+    {
+        sparseSolver.analyze(left);                                                     // выполняем символьный анализ
+        sparseSolver.factorize(values);                                                 // и полное численное разложение
+    }
+    else                                                                                // иначе изменились только значения
+    {
+        sparseSolver.refactorize(values);                                               // повторяем численный этап
+    }
+
+    patternChanged = false;
+    entriesChanged = false;
+}
+
+// метод выбора способа составления системы уравнений (следующий update строит систему заново)
+// для узловых уравнений по умолчанию выбирается симметричное упорядочение
+// (их матрица симметрична по структуре), для уравнений Кирхгофа - по столбцам;
+// упорядочение можно переопределить вызовом setOrdering после этого метода
+// принимает на вход: название способа ("branch" или "mna")
+inline void Circuit::setFormulation(const std::string& name)
+{
+    if (name == "branch")
+    {
+        formulation = Formulation::Branch;
+        sparseSolver.setOrdering(SparseLUSolver::Ordering::Column);
+    }
+    else if (name == "mna")
+    {
+        formulation = Formulation::Nodal;
+        sparseSolver.setOrdering(SparseLUSolver::Ordering::Symmetric);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown formulation: " + name);
+    }
+
+    fullUpdateNeeded = true;                                                            // систему нужно построить заново
+}
+
+// метод выбора способа решения системы уравнений
+// принимает на вход: название способа ("dense" или "sparse")
+inline void Circuit::setSolver(const std::string& name)
+{
+    if (name == "dense")
+    {
+        solverType = SolverType::Dense;
+    }
+    else if (name == "sparse")
+    {
+        solverType = SolverType::Sparse;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown solver: " + name);
+    }
+
+    valuesChanged = true;                                                               // разложение выбранным способом еще не выполнено
+}
+
+// метод выбора упорядочения столбцов для разреженного разложения
+// (действует со следующего символьного анализа)
+// принимает на вход: название упорядочения ("natural", "column" или "symmetric")
+inline void Circuit::setOrdering(const std::string& name)
+{
+    if (name == "natural")
+    {
+        sparseSolver.setOrdering(SparseLUSolver::Ordering::Natural);
+    }
+    else if (name == "column")
+    {
+        sparseSolver.setOrdering(SparseLUSolver::Ordering::Column);
+    }
+    else if (name == "symmetric")
+    {
+        sparseSolver.setOrdering(SparseLUSolver::Ordering::Symmetric);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown ordering: " + name);
+    }
+
+    patternChanged = true;                                                              // при следующем решении упорядочение строится заново
+}
+
+// геттер способа упорядочения разреженного разложения (см. setOrdering)
+inline SparseLUSolver::Ordering Circuit::getOrdering() const
+{
+    return sparseSolver.getOrdering();
+}
+
+// метод выбора способа поиска контуров (следующий update строит контуры заново)
+// принимает на вход: название способа ("tree" - фундаментальные контуры остовного
+// дерева, или "search" - поиск деревьями от каждой ветви)
+inline void Circuit::setLoopMethod(const std::string& name)
+{
+    if (name == "tree")
+    {
+        loops.setMethod(Loops::Method::SpanningTree);
+    }
+    else if (name == "search")
+    {
+        loops.setMethod(Loops::Method::Search);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown loop method: " + name);
+    }
+
+    fullUpdateNeeded = true;                                                            // контуры нужно построить заново
+}
+
+// метод выбора каталога кэша топологии (см. TopologyCache): полное обновление схемы
+// читает из него результаты для тех же соединений и записывает новые
+// принимает на вход: путь к каталогу (пустой - кэш отключен)
+inline void Circuit::setTopologyCache(const std::string& directory)
+{
+    topologyCache.setDirectory(directory);
+}
+
+// геттер кэша топологии (каталог и количество попаданий и промахов)
+inline const TopologyCache& Circuit::getTopologyCache() const
+{
+    return topologyCache;
+}
+
+// геттер разложения левой части системы уравнений
+inline const LUSolver& Circuit::getSolver() const
+{
+    return solver;
+}
+
+// геттер разреженного разложения левой части системы уравнений
+// (содержит сведения о заполнении и количестве операций, см. getReport)
+inline const SparseLUSolver& Circuit::getSparseSolver() const
+{
+    return sparseSolver;
+}
+
+// геттер списка элементов
+inline const Elements& Circuit::getElements() const
+{
+    return elements;
+}
+
+// геттер способа составления системы уравнений
+inline Circuit::Formulation Circuit::getFormulation() const
+{
+    return formulation;
+}
+
+// геттер системы уравнений по законам Кирхгофа (актуальна после update, если
+// выбран способ Formulation::Branch)
+inline const Equations& Circuit::getEquations() const
+{
+    return equations;
+}
+
+// геттер системы узловых уравнений (актуальна после update, если выбран
+// способ Formulation::Nodal)
+inline const MnaEquations& Circuit::getMnaEquations() const
 {
-    pinMatrix.update(elements);                                                         // обновляем матрицу пинов
-    nodes.update(pinMatrix);                                                            // обновляем узлы и все, что с ними связано
-    branches.update(pinMatrix, nodes, elements);                                        // обновляем ветви и все, что с ними связано
-    incMatrix.update(nodes, branches, elements);                                        // обновляем матрицу инцидентности
-    loops.update(incMatrix);                                                            // обновляем узлы
-    equations.update(incMatrix, loops, branches, elements);                             // обновляем систему уравнений
+    return mnaEquations;
 }
 
 } // namespace CS
@@ -1,36 +1,57 @@
 #pragma once
 
-#include <map>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
 
 #include "circuit-solver/common.h"
 #include "circuit-solver/circuit_configuration/elements.h"
 #include "circuit-solver/circuit_configuration/pin_matrix.h"
 #include "circuit-solver/circuit_configuration/nodes.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
 // класс для представления ветвей схемы
+// ветви трассируются от пинов узлов по соседним пинам (через элемент и через
+// соединение "проводом"), поэтому время построения пропорционально числу пинов
+// после частичного обновления групп пинов ветви можно обновить частично (patch):
+// заново трассируются только ветви, проходящие через пересчитанные группы, остальные
+// ветви сохраняют свои номера (таблица новых номеров ветвей по старым при этом
+// строится проходом по всем ветвям)
 //////////////////////////////////////////////////////////////////////////////////////////
 class Branches
 {
 public:
     void update(const PinMatrix& matrix, const Nodes& nodes,
                 const Elements& elements);                                              // метод обновления всех структур
+    void patch(const PinMatrix& matrix, const Nodes& nodes,
+               const Elements& elements);                                               // метод частичного обновления после PinMatrix::patch
+    const SizeVect& getIndexMap() const;                                                // геттер новых номеров ветвей по старым (после patch)
+    const SizeVect& getChangedBranches() const;                                         // геттер номеров ветвей, измененных последним patch
     const SizeMatr& get() const;                                                        // геттер для списка ветвей branches
     const SizeVect& operator[] (size_t index) const;                                    // геттер строки списка ветвей branches (одномерного вектора)
-    const BoolMatr& getBranchesOnPins() const;                                          // геттер матрицы branchesOnPins
+    const IntVect& getBranchesForPin() const;                                           // геттер вектора branchesForPin
     size_t size() const;                                                                // геттер размера списка ветвей branches
     size_t getCurrentSourceCount() const;                                               // геттер счетчика источников тока
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
     friend std::ostream& operator<<(std::ostream& os, const Branches& branches);        // перегрузка оператора вывода в поток
 
 private:
     SizeMatr branches;                                                                  // вектор векторов номеров пинов, представляющий список ветвей схемы
-    BoolMatr branchesOnPins;                                                            // матрица-отношение между множеством ветвей и пинов
+    IntVect branchesForPin;                                                             // вектор номеров ветвей, в которые входят пины (-1 - пин не входит в ветвь)
     size_t currentSourceCount = 0;                                                      // счетчик источников тока
-
-    void sortBranches(BoolVect branchesWithCurrentSource);                              // метод сортировки ветвей в списке mBranches по наличию источника тока
-    void updateBranchesOnPins(const size_t pinCount);                                   // метод обновления матрицы mBranchesOnPins
-    BoolVect findBranchesWithCurrentSource(const Elements& elements) const;             // метод построения вектора индикации наличия в i-ой ветви источника тока 
+    SizeVect indexMap;                                                                  // новые номера ветвей по старым (NONE - ветвь удалена)
+    SizeVect changedBranches;                                                           // номера ветвей, измененных последним patch (по возрастанию)
+
+    SizeVect traceBranch(size_t pin, const PinMatrix& matrix, const Nodes& nodes) const; // метод трассировки ветви от пина узла
+    SizeVect matchBranches(const std::vector<std::pair<size_t, size_t>>& ends, SizeMatr (&newBranches)[2],
+                           size_t unknownCount);                                        // метод сохранения мест ветвей с теми же концами
+    void moveBranch(size_t from, size_t to, SizeVect& origins);                         // метод перемещения ветви на другое место списка
+    void sortBranches(const Elements& elements);                                        // метод сортировки ветвей в списке branches по наличию источника тока
+    void updateBranchesForPin(const size_t pinCount);                                   // метод обновления вектора branchesForPin
+    static bool hasCurrentSource(const SizeVect& branch, const Elements& elements);     // метод проверки наличия в ветви источника тока
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -40,52 +61,202 @@ private:
 // принимает на вход: 
 // 1) матрицу соединений пинов, по которой осуществляется поиск последовательностей пинов
 // 2) объект nodes для информации об узлах схемы
-// 4) вектор элементов схемы для определения принадлежности пина источнику тока 
+// 3) вектор элементов схемы для определения принадлежности пина источнику тока
+// при пине вне узла, не соединенном ровно с одним другим пином, выбрасывает
+// исключение std::runtime_error (ветвь не может быть продолжена)
 inline void Branches::update(const PinMatrix& matrix, const Nodes& nodes,
                              const Elements& elements)
 {
     branches.clear();                                                                   // очищаем текущий вектор ветвей
     BoolVect pinsInBranches(matrix.size(), false);                                      // нулевой вектор для индикации выводов, участвующих в формировании ветвей
 
-    for (size_t i = 0; i < nodes.size() - 1; i++)                                       // перебор по узлам схемы (- 1, т.к. каждая ветвь начинается и заканчивается в узле)
-    {                                                                                   // т.е. если от n-1 узлов все ветви построены, то от n-ого узла не построить новую
+    for (size_t i = 0; i < nodes.size(); i++)                                           // перебор по узлам схемы (от последнего узла новыми могут быть только ветви,
+    {                                                                                   // замкнутые на него же, - их тоже нужно построить)
         for (size_t j = 0; j < nodes[i].size(); j++)                                    // перебор по выводам i-го узла (строим ветви от узла во все стороны)
         {
             if (!pinsInBranches[nodes[i][j]])                                            // если рассматриваемый пин nodes[i][j] не входит ни в одну из ветвей
             {
-                size_t pinForBranch = nodes[i][j];                                      // сохраняем номер этого пина в переменную - он будет первым в новой ветви
-                branches.push_back({});                                                 // добавляем новую ветвь
+                branches.push_back(traceBranch(nodes[i][j], matrix, nodes));            // строим ветвь от этого пина
 
-                do                                                                      // один элемент точно добавим (потом может быть узел или другой элемент)
+                for (size_t pin : branches.back())                                      // делаем отметку о том, что пины ветви вошли в ветвь
                 {
-                    branches.back().push_back(pinForBranch);                            // добавляем в ветвь пин pinForBranch
-                    pinsInBranches[pinForBranch] = true;                                // делаем отметку о том, что пин pinForBranch вошел в ветвь
+                    pinsInBranches[pin] = true;
+                }
+            }
+        }
+    }
 
-                    pinForBranch += ((pinForBranch + 1) % 2) - (pinForBranch % 2);      // переинициализируем пин pinForBranch соседним по элементу пином: четный номер
-                                                                                        // инкрементируем, нечетный - декрементриуем. т.к. элементы расположены по порядку
-                    branches.back().push_back(pinForBranch);                            // добавляем в ветвь пин pinForBranch
-                    pinsInBranches[pinForBranch] = true;                                // делаем отметку о том, что пин pinForBranch вошел в ветвь    
-
-                    if (nodes.getNodesForPin()[pinForBranch] >= 0)                      // если пин pinForBranch напрямую соединен с каким-нибудь узлом (-1 - не соединен)
-                    {
-                        break;                                                          // выходим из цикла формирования ветви
-                    }
-
-                    for (size_t k = pinForBranch + 1; ; k++)                            // перебор по строкам матрицы соединений
-                    {
-                         if (matrix[k][pinForBranch])                                   // ищем пин, с которым соединен пин pinForBranch (не через элемент, а "проводом")
-                        {
-                            pinForBranch = k;                                           // переинициализируем pinForBranch выводом, соединенным с ним
-                            break;                                                      // выходим из цикла поиска
-                        }
-                    }
-                } while (true);                                                         // бесконечный цикл
+    sortBranches(elements);                                                             // сортируем ветви по признаку наличия в ветви источника тока
+    updateBranchesForPin(matrix.size());                                                // обновляем отношение пинов и ветвей
+    indexMap.clear();
+    changedBranches.clear();
+}
+
+// метод частичного обновления ветвей после частичного обновления групп пинов:
+// удаляются ветви, проходящие через пины пересчитанных групп, и заново трассируются
+// ветви от узловых пинов этих групп и удаленных ветвей (за пределы этих пинов новые
+// ветви не выходят: за ними соединения не менялись); новая ветвь с теми же концами,
+// что у удаленной, сразу занимает ее место (см. matchBranches)
+// освободившиеся места заполняются новыми ветвями, остальные - последними ветвями
+// своей части списка, так что ветви с источниками тока остаются в конце, а номера
+// большинства ветвей сохраняются; новые номера старых ветвей - см. getIndexMap,
+// номера измененных мест - см. getChangedBranches
+// принимает на вход:
+// 1) матрицу соединений пинов после patch
+// 2) объект nodes, обновленный по этой матрице
+// 3) вектор элементов схемы
+inline void Branches::patch(const PinMatrix& matrix, const Nodes& nodes,
+                            const Elements& elements)
+{
+    static constexpr size_t NONE = PinMatrix::NONE;                                     // отсутствующий номер ветви
+
+    const SizeVect& changedPins = matrix.getChangedPins();                              // пины пересчитанных групп
+    SizeVect removed;                                                                   // номера удаляемых ветвей
+    SizeVect region(changedPins);                                                       // пины, от которых трассируются новые ветви
+
+    branchesForPin.resize(matrix.size(), -1);                                           // новые пины еще не входят в ветви
+    changedBranches.clear();
+
+    for (size_t pin : changedPins)                                                      // ветви, проходящие через пересчитанные группы
+    {
+        if (branchesForPin[pin] >= 0)
+        {
+            removed.push_back(branchesForPin[pin]);
+        }
+    }
+
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+    std::vector<std::pair<size_t, size_t>> ends;                                        // концевые пины удаляемых ветвей (пин, ветвь)
+
+    for (size_t branch : removed)                                                       // освобождаем пины удаляемых ветвей
+    {
+        ends.emplace_back(branches[branch].front(), branch);
+        ends.emplace_back(branches[branch].back(), branch);
+
+        for (size_t pin : branches[branch])
+        {
+            branchesForPin[pin] = -1;
+            region.push_back(pin);
+        }
+    }
+
+    std::sort(region.begin(), region.end());
+    region.erase(std::unique(region.begin(), region.end()), region.end());
+
+    SizeMatr newBranches[2];                                                            // новые ветви без источников тока и с ними
+
+    for (size_t pin : region)                                                           // трассируем новые ветви от узловых пинов области
+    {
+        if (nodes.getNodesForPin()[pin] < 0 || branchesForPin[pin] != -1)               // пин вне узла или уже вошел в новую ветвь
+        {
+            continue;
+        }
+
+        SizeVect branch = traceBranch(pin, matrix, nodes);
+
+        for (size_t branchPin : branch)                                                 // временная отметка о вхождении пина в новую ветвь
+        {
+            branchesForPin[branchPin] = -2;
+        }
+
+        newBranches[hasCurrentSource(branch, elements)].push_back(std::move(branch));
+    }
+
+    size_t unknownCount = branches.size() - currentSourceCount;                         // граница частей списка ветвей
+    std::sort(ends.begin(), ends.end());
+    SizeVect reused = matchBranches(ends, newBranches, unknownCount);                   // ветви, сохранившие свои места
+    SizeVect rest;                                                                      // удаляемые ветви, не нашедшие замены
+
+    std::sort(reused.begin(), reused.end());
+    std::set_difference(removed.begin(), removed.end(), reused.begin(), reused.end(),
+                        std::back_inserter(rest));
+    removed.swap(rest);
+
+    size_t oldSize = branches.size();
+    SizeVect origins(oldSize);                                                          // старый номер ветви на каждом месте (NONE - новая ветвь)
+    std::iota(origins.begin(), origins.end(), 0);
+
+    indexMap = origins;                                                                 // новые номера старых ветвей
+
+    for (size_t branch : removed)
+    {
+        indexMap[branch] = NONE;
+    }
+
+    for (auto it = removed.rbegin(); it != removed.rend() && *it >= unknownCount; ++it) // удаляем ветви с источниками тока (с конца): место занимает
+    {                                                                                   // последняя ветвь
+        moveBranch(branches.size() - 1, *it, origins);
+        branches.pop_back();
+        origins.pop_back();
+    }
+
+    for (auto it = removed.rbegin(); it != removed.rend(); ++it)                        // удаляем ветви без источников тока (с конца): место занимает
+    {                                                                                   // последняя ветвь этой части, ее место - последняя ветвь списка
+        if (*it >= unknownCount)
+        {
+            continue;
+        }
+
+        moveBranch(unknownCount - 1, *it, origins);
+        moveBranch(branches.size() - 1, unknownCount - 1, origins);
+        branches.pop_back();
+        origins.pop_back();
+        unknownCount--;
+    }
+
+    for (SizeVect& branch : newBranches[0])                                             // новые ветви без источников тока - в конец своей части,
+    {                                                                                   // первая ветвь с источником тока переносится в конец списка
+        branches.emplace_back();
+        origins.push_back(NONE);
+        moveBranch(unknownCount, branches.size() - 1, origins);
+        branches[unknownCount] = std::move(branch);
+        origins[unknownCount] = NONE;
+        changedBranches.push_back(unknownCount++);
+    }
+
+    for (SizeVect& branch : newBranches[1])                                             // новые ветви с источниками тока - в конец списка
+    {
+        changedBranches.push_back(branches.size());
+        branches.push_back(std::move(branch));
+        origins.push_back(NONE);
+    }
+
+    for (size_t i = branches.size(); i < oldSize; i++)                                  // места, которых больше нет, тоже изменились
+    {
+        changedBranches.push_back(i);
+    }
+
+    std::sort(changedBranches.begin(), changedBranches.end());
+    changedBranches.erase(std::unique(changedBranches.begin(), changedBranches.end()),
+                          changedBranches.end());
+    currentSourceCount = branches.size() - unknownCount;
+
+    for (size_t i : changedBranches)                                                    // обновляем отношение пинов и ветвей на измененных местах
+    {
+        if (i < branches.size())
+        {
+            for (size_t pin : branches[i])
+            {
+                branchesForPin[pin] = static_cast<int>(i);
             }
         }
     }
+}
 
-    sortBranches(findBranchesWithCurrentSource(elements));                              // сортируем ветви по признаку наличия в ветви источника тока 
-    updateBranchesOnPins(matrix.size());                                                // обновляем матрицу-отношение mNodesOnPins
+// геттер новых номеров ветвей по номерам до последнего patch
+// (NONE - ветвь удалена; после update - пустой)
+inline const SizeVect& Branches::getIndexMap() const
+{
+    return indexMap;
+}
+
+// геттер номеров мест списка ветвей, содержимое которых изменил последний patch
+// (включая места за концом списка, если он сократился; после update - пустой)
+inline const SizeVect& Branches::getChangedBranches() const
+{
+    return changedBranches;
 }
 
 // геттер для списка ветвей branches
@@ -100,10 +271,10 @@ inline const SizeVect& Branches::operator[](size_t index) const
     return branches[index];
 }
 
-// геттер матрицы branchesOnPins
-inline const BoolMatr& Branches::getBranchesOnPins() const
+// геттер вектора branchesForPin
+inline const IntVect& Branches::getBranchesForPin() const
 {
-    return branchesOnPins;
+    return branchesForPin;
 }
 
 // геттер размера списка ветвей branches
@@ -138,66 +309,198 @@ inline std::ostream& operator<<(std::ostream& os, const Branches& branches)
     return os;
 }
 
-// метод для сортировки ветвей в векторе branches по наличию источника тока
-// ветви с источником тока - в конец вектора (так с ними потом удобнее работать)
-// принимает на вход: булевый вектор наличия источника тока в i-ой ветви
-inline void Branches::sortBranches(BoolVect branchesWithCurrentSource)
+// метод трассировки ветви от пина узла: ветвь продолжается через элемент и через
+// соединение "проводом" до пина, входящего в узел
+// принимает на вход:
+// 1) пин узла, с которого начинается ветвь
+// 2) матрицу соединений пинов, по которой осуществляется поиск последовательностей пинов
+// 3) объект nodes для информации об узлах схемы
+// возвращает ветвь (последовательность номеров пинов)
+// при пине вне узла, не соединенном ровно с одним другим пином, выбрасывает
+// исключение std::runtime_error (ветвь не может быть продолжена)
+inline SizeVect Branches::traceBranch(size_t pin, const PinMatrix& matrix,
+                                      const Nodes& nodes) const
 {
-    std::multimap<bool, SizeVect> sortedBranches;                                       // создаем словарь (multimap, т.к. ключи не являются уникальными)
-                                                                                            
-    for (size_t i = 0; i < branches.size(); i++)                                    
+    SizeVect branch;
+    size_t pinForBranch = pin;                                                          // первый пин ветви
+
+    do                                                                                  // один элемент точно добавим (потом может быть узел или другой элемент)
     {
-        sortedBranches.emplace(branchesWithCurrentSource[i], branches[i]);              // наполняем словарь парами (ключ: содержит ли ветвь источник тока,
-    }                                                                                   // значение: непосредственно, ветвь)
+        branch.push_back(pinForBranch);                                                 // добавляем в ветвь пин pinForBranch
+        pinForBranch += ((pinForBranch + 1) % 2) - (pinForBranch % 2);                  // переинициализируем пин pinForBranch соседним по элементу пином: четный номер
+                                                                                        // инкрементируем, нечетный - декрементриуем. т.к. элементы расположены по порядку
+        branch.push_back(pinForBranch);                                                 // добавляем в ветвь пин pinForBranch
+
+        if (nodes.getNodesForPin()[pinForBranch] >= 0)                                  // если пин pinForBranch напрямую соединен с каким-нибудь узлом (-1 - не соединен)
+        {
+            break;                                                                      // выходим из цикла формирования ветви
+        }
+
+        size_t wiredPin = matrix.getWiredPin(pinForBranch);                             // пин, с которым соединен пин pinForBranch (не через элемент, а "проводом")
+
+        if (wiredPin == PinMatrix::NONE)                                                // вне узла пин должен быть соединен ровно с одним другим пином
+        {
+            throw std::runtime_error("Pin " + std::to_string(pinForBranch) + " is not connected");
+        }
+
+        pinForBranch = wiredPin;                                                        // переинициализируем pinForBranch выводом, соединенным с ним
+    } while (true);                                                                     // бесконечный цикл
+
+    return branch;
+}
+
+// метод сопоставления заново трассированных ветвей удаляемым: новая ветвь с теми же
+// концевыми пинами, что у удаляемой, занимает ее место (направление прежнее), так
+// что неизвестная этой ветви сохраняется (замкнутость контуров через нее проверяет
+// Loops::patch); место считается измененным, только если изменились пины ветви
+// принимает на вход:
+// 1) концевые пины удаляемых ветвей (пин, ветвь) по возрастанию
+// 2) новые ветви без источников тока и с ними (сопоставленные из них удаляются)
+// 3) количество ветвей без источников тока до обновления
+// возвращает номера удаляемых ветвей, места которых заняты
+inline SizeVect Branches::matchBranches(const std::vector<std::pair<size_t, size_t>>& ends,
+                                        SizeMatr (&newBranches)[2], size_t unknownCount)
+{
+    SizeVect reused;
 
-    size_t i = 0;                                                                       // счетчик для индексации по списку ветвей
-    for (auto& item : sortedBranches)                                                   // range-based цикл для перебора по словарю
+    for (size_t part = 0; part < 2; part++)
     {
-        branches[i] = item.second;                                                      // переписываем ветвь
-        i++;                                                                            // инкрементируем счетчик
-     }
+        SizeMatr& list = newBranches[part];
 
-    currentSourceCount = sortedBranches.count(true);                                    // считаем источники тока и сохраняем
+        for (size_t i = 0; i < list.size(); )
+        {
+            SizeVect& branch = list[i];
+            auto it = std::lower_bound(ends.begin(), ends.end(), std::make_pair(branch.front(), size_t(0)));
+
+            if (it == ends.end() || it->first != branch.front() || (it->second < unknownCount) != (part == 0))
+            {
+                i++;
+                continue;
+            }
+
+            SizeVect& target = branches[it->second];
+
+            if (target.front() != branch.front())                                       // сохраняем прежнее направление ветви
+            {
+                std::reverse(branch.begin(), branch.end());
+            }
+
+            if (target.front() != branch.front() || target.back() != branch.back())     // другой конец у ветвей разный
+            {
+                i++;
+                continue;
+            }
+
+            if (target != branch)
+            {
+                target.swap(branch);
+                changedBranches.push_back(it->second);
+            }
+
+            for (size_t pin : target)
+            {
+                branchesForPin[pin] = static_cast<int>(it->second);
+            }
+
+            reused.push_back(it->second);
+            list[i].swap(list.back());
+            list.pop_back();
+        }
+    }
+
+    return reused;
+}
+
+// метод перемещения ветви на место to (ветвь на месте from становится пустой)
+// учитывает перемещение в отношении старых и новых номеров ветвей
+// принимает на вход:
+// 1) место, с которого перемещается ветвь
+// 2) место, на которое перемещается ветвь
+// 3) старые номера ветвей на каждом месте (NONE - новая ветвь)
+inline void Branches::moveBranch(size_t from, size_t to, SizeVect& origins)
+{
+    if (from == to)
+    {
+        return;
+    }
+
+    branches[to] = std::move(branches[from]);
+    origins[to] = origins[from];
+
+    if (origins[to] != PinMatrix::NONE)
+    {
+        indexMap[origins[to]] = to;
+    }
+
+    changedBranches.push_back(to);
+}
+
+// метод для сортировки ветвей в векторе branches по наличию источника тока
+// ветви с источником тока - в конец вектора (так с ними потом удобнее работать)
+// сортировка устойчивая и выполняется на месте: порядок ветвей внутри каждой
+// из двух групп сохраняется
+// принимает на вход: вектор элементов схемы для определения типа элемента
+inline void Branches::sortBranches(const Elements& elements)
+{
+    auto partitionPoint = std::stable_partition(branches.begin(), branches.end(),       // ветви без источников тока - в начало
+        [&elements](const SizeVect& branch) { return !hasCurrentSource(branch, elements); });
+
+    currentSourceCount = branches.end() - partitionPoint;                               // считаем источники тока и сохраняем
 }
 
-// обновления матрицы-отношения между множествами ветвей и пинов такой, что:
-// если branchesOnPins[i][j] равно единице, i-ая ветвь содержит j-ый пин 
+// обновление отношения между множествами пинов и ветвей такого, что:
+// branchesForPin[i] - номер ветви, содержащей i-ый пин (-1 - пин не входит в ветвь)
 // принимает на вход: счетчик пинов схемы
-inline void Branches::updateBranchesOnPins(const size_t pinCount)
+inline void Branches::updateBranchesForPin(const size_t pinCount)
 {
-    branchesOnPins = BoolMatr(branches.size(), BoolVect(pinCount, false));              // создаем матрицу размера branches.size() x pinCount, заполненную false
+    branchesForPin = IntVect(pinCount, -1);                                             // создаем вектор размера pinCount, заполненный -1
 
     for (size_t i = 0; i < branches.size(); i++)                                        // перебираем ветви
     {
-        for (size_t j = 0; j < branches[i].size(); j++)                                 // перебираем пины i-ой ветви
+        for (size_t pin : branches[i])                                                  // перебираем пины i-ой ветви
         {
-            branchesOnPins[i][branches[i][j]] = true;                                   // в i-ой строке (соответствует i-ой ветви) инициализируем истиной элемент,
-        }                                                                               // находящийся в столбце, номер которого хранит в себе j-ый элемент i-ой ветви
-    }                                                                                   // (то есть номер пина, который содержится в i-ой ветви)
+            branchesForPin[pin] = static_cast<int>(i);                                  // пин входит в i-ую ветвь
+        }
+    }
 }
 
-// метод создания вектора отметок о ветвях, содержащих источники тока, такого, что:
-// если branchesWithCurrentSource[i] равно единице, i-ая ветвь содержит источник тока
-// принимает на вход: вектор элементов схемы для определения типа элемента;
-inline BoolVect Branches::findBranchesWithCurrentSource(const Elements& elements) const
+// метод проверки наличия в ветви источника тока
+// принимает на вход:
+// 1) ветвь (последовательность номеров пинов)
+// 2) вектор элементов схемы для определения типа элемента
+inline bool Branches::hasCurrentSource(const SizeVect& branch, const Elements& elements)
 {
-    BoolVect branchesWithCurrentSource(branches.size(), false);                         // создаем вектор размером branches.size() и заполняем его false
-    size_t foundCurrentSourceCount = 0;                                                 // переменная, хранящая в себе количество найденных источников тока 
-
-    for (size_t i = 0; i < branches.size(); i++)                                        // перебираем ветви
+    for (size_t j = 0; j < branch.size(); j += 2)                                       // перебираем элементы ветви
     {
-        for (size_t j = 0; j < branches[i].size(); j += 2)                              // перебираем элементы ветви
+        if (elements[branch[j] / 2].getType() == Element::Type::J)                      // если данный вывод принадлежит источнику тока
         {
-            if (elements[branches[i][j] / 2].getType() == Element::Type::J)             // если данный вывод принадлежит источнику тока
-            {
-                branchesWithCurrentSource[i] = true;                                    // инициализируем элемент массива - ветвь содержит источник тока
-                foundCurrentSourceCount++;                                              // инкрементируем счетчик найденных источников тока
-                break;                                                                  // выходим из цикла перебора ветви по элементам (т.к. в одной ветви
-            }                                                                           // не может быть двух источников тока)
+            return true;                                                                // в одной ветви не может быть двух источников тока
         }
     }
 
-    return branchesWithCurrentSource;                                                   // возвращаем искомый вектор
+    return false;
+}
+
+// метод записи списка ветвей в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void Branches::save(BinaryWriter& writer) const
+{
+    writer.write(branches);
+    writer.write(branchesForPin);
+    writer.write(currentSourceCount);
+}
+
+// метод чтения списка ветвей из двоичного буфера, записанного методом save
+// (как после полного обновления: сведения о последнем patch очищаются)
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void Branches::load(BinaryReader& reader)
+{
+    reader.read(branches);
+    reader.read(branchesForPin);
+    reader.read(currentSourceCount);
+    indexMap.clear();
+    changedBranches.clear();
 }
 
 } // namespace CS
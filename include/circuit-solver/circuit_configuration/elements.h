@@ -2,24 +2,36 @@
 
 #include "circuit-solver/common.h"
 #include "circuit-solver/structure_units/element.h"
+#include "circuit-solver/netlist/binary_netlist.h"
 
 namespace CS
 {
 // класс для хранения массива элементов схемы
+// удаленный элемент оставляет на своем месте ни с чем не соединенное сопротивление
+// (номера пинов остальных элементов не меняются), а его место занимает следующий
+// элемент, вставленный методом insert
 //////////////////////////////////////////////////////////////////////////////////////////
 class Elements
 {
 public:
     void add(const Element& element);                                                   // метод для добавления нового элемента
+    void add(const ElemVect& list);                                                     // метод добавления всех элементов списка
+    void add(const BinaryNetlist& netlist);                                             // метод добавления всех элементов двоичного описания схемы
+    size_t insert(const Element& element);                                              // метод вставки элемента на свободное место (или в конец)
+    void remove(size_t index);                                                          // метод удаления элемента
+    bool isRemoved(size_t index) const;                                                 // метод проверки, удален ли элемент
     const Element& operator[] (size_t index) const;                                     // константный оператор обращения к элементу по индексу
     Element& operator[] (size_t index);                                                 // неконстантный оператор обращения к элементу по индексу
     size_t size() const;                                                                // геттер размера массива элементов
+    DoubleVect getValues() const;                                                       // геттер значений всех элементов подряд
     size_t getCurrentSourceCount() const;                                               // геттер счетчика источников тока
     size_t getVoltageSourceCount() const;                                               // геттер счетчика источников напряжения
     size_t getResistanceCount() const;                                                  // геттер счетчика сопротивлений
 
 private:
     ElemVect elements;                                                                  // вектор объектов типа Element
+    BoolVect removed;                                                                   // признаки удаленных элементов
+    SizeVect freeIndices;                                                               // индексы удаленных элементов (свободные места)
     size_t currentSourceCount = 0;                                                      // счетчик источников тока
     size_t voltageSourceCount = 0;                                                      // счетчик источников напряжения
     size_t resistanceCount = 0;                                                         // счетчик сопротивлений
@@ -43,6 +55,113 @@ inline void Elements::add(const Element& element)
     case Element::Type::R:                                                              //
         resistanceCount++;                                                              //
     }
+
+    removed.push_back(false);
+}
+
+// метод добавления всех элементов списка в конец (номера пинов элементов списка
+// должны быть даны уже с учетом элементов, добавленных ранее)
+// принимает на вход: список элементов
+inline void Elements::add(const ElemVect& list)
+{
+    elements.reserve(elements.size() + list.size());
+
+    for (const Element& element : list)
+    {
+        elements.push_back(element);
+        currentSourceCount += element.getType() == Element::Type::J;
+        voltageSourceCount += element.getType() == Element::Type::E;
+        resistanceCount += element.getType() == Element::Type::R;
+    }
+
+    removed.resize(elements.size(), false);
+}
+
+// метод добавления всех элементов двоичного описания схемы в конец списка:
+// элементы собираются одним проходом по массивам отображенного файла, без разбора
+// принимает на вход: двоичное описание схемы
+inline void Elements::add(const BinaryNetlist& netlist)
+{
+    const double* values = netlist.getValues();
+    const int32_t* linkedPins = netlist.getLinkedPins();
+
+    elements.reserve(elements.size() + netlist.size());
+
+    for (size_t i = 0; i < netlist.size(); i++)
+    {
+        Element::Type type = netlist.getType(i);
+        elements.emplace_back(type, values[i], linkedPins[2 * i], linkedPins[2 * i + 1]);
+        currentSourceCount += type == Element::Type::J;
+        voltageSourceCount += type == Element::Type::E;
+        resistanceCount += type == Element::Type::R;
+    }
+
+    removed.resize(elements.size(), false);
+}
+
+// метод вставки элемента: занимает место последнего удаленного элемента, если
+// такое есть, иначе добавляет элемент в конец
+// возвращает индекс элемента
+inline size_t Elements::insert(const Element& element)
+{
+    if (freeIndices.empty())
+    {
+        add(element);
+        return elements.size() - 1;
+    }
+
+    size_t index = freeIndices.back();                                                  // занимаем свободное место
+    freeIndices.pop_back();
+
+    elements[index] = element;                                                          // заглушка в счетчиках не учитывалась
+    removed[index] = false;
+
+    switch (element.getType())                                                          // учитываем тип нового элемента
+    {
+    case Element::Type::J:
+        currentSourceCount++;
+        break;
+    case Element::Type::E:
+        voltageSourceCount++;
+        break;
+    case Element::Type::R:
+        resistanceCount++;
+    }
+
+    return index;
+}
+
+// метод удаления элемента: элемент заменяется ни с чем не соединенным сопротивлением,
+// которое не входит ни в одну ветвь; соединения других пинов с пинами элемента
+// должны быть перенаправлены заранее
+inline void Elements::remove(size_t index)
+{
+    if (removed[index])                                                                 // элемент уже удален
+    {
+        return;
+    }
+
+    switch (elements[index].getType())                                                  // уменьшаем счетчик типа удаляемого элемента
+    {
+    case Element::Type::J:
+        currentSourceCount--;
+        break;
+    case Element::Type::E:
+        voltageSourceCount--;
+        break;
+    case Element::Type::R:
+        resistanceCount--;
+    }
+
+    elements[index] = Element(Element::Type::R, 0, -1, -1);                             // заглушка не участвует в расчете
+    removed[index] = true;
+    freeIndices.push_back(index);
+}
+
+// метод проверки, удален ли элемент
+inline bool Elements::isRemoved(size_t index) const
+{
+    return removed[index];
 }
 
 // константный оператор обращения к элементу по индексу
@@ -63,6 +182,20 @@ inline size_t Elements::size() const
     return elements.size();
 }
 
+// геттер значений всех элементов подряд (в порядке списка элементов, у удаленных
+// элементов - нулевые); по таким массивам значений вычисляются коэффициенты систем
+inline DoubleVect Elements::getValues() const
+{
+    DoubleVect values(elements.size());
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        values[i] = elements[i].getValue();
+    }
+
+    return values;
+}
+
 // геттер счетчика источников тока
 inline size_t Elements::getCurrentSourceCount() const
 {
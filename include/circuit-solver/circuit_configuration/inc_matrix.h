@@ -1,37 +1,70 @@
 #pragma once
 
+#include <algorithm>
+
 #include "circuit-solver/common.h"
 #include "circuit-solver/circuit_configuration/elements.h"
 #include "circuit-solver/circuit_configuration/nodes.h"
 #include "circuit-solver/circuit_configuration/branches.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
 // класс для представления матрицы инцидентности схемы
+// в строке матрицы не больше двух ненулевых элементов, поэтому матрица хранится
+// разреженно: для каждой ветви - пара узлов (из которого ток вытекает и в который
+// втекает), для каждого узла - инцидентные ему ветви по возрастанию номеров (участки
+// узлов в одном массиве заданы началом и концом)
+// плотная матрица строится только при выводе в поток
+// после частичного обновления узлов и ветвей матрицу можно обновить частично (patch):
+// пересчитываются только строки измененных ветвей и столбцы узлов, которым они
+// инцидентны (см. getChangedBranches, getChangedNodes)
 //////////////////////////////////////////////////////////////////////////////////////////
 class IncMatrix
 {
 public:
     void update(const Nodes& nodes, const Branches& branches,
                 const Elements& elements);                                              // метод обновления матрицы
-    size_t size() const;                                                                // геттер размера матрицы
+    void patch(const Nodes& nodes, const Branches& branches,
+               const Elements& elements);                                               // метод частичного обновления после Nodes::patch и Branches::patch
+    const SizeVect& getChangedBranches() const;                                         // геттер номеров строк, измененных последним patch
+    const SizeVect& getChangedNodes() const;                                            // геттер номеров столбцов, измененных последним patch
+    size_t size() const;                                                                // геттер количества строк матрицы (ветвей)
+    size_t getNodeCount() const;                                                        // геттер количества столбцов матрицы (узлов)
     size_t getUnknownCurrentCount() const;                                              // геттер счетчика неизвестных токов
-    const IntVect& operator[] (size_t index) const;                                     // геттер строки матрицы (одномерного вектора)
+    size_t getFrom(size_t branch) const;                                                // геттер узла, из которого вытекает ток ветви
+    size_t getTo(size_t branch) const;                                                  // геттер узла, в который втекает ток ветви
+    SizeRange getNodeBranches(size_t node) const;                                       // геттер ветвей, инцидентных узлу (по возрастанию)
+    int operator() (size_t branch, size_t node) const;                                  // геттер элемента матрицы
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
     friend std::ostream& operator<<(std::ostream& os, const IncMatrix& matrix);         // перегрузка оператора вывода в поток
 
 private:
-    IntMatr matrix;                                                                     // двумерная матрица для хранения информации об инцидентности ветвей узлам
+    SizeVect branchFrom;                                                                // номера узлов, из которых вытекают токи ветвей
+    SizeVect branchTo;                                                                  // номера узлов, в которые втекают токи ветвей
+    SizeVect nodeStarts;                                                                // начала и концы участков узлов в массиве nodeBranches
+    SizeVect nodeEnds;                                                                  //
+    SizeVect nodeBranches;                                                              // номера ветвей, инцидентных узлам (после patch - с прежними участками)
     size_t unknownCurrentCount = 0;                                                     // счетчик неизвестных токов
+    SizeVect changedBranches;                                                           // номера строк, измененных последним patch (по возрастанию)
+    SizeVect changedNodes;                                                              // номера столбцов, измененных последним patch (по возрастанию)
 
     void orient(const Nodes& nodes, const Branches& branches,
                 const Elements& elements);                                              // метод выбора направления токов (ориентирования матрицы)
+    void orientBranch(size_t branch, const Nodes& nodes, const Branches& branches,
+                      const Elements& elements);                                        // метод выбора направления тока ветви
+    void updateNodeBranches(size_t nodeCount);                                          // метод построения списков ветвей узлов
+    void compactNodeBranches();                                                         // метод удаления прежних участков узлов из nodeBranches
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
 // метод обновления матрицы-отношения между множествами ветвей и узлов такой, что:
-// если matrix[i][j] равно -1, ток в i-ой ветви вытекает из j-го узла;
-// если matrix[i][j] равно 1, ток в i-ой ветви втекает в j-ый узел;
+// если (i, j) равно -1, ток в i-ой ветви вытекает из j-го узла;
+// если (i, j) равно 1, ток в i-ой ветви втекает в j-ый узел;
+// с узлами соединены только крайние пины ветви, поэтому узлы ветви находятся
+// по ее первому и последнему пинам за O(1), вся матрица - за O(ветвей + узлов)
 // принимает на вход:
 // 1) объект nodes для информации об узлах схемы
 // 2) объект branches для информации о ветвях схемы
@@ -39,36 +72,182 @@ private:
 inline void IncMatrix::update(const Nodes& nodes, const Branches& branches,
                               const Elements& elements)
 {
-    matrix = IntMatr(branches.size(), IntVect(nodes.size(), 0));                        // создаем нулевую матрицу размера branchesSize x nodesSize, заполненную нулями
+    orient(nodes, branches, elements);                                                  // находим узлы ветвей и ориентируем матрицу инцидентности
+    updateNodeBranches(nodes.size());                                                   // строим списки ветвей узлов
+    changedBranches.clear();
+    changedNodes.clear();
+}
 
-    const BoolMatr& branchesOnPins = branches.getBranchesOnPins();                      // сохраняем матрицы-отношения в отдельные переменные для краткости
-    const BoolMatr& nodesOnPins = nodes.getNodesOnPins();                               //
+// метод частичного обновления матрицы после частичного обновления узлов и ветвей:
+// строки пересчитываются для измененных ветвей и ветвей, инцидентных измененным
+// узлам (номера их узлов могли измениться), столбцы - для измененных узлов и узлов,
+// которым эти ветви были или стали инцидентны (если ветвь на месте прежняя и ее
+// узлы те же, ее узлы не затрагиваются); список ветвей узла строится по ветвям его
+// пинов, поэтому время пропорционально количеству измененных строк и столбцов
+// принимает на вход:
+// 1) объект nodes после patch
+// 2) объект branches после patch
+// 3) последовательность элементов для информации об источниках тока
+inline void IncMatrix::patch(const Nodes& nodes, const Branches& branches,
+                             const Elements& elements)
+{
+    const IntVect& branchesForPin = branches.getBranchesForPin();
+    const SizeVect& replaced = branches.getChangedBranches();                           // места с другими ветвями или пинами
+    size_t oldSize = size();
+    SizeVect candidates = replaced;                                                     // строки, которые могли измениться
 
-    for (size_t i = 0; i < branchesOnPins.size(); i++)                                  // перебираем строки первого отношения (ветви)
+    for (size_t node : nodes.getChangedNodes())                                         // ветви измененных узлов
     {
-        for (size_t j = 0; j < nodesOnPins.size(); j++)                                 // перебираем строки второго отношения (узлы)
+        if (node < nodes.size())
         {
-            for (size_t k = 0; k < nodesOnPins[j].size(); k++)                          // перебираем столбцы отношений (пины)
+            for (size_t pin : nodes[node])
             {
-                matrix[i][j] |= 
-                    nodesOnPins[j][k] && branchesOnPins[i][k];                          // дизъюнкция всех конъюнкций элемента из первого отношения с элементом из второго
-            }                                                                           // (если у узла j найдется хоть один общий пин с ветвью i, то соединяем их)
+                if (branchesForPin[pin] >= 0)
+                {
+                    candidates.push_back(branchesForPin[pin]);
+                }
+            }
         }
     }
 
-    orient(nodes, branches, elements);                                                  // ориентируем матрицу инцидентности
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    changedBranches.clear();
+    changedNodes = nodes.getChangedNodes();
+    unknownCurrentCount = branches.size() - branches.getCurrentSourceCount();
+    branchFrom.resize(std::max(oldSize, branches.size()));
+    branchTo.resize(std::max(oldSize, branches.size()));
+
+    for (size_t branch : candidates)                                                    // пересчитываем строки
+    {
+        size_t from = branchFrom[branch];
+        size_t to = branchTo[branch];
+
+        if (branch < branches.size())
+        {
+            orientBranch(branch, nodes, branches, elements);
+        }
+
+        if (branch < oldSize && branch < branches.size() && from == branchFrom[branch] && to == branchTo[branch] &&
+            !std::binary_search(replaced.begin(), replaced.end(), branch))
+        {
+            continue;                                                                   // та же ветвь между теми же узлами
+        }
+
+        changedBranches.push_back(branch);
+
+        if (branch < oldSize)                                                           // узлы, которым ветвь была инцидентна
+        {
+            changedNodes.push_back(from);
+            changedNodes.push_back(to);
+        }
+
+        if (branch < branches.size())                                                   // и узлы, которым она стала инцидентна
+        {
+            changedNodes.push_back(branchFrom[branch]);
+            changedNodes.push_back(branchTo[branch]);
+        }
+    }
+
+    branchFrom.resize(branches.size());
+    branchTo.resize(branches.size());
+
+    std::sort(changedNodes.begin(), changedNodes.end());
+    changedNodes.erase(std::unique(changedNodes.begin(), changedNodes.end()), changedNodes.end());
+    nodeStarts.resize(nodes.size(), 0);
+    nodeEnds.resize(nodes.size(), 0);
+
+    for (size_t node : changedNodes)                                                    // пересчитываем столбцы: ветви узла - ветви его пинов
+    {
+        if (node >= nodes.size())
+        {
+            continue;
+        }
+
+        nodeStarts[node] = nodeBranches.size();
+
+        for (size_t pin : nodes[node])
+        {
+            if (branchesForPin[pin] >= 0)
+            {
+                nodeBranches.push_back(branchesForPin[pin]);
+            }
+        }
+
+        std::sort(nodeBranches.begin() + nodeStarts[node], nodeBranches.end());         // ветвь, замкнутая на узел, входит в список один раз
+        nodeBranches.erase(std::unique(nodeBranches.begin() + nodeStarts[node], nodeBranches.end()), nodeBranches.end());
+        nodeEnds[node] = nodeBranches.size();
+    }
+
+    if (nodeBranches.size() > 4 * size() + nodes.size())                                // прежние участки занимают больше половины массива
+    {
+        compactNodeBranches();
+    }
+}
+
+// геттер номеров строк (ветвей), которые пересчитал последний patch (включая места
+// за концом списка, если он сократился; после update - пустой)
+inline const SizeVect& IncMatrix::getChangedBranches() const
+{
+    return changedBranches;
+}
+
+// геттер номеров столбцов (узлов), списки ветвей которых пересчитал последний patch
+// (включая места за концом списка, если он сократился; после update - пустой)
+inline const SizeVect& IncMatrix::getChangedNodes() const
+{
+    return changedNodes;
+}
+
+// геттер количества строк матрицы (ветвей)
+inline size_t IncMatrix::size() const
+{
+    return branchFrom.size();
+}
+
+// геттер количества столбцов матрицы (узлов)
+inline size_t IncMatrix::getNodeCount() const
+{
+    return nodeStarts.size();
+}
+
+// геттер счетчика неизвестных токов
+inline size_t IncMatrix::getUnknownCurrentCount() const
+{
+    return unknownCurrentCount;
+}
+
+// геттер узла, из которого вытекает ток ветви
+inline size_t IncMatrix::getFrom(size_t branch) const
+{
+    return branchFrom[branch];
+}
+
+// геттер узла, в который втекает ток ветви
+// (для ветви, замкнутой на один узел, совпадает с getFrom)
+inline size_t IncMatrix::getTo(size_t branch) const
+{
+    return branchTo[branch];
 }
 
-// геттер размера матрицы
-size_t IncMatrix::size() const
+// геттер ветвей, инцидентных узлу (ветви с источниками тока - в конце, так как
+// они идут последними в списке ветвей)
+inline SizeRange IncMatrix::getNodeBranches(size_t node) const
 {
-    return matrix.size();
+    return { nodeBranches.data() + nodeStarts[node], nodeBranches.data() + nodeEnds[node] };
 }
 
-// геттер строки матрицы (одномерного вектора)
-const IntVect& IncMatrix::operator[](size_t index) const
+// геттер элемента матрицы: -1 - ток ветви вытекает из узла, 1 - втекает, 0 - ветвь
+// не инцидентна узлу (у ветви, замкнутой на один узел, единственный элемент равен -1)
+inline int IncMatrix::operator()(size_t branch, size_t node) const
 {
-    return matrix[index];
+    if (branchFrom[branch] == node)
+    {
+        return -1;
+    }
+
+    return branchTo[branch] == node ? 1 : 0;
 }
 
 // перегрузка оператора вывода в поток
@@ -80,7 +259,7 @@ inline std::ostream& operator<<(std::ostream& os, const IncMatrix& matrix)
     {
         os << std::setw(6) << ' ';
 
-        for (size_t i = 0; i < matrix[0].size(); i++)
+        for (size_t i = 0; i < matrix.getNodeCount(); i++)
         {
             os << std::setw(4) << i << ' ';
         }
@@ -91,9 +270,9 @@ inline std::ostream& operator<<(std::ostream& os, const IncMatrix& matrix)
         {
             os << std::left << std::setw(4) << i << std::right << ": ";
 
-            for (size_t j = 0; j < matrix[i].size(); j++)
+            for (size_t j = 0; j < matrix.getNodeCount(); j++)
             {
-                os << std::setw(4) << matrix[i][j] << ' ';
+                os << std::setw(4) << matrix(i, j) << ' ';
             }
 
             os << "\n\n";
@@ -103,44 +282,142 @@ inline std::ostream& operator<<(std::ostream& os, const IncMatrix& matrix)
     return os;
 }
 
-// геттер счетчика неизвестных токов
-inline size_t IncMatrix::getUnknownCurrentCount() const
-{
-    return unknownCurrentCount;
-}
-
 // метод выбора направления токов (ориентирования матрицы):
-// - для ветвей с неизвестными токами направление тока выбирается произвольно (от меньшего узла)
+// - для ветвей с неизвестными токами направление тока выбирается произвольно (от узла первого пина)
 // - для ветвей с источниками тока направление тока выбирается в соответствии с полярностью источника
 inline void IncMatrix::orient(const Nodes& nodes, const Branches& branches,
                               const Elements& elements)
 {
     unknownCurrentCount = branches.size() - branches.getCurrentSourceCount();           // сохраняем количество неизвестных токов
+    branchFrom = SizeVect(branches.size());                                             //
+    branchTo = SizeVect(branches.size());                                               //
 
-    for (size_t i = 0; i < unknownCurrentCount; i++)                                    // перебор по ветвям с неизвестными токами (строки в матрице сортированы)
+    for (size_t i = 0; i < branches.size(); i++)                                        // перебор по ветвям
     {
-        size_t nodeNumber = nodes.getNodesForPin().at(branches[i][0]);                  // промежуточная переменная - номер узла, с которым соединен первый пин i-ой ветви
-        matrix[i][nodeNumber] = -1;                                                     // инициализируем -1 позицию, соответствующую соединению i-ой ветви с узлом nodeNumber 
-    }                                                                                   // т.е. направляем ток от узла с меньшим номером к узлу с большим
+        orientBranch(i, nodes, branches, elements);
+    }
+}
 
-    for (size_t i = unknownCurrentCount; i < branches.size(); i++)                      // перебор по ветвям с источниками тока
+// метод выбора направления тока ветви (см. orient)
+// принимает на вход:
+// 1) номер ветви
+// 2) объект nodes для информации об узлах схемы
+// 3) объект branches для информации о ветвях схемы
+// 4) последовательность элементов для информации об источниках тока
+inline void IncMatrix::orientBranch(size_t branch, const Nodes& nodes, const Branches& branches,
+                                    const Elements& elements)
+{
+    const IntVect& nodesForPin = nodes.getNodesForPin();                                // сохраняем отношение пинов и узлов в отдельную переменную для краткости
+    const SizeVect& pins = branches[branch];                                            //
+
+    size_t first = nodesForPin[pins.front()];                                           // узлы первого и последнего пинов ветви
+    size_t last = nodesForPin[pins.back()];                                             //
+
+    branchFrom[branch] = first;                                                         // по умолчанию ток направлен от начала ветви
+    branchTo[branch] = last;                                                            //
+
+    if (branch < unknownCurrentCount)                                                   // ветви с неизвестными токами (строки сортированы)
+    {
+        return;
+    }
+
+    for (size_t j = 0; ; j += 2)                                                        // перебираем пины ветви - ищем источник тока
     {
-        for (size_t j = 0; ; j += 2)                                                    // перебираем пины ветви - ищем источник тока
+        if (elements[pins[j] / 2].getType() == Element::Type::J)                        // если элемент является источником тока
         {
-            if (elements[branches[i][j] / 2].getType() == Element::Type::J)             // если элемент является источником тока
+            if (pins[j] % 2)                                                            // если рассматривается нечетный (положительный) вывод источника
             {
-                if (branches[i][j] % 2)                                                 // если рассматривается нечетный (положительный) вывод источника 
-                {
-                    matrix[i][nodes.getNodesForPin().at(branches[i].back())] = -1;      // инициализируем последний элемент ветви значением -1 (ток от конца ветви) 
-                }
-                else                                                                    // если рассматривается четный (отрицательный) вывод источника
-                {
-                    matrix[i][nodes.getNodesForPin().at(branches[i][0])] = -1;          // инициализируем первый элемент ветви значением -1 (ток от начала ветви)
-                }
-                break;                                                                  // выходим из цикла перебора по элементам
+                branchFrom[branch] = last;                                              // ток от конца ветви
+                branchTo[branch] = first;                                               //
             }
+            break;                                                                      // выходим из цикла перебора по элементам
         }
     }
 }
 
+// метод построения списков ветвей, инцидентных узлам (подсчетом, за линейное время)
+// ветви в каждом списке идут по возрастанию номеров; ветвь, замкнутая на один
+// узел, входит в его список один раз
+// принимает на вход: количество узлов схемы
+inline void IncMatrix::updateNodeBranches(size_t nodeCount)
+{
+    SizeVect offsets(nodeCount + 1, 0);                                                 // смещения начала узлов (узлов + 1)
+
+    for (size_t i = 0; i < size(); i++)                                                 // считаем ветви каждого узла
+    {
+        offsets[branchFrom[i] + 1]++;
+
+        if (branchTo[i] != branchFrom[i])
+        {
+            offsets[branchTo[i] + 1]++;
+        }
+    }
+
+    for (size_t i = 1; i < offsets.size(); i++)                                         // количества превращаем в смещения
+    {
+        offsets[i] += offsets[i - 1];
+    }
+
+    nodeBranches = SizeVect(offsets.back());
+    nodeStarts.assign(offsets.begin(), offsets.end() - 1);
+    nodeEnds.assign(offsets.begin() + 1, offsets.end());
+    SizeVect positions(nodeStarts);                                                     // текущие позиции записи в списках узлов
+
+    for (size_t i = 0; i < size(); i++)                                                 // раскладываем ветви по узлам (по возрастанию)
+    {
+        nodeBranches[positions[branchFrom[i]]++] = i;
+
+        if (branchTo[i] != branchFrom[i])
+        {
+            nodeBranches[positions[branchTo[i]]++] = i;
+        }
+    }
+}
+
+// метод удаления из массива nodeBranches прежних участков узлов, пересчитанных при
+// patch: участки узлов переписываются подряд в порядке номеров (за линейное время,
+// но только когда прежние участки занимают больше половины массива)
+inline void IncMatrix::compactNodeBranches()
+{
+    SizeVect compacted;
+
+    for (size_t i = 0; i < getNodeCount(); i++)
+    {
+        size_t start = compacted.size();
+
+        compacted.insert(compacted.end(), nodeBranches.begin() + nodeStarts[i], nodeBranches.begin() + nodeEnds[i]);
+        nodeStarts[i] = start;
+        nodeEnds[i] = compacted.size();
+    }
+
+    nodeBranches.swap(compacted);
+}
+
+// метод записи матрицы инцидентности в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void IncMatrix::save(BinaryWriter& writer) const
+{
+    writer.write(branchFrom);
+    writer.write(branchTo);
+    writer.write(nodeStarts);
+    writer.write(nodeEnds);
+    writer.write(nodeBranches);
+    writer.write(unknownCurrentCount);
+}
+
+// метод чтения матрицы инцидентности из двоичного буфера, записанного методом save
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void IncMatrix::load(BinaryReader& reader)
+{
+    reader.read(branchFrom);
+    reader.read(branchTo);
+    reader.read(nodeStarts);
+    reader.read(nodeEnds);
+    reader.read(nodeBranches);
+    reader.read(unknownCurrentCount);
+    changedBranches.clear();
+    changedNodes.clear();
+}
+
 } // namespace CS
@@ -1,73 +1,470 @@
 #pragma once
 
+#include <algorithm>
+#include <numeric>
+
 #include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/branches.h"
 #include "circuit-solver/circuit_configuration/inc_matrix.h"
-#include "circuit-solver/structure_units/loop_tree_node.h"
+#include "circuit-solver/structure_units/loop_tree.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
 // класс для представления информации о замкнутых контурах схемы
+// контуры находятся одним из двух способов:
+// - поиском: от каждой ветви, еще не вошедшей в контур, строится свое дерево поиска
+//   в ширину до замыкания контура на эту ветвь
+// - по остовному дереву: строится одно остовное дерево графа узлов, каждая ветвь
+//   вне дерева (хорда) вместе с путем по дереву между ее узлами образует ровно один
+//   фундаментальный контур; контуры заведомо независимы, их ровно
+//   ветвей - узлов + компонент связности, время построения почти линейно
+// ветви с источниками тока в контуры не входят
+// после частичного обновления ветвей контуры можно обновить частично (patch):
+// сохраняются контуры из неизменившихся ветвей (на своих местах списка), недостающие
+// ищутся деревьями поиска; места, содержимое которых изменилось, - см. getChangedLoops
 //////////////////////////////////////////////////////////////////////////////////////////
 class Loops
 {
 public:
+    enum class Method                                                                   // способ поиска контуров
+    {
+        Search,                                                                         // дерево поиска в ширину от каждой непокрытой ветви
+        SpanningTree                                                                    // фундаментальные контуры остовного дерева
+    };
+
+    void setMethod(Method method);                                                      // метод выбора способа поиска контуров
+    Method getMethod() const;                                                           // геттер способа поиска контуров
     void update(const IncMatrix& matrix);                                               // метод обновления списка контуров
+    void patch(const IncMatrix& matrix, const Branches& branches);                      // метод частичного обновления после Branches::patch
+    const SizeVect& getChangedLoops() const;                                            // геттер номеров контуров, измененных последним patch
     size_t size() const;                                                                // геттер размера списка контуров (количества контуров)
     const IntVect& operator[] (size_t index) const;                                     // константный геттер контура (последовательности номеров ветвей)
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
     friend std::ostream& operator<<(std::ostream& os, const Loops& loops);              // перегрузка оператора вывода в поток
 
 private:
     IntMatr loops;                                                                      // список контуров (каждый контур - последовательность номеров ветвей) 
+    Method method = Method::SpanningTree;                                               // способ поиска контуров
+    LoopTree tree;                                                                      // дерево поиска (память переиспользуется между поисками)
+    SizeVect changedLoops;                                                              // номера контуров, измененных последним patch (по возрастанию)
+
+    void search(const IncMatrix& matrix);                                               // метод поиска контуров деревьями поиска
+    static bool isClosed(const IncMatrix& matrix, const IntVect& loop,
+                         const SizeVect& indexMap);                                     // метод проверки замкнутости контура после patch
+    bool addLoop(const IncMatrix& matrix, size_t branch, BoolVect& branchesInLoops);    // метод поиска контура через ветвь деревом поиска
+    void buildFundamentalLoops(const IncMatrix& matrix);                                // метод построения фундаментальных контуров
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
-// метод обновления списка контуров:
-// выполняет обход матрицы инцидентности и с помощью построения 
-// дерева ветвей находит замкнутые контуры схемы
+// метод выбора способа поиска контуров (действует со следующего update)
+inline void Loops::setMethod(Method method)
+{
+    this->method = method;
+}
+
+// геттер способа поиска контуров
+inline Loops::Method Loops::getMethod() const
+{
+    return method;
+}
+
+// метод обновления списка контуров выбранным способом (см. setMethod)
+// каждый контур - последовательность номеров ветвей, увеличенных на единицу,
+// со знаком: плюс - ток ветви направлен по обходу контура, минус - против
 inline void Loops::update(const IncMatrix& matrix)
 {
     loops.clear();                                                                      // вектор для хранения контуров (номера ветвей)
+    changedLoops.clear();
+
+    switch (method)
+    {
+    case Method::Search:
+        search(matrix);
+        break;
+    case Method::SpanningTree:
+        buildFundamentalLoops(matrix);
+        break;
+    }
+}
+
+// метод поиска контуров:
+// выполняет обход матрицы инцидентности и с помощью построения 
+// дерева ветвей находит замкнутые контуры схемы
+inline void Loops::search(const IncMatrix& matrix)
+{
     BoolVect branchesInLoops(matrix.getUnknownCurrentCount());                          // массив для индикации вхождения ветви в контур (изначально нулевой)
 
     for (size_t i = 0; i < branchesInLoops.size(); i++)                                 // перебор по ветвям (контуры строятся так, чтобы каждая ветвь 
     {                                                                                   // вошла хотя бы в один контур)
         if (!branchesInLoops[i])                                                        // фильтрация ветвей, еще не вошедших в контур
         {
-            for (size_t j = 0; j < matrix[i].size(); j++)                               // перебор по узлам матрицы инцидентности (номер узла нужен, чтобы находить ветви, 
-            {                                                                           // инцидентные заданному узлу, то есть смежные с заданной ветвью)
-                if (matrix[i][j])                                                       // если ветвь i инцидентна узлу j, отсюда можно строить дерево
-                {
-                    LoopTreeNode::Data data = { (int)(i + 1) * matrix[i][j], j };       // (*) создание структуры для хранения в узле: ветвь с номером i + 1, узел с номером j
+            addLoop(matrix, i, branchesInLoops);
+        }
+    }
+}
+
+// метод поиска контура через ветвь branch деревом поиска:
+// найденный контур добавляется в конец списка, его ветви отмечаются в branchesInLoops
+// (контур содержит ветвь branch, еще не вошедшую в контур, поэтому он не зависит
+// от уже найденных контуров); ветвь, замкнутая на один узел, образует контур сама
+// возвращает false, если ветвь не входит ни в один контур
+inline bool Loops::addLoop(const IncMatrix& matrix, size_t branch, BoolVect& branchesInLoops)
+{
+    if (matrix.getFrom(branch) == matrix.getTo(branch))                                 // ветвь, замкнутая на один узел, образует контур сама по себе
+    {
+        loops.push_back({ static_cast<int>(branch + 1) });
+        branchesInLoops[branch] = true;
+        return true;
+    }
+
+    size_t j = std::min(matrix.getFrom(branch), matrix.getTo(branch));                  // дерево строится от узла ветви с меньшим номером (номер узла нужен, чтобы
+                                                                                        // находить ветви, инцидентные заданному узлу, то есть смежные с заданной ветвью)
+    LoopTree::Data data = { (int)(branch + 1) * matrix(branch, j), j };                 // (*) создание структуры для хранения в корне: ветвь с номером branch + 1, узел j
                                                                                         // инкремент нужен для того, чтобы отличать направление 0-й ветви по знаку +-
-                    auto node = std::make_shared<LoopTreeNode>(data);                   // создание узла, от которого будет строиться дерево
-                    node->createTree(matrix);                                           // построение дерева от узла node
-                    loops.push_back({});                                                // помещение в конец вектора контуров пустого вектора для нового контура
-
-                    for (auto itNode = node->getParent()->getParent();                  // ХИТРО: указатель родителя корня node - конечный элемент контура: номера их ветвей
-                        itNode->getData().node != node->getData().node;                 // совпадают. Поэтому, чтобы восстановить последовательность ветвей контура, нужно
-                        itNode = itNode->getParent())                                   // сместиться ДВАЖДЫ к родителю от корня, а затем восстановить путь от предпоследнего  
-                    {                                                                   // элемента контура до родителя включительно
-                        loops.back().push_back(itNode->getData().branch * -1);          // добавляем номер ветви, умноженный на -1, в контур
-                        branchesInLoops[abs(itNode->getData().branch) - 1] = true;      // делаем отметку о том, что ветвь branch вошла в контур - от неё не нужно строить 
-                    }                                                                   // новый контур. Берем по модулю и отнимаем единицу, см. (*)
-                    
-                    loops.back().push_back(node->getData().branch * -1);                // добавляем умноженный на -1 номер ветви корня в контур
-
-                    if (loops.back().size() == 1)                                       // если контур состоит из одной ветви (в случае узла с тремя ветвями,
-                    {                                                                   // две из которых содержат источники тока)
-                        loops.pop_back();                                               // извлекаем контур из вектора контуров
-                    }
-                    else
-                    {
-                        branchesInLoops[int(abs(node->getData().branch)) - 1] = true;   // делаем отметку о том, что ветвь branch вошла в контур
-                    }
-
-                    break;                                                              // выходим из цикла, т.к. одна ветвь может быть инцидентна только двум узлам,
-                }                                                                       // при этом, так как ищем только в одном направлении, достаточно одного узла
+    size_t last = tree.createTree(matrix, data);                                        // построение дерева от корня до узла, замыкающего контур
+
+    if (last == LoopTree::NONE)                                                         // ветвь не входит ни в один контур (например, в узле с тремя ветвями,
+    {                                                                                   // две из которых содержат источники тока)
+        return false;
+    }
+
+    loops.push_back({});                                                                // помещение в конец вектора контуров пустого вектора для нового контура
+
+    for (size_t k = tree.getParent(last); k != 0; k = tree.getParent(k))                // ветвь замыкающего узла совпадает с ветвью корня, поэтому путь восстанавливается
+    {                                                                                   // от его родителя до потомка корня включительно
+        loops.back().push_back(tree.getData(k).branch * -1);                            // добавляем номер ветви, умноженный на -1, в контур
+        branchesInLoops[abs(tree.getData(k).branch) - 1] = true;                        // делаем отметку о том, что ветвь branch вошла в контур - от неё не нужно строить
+    }                                                                                   // новый контур. Берем по модулю и отнимаем единицу, см. (*)
+
+    loops.back().push_back(data.branch * -1);                                           // добавляем умноженный на -1 номер ветви корня в контур
+    branchesInLoops[branch] = true;                                                     // делаем отметку о том, что ветвь корня вошла в контур
+
+    return true;
+}
+
+// метод проверки, что контур с новыми номерами ветвей остается замкнутым: в каждом
+// узле сумма токов контура (с учетом направлений ветвей) равна нулю; проверяются
+// только столбцы, которые пересчитала IncMatrix::patch (в остальных узлах ветви и
+// их концы не менялись)
+// принимает на вход:
+// 1) матрицу инцидентности после patch
+// 2) контур со старыми номерами ветвей
+// 3) новые номера ветвей по старым
+inline bool Loops::isClosed(const IncMatrix& matrix, const IntVect& loop, const SizeVect& indexMap)
+{
+    const SizeVect& changedNodes = matrix.getChangedNodes();
+    std::vector<std::pair<size_t, int>> sums;                                           // вклады ветвей в измененные узлы (узел, знак)
+
+    for (int branch : loop)
+    {
+        size_t index = indexMap[abs(branch) - 1];
+        size_t from = matrix.getFrom(index);
+        size_t to = matrix.getTo(index);
+        int sign = branch > 0 ? 1 : -1;
+
+        if (from == to)                                                                 // ветвь, замкнутая на узел, в сумму не входит
+        {
+            continue;
+        }
+
+        if (std::binary_search(changedNodes.begin(), changedNodes.end(), from))
+        {
+            sums.emplace_back(from, -sign);
+        }
+
+        if (std::binary_search(changedNodes.begin(), changedNodes.end(), to))
+        {
+            sums.emplace_back(to, sign);
+        }
+    }
+
+    std::sort(sums.begin(), sums.end());
+
+    for (size_t i = 0; i < sums.size(); )
+    {
+        int sum = 0;
+        size_t node = sums[i].first;
+
+        for (; i < sums.size() && sums[i].first == node; i++)
+        {
+            sum += sums[i].second;
+        }
+
+        if (sum)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// метод частичного обновления списка контуров после частичного обновления ветвей:
+// контуры, все ветви которых сохранились, остаются на своих местах (с новыми номерами
+// ветвей) - узлы таких ветвей не менялись, поэтому контуры остаются замкнутыми и
+// независимыми; недостающие контуры (всего их ветвей - узлов + 1) ищутся деревьями
+// поиска от измененных ветвей и ветвей удаленных контуров, еще не вошедших в контуры
+// (остальные ветви либо покрыты сохраненными контурами, либо не входили ни в один
+// контур и не могли в него войти без измененной ветви), и занимают места удаленных
+// контуров; оставшиеся места заполняются последними контурами списка
+// контур, ветвь которого сохранила место, но изменила пины, тоже считается измененным
+// проверка контуров - один проход по их ветвям без поиска
+// если нужное количество контуров так не набирается, список строится заново (update),
+// и измененными считаются все контуры
+// принимает на вход:
+// 1) обновленную матрицу инцидентности
+// 2) объект branches после patch (новые номера ветвей и измененные ветви)
+inline void Loops::patch(const IncMatrix& matrix, const Branches& branches)
+{
+    const SizeVect& indexMap = branches.getIndexMap();                                  // новые номера ветвей по старым
+    size_t branchCount = matrix.getUnknownCurrentCount();                               // в контуры входят только ветви с неизвестными токами
+    size_t nodeCount = matrix.getNodeCount();                                           //
+    size_t oldCount = loops.size();
+
+    changedLoops.clear();
+
+    if (!nodeCount || branchCount + 1 < nodeCount)                                      // количество контуров не определено - строим заново
+    {
+        update(matrix);
+        changedLoops.resize(std::max(oldCount, loops.size()));
+        std::iota(changedLoops.begin(), changedLoops.end(), 0);
+        return;
+    }
+
+    size_t loopCount = branchCount + 1 - nodeCount;                                     // нужное количество независимых контуров
+    BoolVect branchesInLoops(branchCount);                                              // признаки вхождения ветвей в контуры
+    BoolVect changedBranches(branchCount);                                              // признаки измененных строк матрицы инцидентности
+    SizeVect candidates;                                                                // ветви, от которых ищутся недостающие контуры
+    SizeVect holes;                                                                     // места удаленных контуров (по возрастанию)
+    size_t kept = 0;                                                                    // количество сохраненных контуров
+
+    for (size_t branch : branches.getChangedBranches())
+    {
+        if (branch < branchCount)
+        {
+            candidates.push_back(branch);
+        }
+    }
+
+    for (size_t branch : matrix.getChangedBranches())                                   // ветви с другими пинами или узлами
+    {
+        if (branch < branchCount)
+        {
+            changedBranches[branch] = true;
+        }
+    }
+
+    for (size_t i = 0; i < loops.size(); i++)                                           // проверяем контуры
+    {
+        IntVect& loop = loops[i];
+        bool valid = kept < loopCount;
+        bool changed = false;                                                           // ветви контура перенесены или изменили пины
+
+        for (int branch : loop)
+        {
+            size_t index = indexMap[abs(branch) - 1];                                   // новый номер ветви
+
+            valid = valid && index < branchCount;                                       // ветвь удалена
+            changed = changed || index != static_cast<size_t>(abs(branch) - 1) ||
+                      (valid && changedBranches[index]);
+        }
+
+        valid = valid && (!changed || isClosed(matrix, loop, indexMap));
+
+        if (valid)                                                                      // сохраняем контур с новыми номерами ветвей
+        {
+            for (int& branch : loop)
+            {
+                size_t index = indexMap[abs(branch) - 1];
+                branch = branch > 0 ? (int)index + 1 : -(int)index - 1;
+                branchesInLoops[index] = true;
+            }
+
+            if (changed)
+            {
+                changedLoops.push_back(i);
+            }
+
+            kept++;
+            continue;
+        }
+
+        for (int branch : loop)                                                         // ветви удаленного контура - кандидаты
+        {
+            size_t index = indexMap[abs(branch) - 1];
+
+            if (index < branchCount)
+            {
+                candidates.push_back(index);
+            }
+        }
+
+        loop.clear();
+        holes.push_back(i);
+        changedLoops.push_back(i);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    size_t hole = 0;                                                                    // очередное свободное место
+
+    for (size_t branch : candidates)                                                    // ищем недостающие контуры
+    {
+        if (kept == loopCount)
+        {
+            break;
+        }
+
+        if (branchesInLoops[branch] || !addLoop(matrix, branch, branchesInLoops))
+        {
+            continue;
+        }
+
+        kept++;
+
+        if (hole < holes.size())                                                        // новый контур занимает свободное место
+        {
+            loops[holes[hole++]].swap(loops.back());
+            loops.pop_back();
+        }
+        else
+        {
+            changedLoops.push_back(loops.size() - 1);
+        }
+    }
+
+    size_t from = loops.size();                                                         // места за концом нового списка
+
+    for (; hole < holes.size() && holes[hole] < kept; hole++)                           // оставшиеся свободные места занимают последние контуры
+    {
+        do
+        {
+            from--;
+        } while (loops[from].empty());
+
+        loops[holes[hole]].swap(loops[from]);
+    }
+
+    loops.resize(kept);
+
+    for (size_t i = kept; i < oldCount; i++)                                            // места, которых больше нет, тоже изменились
+    {
+        changedLoops.push_back(i);
+    }
+
+    if (kept != loopCount)                                                              // независимых контуров не хватает - строим заново
+    {
+        update(matrix);
+        changedLoops.resize(std::max(oldCount, loops.size()));
+        std::iota(changedLoops.begin(), changedLoops.end(), 0);
+        return;
+    }
+
+    std::sort(changedLoops.begin(), changedLoops.end());
+    changedLoops.erase(std::unique(changedLoops.begin(), changedLoops.end()), changedLoops.end());
+}
+
+// геттер номеров мест списка контуров, содержимое которых изменил последний patch
+// (включая места за концом списка, если он сократился; после update - пустой)
+inline const SizeVect& Loops::getChangedLoops() const
+{
+    return changedLoops;
+}
+
+// метод построения фундаментальных контуров:
+// обходом в ширину строится остовный лес графа узлов (по ветвям с неизвестными токами),
+// для каждого узла запоминаются ветвь к родителю и глубина; затем для каждой хорды
+// (u -> v) контур обходится так: хорда от u к v, путь по дереву от v вверх до общего
+// предка, путь от общего предка вниз до u; ветвь, замкнутая на один узел, образует
+// контур сама по себе
+inline void Loops::buildFundamentalLoops(const IncMatrix& matrix)
+{
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер ветви
+
+    size_t branchCount = matrix.getUnknownCurrentCount();                               // в контуры входят только ветви с неизвестными токами
+    size_t nodeCount = matrix.getNodeCount();                                           //
+
+    SizeVect parentBranches(nodeCount, NONE);                                           // ветвь к родителю для каждого узла дерева (у корней - NONE)
+    SizeVect depths(nodeCount, 0);                                                      // глубина узлов в дереве
+    BoolVect visited(nodeCount);                                                        // признаки посещенных узлов
+    BoolVect treeBranches(branchCount);                                                 // признаки ветвей дерева
+    SizeVect queue;                                                                     // очередь обхода в ширину (узлы не извлекаются)
+    queue.reserve(nodeCount);
+
+    for (size_t root = 0; root < nodeCount; root++)                                     // дерево строится для каждой компоненты связности
+    {
+        if (visited[root])
+        {
+            continue;
+        }
+
+        visited[root] = true;
+        queue.push_back(root);
+
+        for (size_t head = queue.size() - 1; head < queue.size(); head++)               // обход в ширину от корня компоненты
+        {
+            size_t node = queue[head];
+
+            for (size_t i : matrix.getNodeBranches(node))                               // перебираем ветви, инцидентные узлу
+            {
+                if (i >= branchCount)                                                   // ветви с источниками тока идут в конце списка
+                {
+                    break;
+                }
+
+                size_t j = matrix.getFrom(i) == node ?                                  // узел на противоположном конце ветви
+                           matrix.getTo(i) : matrix.getFrom(i);                         //
+
+                if (!visited[j])                                                        // ветвь ведет в новый узел - добавляем ее в дерево
+                {
+                    visited[j] = true;
+                    parentBranches[j] = i;
+                    depths[j] = depths[node] + 1;
+                    treeBranches[i] = true;
+                    queue.push_back(j);
+                }
             }
         }
     }
+
+    IntVect upPath;                                                                     // вспомогательный путь от u вверх до общего предка
+
+    for (size_t i = 0; i < branchCount; i++)                                            // каждая хорда дает ровно один контур
+    {
+        if (treeBranches[i])
+        {
+            continue;
+        }
+
+        size_t u = matrix.getFrom(i);
+        size_t v = matrix.getTo(i);
+
+        loops.push_back({ static_cast<int>(i + 1) });                                   // хорда обходится по направлению своего тока
+        upPath.clear();
+
+        while (v != u)                                                                  // поднимаемся от более глубокого из узлов до общего предка
+        {
+            if (depths[v] >= depths[u])                                                 // шаг от v к родителю: по обходу контура
+            {
+                size_t branch = parentBranches[v];
+                int sign = matrix.getFrom(branch) == v ? 1 : -1;                        // ток ветви направлен от v к родителю - по обходу
+                loops.back().push_back(sign * static_cast<int>(branch + 1));
+                v = matrix.getFrom(branch) == v ? matrix.getTo(branch) : matrix.getFrom(branch);
+            }
+            else                                                                        // шаг от u к родителю: обход идет в обратную сторону
+            {
+                size_t branch = parentBranches[u];
+                int sign = matrix.getTo(branch) == u ? 1 : -1;                          // ток ветви направлен от родителя к u - по обходу
+                upPath.push_back(sign * static_cast<int>(branch + 1));
+                u = matrix.getFrom(branch) == u ? matrix.getTo(branch) : matrix.getFrom(branch);
+            }
+        }
+
+        loops.back().insert(loops.back().end(), upPath.rbegin(), upPath.rend());        // путь от общего предка вниз до u
+    }
 }
 
 // геттер размера списка контуров
@@ -102,4 +499,20 @@ inline std::ostream& operator<<(std::ostream& os, const Loops& loops)
     return os;
 }
 
+// метод записи списка контуров в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void Loops::save(BinaryWriter& writer) const
+{
+    writer.write(loops);
+}
+
+// метод чтения списка контуров из двоичного буфера, записанного методом save
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void Loops::load(BinaryReader& reader)
+{
+    reader.read(loops);
+    changedLoops.clear();
+}
+
 } // namespace CS
@@ -1,86 +1,332 @@
 #pragma once
 
+#include <algorithm>
+
 #include "circuit-solver/common.h"
 #include "circuit-solver/circuit_configuration/pin_matrix.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
 // класс для представления узлов схемы
+// пины всех узлов лежат в одном массиве, участок каждого узла задан началом и концом;
+// обратное отношение (в какой узел входит пин) хранится вектором номеров узлов по пинам
+// после частичного обновления групп пинов узлы можно обновить частично (patch):
+// пересчитываются только узлы из пинов пересчитанных групп, номера остальных узлов
+// сохраняются (см. patch), пины новых узлов дописываются в конец массива
 //////////////////////////////////////////////////////////////////////////////////////////
 class Nodes
 {
 public:
     void update(const PinMatrix& pinMatrix);                                            // метод обновления всех структур
-    const SizeVect& operator[] (size_t index) const;                                    // геттер строки списка узлов nodes (одномерного вектора)
+    void patch(const PinMatrix& pinMatrix);                                             // метод частичного обновления после PinMatrix::patch
+    SizeRange operator[] (size_t index) const;                                          // геттер пинов узла с номером index
     const IntVect& getNodesForPin() const;                                              // геттер вектора nodesForPin
-    const BoolMatr& getNodesOnPins() const;                                             // геттер матрицы nodesOnPins
-    size_t size() const;                                                                // геттер размера списка узлов nodes
+    const SizeVect& getChangedNodes() const;                                            // геттер номеров узлов, измененных последним patch
+    size_t size() const;                                                                // геттер количества узлов
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
     friend std::ostream& operator<<(std::ostream& os, const Nodes& nodes);              // перегрузка оператора вывода в поток
 
 private:
-    SizeMatr nodes;                                                                     // вектор векторов номеров пинов, представляющий список узлов схемы
+    SizeVect nodeStarts;                                                                // начала и концы участков узлов в массиве nodePins
+    SizeVect nodeEnds;                                                                  //
+    SizeVect nodePins;                                                                  // номера пинов, образующих узлы (после patch - с участками удаленных узлов)
     IntVect nodesForPin;                                                                // вектор номеров узлов, в которые входят пины
-    BoolMatr nodesOnPins;                                                               // матрица-отношение между множеством узлов и пинов
+    SizeVect changedNodes;                                                              // номера узлов, измененных последним patch (по возрастанию)
 
-    void updateNodesOnPins(const size_t pinCount);                                      // метод обновления матрицы nodesOnPins
+    void setNode(size_t node, SizeRange pins);                                          // метод записи пинов узла в конец массива nodePins
+    void compactNodePins();                                                             // метод удаления участков удаленных узлов из nodePins
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
 // метод обновления списка узлов
-// каждый узел представляется вектором номеров пинов, образующих этот узел
+// каждый узел представляется последовательностью номеров пинов, образующих этот узел
 // так же обновляет вектор nodesForPin хранящий информацию о том, какой узел формирует каждый пин
-// принимает на вход: матрицу соединений пинов, по которой осуществляется поиск узлов
+// выполняется за один проход по группам соединенных пинов - O(pins)
+// узел образует группа из трех и более соединенных пинов (два соединенных пина -
+// последовательное соединение элементов); узлы нумеруются в порядке групп
+// принимает на вход: матрицу соединений пинов с группами соединенных пинов
 inline void Nodes::update(const PinMatrix& pinMatrix)
 {
-    nodes.clear();                                                                      // очищаем текущий вектор узлов
+    nodeStarts.clear();                                                                 // очищаем текущий список узлов
+    nodeEnds.clear();                                                                   //
+    nodePins.clear();                                                                   //
+    changedNodes.clear();                                                               //
     nodesForPin = IntVect(pinMatrix.size(), -1);                                        // вектор, хранящий номера узлов, которые формируют выводы (-1 - узел отсутствует)
-    BoolVect checkedPins(pinMatrix.size(), false);                                      // временный вектор для индикации уже рассмотренных выводов, заполненный false
 
-    for (size_t i = 0; i < pinMatrix.size() - 2; i++)                                   // перебор по столбцам: -2, т.к. два вывода не могут сформировать узел
-    {                                                                                   // по столбцам, т.к. работаем в левой нижней половине матрицы соединений
-        if (!checkedPins[i])                                                            // если вывод i не участвовал в формировании других узлов
+    for (size_t i = 0; i < pinMatrix.getGroupCount(); i++)                              // перебор по группам соединенных пинов
+    {
+        SizeRange pins = pinMatrix.getGroupPins(i);
+
+        if (pins.size() < 3)                                                            // два вывода не могут сформировать узел
+        {
+            continue;
+        }
+
+        nodeStarts.push_back(nodePins.size());                                          // добавляем новый узел из пинов группы
+
+        for (size_t pin : pins)
+        {
+            nodePins.push_back(pin);
+            nodesForPin[pin] = static_cast<int>(size() - 1);                            // сохранение номера узла, сформированного выводом pin
+        }
+
+        nodeEnds.push_back(nodePins.size());                                            // завершаем узел
+    }
+}
+
+// метод частичного обновления узлов после частичного обновления групп пинов:
+// узлы, в которые входили пины пересчитанных групп, удаляются, а узлы из новых групп
+// этих пинов (из трех и более пинов) занимают их номера - новый узел получает номер
+// старого узла одного из своих пинов, если его еще не занял другой узел (номер
+// последнего узла - в первую очередь: он базисный в системах уравнений)
+// остальные новые узлы занимают освободившиеся номера, а если их не хватает -
+// добавляются в конец; если номера остаются свободными, на них переносятся
+// последние узлы, при этом последний узел остается последним
+// время пропорционально количеству пересчитанных пинов и пинов перенесенных узлов
+// номера измененных узлов (составленных заново из других пинов, перенесенных и мест
+// за концом списка, если он сократился) - см. getChangedNodes
+// принимает на вход: матрицу соединений пинов после patch
+inline void Nodes::patch(const PinMatrix& pinMatrix)
+{
+    static constexpr size_t NONE = PinMatrix::NONE;                                     // отсутствующий номер узла
+
+    const SizeVect& changedPins = pinMatrix.getChangedPins();                           // пины пересчитанных групп
+    size_t oldCount = size();
+    size_t basis = oldCount - 1;                                                        // последний (базисный) узел
+    SizeVect removed;                                                                   // старые узлы пересчитанных групп
+    SizeVect groups;                                                                    // новые группы из трех и более пинов (по наименьшему пину)
+
+    nodesForPin.resize(pinMatrix.size(), -1);
+    changedNodes.clear();
+
+    for (size_t pin : changedPins)
+    {
+        if (nodesForPin[pin] >= 0)
+        {
+            removed.push_back(nodesForPin[pin]);
+        }
+
+        SizeRange pins = pinMatrix.getGroupPins(pinMatrix.getGroup(pin));
+
+        if (pins.size() >= 3 && pins[0] == pin)
         {
-            bool mayBeNode = false;                                                     // логическая переменная для индикации возможности формирования узла 
-            bool nodeIsCreated = false;                                                 // логическая переменная для индикации созданного узла
-            size_t secondPinForNode;                                                    // переменная для хранения номера вывода, с которым может быть узел 
+            groups.push_back(pinMatrix.getGroup(pin));
+        }
+    }
+
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+    SizeVect claimed(removed.size(), NONE);                                             // новый узел, занявший старый номер
+    SizeVect slots(groups.size(), NONE);                                                // номера новых узлов
+    SizeVect origins(groups.size(), NONE);                                              // старые номера, занятые новыми узлами
 
-            for (size_t j = i + 1; j < pinMatrix.size(); j++)                           // перебор элементов по столбцу i вниз от главной диагонали
+    for (size_t pass = 0; pass < 2; pass++)                                             // сначала номер базисного узла, затем остальные
+    {
+        for (size_t i = 0; i < groups.size(); i++)
+        {
+            for (size_t pin : pinMatrix.getGroupPins(groups[i]))
             {
-                if (pinMatrix[j][i] && !checkedPins[j])                                 // если в текущей позиции единица и текущий вывод не участвовал в 
-                {                                                                       // формировании других узлов
-                    if (mayBeNode)                                                      // если уже есть соединение двух выводов и возможно наличие узла
-                    {
-                        if (!nodeIsCreated)                                             // если узел еще не создан
-                        {
-                            nodes.push_back({ i, secondPinForNode });                   // добавить новый узел
-                            nodesForPin[i] = nodesForPin[secondPinForNode] =
-                                static_cast<int>(nodes.size()) - 1;                     // сохранение номера узла, сформированного выводами i и secondPinForNode
-                            nodeIsCreated = true;                                       // узел создан
-                        }
-
-                        nodes.back().push_back(j);                                      // добавить в последний узел вывод с номером j
-                        nodesForPin[j] = static_cast<int>(nodes.size()) - 1;            // сохранение номера узла, сформированного выводом j
-                        checkedPins[j] = true;                                          // вывод j принял участие в формировании узла
-                    }
-                    else                                                                // если рассматриваемый вывод - первый присоединенный к i-му
-                    {
-                        mayBeNode = true;                                               // возможно наличие узла
-                        secondPinForNode = j;                                           // второй вывод для узла - рассматриваемый
-                        checkedPins[i] = checkedPins[secondPinForNode] = true;          // отметки о том, что выводы i и secondPinForNode были рассмотрены
-                    }
+                if (slots[i] != NONE || nodesForPin[pin] < 0 ||
+                    (pass == 0 && static_cast<size_t>(nodesForPin[pin]) != basis))
+                {
+                    continue;
+                }
+
+                size_t position = std::lower_bound(removed.begin(), removed.end(),
+                                                   nodesForPin[pin]) - removed.begin();
+
+                if (claimed[position] == NONE)
+                {
+                    claimed[position] = i;
+                    slots[i] = removed[position];
+                    origins[i] = removed[position];
                 }
             }
         }
     }
 
-    updateNodesOnPins(pinMatrix.size());                                                // обновляем матрицу-отношение mNodesOnPins
+    SizeVect holes;                                                                     // номера удаленных узлов, не занятые новыми
+    size_t unplaced = 0;                                                                // количество новых узлов без номера
+
+    for (size_t i = 0; i < removed.size(); i++)
+    {
+        if (claimed[i] == NONE)
+        {
+            holes.push_back(removed[i]);
+        }
+    }
+
+    for (size_t slot : slots)
+    {
+        unplaced += slot == NONE;
+    }
+
+    size_t newCount = oldCount - holes.size() + unplaced;
+    size_t last = newCount - 1;                                                         // место базисного узла после обновления
+
+    auto isHole = [&holes](size_t node)
+    {
+        return std::binary_search(holes.begin(), holes.end(), node);
+    };
+
+    SizeVect freeSlots;                                                                 // свободные места в пределах нового списка
+    SizeVect movers;                                                                    // сохранившиеся узлы за пределами нового списка
+
+    for (size_t node : holes)
+    {
+        if (node < newCount)
+        {
+            freeSlots.push_back(node);
+        }
+    }
+
+    for (size_t node = oldCount; node < newCount; node++)
+    {
+        freeSlots.push_back(node);
+    }
+
+    for (size_t node = newCount; node < oldCount; node++)
+    {
+        if (!isHole(node))
+        {
+            movers.push_back(node);
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> moves;                                       // перенос сохранившихся узлов (откуда, куда)
+
+    if (newCount && oldCount && !isHole(basis) && basis != last)                        // базисный узел сохранился - он остается последним
+    {
+        if (basis < newCount)                                                           // список вырос: место базисного узла освобождается
+        {
+            freeSlots.erase(std::find(freeSlots.begin(), freeSlots.end(), last));
+            freeSlots.push_back(basis);
+        }
+        else                                                                            // список сократился: узел с последнего места
+        {                                                                               // переносится вместе с остальными
+            movers.erase(std::find(movers.begin(), movers.end(), basis));
+            auto it = std::find(freeSlots.begin(), freeSlots.end(), last);
+
+            if (it != freeSlots.end())
+            {
+                freeSlots.erase(it);
+            }
+            else
+            {
+                movers.push_back(last);
+            }
+        }
+
+        moves.emplace_back(basis, last);
+    }
+
+    std::sort(freeSlots.begin(), freeSlots.end());
+    std::sort(movers.begin(), movers.end());
+
+    for (size_t i = 0; i < movers.size(); i++)                                          // перенесенные узлы занимают первые свободные места
+    {
+        moves.emplace_back(movers[i], freeSlots[i]);
+    }
+
+    for (size_t i = 0; i < moves.size(); )                                              // новый узел, занявший номер переносимого, просто
+    {                                                                                   // получает другой номер
+        auto it = std::lower_bound(removed.begin(), removed.end(), moves[i].first);
+
+        if (it != removed.end() && *it == moves[i].first)
+        {
+            slots[claimed[it - removed.begin()]] = moves[i].second;
+            moves.erase(moves.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    for (size_t i = 0, k = movers.size(); i < slots.size(); i++)                        // новые узлы без номера - остальные
+    {
+        if (slots[i] == NONE)
+        {
+            slots[i] = freeSlots[k++];
+        }
+    }
+
+    for (size_t node : removed)                                                         // пины удаленных узлов пока не входят в узлы
+    {
+        for (size_t pin : (*this)[node])
+        {
+            nodesForPin[pin] = -1;
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> ranges;                                      // участки переносимых узлов
+
+    for (const auto& [from, to] : moves)
+    {
+        ranges.emplace_back(nodeStarts[from], nodeEnds[from]);
+    }
+
+    nodeStarts.resize(std::max(oldCount, newCount), 0);
+    nodeEnds.resize(std::max(oldCount, newCount), 0);
+
+    for (size_t i = 0; i < moves.size(); i++)                                           // переносим узлы (пины остаются на прежних участках)
+    {
+        size_t node = moves[i].second;
+
+        nodeStarts[node] = ranges[i].first;
+        nodeEnds[node] = ranges[i].second;
+
+        for (size_t pin : (*this)[node])
+        {
+            nodesForPin[pin] = static_cast<int>(node);
+        }
+
+        changedNodes.push_back(node);
+    }
+
+    for (size_t i = 0; i < groups.size(); i++)                                          // записываем новые узлы
+    {
+        SizeRange pins = pinMatrix.getGroupPins(groups[i]);
+        SizeRange oldPins = (*this)[slots[i]];                                          // участок узла, прежде стоявшего на этом месте
+
+        if (slots[i] == origins[i] && std::equal(pins.begin(), pins.end(), oldPins.begin(), oldPins.end()))
+        {
+            for (size_t pin : pins)                                                     // узел собран из тех же пинов - он не изменился
+            {
+                nodesForPin[pin] = static_cast<int>(slots[i]);
+            }
+
+            continue;
+        }
+
+        setNode(slots[i], pins);
+        changedNodes.push_back(slots[i]);
+    }
+
+    for (size_t node = newCount; node < oldCount; node++)                               // места за концом списка тоже изменились
+    {
+        changedNodes.push_back(node);
+    }
+
+    nodeStarts.resize(newCount);
+    nodeEnds.resize(newCount);
+    std::sort(changedNodes.begin(), changedNodes.end());
+    changedNodes.erase(std::unique(changedNodes.begin(), changedNodes.end()), changedNodes.end());
+
+    if (nodePins.size() > 2 * pinMatrix.size())                                         // участки удаленных узлов занимают больше половины массива
+    {
+        compactNodePins();
+    }
 }
 
-// геттер строки списка узлов nodes (одномерного вектора)
-inline const SizeVect& Nodes::operator[](size_t index) const
+// геттер пинов узла с номером index
+inline SizeRange Nodes::operator[](size_t index) const
 {
-    return nodes[index];
+    return { nodePins.data() + nodeStarts[index], nodePins.data() + nodeEnds[index] };
 }
 
 // геттер вектора nodesForPin
@@ -89,16 +335,17 @@ inline const IntVect& Nodes::getNodesForPin() const
     return nodesForPin;
 }
 
-// геттер матрицы nodesOnPins
-inline const BoolMatr& Nodes::getNodesOnPins() const
+// геттер номеров узлов, пины которых изменил последний patch (включая места за
+// концом списка, если он сократился; после update - пустой)
+inline const SizeVect& Nodes::getChangedNodes() const
 {
-    return nodesOnPins;
+    return changedNodes;
 }
 
-// геттер размера списка узлов nodes
+// геттер количества узлов
 inline size_t Nodes::size() const
 {
-    return nodes.size();
+    return nodeStarts.size();
 }
 
 // перегрузка оператора вывода в поток
@@ -121,20 +368,62 @@ inline std::ostream& operator<<(std::ostream& os, const Nodes& nodes)
     return os;
 }
 
-// обновления матрицы-отношения между множествами узлов и пинов такой, что:
-// если mNodesOnPins[i][j] равно единице, i-ый узел содержит j-ый пин (напрямую с ним соединен) 
-// принимает на вход: счетчик пинов схемы
-inline void Nodes::updateNodesOnPins(const size_t pinCount)
+// метод записи пинов узла node в конец массива nodePins (прежний участок узла
+// больше не используется)
+// принимает на вход:
+// 1) номер узла
+// 2) пины узла
+inline void Nodes::setNode(size_t node, SizeRange pins)
 {
-    nodesOnPins = BoolMatr(nodes.size(), BoolVect(pinCount, false));                    // создаем матрицу размером nodes.size() x pinCount и заполняем ее false
+    nodeStarts[node] = nodePins.size();
+    nodePins.insert(nodePins.end(), pins.begin(), pins.end());
+    nodeEnds[node] = nodePins.size();
 
-    for (size_t i = 0; i < nodes.size(); i++)                                           // перебираем все узлы
+    for (size_t pin : pins)
     {
-        for (size_t j = 0; j < nodes[i].size(); j++)                                    // перебираем все пины i-го узла
-        {
-            nodesOnPins[i][nodes[i][j]] = true;                                         // в i-ой строке (соответствует i-ому узлу) инициализируем истиной элемент,
-        }                                                                               // находящийся в столбце, номер которого хранит в себе j-ый элемент i-ого узла
-    }                                                                                   // (то есть номер пина, с которым напрямую соединен i-ый узел)
+        nodesForPin[pin] = static_cast<int>(node);
+    }
+}
+
+// метод удаления из массива nodePins участков удаленных и перенесенных узлов:
+// участки узлов переписываются подряд в порядке номеров (за линейное время, но
+// только когда такие участки занимают больше половины массива)
+inline void Nodes::compactNodePins()
+{
+    SizeVect compacted;
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        size_t start = compacted.size();
+
+        compacted.insert(compacted.end(), nodePins.begin() + nodeStarts[i], nodePins.begin() + nodeEnds[i]);
+        nodeStarts[i] = start;
+        nodeEnds[i] = compacted.size();
+    }
+
+    nodePins.swap(compacted);
+}
+
+// метод записи узлов в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void Nodes::save(BinaryWriter& writer) const
+{
+    writer.write(nodeStarts);
+    writer.write(nodeEnds);
+    writer.write(nodePins);
+    writer.write(nodesForPin);
+}
+
+// метод чтения узлов из двоичного буфера, записанного методом save
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void Nodes::load(BinaryReader& reader)
+{
+    reader.read(nodeStarts);
+    reader.read(nodeEnds);
+    reader.read(nodePins);
+    reader.read(nodesForPin);
+    changedNodes.clear();
 }
 
 } // namespace CS
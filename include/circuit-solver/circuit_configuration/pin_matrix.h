@@ -1,86 +1,315 @@
 #pragma once
 
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+
 #include "circuit-solver/common.h"
 #include "circuit-solver/circuit_configuration/elements.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
-// класс для представления матрицы соединений пинов
+// класс для представления соединений пинов схемы
+// пины, соединенные "проводами" напрямую или через другие пины, образуют группы;
+// группы строятся системой непересекающихся множеств (со сжатием путей и
+// объединением по рангу) за почти линейное время от количества пинов
+// после update группы нумеруются по возрастанию наименьшего пина, пины внутри группы
+// хранятся по возрастанию в одном массиве (участок каждой группы задан началом и концом)
+// для пинов, соединенных ровно с одним другим пином (последовательное соединение
+// элементов), хранится номер этого соседнего пина - по нему трассируются ветви
+// матрица соединений пинов (пин i соединен с пином j) в памяти не хранится:
+// она вычисляется по номерам групп и строится целиком только при выводе в поток
+// после изменения соединений отдельных пинов группы можно обновить частично (patch):
+// множества строятся заново только для пинов затронутых групп; новая группа получает
+// номер старой группы своего пина (или освободившийся номер), пины новых групп
+// дописываются в конец массива, поэтому время patch зависит только от размера
+// затронутых групп; освободившиеся номера остаются пустыми группами до следующего patch
 //////////////////////////////////////////////////////////////////////////////////////////
 class PinMatrix
 {
 public:
-    void update(const Elements& elements);                                              // метод обновления матрицы
-    const size_t size() const;                                                          // геттер размера матрицы
-    const BoolVect& operator[] (size_t index) const;                                    // геттер строки матрицы (одномерного вектора)
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер пина
+
+    void update(const Elements& elements);                                              // метод обновления групп соединенных пинов
+    void patch(const Elements& elements, const SizeVect& touchedPins);                  // метод частичного обновления групп после изменения соединений
+    size_t size() const;                                                                // геттер количества пинов
+    size_t getGroupCount() const;                                                       // геттер количества групп
+    size_t getGroup(size_t pin) const;                                                  // геттер номера группы, в которую входит пин
+    SizeRange getGroupPins(size_t group) const;                                         // геттер пинов группы (по возрастанию)
+    size_t getWiredPin(size_t pin) const;                                               // геттер единственного соединенного с пином пина (или NONE)
+    const SizeVect& getChangedPins() const;                                             // геттер пинов групп, пересчитанных последним patch
+    bool connected(size_t first, size_t second) const;                                  // метод проверки соединения двух пинов
+    bool operator() (size_t first, size_t second) const;                                // элемент матрицы соединений (пины соединены и не совпадают)
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
     friend std::ostream& operator<<(std::ostream& os, const PinMatrix& matrix);         // перегрузка оператора вывода в поток
 
 private:
-    BoolMatr matrix;                                                                    // логическая двумерная матрица для хранения информации о соединениях пинов
+    SizeVect groups;                                                                    // номера групп пинов
+    SizeVect groupStarts;                                                               // начала и концы участков групп в массиве groupPins
+    SizeVect groupEnds;                                                                 //
+    SizeVect groupPins;                                                                 // пины групп (после patch - с участками удаленных групп)
+    SizeVect freeGroups;                                                                // номера пустых групп (используются новыми группами)
+    SizeVect wiredPins;                                                                 // соседний пин для пинов групп из двух пинов (для остальных NONE)
+    SizeVect changedPins;                                                               // пины групп, пересчитанных последним patch (по возрастанию)
+
+    SizeVect parents;                                                                   // родители пинов в системе непересекающихся множеств
+    SizeVect ranks;                                                                     // ранги корней множеств
+
+    size_t find(size_t pin);                                                            // метод поиска корня множества пина (со сжатием пути)
+    void unite(size_t first, size_t second);                                            // метод объединения множеств двух пинов
+    void updateGroups();                                                                // метод нумерации групп по корням множеств
+    void updateGroupPins(size_t groupCount);                                            // метод построения списков пинов групп
+    void compactGroupPins();                                                            // метод удаления участков удаленных групп из groupPins
+    void addRegionPin(size_t pin, SizeVect& regionGroups);                              // метод добавления пина с его группой в пересчитываемую область
+    size_t getLinkedPin(const Elements& elements, size_t pin) const;                    // метод получения проверенного номера присоединенного пина
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
-// метод обновления матрицы пинов
-// треугольная матрица пинов строится таким образом, что при matrix[i][j] == 1
-// i-ый пин напрямую подключен к j-ому пину; иначе прямое соединение отсутствует 
-// принимает на вход список элементов схемы 
+// метод обновления групп соединенных пинов
+// каждое соединение, заданное в элементе (номер присоединенного пина), объединяет
+// множества двух пинов; транзитивность соединений обеспечивается самими множествами
+// принимает на вход список элементов схемы
 inline void PinMatrix::update(const Elements& elements)
 {
     size_t pinCount = elements.size() * 2;                                              // считаем пины по количеству элементов
 
-    matrix = BoolMatr(pinCount);                                                        // создаем двумерный вектор размера pinCount
-    for (size_t i = 0; i < pinCount; i++)                                               // создаем треугольную матрицу нижу главной диагонали, заполненную нулями
+    parents = SizeVect(pinCount);                                                       // изначально каждый пин - отдельное множество
+    ranks = SizeVect(pinCount, 0);                                                      //
+
+    for (size_t i = 0; i < pinCount; i++)
     {
-        matrix[i] = BoolVect(i, false);
+        parents[i] = i;
     }
-                                                                                        // первая часть: соединяем то, что соединено напрямую
+
     for (size_t i = 0; i < pinCount; i++)                                               // перебираем по пинам схемы (их ровно в 2 раза больше, чем элементов)
-    {    
-        if (elements[i / 2].getLinkedPin(i % 2) >= 0)                                   // если i-ый пин соединен с каким-нибудь другим пином (-1, если не соединен)
-        {                                                                               // целая часть от деления на два - номер элемента, остаток - номер пина элемента
-            matrix[i][elements[i / 2].getLinkedPin(i % 2)] = true;                      // отмечаем соединение пинов в матрице соединений 
+    {
+        size_t linkedPin = getLinkedPin(elements, i);                                   // номер пина, с которым соединен i-ый пин
+
+        if (linkedPin != NONE)                                                          // пин соединен с другим пином
+        {
+            unite(i, linkedPin);                                                        // объединяем множества соединенных пинов
+        }
+    }
+
+    updateGroups();                                                                     // нумеруем группы
+    changedPins.clear();
+
+    SizeVect().swap(parents);                                                           // рабочие массивы больше не нужны
+    SizeVect().swap(ranks);                                                             //
+}
+
+// метод частичного обновления групп после изменения соединений:
+// пересчитываются только группы, в которые до изменения входили затронутые пины
+// и пины, с которыми они теперь соединены (новые пины образуют собственные группы);
+// соединения остальных пинов не менялись, поэтому не выходят за пределы этих групп
+// система непересекающихся множеств строится только для пинов этой области; новая
+// группа получает номер старой группы одного из своих пинов, если его еще не заняла
+// другая группа, иначе - номер пустой группы или следующий номер; номера остальных
+// групп не меняются, поэтому время patch пропорционально размеру области
+// принимает на вход:
+// 1) список элементов схемы (пины новых элементов - в конце)
+// 2) пины, соединения которых изменились после последнего обновления
+inline void PinMatrix::patch(const Elements& elements, const SizeVect& touchedPins)
+{
+    size_t pinCount = elements.size() * 2;                                              // пины после изменений (новые - в конце)
+    SizeVect regionGroups;                                                              // старые группы затронутой области
+
+    changedPins.clear();
+
+    for (size_t pin : touchedPins)                                                      // собираем затронутые пины и их новых соседей
+    {
+        addRegionPin(pin, regionGroups);
+        size_t linkedPin = getLinkedPin(elements, pin);
+
+        if (linkedPin != NONE)
+        {
+            addRegionPin(linkedPin, regionGroups);
+        }
+    }
+
+    std::sort(regionGroups.begin(), regionGroups.end());
+    regionGroups.erase(std::unique(regionGroups.begin(), regionGroups.end()), regionGroups.end());
+
+    for (size_t group : regionGroups)                                                   // старые группы входят в область целиком
+    {
+        SizeRange pins = getGroupPins(group);
+        changedPins.insert(changedPins.end(), pins.begin(), pins.end());
+    }
+
+    std::sort(changedPins.begin(), changedPins.end());
+    changedPins.erase(std::unique(changedPins.begin(), changedPins.end()), changedPins.end());
+
+    parents = SizeVect(changedPins.size());                                             // множества строятся по индексам пинов в области
+    ranks = SizeVect(changedPins.size(), 0);                                            //
+    std::iota(parents.begin(), parents.end(), 0);
+
+    for (size_t i = 0; i < changedPins.size(); i++)
+    {
+        size_t linkedPin = getLinkedPin(elements, changedPins[i]);
+
+        if (linkedPin == NONE)
+        {
+            continue;
+        }
+
+        auto it = std::lower_bound(changedPins.begin(), changedPins.end(), linkedPin);
+
+        if (it == changedPins.end() || *it != linkedPin)                                // соединение вне области возможно, только если затронутые
+        {                                                                               // пины переданы не полностью
+            throw std::runtime_error("Pin " + std::to_string(changedPins[i]) +
+                                     " is linked outside of the changed pins");
+        }
+
+        unite(i, it - changedPins.begin());
+    }
+
+    size_t oldPinCount = groups.size();
+    BoolVect claimed(regionGroups.size(), false);                                       // старые номера, уже занятые новыми группами
+    SizeVect rootGroups(changedPins.size(), NONE);                                      // новые номера групп области (по корням множеств)
+
+    for (size_t i = 0; i < changedPins.size(); i++)                                     // новая группа наследует номер старой группы своего пина
+    {
+        size_t root = find(i);
+
+        if (rootGroups[root] != NONE || changedPins[i] >= oldPinCount)
+        {
+            continue;
+        }
+
+        size_t position = std::lower_bound(regionGroups.begin(), regionGroups.end(),
+                                           groups[changedPins[i]]) - regionGroups.begin();
+
+        if (!claimed[position])
+        {
+            claimed[position] = true;
+            rootGroups[root] = regionGroups[position];
         }
     }
-                                                                                        // вторая часть: соединяем то, что соединено через другие пины
-    for (size_t i = 0; i < pinCount; i++)                                               // перебираем матрицу пинов по строкам
+
+    for (size_t i = 0; i < regionGroups.size(); i++)                                    // номера, не занятые новыми группами, освобождаются
     {
-        for (size_t j = 0; j < i; j++)                                                  // перебираем матрицу пинов по столбцам (смотрим ниже главной диагонали)
+        if (!claimed[i])
         {
-            if (matrix[i][j])                                                           // если i-ый пин соединен с j-ым
+            groupStarts[regionGroups[i]] = groupEnds[regionGroups[i]] = 0;
+            freeGroups.push_back(regionGroups[i]);
+        }
+    }
+
+    SizeVect counts(changedPins.size() + 1, 0);                                         // количество пинов каждой группы области (по корням)
+
+    for (size_t i = 0; i < changedPins.size(); i++)
+    {
+        size_t root = find(i);
+
+        if (rootGroups[root] == NONE)                                                   // группе не достался старый номер - берем пустую
+        {                                                                               // группу или добавляем новую
+            if (freeGroups.empty())
             {
-                for (size_t k = 0; k < j; k++)                                          // перебираем до главной диагонали строку j, пин из которой соединен с i-ым  
-                {                                                                       // ищем пины, которые через j-ый соединены с i-ым
-                    if (matrix[j][k])                                                   // если j-ый пин соединен с k-ым
-                    {
-                        matrix[i][k] = true;                                            // то i-ый пин так же соединен с k-ым
-                    }
-                }
-                for (size_t k = i + 1; k < pinCount; k++)                               // перебираем от главноц диагонали столбец j, пин из которой соединен с i-ым
-                {                                                                       // ищем пины, которые через j-ый соединены с i-ым
-                    if (matrix[k][j])                                                   // если k-ый пин соединен с j-ым
-                    {
-                        matrix[k][i] = true;                                            // то k-ый пин так же соединен с i-ым
-                    }                                                                   // т.е. дополняем отношение до транзитивного, каким оно и должно быть
-                }
+                freeGroups.push_back(groupStarts.size());
+                groupStarts.push_back(0);
+                groupEnds.push_back(0);
             }
+
+            rootGroups[root] = freeGroups.back();
+            freeGroups.pop_back();
         }
+
+        counts[root + 1]++;
+    }
+
+    for (size_t i = 1; i < counts.size(); i++)                                          // размеры групп превращаем в смещения
+    {
+        counts[i] += counts[i - 1];
+    }
+
+    size_t first = groupPins.size();                                                    // участки групп области дописываются в конец массива
+    SizeVect positions(counts.begin(), counts.end() - 1);                               // текущие позиции записи в группах
+    groupPins.resize(first + changedPins.size());
+    groups.resize(pinCount, NONE);
+    wiredPins.resize(pinCount, NONE);
+
+    for (size_t i = 0; i < changedPins.size(); i++)                                     // раскладываем пины по группам (по возрастанию)
+    {
+        size_t root = find(i);
+        size_t group = rootGroups[root];
+
+        groupPins[first + positions[root]++] = changedPins[i];
+        groupStarts[group] = first + counts[root];
+        groupEnds[group] = first + counts[root + 1];
+        groups[changedPins[i]] = group;
+    }
+
+    for (size_t pin : changedPins)                                                      // соседние пины групп из двух пинов
+    {
+        SizeRange pins = getGroupPins(groups[pin]);
+        wiredPins[pin] = pins.size() == 2 ? pins[pins[0] == pin ? 1 : 0] : NONE;
+    }
+
+    if (groupPins.size() > 2 * pinCount)                                                // участки удаленных групп занимают больше половины массива
+    {
+        compactGroupPins();
     }
+
+    SizeVect().swap(parents);                                                           // рабочие массивы больше не нужны
+    SizeVect().swap(ranks);                                                             //
+}
+
+// геттер количества пинов
+inline size_t PinMatrix::size() const
+{
+    return groups.size();
+}
+
+// геттер количества групп (включая группы из одного пина и пустые группы,
+// номера которых освободил patch)
+inline size_t PinMatrix::getGroupCount() const
+{
+    return groupStarts.size();
+}
+
+// геттер номера группы, в которую входит пин
+inline size_t PinMatrix::getGroup(size_t pin) const
+{
+    return groups[pin];
+}
+
+// геттер пинов группы
+inline SizeRange PinMatrix::getGroupPins(size_t group) const
+{
+    return { groupPins.data() + groupStarts[group], groupPins.data() + groupEnds[group] };
+}
+
+// геттер пина, соединенного "проводом" с пином pin, если такой пин единственный
+// (группа из двух пинов); для узловых и свободных пинов возвращает NONE
+inline size_t PinMatrix::getWiredPin(size_t pin) const
+{
+    return wiredPins[pin];
+}
+
+// геттер пинов групп, пересчитанных последним patch (после update - пустой)
+inline const SizeVect& PinMatrix::getChangedPins() const
+{
+    return changedPins;
 }
 
-// геттер размера матрицы
-inline const size_t PinMatrix::size() const
+// метод проверки соединения двух пинов (напрямую или через другие пины)
+inline bool PinMatrix::connected(size_t first, size_t second) const
 {
-    return matrix.size();
+    return groups[first] == groups[second];
 }
 
-// геттер строки матрицы (одномерного вектора)
-inline const BoolVect& PinMatrix::operator[](size_t index) const
+// элемент матрицы соединений: истина, если разные пины first и second соединены
+inline bool PinMatrix::operator()(size_t first, size_t second) const
 {
-    return matrix[index];
+    return first != second && connected(first, second);
 }
 
 // перегрузка оператора вывода в поток
+// выводится треугольная матрица соединений (ниже главной диагонали), которая строится
+// только здесь - для отладочного представления
 inline std::ostream& operator<<(std::ostream& os, const PinMatrix& matrix)
 {
     os << "Матрица соединений пинов:\n\n" << std::setw(6) << ' ';
@@ -96,9 +325,9 @@ inline std::ostream& operator<<(std::ostream& os, const PinMatrix& matrix)
     {
         os << std::left << std::setw(4) << i << std::right << ": ";
 
-        for (size_t j = 0; j < matrix[i].size(); j++)
+        for (size_t j = 0; j < i; j++)
         {
-            os << std::setw(4) << matrix[i][j] << ' ';
+            os << std::setw(4) << matrix(i, j) << ' ';
         }
 
         os << "\n\n";
@@ -107,4 +336,206 @@ inline std::ostream& operator<<(std::ostream& os, const PinMatrix& matrix)
     return os;
 }
 
+// метод поиска корня множества, в которое входит пин
+// все пины на пройденном пути подвешиваются непосредственно к корню
+inline size_t PinMatrix::find(size_t pin)
+{
+    size_t root = pin;
+
+    while (parents[root] != root)                                                       // поднимаемся к корню
+    {
+        root = parents[root];
+    }
+
+    while (parents[pin] != root)                                                        // сжимаем путь
+    {
+        size_t parent = parents[pin];
+        parents[pin] = root;
+        pin = parent;
+    }
+
+    return root;
+}
+
+// метод объединения множеств двух пинов:
+// корень множества меньшего ранга подвешивается к корню множества большего ранга
+inline void PinMatrix::unite(size_t first, size_t second)
+{
+    size_t firstRoot = find(first);
+    size_t secondRoot = find(second);
+
+    if (firstRoot == secondRoot)                                                        // пины уже в одном множестве
+    {
+        return;
+    }
+
+    if (ranks[firstRoot] < ranks[secondRoot])
+    {
+        std::swap(firstRoot, secondRoot);
+    }
+
+    parents[secondRoot] = firstRoot;
+
+    if (ranks[firstRoot] == ranks[secondRoot])
+    {
+        ranks[firstRoot]++;
+    }
+}
+
+// метод нумерации групп по корням множеств:
+// группы нумеруются в порядке появления наименьших пинов
+inline void PinMatrix::updateGroups()
+{
+    size_t pinCount = parents.size();
+    SizeVect rootGroups(pinCount, NONE);                                                // номер группы для каждого корня (NONE - еще не пронумерован)
+    size_t groupCount = 0;
+
+    groups = SizeVect(pinCount);
+
+    for (size_t i = 0; i < pinCount; i++)                                               // перебираем пины по возрастанию
+    {
+        size_t root = find(i);
+
+        if (rootGroups[root] == NONE)                                                   // первый (наименьший) пин группы
+        {
+            rootGroups[root] = groupCount++;
+        }
+
+        groups[i] = rootGroups[root];
+    }
+
+    updateGroupPins(groupCount);
+}
+
+// метод построения списков пинов групп по номерам групп пинов:
+// пины раскладываются подсчетом (за линейное время) по возрастанию, участки групп
+// идут в массиве подряд; для групп из двух пинов запоминаются соседние пины
+// принимает на вход: количество групп
+inline void PinMatrix::updateGroupPins(size_t groupCount)
+{
+    size_t pinCount = groups.size();
+    SizeVect offsets(groupCount + 1, 0);                                                // смещения начала групп (групп + 1)
+
+    for (size_t i = 0; i < pinCount; i++)                                               // считаем пины групп
+    {
+        offsets[groups[i] + 1]++;
+    }
+
+    for (size_t i = 1; i < offsets.size(); i++)                                         // размеры групп превращаем в смещения
+    {
+        offsets[i] += offsets[i - 1];
+    }
+
+    groupPins = SizeVect(pinCount);
+    groupStarts.assign(offsets.begin(), offsets.end() - 1);
+    groupEnds.assign(offsets.begin() + 1, offsets.end());
+    freeGroups.clear();
+    SizeVect positions(groupStarts);                                                    // текущие позиции записи в группах
+
+    for (size_t i = 0; i < pinCount; i++)                                               // раскладываем пины по группам (по возрастанию)
+    {
+        groupPins[positions[groups[i]]++] = i;
+    }
+
+    wiredPins = SizeVect(pinCount, NONE);
+
+    for (size_t i = 0; i < groupCount; i++)                                             // перебираем группы из двух пинов
+    {
+        if (groupEnds[i] - groupStarts[i] == 2)
+        {
+            size_t first = groupPins[groupStarts[i]];
+            size_t second = groupPins[groupStarts[i] + 1];
+
+            wiredPins[first] = second;
+            wiredPins[second] = first;
+        }
+    }
+}
+
+// метод удаления из массива groupPins участков групп, удаленных или пересчитанных
+// при patch: участки групп переписываются подряд в порядке номеров групп (за
+// линейное время; выполняется, когда такие участки занимают больше половины массива,
+// поэтому на каждый patch приходится время, пропорциональное размеру его области)
+inline void PinMatrix::compactGroupPins()
+{
+    SizeVect compacted;
+    compacted.reserve(groups.size());
+
+    for (size_t i = 0; i < getGroupCount(); i++)
+    {
+        size_t start = compacted.size();
+
+        compacted.insert(compacted.end(), groupPins.begin() + groupStarts[i], groupPins.begin() + groupEnds[i]);
+        groupStarts[i] = start;
+        groupEnds[i] = compacted.size();
+    }
+
+    groupPins.swap(compacted);
+}
+
+// метод добавления пина в пересчитываемую область: для пина, существовавшего
+// при последнем обновлении, запоминается его старая группа, новый пин добавляется сам
+inline void PinMatrix::addRegionPin(size_t pin, SizeVect& regionGroups)
+{
+    if (pin < groups.size())
+    {
+        regionGroups.push_back(groups[pin]);
+    }
+    else
+    {
+        changedPins.push_back(pin);
+    }
+}
+
+// метод получения номера пина, с которым соединен пин pin (NONE - ни с чем не соединен)
+// при соединении с несуществующим пином выбрасывает исключение std::runtime_error
+inline size_t PinMatrix::getLinkedPin(const Elements& elements, size_t pin) const
+{
+    int linkedPin = elements[pin / 2].getLinkedPin(pin % 2);                            // целая часть от деления на два - номер элемента, остаток - номер пина элемента
+
+    if (linkedPin < 0)                                                                  // пин ни с чем не соединен (-1)
+    {
+        return NONE;
+    }
+
+    if (static_cast<size_t>(linkedPin) >= elements.size() * 2)                          // соединение с несуществующим пином
+    {
+        throw std::runtime_error("Pin " + std::to_string(pin) +
+                                 " is linked to nonexistent pin " + std::to_string(linkedPin));
+    }
+
+    return linkedPin;
+}
+
+// метод записи групп пинов в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void PinMatrix::save(BinaryWriter& writer) const
+{
+    writer.write(groups);
+    writer.write(groupStarts);
+    writer.write(groupEnds);
+    writer.write(groupPins);
+    writer.write(freeGroups);
+    writer.write(wiredPins);
+    writer.write(parents);
+    writer.write(ranks);
+}
+
+// метод чтения групп пинов из двоичного буфера, записанного методом save
+// (системы непересекающихся множеств тоже читаются - для последующих patch)
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void PinMatrix::load(BinaryReader& reader)
+{
+    reader.read(groups);
+    reader.read(groupStarts);
+    reader.read(groupEnds);
+    reader.read(groupPins);
+    reader.read(freeGroups);
+    reader.read(wiredPins);
+    reader.read(parents);
+    reader.read(ranks);
+    changedPins.clear();
+}
+
 } // namespace CS
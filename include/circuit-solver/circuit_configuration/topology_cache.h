@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/elements.h"
+#include "circuit-solver/structure_units/serialization.h"
+
+namespace CS
+{
+// класс для кэша топологии на диске
+// результаты топологических этапов обновления схемы (группы пинов, узлы, ветви,
+// матрица инцидентности, контуры и структура системы уравнений) зависят только от
+// типов элементов и номеров присоединенных пинов, но не от значений; поэтому они
+// сохраняются в файл, названный по хэшу соединений, и при повторном построении той же
+// схемы (например, после перезапуска процесса) читаются вместо вычисления
+// ключ - два независимых 64-битных хэша соединений, количество элементов и вариант
+// построения (способ составления уравнений и поиска контуров); первый хэш дает имя
+// файла, остальное проверяется по заголовку вместе с версией формата и контрольной
+// суммой содержимого - при любом несовпадении файл считается промахом и
+// перезаписывается
+// файл записывается во временный и переименовывается, поэтому одновременно работающие
+// процессы не читают недописанные файлы; ошибки записи кэша не прерывают расчет
+//////////////////////////////////////////////////////////////////////////////////////////
+class TopologyCache
+{
+public:
+    static constexpr uint32_t VERSION = 2;                                              // версия формата файлов кэша
+
+    struct Key                                                                          // ключ кэша
+    {
+        uint64_t hash = 0;                                                              // хэш соединений (имя файла)
+        uint64_t check = 0;                                                             // независимый проверочный хэш соединений
+        uint64_t elementCount = 0;                                                      // количество элементов
+        uint32_t variant = 0;                                                           // вариант построения
+    };
+
+    void setDirectory(const std::string& directory);                                    // сеттер каталога кэша (пустой - кэш отключен)
+    const std::string& getDirectory() const;                                            // геттер каталога кэша
+    bool isEnabled() const;                                                             // метод проверки, включен ли кэш
+    size_t getHitCount() const;                                                         // геттер количества попаданий
+    size_t getMissCount() const;                                                        // геттер количества промахов
+    static Key getKey(const Elements& elements, uint32_t variant);                      // метод вычисления ключа по соединениям элементов
+    bool read(const Key& key, std::string& payload);                                    // метод чтения содержимого по ключу
+    bool write(const Key& key, const std::string& payload) const;                       // метод записи содержимого по ключу
+    void countMiss();                                                                   // метод учета промаха (содержимое не подошло)
+
+private:
+    struct Header                                                                       // заголовок файла кэша
+    {
+        char magic[8];                                                                  // сигнатура формата
+        uint32_t version;                                                               // версия формата
+        uint32_t variant;                                                               // вариант построения
+        uint64_t hash;                                                                  // ключ
+        uint64_t check;                                                                 //
+        uint64_t elementCount;                                                          //
+        uint64_t payloadSize;                                                           // размер содержимого
+        uint64_t payloadHash;                                                           // контрольная сумма содержимого
+        uint32_t sizeSize;                                                              // sizeof(size_t) записавшей сборки
+        uint32_t orderMark;                                                             // ORDER_MARK в порядке байтов записавшей машины
+    };
+
+    static constexpr char MAGIC[8] = { 'C', 'S', 'T', 'O', 'P', 'O', 'L', 'O' };        // сигнатура формата
+    static constexpr uint32_t ORDER_MARK = 0x01020304;                                  // метка порядка байтов
+    static constexpr uint64_t HASH_SEED = 0x5EED0F7090106Dull;                          // начальные значения хэшей ключа
+    static constexpr uint64_t CHECK_SEED = 0xC4ECC0FFEE15A11ull;                        //
+    static constexpr uint64_t PAYLOAD_SEED = 0x9A7104D5EEDull;                          // начальное значение контрольной суммы
+
+    std::string directory;                                                              // каталог файлов кэша (пустой - кэш отключен)
+    size_t hitCount = 0;                                                                // количество попаданий
+    size_t missCount = 0;                                                               // количество промахов
+
+    std::string getPath(const Key& key) const;                                          // метод получения пути к файлу ключа
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// сеттер каталога кэша: каталог создается при первой записи
+// принимает на вход: путь к каталогу (пустой - кэш отключен)
+inline void TopologyCache::setDirectory(const std::string& directory)
+{
+    this->directory = directory;
+}
+
+// геттер каталога кэша
+inline const std::string& TopologyCache::getDirectory() const
+{
+    return directory;
+}
+
+// метод проверки, включен ли кэш (задан ли каталог)
+inline bool TopologyCache::isEnabled() const
+{
+    return !directory.empty();
+}
+
+// геттер количества попаданий в кэш
+inline size_t TopologyCache::getHitCount() const
+{
+    return hitCount;
+}
+
+// геттер количества промахов кэша
+inline size_t TopologyCache::getMissCount() const
+{
+    return missCount;
+}
+
+// метод вычисления ключа по соединениям: для каждого элемента хэшируются тип и номера
+// обоих присоединенных пинов (значения не участвуют)
+// принимает на вход:
+// 1) список элементов
+// 2) вариант построения (различает кэши разных способов построения одной схемы)
+inline TopologyCache::Key TopologyCache::getKey(const Elements& elements, uint32_t variant)
+{
+    const size_t BLOCK = 1024;                                                          // элементов в блоке хэширования
+    uint64_t words[2 * BLOCK];                                                          // тип и пины элементов блока
+    Key key;
+    key.elementCount = elements.size();
+    key.variant = variant;
+    key.hash = HASH_SEED ^ variant;
+    key.check = CHECK_SEED ^ variant;
+
+    for (size_t first = 0; first < elements.size(); first += BLOCK)
+    {
+        size_t count = std::min(BLOCK, elements.size() - first);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const Element& element = elements[first + i];
+            words[2 * i] = static_cast<uint64_t>(element.getType());
+            words[2 * i + 1] = static_cast<uint32_t>(element.getLinkedPin(0)) |
+                               static_cast<uint64_t>(static_cast<uint32_t>(element.getLinkedPin(1))) << 32;
+        }
+
+        key.hash = hashBytes(words, 2 * count * sizeof(uint64_t), key.hash);            // хэш блока продолжает хэш предыдущих
+        key.check = hashBytes(words, 2 * count * sizeof(uint64_t), key.check);
+    }
+
+    return key;
+}
+
+// метод чтения содержимого по ключу: файл принимается, только если его заголовок
+// совпадает с ключом, версией и параметрами сборки, а контрольная сумма - с
+// содержимым
+// принимает на вход:
+// 1) ключ
+// 2) строка для содержимого
+// возвращает true при попадании
+inline bool TopologyCache::read(const Key& key, std::string& payload)
+{
+    std::ifstream input(getPath(key), std::ios::binary);
+    Header header;
+
+    bool valid = input && input.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version == VERSION && header.variant == key.variant &&
+                 header.hash == key.hash && header.check == key.check &&
+                 header.elementCount == key.elementCount &&
+                 header.sizeSize == sizeof(size_t) && header.orderMark == ORDER_MARK;
+
+    if (valid)
+    {
+        input.seekg(0, std::ios::end);
+        valid = static_cast<uint64_t>(input.tellg()) == sizeof(header) + header.payloadSize;
+    }
+
+    if (valid)
+    {
+        payload.resize(header.payloadSize);
+        input.seekg(sizeof(header));
+        valid = input.read(&payload[0], payload.size()) &&
+                hashBytes(payload.data(), payload.size(), PAYLOAD_SEED) == header.payloadHash;
+    }
+
+    if (!valid)
+    {
+        missCount++;
+        return false;
+    }
+
+    hitCount++;
+    return true;
+}
+
+// метод записи содержимого по ключу: файл пишется во временный файл того же каталога
+// и переименовывается (каталог создается при необходимости)
+// принимает на вход:
+// 1) ключ
+// 2) содержимое
+// возвращает false, если записать не удалось (кэш при этом не меняется)
+inline bool TopologyCache::write(const Key& key, const std::string& payload) const
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.variant = key.variant;
+    header.hash = key.hash;
+    header.check = key.check;
+    header.elementCount = key.elementCount;
+    header.payloadSize = payload.size();
+    header.payloadHash = hashBytes(payload.data(), payload.size(), PAYLOAD_SEED);
+    header.sizeSize = sizeof(size_t);
+    header.orderMark = ORDER_MARK;
+
+    std::string path = getPath(key);
+    std::string temporary = path + ".tmp" +                                             // уникальное имя для одновременных записей
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                       static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    {
+        std::ofstream output(temporary, std::ios::binary);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(payload.data(), payload.size());
+
+        if (!output.flush())
+        {
+            output.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+
+    if (error)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// метод учета промаха: прочитанное содержимое не удалось разобрать
+// (попадание, засчитанное read, заменяется промахом)
+inline void TopologyCache::countMiss()
+{
+    hitCount--;
+    missCount++;
+}
+
+// метод получения пути к файлу ключа: каталог и шестнадцатеричный хэш соединений
+// принимает на вход: ключ
+inline std::string TopologyCache::getPath(const Key& key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.topology", static_cast<unsigned long long>(key.hash));
+
+    return (std::filesystem::path(directory) / name).string();
+}
+
+} // namespace CS
@@ -18,10 +18,24 @@ using DoublePtrMatr = std::vector<std::vector<double*>>;
 using CoeffMatr = std::vector<std::vector<Coefficient>>;
 using CoeffVect = std::vector<Coefficient>;
 using IntVect = std::vector<int>;
+using DoubleVect = std::vector<double>;
 using SizeVect = std::vector<size_t>;
 using BoolVect = std::vector<bool>;
 using ElemVect = std::vector<Element>;
 
+// представление непрерывного участка вектора номеров без копирования
+// (например, пинов одной группы в построчно хранимом списке групп)
+struct SizeRange
+{
+    const size_t* first = nullptr;                                                      // указатель на первый номер участка
+    const size_t* last = nullptr;                                                       // указатель за последним номером участка
+
+    const size_t* begin() const { return first; }                                       // итераторы для range-based цикла
+    const size_t* end() const { return last; }                                          //
+    size_t size() const { return last - first; }                                        // геттер количества номеров
+    size_t operator[] (size_t index) const { return first[index]; }                     // геттер номера по индексу
+};
+
 // константы для коэффициентов системы уравнений
 static const double ZERO = 0.0;
 static const double ONE = 1.0;
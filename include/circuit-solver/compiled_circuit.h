@@ -0,0 +1,301 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit.h"
+
+namespace CS
+{
+// класс для представления скомпилированной схемы - неизменяемого снимка схемы,
+// достаточного для расчета при любых значениях элементов:
+// - система уравнений выбранного способа (коэффициенты - индексы значений и знаки)
+// - типы и номинальные значения элементов
+// - символьный анализ левой части и ее разложение при номинальных значениях
+//   (выбор ведущих строк, который повторяют численные разложения)
+// снимок не ссылается на исходную схему и после создания не изменяется, поэтому
+// один объект можно использовать из нескольких потоков одновременно без блокировок;
+// значения элементов и численное разложение хранит SolveContext (по одному на поток)
+//////////////////////////////////////////////////////////////////////////////////////////
+class CompiledCircuit
+{
+public:
+    explicit CompiledCircuit(Circuit& circuit);                                         // конструктор с параметрами (компиляция схемы)
+    Circuit::Formulation getFormulation() const;                                        // геттер способа составления системы уравнений
+    size_t getElementCount() const;                                                     // геттер количества элементов
+    size_t getBranchCount() const;                                                      // геттер количества ветвей (длины вектора токов)
+    Element::Type getElementType(size_t index) const;                                   // геттер типа элемента
+    const DoubleVect& getNominalValues() const;                                         // геттер номинальных значений элементов
+    const SparseLUSolver& getSolver() const;                                            // геттер разложения при номинальных значениях
+    void evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const;   // метод вычисления коэффициентов левой части
+    DoubleVect getSourceValues(const DoubleVect& elementValues) const;                  // метод получения значений источников по столбцам правой части
+    void evaluateRight(const DoubleVect& elementValues, const DoubleVect& sourceValues,
+                       DoubleVect& rightPart) const;                                    // метод вычисления правой части
+    DoubleVect getBranchCurrents(const DoubleVect& solution, const DoubleVect& elementValues,
+                                 const DoubleVect& sourceValues) const;                 // метод получения токов ветвей по решению системы
+    void getCurrentGradient(size_t branch, const DoubleVect& solution,
+                            const DoubleVect& elementValues, DoubleVect& bySolution,
+                            DoubleVect& byElements) const;                              // метод вычисления производных тока ветви
+    void addElementResidual(size_t element, const DoubleVect& elementValues,
+                            const DoubleVect& solution, DoubleVect& residual) const;    // метод добавления производной невязки по значению элемента
+    void addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& elementValues,
+                               const DoubleVect& solution,
+                               DoubleVect& derivatives) const;                          // метод добавления производных для сопряженного решения
+    void getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                          double value, RankOneUpdate& update) const;                   // метод получения изменения системы при новом значении элемента
+
+private:
+    Circuit::Formulation formulation;                                                   // способ составления системы уравнений
+    Equations equations;                                                                // система уравнений по законам Кирхгофа
+    MnaEquations mnaEquations;                                                          // система узловых уравнений
+    SparseLUSolver solver;                                                              // разложение при номинальных значениях (структура общая с контекстами)
+    DoubleVect nominalValues;                                                           // номинальные значения элементов
+    std::vector<Element::Type> types;                                                   // типы элементов
+    size_t branchCount = 0;                                                             // количество ветвей
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами: обновляет схему, копирует систему уравнений выбранного
+// способа и раскладывает ее левую часть при номинальных значениях (с упорядочением,
+// выбранным в схеме); дальнейшие изменения схемы на снимок не влияют
+// схема передается неконстантной ссылкой только ради update: накопленные изменения
+// топологии применяются к ней самой, иначе снимок собирался бы из устаревших структур
+// (разложение схемы не копируется - снимок раскладывает систему сам)
+// при вырожденной системе или несовпадении количества уравнений и неизвестных
+// выбрасывает исключение std::runtime_error
+inline CompiledCircuit::CompiledCircuit(Circuit& circuit) :
+    formulation{ circuit.getFormulation() }
+{
+    circuit.update();
+    solver.setOrdering(circuit.getOrdering());
+
+    const Elements& elements = circuit.getElements();
+
+    nominalValues = elements.getValues();
+    types = std::vector<Element::Type>(elements.size());
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        types[i] = elements[i].getType();
+    }
+
+    switch (formulation)                                                                // копируем систему выбранного способа
+    {
+    case Circuit::Formulation::Branch:
+        equations = circuit.getEquations();
+
+        if (equations.size() != equations.getUnknownCurrentCount())
+        {
+            throw std::runtime_error("Equation count " + std::to_string(equations.size()) +
+                                     " does not match unknown current count " +
+                                     std::to_string(equations.getUnknownCurrentCount()));
+        }
+
+        solver.analyze(equations.left());
+        branchCount = equations.getBranchCount();
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations = circuit.getMnaEquations();
+        solver.analyze(mnaEquations.left());
+        branchCount = mnaEquations.getBranchCount();
+    }
+
+    DoubleVect leftValues;
+    evaluateLeft(nominalValues, leftValues);
+    solver.factorize(leftValues);
+}
+
+// геттер способа составления системы уравнений
+inline Circuit::Formulation CompiledCircuit::getFormulation() const
+{
+    return formulation;
+}
+
+// геттер количества элементов (длины массива значений элементов)
+inline size_t CompiledCircuit::getElementCount() const
+{
+    return nominalValues.size();
+}
+
+// геттер количества ветвей (длины вектора токов)
+inline size_t CompiledCircuit::getBranchCount() const
+{
+    return branchCount;
+}
+
+// геттер типа элемента
+inline Element::Type CompiledCircuit::getElementType(size_t index) const
+{
+    return types[index];
+}
+
+// геттер номинальных значений элементов (значений на момент компиляции)
+inline const DoubleVect& CompiledCircuit::getNominalValues() const
+{
+    return nominalValues;
+}
+
+// геттер разложения левой части при номинальных значениях: копия разложения
+// разделяет с ним символьный анализ и структуру L, U и служит отправной точкой для
+// численных разложений при других значениях
+inline const SparseLUSolver& CompiledCircuit::getSolver() const
+{
+    return solver;
+}
+
+// метод вычисления коэффициентов левой части системы выбранного способа
+// принимает на вход:
+// 1) значения элементов
+// 2) вектор для значений коэффициентов левой части
+inline void CompiledCircuit::evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.evaluateLeft(elementValues, leftValues);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.evaluateLeft(elementValues, leftValues);
+    }
+}
+
+// метод получения значений источников по столбцам правой части
+// принимает на вход: значения элементов
+inline DoubleVect CompiledCircuit::getSourceValues(const DoubleVect& elementValues) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        return equations.getSourceValues(elementValues);
+    case Circuit::Formulation::Nodal:
+        return mnaEquations.getSourceValues(elementValues);
+    }
+
+    return DoubleVect();
+}
+
+// метод вычисления правой части системы выбранного способа
+// принимает на вход:
+// 1) значения элементов
+// 2) значения источников по столбцам правой части (см. getSourceValues)
+// 3) вектор для правой части системы
+inline void CompiledCircuit::evaluateRight(const DoubleVect& elementValues, const DoubleVect& sourceValues,
+                                           DoubleVect& rightPart) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.evaluateRight(sourceValues, rightPart);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.evaluateRight(elementValues, sourceValues, rightPart);
+    }
+}
+
+// метод получения токов всех ветвей по решению системы выбранного способа
+// принимает на вход:
+// 1) решение системы
+// 2) значения элементов
+// 3) значения источников по столбцам правой части
+inline DoubleVect CompiledCircuit::getBranchCurrents(const DoubleVect& solution, const DoubleVect& elementValues,
+                                                     const DoubleVect& sourceValues) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        return equations.getBranchCurrents(solution, sourceValues);
+    case Circuit::Formulation::Nodal:
+        return mnaEquations.getBranchCurrents(solution, elementValues, sourceValues);
+    }
+
+    return DoubleVect();
+}
+
+// метод вычисления производных тока ветви по решению системы и по значениям элементов
+// (при неизменном решении)
+// принимает на вход:
+// 1) номер ветви
+// 2) решение системы
+// 3) значения элементов
+// 4) вектор для производных по решению (размер приводится к размеру системы)
+// 5) вектор для производных по значениям элементов (размер приводится к количеству элементов)
+inline void CompiledCircuit::getCurrentGradient(size_t branch, const DoubleVect& solution,
+                                                const DoubleVect& elementValues, DoubleVect& bySolution,
+                                                DoubleVect& byElements) const
+{
+    byElements.resize(getElementCount());
+
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.getCurrentGradient(branch, bySolution, byElements);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.getCurrentGradient(branch, solution, elementValues, bySolution, byElements);
+    }
+}
+
+// метод добавления производной невязки системы d(right - left * x) / dp по значению
+// элемента при неизменном решении
+// принимает на вход:
+// 1) номер элемента
+// 2) значения элементов
+// 3) решение системы
+// 4) вектор, к которому добавляется производная
+inline void CompiledCircuit::addElementResidual(size_t element, const DoubleVect& elementValues,
+                                                const DoubleVect& solution, DoubleVect& residual) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.addElementResidual(element, solution, residual);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.addElementResidual(element, elementValues, solution, residual);
+    }
+}
+
+// метод добавления производных по значениям всех элементов для сопряженного решения
+// (adjoint^T * d(right - left * x) / dp для каждого элемента p)
+// принимает на вход:
+// 1) решение сопряженной системы
+// 2) значения элементов
+// 3) решение системы
+// 4) вектор производных по элементам
+inline void CompiledCircuit::addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& elementValues,
+                                                   const DoubleVect& solution,
+                                                   DoubleVect& derivatives) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.addAdjointDerivatives(adjoint, solution, derivatives);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.addAdjointDerivatives(adjoint, elementValues, solution, derivatives);
+    }
+}
+
+// метод получения изменения системы выбранного способа при новом значении элемента
+// (см. RankOneUpdate)
+// принимает на вход:
+// 1) номер элемента
+// 2) текущие значения элементов
+// 3) новое значение элемента
+// 4) структура для изменения системы
+inline void CompiledCircuit::getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                                              double value, RankOneUpdate& update) const
+{
+    switch (formulation)
+    {
+    case Circuit::Formulation::Branch:
+        equations.getRankOneUpdate(element, elementValues, value, update);
+        break;
+    case Circuit::Formulation::Nodal:
+        mnaEquations.getRankOneUpdate(element, elementValues, value, update);
+    }
+}
+
+} // namespace CS
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/equation_system/sparse_matrix.h"
+
+namespace CS
+{
+// класс для вычисления значений коэффициентов разреженной матрицы (сборки системы)
+// коэффициенты SparseMatrix переводятся в плоские массивы одинаковой длины:
+// индекс значения (32 бита, -1 - единичный коэффициент) и знак (8 бит), так что
+// значение коэффициента равно sign * values[index] (или sign для единичного)
+// сборка сводится к выборке значений по индексам (gather) и умножению на знак:
+// при сборке с AVX2 они выполняются векторными командами по 4 коэффициента
+// (единичные коэффициенты исключаются из выборки маской), иначе - простым циклом,
+// который компилятор может векторизовать сам
+//////////////////////////////////////////////////////////////////////////////////////////
+class Assembly
+{
+public:
+    void update(const SparseMatrix& matrix);                                            // метод построения плоских массивов по матрице
+    size_t size() const;                                                                // геттер количества коэффициентов
+    void evaluate(const double* values, double* result) const;                          // метод вычисления значений коэффициентов
+    void evaluate(const DoubleVect& values, DoubleVect& result) const;                  // метод вычисления значений коэффициентов (перегрузка)
+
+private:
+    static constexpr int32_t UNIT = -1;                                                 // индекс единичного коэффициента
+
+    std::vector<int32_t> indices;                                                       // индексы значений
+    std::vector<int8_t> signs;                                                          // знаки (+-1)
+
+    void evaluateScalar(const double* values, double* result, size_t first) const;      // метод вычисления значений без векторных команд
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод построения плоских массивов по коэффициентам разреженной матрицы
+// (в порядке их хранения)
+// принимает на вход: разреженную матрицу
+// если индекс значения не помещается в 32 бита, выбрасывает исключение
+// std::length_error
+inline void Assembly::update(const SparseMatrix& matrix)
+{
+    const SizeVect& valueIndices = matrix.getValueIndices();
+    const IntVect& matrixSigns = matrix.getSigns();
+
+    indices = std::vector<int32_t>(matrix.nonZeros(), UNIT);
+    signs = std::vector<int8_t>(matrix.nonZeros());
+
+    for (size_t k = 0; k < matrix.nonZeros(); k++)
+    {
+        signs[k] = static_cast<int8_t>(matrixSigns[k]);
+
+        if (valueIndices[k] == SparseMatrix::UNIT)                                      // единичный коэффициент - индекс не нужен
+        {
+            continue;
+        }
+
+        if (valueIndices[k] > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+        {
+            throw std::length_error("Value index does not fit assembly");
+        }
+
+        indices[k] = static_cast<int32_t>(valueIndices[k]);
+    }
+}
+
+// геттер количества коэффициентов
+inline size_t Assembly::size() const
+{
+    return indices.size();
+}
+
+// метод вычисления значений коэффициентов
+// принимает на вход:
+// 1) значения, в которые указывают индексы (значения элементов, проводимости ветвей)
+// 2) массив для значений коэффициентов (size() значений)
+inline void Assembly::evaluate(const double* values, double* result) const
+{
+    size_t k = 0;
+
+#if defined(__AVX2__)
+    const __m256d ones = _mm256_set1_pd(1.0);
+
+    for (; k + 4 <= size(); k += 4)                                                     // по 4 коэффициента
+    {
+        __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&indices[k]));
+        __m128i valued = _mm_cmpgt_epi32(index, _mm_set1_epi32(UNIT));                  // маска коэффициентов со значениями
+        __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(valued));              // (расширенная до 64 бит)
+        __m256d value = _mm256_mask_i32gather_pd(ones, values, index, mask, 8);         // выборка значений по индексам (единица для единичных)
+
+        int32_t packed;                                                                 // 4 знака по 8 бит
+        std::memcpy(&packed, &signs[k], sizeof(packed));
+        __m256d sign = _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed)));
+
+        _mm256_storeu_pd(result + k, _mm256_mul_pd(sign, value));
+    }
+#endif
+
+    evaluateScalar(values, result, k);                                                  // остаток (или все коэффициенты)
+}
+
+// метод вычисления значений коэффициентов (перегрузка)
+// принимает на вход:
+// 1) значения, в которые указывают индексы
+// 2) вектор для значений коэффициентов (размер приводится к size())
+inline void Assembly::evaluate(const DoubleVect& values, DoubleVect& result) const
+{
+    result.resize(size());
+
+    if (size())
+    {
+        evaluate(values.data(), result.data());                                         // при пустом values все коэффициенты единичные
+    }
+}
+
+// метод вычисления значений коэффициентов без векторных команд
+// принимает на вход:
+// 1) значения, в которые указывают индексы
+// 2) массив для значений коэффициентов
+// 3) номер первого вычисляемого коэффициента
+inline void Assembly::evaluateScalar(const double* values, double* result, size_t first) const
+{
+    const int32_t* index = indices.data();
+    const int8_t* sign = signs.data();
+
+    for (size_t k = first; k < size(); k++)
+    {
+        result[k] = sign[k] * (index[k] == UNIT ? 1.0 : values[index[k]]);
+    }
+}
+
+} // namespace CS
@@ -6,38 +6,91 @@
 #include "circuit-solver/circuit_configuration/branches.h"
 #include "circuit-solver/circuit_configuration/inc_matrix.h"
 #include "circuit-solver/circuit_configuration/loops.h"
+#include "circuit-solver/equation_system/sparse_matrix.h"
+#include "circuit-solver/equation_system/assembly.h"
+#include "circuit-solver/equation_system/rank_one_update.h"
+#include "circuit-solver/structure_units/serialization.h"
 
 namespace CS
 {
 // класс для представления уравнений схемы по I и II законам Кирхгофа
+// обе части системы хранятся в разреженном виде (SparseMatrix): коэффициенты
+// задаются индексами значений в списке элементов и знаками, плотные матрицы
+// коэффициентов строятся только по запросу (exportLeft, exportRight)
+// объект не ссылается на список элементов: значения передаются при вычислении,
+// поэтому копия системы не зависит от схемы, по которой она построена
+// после частичного обновления контуров систему можно обновить частично (patch):
+// строятся только строки измененных узлов и контуров, остальные переносятся
 ////////////////////////////////////////////////////////////////////////////////////////// 
 class Equations
 {
 public:
     void update(const IncMatrix& matrix, const Loops& loops,
                 const Branches& branches, const Elements& elements);                    // метод обновления уравнений
-    const CoeffMatr& left() const;                                                      // константный геттер левой части системы уравнений
-    const CoeffMatr& right() const;                                                     // константный геттер правой части системы уравнений
-    friend std::ostream& operator<<(std::ostream& os, const Equations& equations);      // перегрузка оператора вывода в поток
+    void patch(const IncMatrix& matrix, const Loops& loops,
+               const Branches& branches, const Elements& elements);                     // метод частичного обновления после Loops::patch
+    const SizeVect& getChangedUnknowns() const;                                         // геттер номеров неизвестных, измененных последним patch
+    bool isPatternChanged() const;                                                      // геттер признака расширения структуры левой части последним patch
+    const SparseMatrix& left() const;                                                   // константный геттер левой части системы уравнений
+    const SparseMatrix& right() const;                                                  // константный геттер правой части системы уравнений
+    CoeffMatr exportLeft(const Elements& elements) const;                               // метод построения плотной левой части системы (для отладки)
+    CoeffMatr exportRight(const Elements& elements) const;                              // метод построения плотной правой части системы (для отладки)
+    void evaluate(const Elements& elements, DoubleVect& leftValues,
+                  DoubleVect& rightPart) const;                                         // метод вычисления коэффициентов левой части и правой части
+    void evaluateLeft(const Elements& elements, DoubleVect& leftValues) const;          // метод вычисления только коэффициентов левой части
+    void evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const;   // метод вычисления коэффициентов левой части (по массиву значений)
+    void evaluateRight(const DoubleVect& sourceValues, DoubleVect& rightPart) const;    // метод вычисления правой части по значениям источников
+    DoubleVect getSourceValues(const Elements& elements) const;                         // метод получения значений источников по столбцам правой части
+    DoubleVect getSourceValues(const DoubleVect& elementValues) const;                  // метод получения значений источников (по массиву значений)
+    DoubleVect getBranchCurrents(const DoubleVect& solution,
+                                 const DoubleVect& sourceValues) const;                 // метод получения токов всех ветвей по решению системы
+    void getCurrentGradient(size_t branch, DoubleVect& bySolution,
+                            DoubleVect& byElements) const;                              // метод вычисления производных тока ветви по решению и значениям
+    void addElementResidual(size_t element, const DoubleVect& solution,
+                            DoubleVect& residual) const;                                // метод добавления производной невязки по значению элемента
+    void addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& solution,
+                               DoubleVect& derivatives) const;                          // метод добавления производных по всем элементам для сопряженного решения
+    void getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                          double value, RankOneUpdate& update) const;                   // метод получения изменения системы при новом значении элемента
+    size_t size() const;                                                                // геттер количества уравнений
+    size_t getUnknownCurrentCount() const;                                              // геттер счетчика неизвестных токов
+    size_t getBranchCount() const;                                                      // геттер количества ветвей (длины вектора токов)
+    std::ostream& print(std::ostream& os, const Elements& elements) const;              // метод вывода системы в поток при значениях элементов
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
 
 private:
-    CoeffMatr leftPart;                                                                 // матрица коэффициентов левой части системы
-    CoeffMatr rightPart;                                                                // матрица коэффициентов правой части системы
+    SparseMatrix leftPart;                                                              // разреженная матрица коэффициентов левой части системы
+    SparseMatrix rightPart;                                                             // разреженная матрица коэффициентов правой части системы
+    Assembly leftAssembly;                                                              // плоские массивы для вычисления коэффициентов левой части
+    SizeVect sourceIndices;                                                             // номера столбцов правой части для источников (по номеру элемента)
+    SizeVect sourceElements;                                                            // номера элементов-источников (по номеру столбца правой части)
+    SizeVect currentSourceColumns;                                                      // номера столбцов источников тока ветвей с источниками тока
     size_t unknownCurrentCount = 0;                                                     // счетчик неизвестных токов
     size_t currentSourceCount = 0;                                                      // счетчие источников тока
     size_t voltageSourceCount = 0;                                                      // счетчик источников напряжения
     size_t knownSourceCount = 0;                                                        // счетчик источников энергии (тока и напряжения)
     size_t firstLawCount = 0;                                                           // счетчик уравнений, составленных по I закону Кирхгофа
     size_t secondLawCount = 0;                                                          // счетчик уравнений, составленных по II закону Кирхгофа
+    SizeVect changedUnknowns;                                                           // номера неизвестных, измененных последним patch (по возрастанию)
+    bool patternChanged = true;                                                         // признак расширения структуры левой части последним patch
 
-    void update1stLawEquations(const IncMatrix& matrix, const Elements& elements);      // метод обновления уравнений, составленных по I закону Кирхгофа
+    void update1stLawEquations(const IncMatrix& matrix, const Branches& branches,
+                               const Elements& elements);                               // метод обновления уравнений, составленных по I закону Кирхгофа
     void update2ndLawEquations(const Loops& loops, const Branches& branches,
                                const Elements& elements);                               // метод обновления уравнений, составленных по II закону Кирхгофа
-
-    size_t getCurrentSourceElemIndex(const size_t currentSourceIndex,                   // метод вычисления индекса источника тока в списке элементов
-                                     const Elements& elements) const;                   // по последовательному номеру этого источника
-    size_t getVoltageSourceIndex(const size_t elemIndex,                                // метод вычисления последовательного индекса источника напряжения
-                                 const Elements& elements) const;                       // по номеру этого источника в списке элементов
+    void add1stLawEquation(size_t node, const IncMatrix& matrix, const Branches& branches,
+                           const Elements& elements, SparseMatrix& left,
+                           SparseMatrix& right) const;                                  // метод добавления уравнения узла по I закону Кирхгофа
+    void add2ndLawEquation(const IntVect& loop, const Branches& branches,
+                           const Elements& elements, SparseMatrix& left,
+                           SparseMatrix& right) const;                                  // метод добавления уравнения контура по II закону Кирхгофа
+    void updateSourceIndices(const Elements& elements);                                 // метод нумерации источников в правой части системы
+    bool hasSameSources(const Elements& elements) const;                                // метод проверки, что источники и их нумерация не изменились
+    void updateCurrentSourceColumns(const Branches& branches,
+                                    const Elements& elements);                          // метод сопоставления ветвям с источниками тока их столбцов
+    size_t getCurrentSourceElemIndex(const SizeVect& branch,                            // метод поиска индекса источника тока ветви
+                                     const Elements& elements) const;                   // в списке элементов
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -55,79 +108,502 @@ inline void Equations::update(const IncMatrix& matrix, const Loops& loops,
 {
     unknownCurrentCount = matrix.getUnknownCurrentCount();
 
-    leftPart = CoeffMatr(unknownCurrentCount,                                           // создаем двумерную матрицу нулевых коэффициентов
-        CoeffVect(unknownCurrentCount, Coefficient(ZERO_PTR)));                         // размером unknownCurrentNumber х unknownCurrentNumber
-
     currentSourceCount = elements.getCurrentSourceCount();                              // получаем количество источников тока 
 
     voltageSourceCount = elements.getVoltageSourceCount();                              // получаем количество источников напряжения 
 
     knownSourceCount = currentSourceCount + voltageSourceCount;                         // считаем все источники
 
-    rightPart = CoeffMatr(matrix.getUnknownCurrentCount(),                              // создаем матрицу нулевых коэффициентов 
-        CoeffVect(knownSourceCount, Coefficient(ZERO_PTR)));                            // размера unknownCurrentCount x knownSourceCount
+    leftPart.clear(unknownCurrentCount);                                                // очищаем разреженные матрицы: в левой части столбцов столько же,
+    rightPart.clear(knownSourceCount);                                                  // сколько неизвестных токов, в правой - сколько источников
                                                                                         // записываем в переменные количество уравнений по I и II з. Кирхгофа:
-    firstLawCount = matrix.size() ? matrix[0].size() - 1 : 0;                           // I закон Кирхгофа - на единицу меньше количества узлов
+    firstLawCount = matrix.size() && matrix.getNodeCount() ?                            // I закон Кирхгофа - на единицу меньше количества узлов
+                    matrix.getNodeCount() - 1 : 0;                                      //
     secondLawCount = loops.size();                                                      // II закон Кирхгофа - по количеству контуров
 
-    update1stLawEquations(matrix, elements);                                            // обновляем коэффициенты уравнений по I з. Кирхгофа
-    update2ndLawEquations(loops, branches, elements);                                   // обновляем коэффициенты уравнений по II з. Кирхгофа
+    updateSourceIndices(elements);                                                      // нумеруем источники в правой части системы
+    updateCurrentSourceColumns(branches, elements);                                     // находим столбцы источников тока ветвей
+    update1stLawEquations(matrix, branches, elements);                                  // строим строки уравнений по I з. Кирхгофа
+    update2ndLawEquations(loops, branches, elements);                                   // строим строки уравнений по II з. Кирхгофа
+    leftAssembly.update(leftPart);                                                      // готовим вычисление коэффициентов левой части
+    changedUnknowns.clear();
+    patternChanged = true;
+}
+
+// метод частичного обновления уравнений после частичного обновления матрицы
+// инцидентности и контуров: заново строятся строки узлов, столбцы которых изменила
+// IncMatrix::patch, и контуров, измененных Loops::patch; остальные строки переносятся
+// (если количество уравнений по I закону изменилось, строки контуров сдвигаются)
+// если набор источников изменился (их столбцы в правой части перенумерованы),
+// система строится заново (update), но признак расширения структуры левой части
+// вычисляется так же - сравнением с прежней
+// принимает на вход:
+// 1) матрицу инцидентности после patch
+// 2) список контуров после patch
+// 3) список ветвей после patch
+// 4) список элементов схемы
+inline void Equations::patch(const IncMatrix& matrix, const Loops& loops,
+                             const Branches& branches, const Elements& elements)
+{
+    size_t oldUnknownCount = unknownCurrentCount;
+    size_t oldFirstLawCount = firstLawCount;
+    size_t oldSecondLawCount = secondLawCount;
+
+    changedUnknowns.clear();                                                            // токи измененных ветвей
+
+    for (size_t branch : branches.getChangedBranches())
+    {
+        if (branch < matrix.getUnknownCurrentCount())
+        {
+            changedUnknowns.push_back(branch);
+        }
+    }
+
+    if (!hasSameSources(elements))                                                      // столбцы правой части перенумерованы - строим заново
+    {
+        SparseMatrix previous = std::move(leftPart);
+        SizeVect changed = std::move(changedUnknowns);
+
+        update(matrix, loops, branches, elements);
+        SizeVect rowSources(leftPart.rows(), SparseMatrix::NONE);
+        patternChanged = previous.patch(leftPart.columns(), rowSources, leftPart);      // сравниваем с прежней структурой
+        changedUnknowns = std::move(changed);
+        return;
+    }
+
+    unknownCurrentCount = matrix.getUnknownCurrentCount();
+    firstLawCount = matrix.size() && matrix.getNodeCount() ? matrix.getNodeCount() - 1 : 0;
+    secondLawCount = loops.size();
+    sourceIndices.resize(elements.size(), 0);                                           // новые элементы - не источники
+
+    if (unknownCurrentCount != oldUnknownCount)                                         // ветви с источниками тока сдвинулись
+    {
+        updateCurrentSourceColumns(branches, elements);
+    }
+    else
+    {
+        currentSourceColumns.resize(branches.size() - unknownCurrentCount);
+
+        for (size_t branch : branches.getChangedBranches())
+        {
+            if (branch >= unknownCurrentCount && branch < branches.size())
+            {
+                currentSourceColumns[branch - unknownCurrentCount] =
+                    sourceIndices[getCurrentSourceElemIndex(branches[branch], elements)];
+            }
+        }
+    }
+
+    SizeVect rowSources(size(), SparseMatrix::NONE);                                    // прежняя строка для каждой новой (NONE - строится заново)
+    SparseMatrix left;                                                                  // новые строки по порядку
+    SparseMatrix right;                                                                 //
+    const SizeVect& changedNodes = matrix.getChangedNodes();
+    const SizeVect& changedLoops = loops.getChangedLoops();
+
+    for (size_t i = 0; i < firstLawCount && i < oldFirstLawCount; i++)                  // строки узлов сохраняются, кроме измененных
+    {
+        rowSources[i] = i;
+    }
+
+    for (size_t node : changedNodes)
+    {
+        if (node < firstLawCount)
+        {
+            rowSources[node] = SparseMatrix::NONE;
+        }
+    }
+
+    for (size_t i = 0; i < secondLawCount && i < oldSecondLawCount; i++)                // строки контуров - тоже
+    {
+        rowSources[firstLawCount + i] = oldFirstLawCount + i;
+    }
+
+    for (size_t loop : changedLoops)
+    {
+        if (loop < secondLawCount)
+        {
+            rowSources[firstLawCount + loop] = SparseMatrix::NONE;
+        }
+    }
+
+    left.clear(unknownCurrentCount);
+    right.clear(knownSourceCount);
+
+    for (size_t i = 0; i < size(); i++)                                                 // строим новые строки по порядку
+    {
+        if (rowSources[i] != SparseMatrix::NONE)
+        {
+            continue;
+        }
+
+        if (i < firstLawCount)
+        {
+            add1stLawEquation(i, matrix, branches, elements, left, right);
+        }
+        else
+        {
+            add2ndLawEquation(loops[i - firstLawCount], branches, elements, left, right);
+        }
+    }
+
+    patternChanged = leftPart.patch(unknownCurrentCount, rowSources, left);
+    rightPart.patch(knownSourceCount, rowSources, right);
+    leftAssembly.update(leftPart);
+}
+
+// геттер номеров неизвестных (токов ветвей), смысл которых изменил последний patch:
+// ветвь на этом месте трассирована заново или перемещена (после update - пустой)
+inline const SizeVect& Equations::getChangedUnknowns() const
+{
+    return changedUnknowns;
+}
+
+// геттер признака расширения структуры левой части последним patch (см.
+// SparseMatrix::patch); при false символьный анализ разложения можно сохранить
+// (после update - true)
+inline bool Equations::isPatternChanged() const
+{
+    return patternChanged;
 }
 
 // константный геттер левой части системы уравнений
-inline const CoeffMatr& Equations::left() const
+inline const SparseMatrix& Equations::left() const
 {
     return leftPart;
 }
 
 // константный геттер правой части системы уравнений
-inline const CoeffMatr& Equations::right() const
+inline const SparseMatrix& Equations::right() const
 {
     return rightPart;
 }
 
-// перегрузка оператора вывода в поток
-inline std::ostream& operator<<(std::ostream& os, const Equations& equations)
+// метод построения плотной левой части системы уравнений (отладочное представление)
+// принимает на вход: список элементов, по которому построена система
+inline CoeffMatr Equations::exportLeft(const Elements& elements) const
+{
+    return leftPart.toDense(elements);
+}
+
+// метод построения плотной правой части системы уравнений (отладочное представление)
+// принимает на вход: список элементов, по которому построена система
+inline CoeffMatr Equations::exportRight(const Elements& elements) const
+{
+    return rightPart.toDense(elements);
+}
+
+// метод вычисления численных значений системы при текущих значениях элементов
+// принимает на вход:
+// 1) список элементов схемы
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+// 3) вектор для правой части системы (суммы известных источников по уравнениям)
+inline void Equations::evaluate(const Elements& elements, DoubleVect& leftValues,
+                                DoubleVect& rightPart) const
+{
+    evaluateLeft(elements, leftValues);                                                 // коэффициенты левой части
+    evaluateRight(getSourceValues(elements), rightPart);                                // правая часть
+}
+
+// метод вычисления коэффициентов левой части при текущих значениях элементов
+// принимает на вход:
+// 1) список элементов схемы
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+inline void Equations::evaluateLeft(const Elements& elements, DoubleVect& leftValues) const
+{
+    evaluateLeft(elements.getValues(), leftValues);
+}
+
+// метод вычисления коэффициентов левой части по массиву значений элементов (перегрузка)
+// принимает на вход:
+// 1) значения элементов схемы подряд (см. Elements::getValues)
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+inline void Equations::evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const
+{
+    leftAssembly.evaluate(elementValues, leftValues);
+}
+
+// метод вычисления правой части системы по значениям источников (коэффициенты
+// правой части - знаки, поэтому она линейно зависит от значений источников, а
+// коэффициенты левой части от них не зависят)
+// принимает на вход:
+// 1) значения источников по столбцам правой части (см. getSourceValues)
+// 2) вектор для правой части системы (суммы известных источников по уравнениям)
+inline void Equations::evaluateRight(const DoubleVect& sourceValues, DoubleVect& rightPart) const
+{
+    rightPart.assign(this->rightPart.rows(), 0.0);
+
+    const SizeVect& offsets = this->rightPart.getRowOffsets();
+    const SizeVect& columns = this->rightPart.getColumns();
+    const IntVect& signs = this->rightPart.getSigns();
+
+    for (size_t i = 0; i < this->rightPart.rows(); i++)                                 // суммируем известные источники в правую часть
+    {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            rightPart[i] += signs[k] * sourceValues[columns[k]];
+        }
+    }
+}
+
+// метод получения значений источников схемы по столбцам правой части
+// (сначала источники тока, затем источники напряжения - в порядке списка элементов)
+// принимает на вход: список элементов схемы
+inline DoubleVect Equations::getSourceValues(const Elements& elements) const
+{
+    return getSourceValues(elements.getValues());
+}
+
+// метод получения значений источников по столбцам правой части (перегрузка)
+// принимает на вход: значения элементов схемы подряд (см. Elements::getValues)
+inline DoubleVect Equations::getSourceValues(const DoubleVect& elementValues) const
+{
+    DoubleVect sourceValues(sourceElements.size());
+
+    for (size_t j = 0; j < sourceElements.size(); j++)
+    {
+        sourceValues[j] = elementValues[sourceElements[j]];
+    }
+
+    return sourceValues;
+}
+
+// метод получения токов всех ветвей в порядке списка ветвей: сначала найденные
+// неизвестные токи, затем токи ветвей с источниками тока (равны значениям источников,
+// так как ветви ориентированы по их полярности)
+// принимает на вход:
+// 1) решение системы (неизвестные токи)
+// 2) значения источников по столбцам правой части (см. getSourceValues)
+inline DoubleVect Equations::getBranchCurrents(const DoubleVect& solution,
+                                               const DoubleVect& sourceValues) const
+{
+    DoubleVect currents(solution.begin(), solution.end());                              // сначала найденные неизвестные токи
+
+    for (size_t column : currentSourceColumns)                                          // токи ветвей с источниками тока известны заранее
+    {
+        currents.push_back(sourceValues[column]);
+    }
+
+    return currents;
+}
+
+// метод вычисления производных тока ветви (см. getBranchCurrents) по решению системы
+// и по значениям элементов при неизменном решении; ток найденной ветви - само решение,
+// ток ветви с источником тока - значение источника
+// принимает на вход:
+// 1) номер ветви
+// 2) вектор для производных по решению (размер приводится к количеству неизвестных)
+// 3) вектор для производных по значениям элементов (размер - количество элементов)
+inline void Equations::getCurrentGradient(size_t branch, DoubleVect& bySolution,
+                                          DoubleVect& byElements) const
+{
+    bySolution.assign(unknownCurrentCount, 0.0);
+    byElements.assign(byElements.size(), 0.0);
+
+    if (branch < unknownCurrentCount)
+    {
+        bySolution[branch] = 1.0;
+    }
+    else
+    {
+        byElements[sourceElements[currentSourceColumns[branch - unknownCurrentCount]]] = 1.0;
+    }
+}
+
+// метод добавления производной невязки системы по значению элемента:
+// d(right - left * x) / dp при неизменном решении x (коэффициент левой части равен
+// знаку, умноженному на сопротивление, правая часть - сумма источников со знаками)
+// принимает на вход:
+// 1) номер элемента
+// 2) решение системы
+// 3) вектор, к которому добавляется производная (по строкам системы)
+inline void Equations::addElementResidual(size_t element, const DoubleVect& solution,
+                                          DoubleVect& residual) const
+{
+    const SizeVect& leftOffsets = leftPart.getRowOffsets();
+    const SizeVect& leftColumns = leftPart.getColumns();
+    const SizeVect& leftIndices = leftPart.getValueIndices();
+    const IntVect& leftSigns = leftPart.getSigns();
+    const SizeVect& rightOffsets = rightPart.getRowOffsets();
+    const SizeVect& rightColumns = rightPart.getColumns();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        for (size_t k = leftOffsets[i]; k < leftOffsets[i + 1]; k++)                    // коэффициенты с этим сопротивлением
+        {
+            if (leftIndices[k] == element)
+            {
+                residual[i] -= leftSigns[k] * solution[leftColumns[k]];
+            }
+        }
+
+        for (size_t k = rightOffsets[i]; k < rightOffsets[i + 1]; k++)                  // вхождения этого источника
+        {
+            if (sourceElements[rightColumns[k]] == element)
+            {
+                residual[i] += rightSigns[k];
+            }
+        }
+    }
+}
+
+// метод добавления производных по значениям всех элементов для сопряженного решения:
+// для каждого элемента p к derivatives[p] добавляется adjoint^T * d(right - left * x) / dp
+// (за один проход по коэффициентам системы)
+// принимает на вход:
+// 1) решение сопряженной системы left^T * adjoint = c
+// 2) решение системы
+// 3) вектор производных по элементам (размер - количество элементов)
+inline void Equations::addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& solution,
+                                             DoubleVect& derivatives) const
+{
+    const SizeVect& leftOffsets = leftPart.getRowOffsets();
+    const SizeVect& leftColumns = leftPart.getColumns();
+    const SizeVect& leftIndices = leftPart.getValueIndices();
+    const IntVect& leftSigns = leftPart.getSigns();
+    const SizeVect& rightOffsets = rightPart.getRowOffsets();
+    const SizeVect& rightColumns = rightPart.getColumns();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (adjoint[i] == 0.0)
+        {
+            continue;
+        }
+
+        for (size_t k = leftOffsets[i]; k < leftOffsets[i + 1]; k++)
+        {
+            if (leftIndices[k] != SparseMatrix::UNIT)
+            {
+                derivatives[leftIndices[k]] -= adjoint[i] * leftSigns[k] * solution[leftColumns[k]];
+            }
+        }
+
+        for (size_t k = rightOffsets[i]; k < rightOffsets[i + 1]; k++)
+        {
+            derivatives[sourceElements[rightColumns[k]]] += adjoint[i] * rightSigns[k];
+        }
+    }
+}
+
+// метод получения изменения системы при новом значении элемента: сопротивление
+// входит только в столбец тока своей ветви (со знаками контуров), поэтому изменение
+// левой части - (R' - R) * column * e_branch^T; источник меняет только правую часть
+// принимает на вход:
+// 1) номер элемента
+// 2) текущие значения элементов
+// 3) новое значение элемента (бесконечное сопротивление - обрыв ветви)
+// 4) структура для изменения системы (см. RankOneUpdate)
+inline void Equations::getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                                        double value, RankOneUpdate& update) const
+{
+    update = RankOneUpdate();
+    double change = value - elementValues[element];
+
+    const SizeVect& leftOffsets = leftPart.getRowOffsets();
+    const SizeVect& leftColumns = leftPart.getColumns();
+    const SizeVect& leftIndices = leftPart.getValueIndices();
+    const IntVect& leftSigns = leftPart.getSigns();
+    const SizeVect& rightOffsets = rightPart.getRowOffsets();
+    const SizeVect& rightColumns = rightPart.getColumns();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        for (size_t k = leftOffsets[i]; k < leftOffsets[i + 1]; k++)                    // сопротивление в уравнениях по II закону Кирхгофа
+        {
+            if (leftIndices[k] == element)
+            {
+                update.column.resize(size(), 0.0);
+                update.column[i] += leftSigns[k];
+                update.rows.assign(1, leftColumns[k]);                                  // все вхождения - в столбце тока ветви элемента
+            }
+        }
+
+        for (size_t k = rightOffsets[i]; k < rightOffsets[i + 1]; k++)                  // вхождения источника
+        {
+            if (sourceElements[rightColumns[k]] == element)
+            {
+                update.rightChange.resize(size(), 0.0);
+                update.rightChange[i] += rightSigns[k] * change;
+            }
+        }
+    }
+
+    if (!update.column.empty())
+    {
+        update.scale = change;
+        update.weights.assign(1, 1.0);
+    }
+}
+
+// геттер количества уравнений (по I и II законам Кирхгофа)
+inline size_t Equations::size() const
+{
+    return firstLawCount + secondLawCount;
+}
+
+// геттер счетчика неизвестных токов
+inline size_t Equations::getUnknownCurrentCount() const
+{
+    return unknownCurrentCount;
+}
+
+// геттер количества ветвей (длины вектора токов, см. getBranchCurrents)
+inline size_t Equations::getBranchCount() const
+{
+    return unknownCurrentCount + currentSourceColumns.size();
+}
+
+// метод вывода системы в поток при текущих значениях элементов
+// принимает на вход:
+// 1) поток вывода
+// 2) список элементов, по которому построена система
+inline std::ostream& Equations::print(std::ostream& os, const Elements& elements) const
 {
     auto precision = os.precision();
     using namespace std;
 
     os << "Система уравнений:\n\n" << setw(9) << ' ';
 
-    os << left << fixed << setprecision(precision);
+    os << std::left << fixed << setprecision(precision);
 
-    for (size_t i = 0; i < equations.unknownCurrentCount; i++)
+    for (size_t i = 0; i < unknownCurrentCount; i++)
     {
         os << "I" << setw(precision + 9) << i << ' ';
     }
     os << setw(precision + 10) << ' ';
 
-    for (size_t i = 0; i < equations.currentSourceCount; i++)
+    for (size_t i = 0; i < currentSourceCount; i++)
     {
         os << "J" << setw(precision + 9) << i << ' ';
     }
 
-    for (size_t i = 0; i < equations.voltageSourceCount; i++)
+    for (size_t i = 0; i < voltageSourceCount; i++)
     {
         os << "E" << setw(precision + 9) << i << ' ';
     }
 
     os << "\n\n";
 
-    for (size_t i = 0; i < equations.unknownCurrentCount; i++)
+    CoeffMatr denseLeft = exportLeft(elements);
+    CoeffMatr denseRight = exportRight(elements);
+
+    for (size_t i = 0; i < denseLeft.size(); i++)
     {
         os << setw(4) << i << ":    ";
 
-        for (size_t j = 0; j < equations.unknownCurrentCount; j++)
+        for (size_t j = 0; j < denseLeft[i].size(); j++)
         {
-            os << setw(precision + 10) << equations.leftPart[i][j]() << ' ';
+            os << setw(precision + 10) << denseLeft[i][j]() << ' ';
         }
 
         os << setw(precision + 10) << ' ';
 
-        for (size_t j = 0; j < equations.knownSourceCount; j++)
+        for (size_t j = 0; j < denseRight[i].size(); j++)
         {
-            os << setw(precision + 10) << equations.leftPart[i][j]() << ' ';
+            os << setw(precision + 10) << denseRight[i][j]() << ' ';
         }
 
         os << "\n\n";
@@ -136,133 +612,237 @@ inline std::ostream& operator<<(std::ostream& os, const Equations& equations)
     return os;
 }
 
-// метод обновления уравнений, составленных по I закону Кирхгофа
+// метод обновления уравнений, составленных по I закону Кирхгофа:
+// строки добавляются в разреженные матрицы сразу, нулевые коэффициенты не хранятся
 inline void Equations::update1stLawEquations(const IncMatrix& matrix,
+                                             const Branches& branches,
                                              const Elements& elements)
 {
-    for (size_t i = 0; i < matrix[0].size() - 1; i++)                                   // перебираем столбцы матрицы инцидентности. сколько столбцов - столько узлов -
+    for (size_t i = 0; i < firstLawCount; i++)                                          // перебираем столбцы матрицы инцидентности. сколько столбцов - столько узлов -
     {                                                                                   // столько уравнений (за исключением одного линейно зависимого столбца)
-        for (size_t j = 0; j < unknownCurrentCount; j++)                                // перебираем строки, соответствующие неизвестным токам (здесь нет значений,
-        {                                                                               // связанных с параметрами элементов - только +-1 или 0 - зависит от геометрии схемы)
-            switch (matrix[j][i])                                                       // смотрим, как соотносится j-ый ток и i-ый узел 
-            {
-            case -1:                                                                    // если ток вытекает из узла
-                leftPart[i][j] = ONE_PTR;                                               // присваиваем указатель на единицу
-                leftPart[i][j].setSign(-1);                                             // знак отрицательный
-                break;                                                                  // выходим из switch
+        add1stLawEquation(i, matrix, branches, elements, leftPart, rightPart);
+    }
+}
 
-            case 1:                                                                     // если ток втекает в узел
-                leftPart[i][j] = ONE_PTR;                                               // присваиваем указатель на единицу (знак по умолчанию положительный)
-                break;                                                                  // выходим из switch
+// метод обновления уравнений, составленных по II закону Кирхгофа
+inline void Equations::update2ndLawEquations(const Loops& loops,
+                                             const Branches& branches,
+                                             const Elements& elements)
+{
+    for (size_t i = 0; i < loops.size(); i++)                                           // перебор по контурам схемы
+    {
+        add2ndLawEquation(loops[i], branches, elements, leftPart, rightPart);
+    }
+}
 
-            default:                                                                    // если j-ый ток не связан с i-ым узлом (j-ая ветвь не инцидентна i-ому узлу)
-                leftPart[i][j] = ZERO_PTR;                                              // присваиваем указатель на ноль
-            }
+// метод добавления уравнения узла по I закону Кирхгофа (строки в обеих частях):
+// перебираются только ветви, инцидентные узлу
+// принимает на вход:
+// 1) номер узла
+// 2) матрицу инцидентности
+// 3) список ветвей
+// 4) список элементов схемы
+// 5) левую и правую части, в которые добавляются строки
+inline void Equations::add1stLawEquation(size_t node, const IncMatrix& matrix,
+                                         const Branches& branches, const Elements& elements,
+                                         SparseMatrix& left, SparseMatrix& right) const
+{
+    for (size_t j : matrix.getNodeBranches(node))                                       // перебираем ветви, инцидентные узлу (по возрастанию номеров)
+    {
+        if (matrix.getFrom(j) == matrix.getTo(j))                                       // ток ветви, замкнутой на один узел, вытекает из узла и сразу
+        {                                                                               // втекает обратно - в уравнение узла он не входит
+            continue;
+        }
+
+        if (j < unknownCurrentCount)                                                    // ветви с неизвестными токами (здесь нет значений, связанных с параметрами
+        {                                                                               // элементов - только +-1 - зависит от геометрии схемы)
+            left.add(j, matrix(j, node), SparseMatrix::UNIT);                           // добавляем единичный коэффициент с соответствующим знаком
+        }                                                                               // (j-ый ток втекает в узел (1) или вытекает из него (-1))
+        else                                                                            // ветви с источниками тока
+        {
+            size_t index = getCurrentSourceElemIndex(branches[j], elements);            // находим индекс источника тока ветви в списке элементов схемы
+            int sign = -matrix(j, node);                                                // определяем знак тока от источника тока в узле (инверсия, так как
+                                                                                        // это правая часть системы уравнений)
+            right.add(sourceIndices[index], sign, index);                               // добавляем коэффициент в столбец этого источника
         }
+    }
+
+    left.finishRow();                                                                   // завершаем строки уравнения
+    right.finishRow();                                                                  //
+}
 
-        for (size_t j = 0; j < currentSourceCount; j++)                                 // перебираем строки, соответствующие ветвям с источниками тока
+// метод добавления уравнения контура по II закону Кирхгофа (строки в обеих частях)
+// если в ветви несколько сопротивлений, для каждого добавляется свой коэффициент
+// в один и тот же столбец - при вычислении значений они суммируются
+// принимает на вход:
+// 1) контур (последовательность номеров ветвей со знаками, см. Loops)
+// 2) список ветвей
+// 3) список элементов схемы
+// 4) левую и правую части, в которые добавляются строки
+inline void Equations::add2ndLawEquation(const IntVect& loop, const Branches& branches,
+                                         const Elements& elements, SparseMatrix& left,
+                                         SparseMatrix& right) const
+{
+    for (size_t j = 0; j < loop.size(); j++)                                            // перебор по ветвям контура
+    {
+        size_t branch = abs(loop[j]) - (int)1;                                          // приводим номер ветви к исходному виду (без знака и инкремента)
+        int branchSign = loop[j] > 0 ? 1 : -1;                                          // определяем знак тока в ветви branch
+
+        for (size_t k = 0; k < branches[branch].size(); k += 2)                         // перебираем ветвь по элементам схемы
         {
-            if (matrix[j + unknownCurrentCount][i])                                     // если j-ая ветвь с источником тока связана с i-ым узлом 
+            size_t elemIndex = branches[branch][k] / 2;                                 // вычисляем индекс элемента по номеру пина k в ветви branch
+
+            if (elements[elemIndex].getType() == Element::Type::R)                      // если элемент является сопротивлением
             {
-                size_t index = getCurrentSourceElemIndex(j, elements);                  // вычисляем индекс j-го источника тока в списке элементов схемы
-                const double* pointer = elements[index].getValuePointer();              // по индексу в списке элементов получаем адрес значения тока источника тока
-                int sign = -matrix[j + unknownCurrentCount][i];                         // определяем знак тока от j-го источника тока в i-ом узле (инверсия, так как 
-                                                                                        // knownSourceMatrix - правая часть системы уравнений)
-                rightPart[i][j] = pointer;                                              // присваиваем полученный адрес на значение
-                rightPart[i][j].setSign(sign);                                          // присваиваем знак
+                left.add(branch, branchSign, elemIndex);                                // добавляем коэффициент, соответствующий уравнению
+                                                                                        // по второму закону Кирхгофа и току branch, с соответствующим знаком тока
             }
-            else                                                                        // если j-ая ветвь с источником тока не связана с i-ым узлом 
+            else                                                                        // иначе - источник напряжения
             {
-                rightPart[i][j] = ZERO_PTR;                                             // присваиваем указатель на ноль
-            }
-        }
+                bool pinIsOdd = branches[branch][k] % 2;                                // определяем, является ли пин k ветви branch нечетным (плюсом источника)
+                int valueSign = 1;                                                      // переменная для знака вхождения напряжения в уравнение
 
-        for (size_t j = 0; j < voltageSourceCount; j++)                                 // присваиваем указатели на нулевые значения в оставшиеся позиции, соответствующие
-        {                                                                               // источникам напряжения, т.к. они не участвуют в формировании уравнений по первому
-            rightPart[i][j + currentSourceCount] = ZERO_PTR;                            // закону Кирхгофа
+                if (pinIsOdd)                                                           // если рассматриваемый пин нечетный (по допущению, четному (меньшему) id пина
+                {                                                                       // соответсвует отрицательный полюс источника, нечетному - положительный)
+                    valueSign = -1;                                                     // пины ветви branch рассматриваются через один, то есть если рассматриваемый
+                }                                                                       // пин нечетный - идем против направления ветви - знак напряжения отрицательный
+
+                right.add(sourceIndices[elemIndex],                                     // добавляем коэффициент в столбец источника напряжения
+                          branchSign * valueSign, elemIndex);                           // c учетом направления ветви в контуре и ориентации источника
+            }
         }
     }
+
+    left.finishRow();                                                                   // завершаем строки уравнения по II з. Кирхгофа
+    right.finishRow();                                                                  //
 }
 
-// метод обновления уравнений, составленных по II закону Кирхгофа
-inline void Equations::update2ndLawEquations(const Loops& loops,
-                                             const Branches& branches,
-                                             const Elements& elements)
+// метод нумерации источников в правой части системы уравнений:
+// сначала по порядку следования в списке элементов идут источники тока,
+// затем - источники напряжения; для сопротивлений номер не используется
+inline void Equations::updateSourceIndices(const Elements& elements)
 {
-    for (size_t i = 0; i < loops.size(); i++)                                           // перебор по контурам схемы
+    sourceIndices = SizeVect(elements.size(), 0);                                       // номера столбцов по индексам элементов
+    sourceElements = SizeVect(knownSourceCount, 0);                                     // и обратное соответствие
+    size_t currentSourceIndex = 0;                                                      // счетчики пронумерованных источников тока
+    size_t voltageSourceIndex = currentSourceCount;                                     // и напряжения (их столбцы идут после источников тока)
+
+    for (size_t i = 0; i < elements.size(); i++)                                        // перебираем элементы схемы за один проход
     {
-        for (size_t j = 0; j < loops[i].size(); j++)                                    // перебор по ветвям контура
+        switch (elements[i].getType())
         {
-            size_t branch = abs(loops[i][j]) - (int)1;                                  // приводим номер ветви к исходному виду (без знака и инкремента)
-            int branchSign = loops[i][j] > 0 ? 1 : -1;                                  // определяем знак тока в ветви branch 
-
-            for (size_t k = 0; k < branches[branch].size(); k += 2)                     // перебираем ветвь по элементам схемы
-            {
-                size_t elemIndex = branches[branch][k] / 2;                             // вычисляем индекс элемента по номеру пина k в ветви branch
-                const double* pointer = elements[elemIndex].getValuePointer();          // получаем адрес значения элемента
-
-                if (elements[elemIndex].getType() == Element::Type::R)                  // если элемент является сопротивлением
-                {
-                    leftPart[firstLawCount + i][branch] = pointer;                      // инициализируем коэффициент, соответствующий i-му уравнению 
-                                                                                        // по второму закону Кирхгофа и току branch, адресом pointer 
-                    leftPart[firstLawCount + i][branch].setSign(branchSign);            // задаем соответствующий знак тока
-                }
-                else                                                                    // иначе - источник напряжения
-                {
-                    size_t voltageSourceIndex =                                         // вычисляем порядковый номер источника напряжения в системе уравнений
-                        getVoltageSourceIndex(elemIndex, elements);                     // по порядковому номеру элемента в векторе элементов
-
-                    bool pinIsOdd = branches[branch][k] % 2;                            // определяем, является ли пин k ветви branch нечетным (плюсом источника)
-                    int valueSign = 1;                                                  // переменная для знака вхождения напряжения в уравнение
-
-                    if (pinIsOdd)                                                       // если рассматриваемый пин нечетный (по допущению, четному (меньшему) id пина 
-                    {                                                                   // соответсвует отрицательный полюс источника, нечетному - положительный)
-                        valueSign = -1;                                                 // пины ветви branch рассматриваются через один, то есть если рассматриваемый 
-                    }                                                                   // пин нечетный - идем против направления ветви - знак напряжения отрицательный
-
-                    size_t index = currentSourceCount + voltageSourceIndex;             // вычисляем порядковый номер коэффициента источника напряжения в уравнении
-                    rightPart[firstLawCount + i][index] = pointer;                      // инициализируем коэффициент, соответствующий i-му уравнению
-                                                                                        // по второму закону Кирхгофа и напряжению index, адресом pointer
-                    rightPart[firstLawCount + i][index].setSign(branchSign*valueSign);  // задаем соответствующий знак c учетом направления ветви в контуре и 
-                }                                                                       // ориентации источника напряжения
-            }
+        case Element::Type::J:
+            sourceElements[currentSourceIndex] = i;
+            sourceIndices[i] = currentSourceIndex++;
+            break;
+        case Element::Type::E:
+            sourceElements[voltageSourceIndex] = i;
+            sourceIndices[i] = voltageSourceIndex++;
+            break;
+        case Element::Type::R:
+            break;
         }
     }
 }
 
-// метод вычисления индекса источника тока в списке элементов
-// по последовательному номеру этого источника
-inline size_t Equations::getVoltageSourceIndex(const size_t elemIndex,
-                                               const Elements& elements) const
+// метод проверки, что набор источников не изменился с последнего построения системы:
+// количества совпадают, а каждый элемент, которому сопоставлен столбец правой части,
+// остался источником того же рода (удаленный элемент источником не является) - тогда
+// и нумерация источников по порядку элементов прежняя
+// время - по количеству источников
+// принимает на вход: список элементов схемы
+inline bool Equations::hasSameSources(const Elements& elements) const
 {
-    size_t counter = 0;                                                                 // переменная для подсчета источников напряжения
+    if (elements.getCurrentSourceCount() != currentSourceCount ||
+        elements.getVoltageSourceCount() != voltageSourceCount)
+    {
+        return false;
+    }
 
-    for (size_t i = 0; i < elemIndex; i++)                                              // перебор элементов схемы до элемента с номером elemIndex 
+    for (size_t j = 0; j < sourceElements.size(); j++)
     {
-        if (elements[i].getType() == Element::Type::E)                                  // если нашли источник напряжения
+        Element::Type type = j < currentSourceCount ? Element::Type::J : Element::Type::E;
+
+        if (sourceElements[j] >= elements.size() || elements[sourceElements[j]].getType() != type)
         {
-            counter++;                                                                  // инкрементируем счетчик
+            return false;
         }
     }
-    return counter;                                                                     // возвращаем значение счетчика
+
+    return true;
 }
 
-inline size_t Equations::getCurrentSourceElemIndex(const size_t currentSourceIndex,
-                                                   const Elements& elements) const
+// метод сопоставления ветвям с источниками тока (они идут в конце списка ветвей)
+// номеров столбцов их источников в правой части системы
+// принимает на вход:
+// 1) список ветвей
+// 2) список элементов схемы для определения типа элемента
+inline void Equations::updateCurrentSourceColumns(const Branches& branches,
+                                                  const Elements& elements)
 {
-    size_t counter = 0;                                                                 // переменная для подсчета источников тока
+    currentSourceColumns.clear();
 
-    for (size_t i = 0; i < elements.size(); i++)                                        // перебираем элементы схемы
+    for (size_t i = unknownCurrentCount; i < branches.size(); i++)
     {
-        if (elements[i].getType() == Element::Type::J)                                  // если элемент является источником тока
+        currentSourceColumns.push_back(sourceIndices[getCurrentSourceElemIndex(branches[i], elements)]);
+    }
+}
+
+// метод поиска индекса источника тока ветви в списке элементов
+// принимает на вход:
+// 1) ветвь (последовательность номеров пинов)
+// 2) список элементов схемы для определения типа элемента
+inline size_t Equations::getCurrentSourceElemIndex(const SizeVect& branch,
+                                                   const Elements& elements) const
+{
+    for (size_t i = 0; i < branch.size(); i += 2)                                       // перебираем элементы ветви
+    {
+        if (elements[branch[i] / 2].getType() == Element::Type::J)                      // если элемент является источником тока
         {
-            if (++counter == currentSourceIndex + 1)                                    // инкрементируем счетчик источников и сравниваем с искомым значением
-            {
-                return i;                                                               // если равны, возвращаем номер элемента
-            }
+            return branch[i] / 2;                                                       // возвращаем его номер
         }
     }
-    return elements.size();                                                             // если совпадений не нашлось, возвращаем размер вектора элементов
+    return elements.size();                                                             // если источника в ветви нет, возвращаем размер вектора элементов
+}
+
+// метод записи структуры системы уравнений в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void Equations::save(BinaryWriter& writer) const
+{
+    leftPart.save(writer);
+    rightPart.save(writer);
+    writer.write(unknownCurrentCount);
+    writer.write(currentSourceCount);
+    writer.write(voltageSourceCount);
+    writer.write(knownSourceCount);
+    writer.write(firstLawCount);
+    writer.write(secondLawCount);
+    writer.write(sourceIndices);
+    writer.write(sourceElements);
+    writer.write(currentSourceColumns);
+}
+
+// метод чтения структуры системы уравнений из двоичного
+// буфера, записанного методом save (плоские массивы сборки строятся по прочитанной
+// левой части)
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void Equations::load(BinaryReader& reader)
+{
+    leftPart.load(reader);
+    rightPart.load(reader);
+    reader.read(unknownCurrentCount);
+    reader.read(currentSourceCount);
+    reader.read(voltageSourceCount);
+    reader.read(knownSourceCount);
+    reader.read(firstLawCount);
+    reader.read(secondLawCount);
+    reader.read(sourceIndices);
+    reader.read(sourceElements);
+    reader.read(currentSourceColumns);
+    leftAssembly.update(leftPart);
+    changedUnknowns.clear();
+    patternChanged = true;
 }
 
 } // namespace CS
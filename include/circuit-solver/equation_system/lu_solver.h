@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+#include "circuit-solver/common.h"
+
+namespace CS
+{
+// класс для решения плотной системы линейных уравнений методом LU-разложения
+// с частичным выбором ведущего элемента по столбцу
+// матрица хранится построчно в непрерывном массиве, разложение выполняется блоками
+// (панель столбцов, затем обновление оставшейся подматрицы), чтобы данные
+// переиспользовались в кэше; после разложения объект можно использовать
+// для решения системы с любым количеством правых частей
+//////////////////////////////////////////////////////////////////////////////////////////
+class LUSolver
+{
+public:
+    void factorize(DoubleVect matrix, size_t size);                                     // метод LU-разложения матрицы size x size (построчное хранение)
+    void solve(DoubleVect& rightPart) const;                                            // метод решения системы (правая часть заменяется решением)
+    size_t size() const;                                                                // геттер размера разложенной матрицы
+    bool isFactorized() const;                                                          // геттер признака наличия разложения
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64;                                            // ширина панели столбцов (блока) разложения
+
+    DoubleVect lu;                                                                      // множители L (ниже диагонали, единичная диагональ) и U (диагональ и выше)
+    SizeVect pivots;                                                                    // номера строк, переставленных с i-ой на i-ом шаге разложения
+    size_t dimension = 0;                                                               // размер разложенной матрицы
+    bool factorized = false;                                                            // признак наличия разложения
+
+    void factorizePanel(size_t first, size_t last);                                     // метод разложения панели столбцов [first, last)
+    void updateTrailing(size_t first, size_t last);                                     // метод обновления строк панели и оставшейся подматрицы
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод LU-разложения матрицы с частичным выбором ведущего элемента
+// принимает на вход:
+// 1) матрицу размера size x size, хранимую построчно в непрерывном массиве
+// 2) размер матрицы
+// при вырожденной матрице выбрасывает исключение std::runtime_error
+inline void LUSolver::factorize(DoubleVect matrix, size_t size)
+{
+    if (matrix.size() != size * size)                                                   // если размер массива не соответствует размеру матрицы
+    {
+        throw std::invalid_argument("Matrix storage does not match its size");
+    }
+
+    lu = std::move(matrix);                                                             // забираем матрицу себе - разложение выполняется на месте
+    dimension = size;                                                                   //
+    pivots = SizeVect(size);                                                            // вектор перестановок строк
+    factorized = false;                                                                 // пока разложение не завершено, пользоваться им нельзя
+
+    for (size_t first = 0; first < dimension; first += BLOCK_SIZE)                      // перебираем панели столбцов шириной BLOCK_SIZE
+    {
+        size_t last = std::min(first + BLOCK_SIZE, dimension);                          // граница текущей панели
+
+        factorizePanel(first, last);                                                    // раскладываем панель (с перестановками строк)
+        updateTrailing(first, last);                                                    // обновляем блок U справа от панели и подматрицу под ним
+    }
+
+    factorized = true;                                                                  // разложение готово
+}
+
+// метод решения системы по готовому разложению
+// принимает на вход: правую часть системы, которая заменяется найденным решением
+inline void LUSolver::solve(DoubleVect& rightPart) const
+{
+    if (!factorized || rightPart.size() != dimension)                                   // если разложения нет или размер правой части не совпадает
+    {
+        throw std::logic_error("Right part does not match factorized matrix");
+    }
+
+    for (size_t i = 0; i < dimension; i++)                                              // переставляем элементы правой части в порядке
+    {                                                                                   // перестановки строк при разложении
+        std::swap(rightPart[i], rightPart[pivots[i]]);
+    }
+
+    for (size_t i = 0; i < dimension; i++)                                              // прямой ход: решаем L * y = b (диагональ L единичная)
+    {
+        const double* row = &lu[i * dimension];
+        double sum = rightPart[i];
+
+        for (size_t j = 0; j < i; j++)
+        {
+            sum -= row[j] * rightPart[j];
+        }
+
+        rightPart[i] = sum;
+    }
+
+    for (size_t i = dimension; i-- > 0; )                                               // обратный ход: решаем U * x = y
+    {
+        const double* row = &lu[i * dimension];
+        double sum = rightPart[i];
+
+        for (size_t j = i + 1; j < dimension; j++)
+        {
+            sum -= row[j] * rightPart[j];
+        }
+
+        rightPart[i] = sum / row[i];
+    }
+}
+
+// геттер размера разложенной матрицы
+inline size_t LUSolver::size() const
+{
+    return dimension;
+}
+
+// геттер признака наличия разложения
+inline bool LUSolver::isFactorized() const
+{
+    return factorized;
+}
+
+// метод разложения панели столбцов [first, last):
+// для каждого столбца панели выбирается ведущий элемент, строки переставляются целиком
+// (при построчном хранении это непрерывный обмен памяти), затем обновляются только
+// столбцы самой панели - остальная часть матрицы обновляется блоком в updateTrailing
+inline void LUSolver::factorizePanel(size_t first, size_t last)
+{
+    for (size_t k = first; k < last; k++)                                               // перебираем столбцы панели
+    {
+        size_t pivot = k;                                                               // ищем максимальный по модулю элемент столбца k
+        double pivotValue = std::abs(lu[k * dimension + k]);                            // на диагонали и ниже
+
+        for (size_t i = k + 1; i < dimension; i++)
+        {
+            double value = std::abs(lu[i * dimension + k]);
+
+            if (value > pivotValue)
+            {
+                pivot = i;
+                pivotValue = value;
+            }
+        }
+
+        if (pivotValue == 0.0)                                                          // если весь столбец нулевой - матрица вырождена
+        {
+            throw std::runtime_error("Equation system is singular at column: " + std::to_string(k));
+        }
+
+        pivots[k] = pivot;                                                              // запоминаем перестановку
+
+        if (pivot != k)                                                                 // переставляем строки целиком
+        {
+            std::swap_ranges(lu.begin() + k * dimension, lu.begin() + (k + 1) * dimension,
+                             lu.begin() + pivot * dimension);
+        }
+
+        const double* pivotRow = &lu[k * dimension];
+        double inverse = 1.0 / pivotRow[k];
+
+        for (size_t i = k + 1; i < dimension; i++)                                      // вычисляем множители L в столбце k и обновляем
+        {                                                                               // оставшиеся столбцы панели
+            double* row = &lu[i * dimension];
+            double factor = row[k] *= inverse;
+
+            if (factor != 0.0)
+            {
+                for (size_t j = k + 1; j < last; j++)
+                {
+                    row[j] -= factor * pivotRow[j];
+                }
+            }
+        }
+    }
+}
+
+// метод обновления матрицы после разложения панели [first, last):
+// 1) строки панели справа от нее: U12 = L11^-1 * A12
+// 2) подматрица под ними: A22 = A22 - L21 * U12
+// подматрица обновляется блоками столбцов, чтобы используемые строки U12 оставались в кэше
+inline void LUSolver::updateTrailing(size_t first, size_t last)
+{
+    if (last == dimension)                                                              // справа от последней панели ничего нет
+    {
+        return;
+    }
+
+    for (size_t k = first; k < last; k++)                                               // прямой ход с единичной L11 по строкам панели
+    {
+        const double* pivotRow = &lu[k * dimension];
+
+        for (size_t i = k + 1; i < last; i++)
+        {
+            double* row = &lu[i * dimension];
+            double factor = row[k];
+
+            if (factor != 0.0)
+            {
+                for (size_t j = last; j < dimension; j++)
+                {
+                    row[j] -= factor * pivotRow[j];
+                }
+            }
+        }
+    }
+
+    const size_t COLUMN_BLOCK = 4 * BLOCK_SIZE;                                         // ширина блока столбцов подматрицы
+
+    for (size_t columnFirst = last; columnFirst < dimension; columnFirst += COLUMN_BLOCK)
+    {
+        size_t columnLast = std::min(columnFirst + COLUMN_BLOCK, dimension);
+
+        for (size_t i = last; i < dimension; i++)                                       // перебираем строки подматрицы
+        {
+            double* row = &lu[i * dimension];
+
+            for (size_t k = first; k < last; k++)                                       // перебираем столбцы панели (множители L21)
+            {
+                double factor = row[k];
+
+                if (factor == 0.0)                                                      // схемные матрицы сильно разрежены - пропускаем нули
+                {
+                    continue;
+                }
+
+                const double* pivotRow = &lu[k * dimension];
+
+                for (size_t j = columnFirst; j < columnLast; j++)                       // внутренний цикл непрерывен по памяти и векторизуется
+                {
+                    row[j] -= factor * pivotRow[j];
+                }
+            }
+        }
+    }
+}
+
+} // namespace CS
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <set>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+#include "circuit-solver/common.h"
+
+namespace CS
+{
+// класс для построения упорядочения столбцов разреженной матрицы, уменьшающего
+// заполнение при разложении (метод приближенной минимальной степени на фактор-графе)
+// фактор-граф состоит из переменных (столбцов) и элементов - клик, образующихся
+// при исключении переменных; клики хранятся списками переменных, а не ребрами,
+// поэтому память не растет с заполнением. как в AMD:
+// - у элемента хранится текущий размер (суммарный вес неисключенных переменных),
+//   элементы, целиком вошедшие в новый, поглощаются
+// - степень переменной оценивается сверху через размеры |Le \ Lp| смежных элементов
+//   и пересчитывается только у переменных нового элемента
+// - переменные с одинаковыми списками смежности объединяются в суперпеременные
+//   (вес - количество столбцов), которые исключаются одним шагом
+// - плотные переменные (смежных больше max(16, 10 * sqrt(n))) в графе не участвуют
+//   и исключаются последними
+// два режима:
+// 1) updateSymmetric - граф матрицы A + A^T (аналог AMD), для матриц с симметричной
+//    структурой и выбором ведущего элемента на диагонали
+// 2) updateColumns - строки матрицы сразу считаются кликами графа A^T * A (аналог
+//    COLAMD), сама матрица A^T * A не строится, плотные строки можно пропустить;
+//    упорядочение ограничивает заполнение при любом выборе ведущих строк
+//////////////////////////////////////////////////////////////////////////////////////////
+class MinimumDegree
+{
+public:
+    void updateSymmetric(const SizeVect& rowOffsets, const SizeVect& columns,
+                         size_t size);                                                  // метод построения упорядочения по графу A + A^T
+    void updateColumns(const SizeVect& rowOffsets, const SizeVect& columns, size_t size,
+                       const BoolVect& skippedRows);                                    // метод построения упорядочения по графу A^T * A
+    const SizeVect& get() const;                                                        // геттер упорядочения (номера столбцов по порядку исключения)
+    static size_t denseThreshold(size_t size);                                          // геттер порога плотной строки или переменной
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер столбца
+
+    SizeVect order;                                                                     // номера столбцов в порядке исключения
+    SizeVect denseVariables;                                                            // плотные переменные (исключаются последними)
+    SizeMatr variableAdjacency;                                                         // смежные переменные каждой переменной
+    SizeMatr variableElements;                                                          // смежные элементы (клики) каждой переменной
+    SizeMatr elementVariables;                                                          // переменные каждого элемента (могут содержать исключенные)
+    SizeVect elementWeights;                                                            // суммарный вес неисключенных переменных элемента
+    BoolVect eliminated;                                                                // отметки об исключенных (и плотных) переменных
+    BoolVect absorbed;                                                                  // отметки о поглощенных элементах
+    SizeVect weights;                                                                   // вес суперпеременной (0 - переменная вошла в другую)
+    SizeVect nextMember;                                                                // следующий столбец суперпеременной
+    SizeVect lastMember;                                                                // последний столбец суперпеременной
+    SizeVect degree;                                                                    // оценки степеней переменных
+    SizeVect marks;                                                                     // метки переменных и элементов для обходов без повторов
+    SizeVect elementMarks;                                                              //
+    SizeVect external;                                                                  // размеры |Le \ Lp| элементов, смежных новому элементу Lp
+    size_t stamp = 0;                                                                   // текущее значение метки
+
+    void eliminate(size_t size);                                                        // метод исключения всех переменных
+    void removeDense(size_t size);                                                      // метод исключения плотных переменных из графа
+    bool isIndistinguishable(size_t first, size_t second);                              // метод проверки совпадения смежности переменных
+    void release(SizeVect& list);                                                       // метод освобождения памяти списка
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод построения упорядочения по графу матрицы A + A^T
+// принимает на вход:
+// 1) смещения начала строк матрицы (строк + 1)
+// 2) номера столбцов коэффициентов (без повторов в строке)
+// 3) размер (квадратной) матрицы
+inline void MinimumDegree::updateSymmetric(const SizeVect& rowOffsets, const SizeVect& columns,
+                                           size_t size)
+{
+    variableAdjacency = SizeMatr(size);                                                 // смежность строится по обеим половинам матрицы
+    variableElements = SizeMatr(size);                                                  // элементов изначально нет
+    elementVariables.clear();                                                           //
+
+    for (size_t i = 0; i < size; i++)                                                   // перебираем коэффициенты: (i, j) дает ребра i - j и j - i
+    {
+        for (size_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)
+        {
+            if (columns[k] != i)                                                        // диагональ ребер не дает
+            {
+                variableAdjacency[i].push_back(columns[k]);
+                variableAdjacency[columns[k]].push_back(i);
+            }
+        }
+    }
+
+    for (SizeVect& adjacency : variableAdjacency)                                       // удаляем повторы в списках смежности
+    {
+        std::sort(adjacency.begin(), adjacency.end());
+        adjacency.erase(std::unique(adjacency.begin(), adjacency.end()), adjacency.end());
+    }
+
+    eliminate(size);
+}
+
+// метод построения упорядочения по графу матрицы A^T * A
+// каждая строка матрицы становится элементом, объединяющим столбцы этой строки;
+// пропускаемые (плотные, длиннее denseThreshold) строки элементов не образуют:
+// иначе все их столбцы получили бы степень не меньше длины строки (такие строки
+// разложение выбирает ведущими последними)
+// принимает на вход:
+// 1) смещения начала строк матрицы (строк + 1)
+// 2) номера столбцов коэффициентов (без повторов в строке)
+// 3) количество столбцов матрицы
+// 4) отметки пропускаемых строк
+inline void MinimumDegree::updateColumns(const SizeVect& rowOffsets, const SizeVect& columns, size_t size,
+                                         const BoolVect& skippedRows)
+{
+    variableAdjacency = SizeMatr(size);                                                 // ребер между переменными изначально нет
+    variableElements = SizeMatr(size);                                                  //
+    elementVariables.clear();                                                           // элементы - непропущенные строки матрицы
+
+    for (size_t i = 0; i + 1 < rowOffsets.size(); i++)                                  // перебираем строки
+    {
+        if (skippedRows[i])
+        {
+            continue;
+        }
+
+        size_t e = elementVariables.size();
+        elementVariables.emplace_back(columns.begin() + rowOffsets[i], columns.begin() + rowOffsets[i + 1]);
+
+        for (size_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)                      // столбец входит в элемент строки
+        {
+            variableElements[columns[k]].push_back(e);
+        }
+    }
+
+    eliminate(size);
+}
+
+// геттер упорядочения
+inline const SizeVect& MinimumDegree::get() const
+{
+    return order;
+}
+
+// геттер порога плотной строки или переменной (как в AMD: max(16, 10 * sqrt(n)))
+// принимает на вход: количество переменных
+inline size_t MinimumDegree::denseThreshold(size_t size)
+{
+    return std::max<size_t>(16, static_cast<size_t>(10.0 * std::sqrt(static_cast<double>(size))));
+}
+
+// метод исключения переменных в порядке возрастания оценки степени:
+// при исключении суперпеременной p смежные с ней элементы поглощаются новым элементом
+// Lp из оставшихся соседей p; затем только для переменных Lp:
+// 1) вычисляются размеры |Le \ Lp| их элементов (элементы, целиком вошедшие в Lp,
+//    поглощаются)
+// 2) из списков удаляются поглощенные элементы и ребра, покрытые Lp, и оценивается
+//    степень: |Lp \ i| + сумма |Le \ Lp| + вес оставшихся смежных переменных
+// 3) переменные с одинаковыми списками объединяются в суперпеременные
+// стоимость шага пропорциональна суммарной длине списков переменных Lp, а не размеру
+// всего графа; плотные переменные добавляются в конец упорядочения
+inline void MinimumDegree::eliminate(size_t size)
+{
+    order.clear();
+    eliminated = BoolVect(size, false);
+    weights = SizeVect(size, 1);
+    nextMember = SizeVect(size, NONE);
+    lastMember = SizeVect(size);
+    degree = SizeVect(size, 0);
+    marks = SizeVect(size, 0);
+    stamp = 0;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        lastMember[i] = i;
+    }
+
+    removeDense(size);                                                                  // плотные переменные исключаются из графа заранее
+
+    size_t elementCount = elementVariables.size();
+    absorbed = BoolVect(elementCount, false);
+    elementWeights = SizeVect(elementCount);
+    elementMarks = SizeVect(elementCount, 0);
+    external = SizeVect(elementCount, 0);
+
+    for (size_t e = 0; e < elementCount; e++)
+    {
+        elementWeights[e] = elementVariables[e].size();
+    }
+
+    size_t remaining = 0;                                                               // суммарный вес неисключенных переменных
+    std::set<std::pair<size_t, size_t>> queue;                                          // очередь переменных: (оценка степени, номер)
+
+    for (size_t i = 0; i < size; i++)                                                   // начальные оценки степеней
+    {
+        if (!eliminated[i])
+        {
+            remaining++;
+            degree[i] = variableAdjacency[i].size();
+
+            for (size_t e : variableElements[i])
+            {
+                degree[i] += elementWeights[e] - 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (!eliminated[i])
+        {
+            degree[i] = std::min(degree[i], remaining - 1);
+            queue.emplace(degree[i], i);
+        }
+    }
+
+    SizeVect element;                                                                   // переменные нового элемента
+    std::vector<std::pair<size_t, size_t>> hashes;                                      // (свертка списков, номер) переменных нового элемента
+
+    while (!queue.empty())                                                              // пока есть неисключенные переменные
+    {
+        size_t pivot = queue.begin()->second;                                           // суперпеременная с наименьшей оценкой степени
+        queue.erase(queue.begin());
+        eliminated[pivot] = true;
+        remaining -= weights[pivot];
+
+        for (size_t column = pivot; column != NONE; column = nextMember[column])        // исключаются все столбцы суперпеременной
+        {
+            order.push_back(column);
+        }
+
+        stamp++;                                                                        // собираем соседей pivot без повторов
+        element.clear();
+        size_t elementWeight = 0;
+
+        auto include = [&](size_t variable) {
+            if (!eliminated[variable] && weights[variable] && marks[variable] != stamp)
+            {
+                marks[variable] = stamp;
+                element.push_back(variable);
+                elementWeight += weights[variable];
+            }
+        };
+
+        for (size_t variable : variableAdjacency[pivot])                                // соседи по ребрам
+        {
+            include(variable);
+        }
+
+        for (size_t e : variableElements[pivot])                                        // соседи по элементам
+        {
+            if (!absorbed[e])
+            {
+                for (size_t variable : elementVariables[e])
+                {
+                    include(variable);
+                }
+
+                absorbed[e] = true;                                                     // элемент поглощается новым
+                release(elementVariables[e]);
+            }
+        }
+
+        release(variableAdjacency[pivot]);                                              // списки исключенной переменной больше не нужны
+        release(variableElements[pivot]);                                               //
+
+        size_t newElement = elementVariables.size();                                    // номер нового элемента
+        elementVariables.push_back(element);
+        elementWeights.push_back(elementWeight);
+        absorbed.push_back(false);
+        elementMarks.push_back(0);
+        external.push_back(0);
+
+        for (size_t variable : element)                                                 // размеры |Le \ Lp| элементов, смежных Lp
+        {
+            for (size_t e : variableElements[variable])
+            {
+                if (absorbed[e])
+                {
+                    continue;
+                }
+
+                if (elementMarks[e] != stamp)
+                {
+                    elementMarks[e] = stamp;
+                    external[e] = elementWeights[e];
+                }
+
+                external[e] -= weights[variable];
+            }
+        }
+
+        hashes.clear();
+
+        for (size_t variable : element)                                                 // обновляем списки и степени переменных Lp
+        {
+            size_t weight = weights[variable];
+            size_t newDegree = elementWeight - weight;                                  // соседи по новому элементу
+            size_t hash = 0;
+
+            SizeVect& elements = variableElements[variable];                            // удаляем поглощенные элементы
+            size_t count = 0;
+
+            for (size_t e : elements)
+            {
+                if (absorbed[e])
+                {
+                    continue;
+                }
+
+                if (external[e] == 0)                                                   // элемент целиком вошел в Lp - поглощается
+                {
+                    absorbed[e] = true;
+                    release(elementVariables[e]);
+                    continue;
+                }
+
+                elements[count++] = e;
+                newDegree += external[e];
+                hash += e;
+            }
+
+            elements.resize(count);
+            elements.push_back(newElement);
+
+            SizeVect& adjacency = variableAdjacency[variable];                          // удаляем исключенные переменные и ребра, покрытые Lp
+            count = 0;
+
+            for (size_t other : adjacency)
+            {
+                if (!eliminated[other] && weights[other] && marks[other] != stamp)
+                {
+                    adjacency[count++] = other;
+                    newDegree += weights[other];
+                    hash += other;
+                }
+            }
+
+            adjacency.resize(count);
+
+            queue.erase({ degree[variable], variable });                                // оценка не больше прежней степени плюс |Lp \ i|
+            degree[variable] = std::min({ newDegree, degree[variable] + elementWeight - weight,
+                                          remaining - weight });
+            hashes.emplace_back(hash, variable);
+        }
+
+        std::sort(hashes.begin(), hashes.end());                                        // кандидаты в суперпеременные - с равной сверткой
+
+        for (size_t first = 0; first < hashes.size(); first++)
+        {
+            size_t variable = hashes[first].second;
+
+            for (size_t second = first + 1; second < hashes.size() && hashes[second].first == hashes[first].first;
+                 second++)
+            {
+                size_t other = hashes[second].second;
+
+                if (!weights[variable] || !weights[other] || !isIndistinguishable(variable, other))
+                {
+                    continue;
+                }
+
+                degree[variable] -= weights[other];                                     // other больше не внешний сосед variable
+                weights[variable] += weights[other];                                    // присоединяем столбцы other к суперпеременной
+                weights[other] = 0;
+                nextMember[lastMember[variable]] = other;
+                lastMember[variable] = lastMember[other];
+                release(variableAdjacency[other]);
+                release(variableElements[other]);
+            }
+        }
+
+        for (size_t variable : element)                                                 // возвращаем суперпеременные Lp в очередь
+        {
+            if (weights[variable])
+            {
+                queue.emplace(degree[variable], variable);
+            }
+        }
+    }
+
+    order.insert(order.end(), denseVariables.begin(), denseVariables.end());            // плотные переменные - в конце
+
+    SizeMatr().swap(variableAdjacency);                                                 // освобождаем рабочие структуры
+    SizeMatr().swap(variableElements);                                                  //
+    SizeMatr().swap(elementVariables);                                                  //
+}
+
+// метод исключения плотных переменных из графа: переменная, смежная больше чем
+// с denseThreshold переменными или элементами, помечается исключенной и удаляется
+// из списков остальных переменных и элементов; сами плотные переменные
+// запоминаются в denseVariables (в порядке номеров)
+// принимает на вход: количество переменных
+inline void MinimumDegree::removeDense(size_t size)
+{
+    size_t threshold = denseThreshold(size);
+    denseVariables.clear();
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (variableAdjacency[i].size() + variableElements[i].size() > threshold)
+        {
+            eliminated[i] = true;
+            denseVariables.push_back(i);
+        }
+    }
+
+    if (denseVariables.empty())
+    {
+        return;
+    }
+
+    auto isDense = [this](size_t variable) { return eliminated[variable]; };
+
+    for (size_t i = 0; i < size; i++)                                                   // удаляем плотные переменные из списков
+    {
+        if (eliminated[i])
+        {
+            release(variableAdjacency[i]);
+            release(variableElements[i]);
+            continue;
+        }
+
+        SizeVect& adjacency = variableAdjacency[i];
+        adjacency.erase(std::remove_if(adjacency.begin(), adjacency.end(), isDense), adjacency.end());
+    }
+
+    for (SizeVect& variables : elementVariables)
+    {
+        variables.erase(std::remove_if(variables.begin(), variables.end(), isDense), variables.end());
+    }
+}
+
+// метод проверки совпадения смежности двух переменных нового элемента (после
+// удаления из их списков поглощенных элементов и ребер, покрытых новым элементом):
+// переменные неразличимы, если у них одинаковые множества смежных элементов и
+// смежных переменных
+// принимает на вход: номера двух переменных
+inline bool MinimumDegree::isIndistinguishable(size_t first, size_t second)
+{
+    const SizeVect& firstElements = variableElements[first];
+    const SizeVect& secondElements = variableElements[second];
+    const SizeVect& firstAdjacency = variableAdjacency[first];
+    const SizeVect& secondAdjacency = variableAdjacency[second];
+
+    if (firstElements.size() != secondElements.size() || firstAdjacency.size() != secondAdjacency.size())
+    {
+        return false;
+    }
+
+    stamp++;
+
+    for (size_t e : firstElements)
+    {
+        elementMarks[e] = stamp;
+    }
+
+    for (size_t variable : firstAdjacency)
+    {
+        marks[variable] = stamp;
+    }
+
+    for (size_t e : secondElements)
+    {
+        if (elementMarks[e] != stamp)
+        {
+            return false;
+        }
+    }
+
+    for (size_t variable : secondAdjacency)
+    {
+        if (marks[variable] != stamp)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// метод освобождения памяти списка (clear не освобождает память вектора)
+// принимает на вход: список
+inline void MinimumDegree::release(SizeVect& list)
+{
+    SizeVect().swap(list);
+}
+
+} // namespace CS
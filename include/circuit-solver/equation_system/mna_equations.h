@@ -0,0 +1,1323 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/elements.h"
+#include "circuit-solver/circuit_configuration/nodes.h"
+#include "circuit-solver/circuit_configuration/branches.h"
+#include "circuit-solver/circuit_configuration/inc_matrix.h"
+#include "circuit-solver/equation_system/sparse_matrix.h"
+#include "circuit-solver/equation_system/assembly.h"
+#include "circuit-solver/equation_system/rank_one_update.h"
+#include "circuit-solver/structure_units/serialization.h"
+
+namespace CS
+{
+// класс для представления уравнений схемы по модифицированному методу узловых
+// потенциалов (MNA)
+// неизвестные: потенциалы всех узлов, кроме последнего (он принимается за базисный),
+// и токи ветвей без сопротивлений (содержащих только источники напряжения)
+// уравнения: I закон Кирхгофа для каждого небазисного узла, в котором ток ветви
+// выражен через потенциалы: I = G * (Vнач - Vкон + E), и по одному уравнению
+// Vнач - Vкон = -E для каждой ветви без сопротивлений
+// контуры для построения системы не нужны; для резистивной схемы без источников
+// напряжения матрица симметрична и положительно определена
+// коэффициенты левой части хранятся в SparseMatrix, но индекс значения здесь - номер
+// ветви, проводимость которой входит в коэффициент (UNIT - единичный коэффициент);
+// столбцы правой части - источники в той же нумерации, что и в Equations (сначала
+// источники тока, затем источники напряжения), коэффициент умножается на значение источника
+// после частичного обновления матрицы инцидентности систему можно обновить частично
+// (patch): сведения пересчитываются только для измененных ветвей, строятся только
+// строки измененных узлов и ветвей без сопротивлений, номера дополнительных
+// неизвестных сохраняются (освободившиеся занимают последние)
+//////////////////////////////////////////////////////////////////////////////////////////
+class MnaEquations
+{
+public:
+    void update(const Nodes& nodes, const Branches& branches,
+                const IncMatrix& matrix, const Elements& elements);                     // метод обновления уравнений
+    void patch(const Nodes& nodes, const Branches& branches,
+               const IncMatrix& matrix, const Elements& elements);                      // метод частичного обновления после IncMatrix::patch
+    const SizeVect& getChangedUnknowns() const;                                         // геттер номеров неизвестных, измененных последним patch
+    bool isPatternChanged() const;                                                      // геттер признака расширения структуры левой части последним patch
+    const SparseMatrix& left() const;                                                   // константный геттер левой части системы уравнений
+    const SparseMatrix& right() const;                                                  // константный геттер правой части системы уравнений
+    void evaluate(const Elements& elements, DoubleVect& leftValues,
+                  DoubleVect& rightPart) const;                                         // метод вычисления коэффициентов левой части и правой части
+    void evaluateLeft(const Elements& elements, DoubleVect& leftValues) const;          // метод вычисления только коэффициентов левой части
+    void evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const;   // метод вычисления коэффициентов левой части (по массиву значений)
+    void evaluateRight(const Elements& elements, const DoubleVect& sourceValues,
+                       DoubleVect& rightPart) const;                                    // метод вычисления правой части по значениям источников
+    void evaluateRight(const DoubleVect& elementValues, const DoubleVect& sourceValues,
+                       DoubleVect& rightPart) const;                                    // метод вычисления правой части (по массиву значений)
+    DoubleVect getSourceValues(const Elements& elements) const;                         // метод получения значений источников по столбцам правой части
+    DoubleVect getSourceValues(const DoubleVect& elementValues) const;                  // метод получения значений источников (по массиву значений)
+    DoubleVect getBranchCurrents(const DoubleVect& solution,
+                                 const Elements& elements) const;                       // метод вычисления токов ветвей по решению системы
+    DoubleVect getBranchCurrents(const DoubleVect& solution, const Elements& elements,
+                                 const DoubleVect& sourceValues) const;                 // метод вычисления токов ветвей при заданных значениях источников
+    DoubleVect getBranchCurrents(const DoubleVect& solution, const DoubleVect& elementValues,
+                                 const DoubleVect& sourceValues) const;                 // метод вычисления токов ветвей (по массиву значений)
+    void getCurrentGradient(size_t branch, const DoubleVect& solution,
+                            const DoubleVect& elementValues, DoubleVect& bySolution,
+                            DoubleVect& byElements) const;                              // метод вычисления производных тока ветви по решению и значениям
+    void addElementResidual(size_t element, const DoubleVect& elementValues,
+                            const DoubleVect& solution, DoubleVect& residual) const;    // метод добавления производной невязки по значению элемента
+    void addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& elementValues,
+                               const DoubleVect& solution,
+                               DoubleVect& derivatives) const;                          // метод добавления производных по всем элементам для сопряженного решения
+    void getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                          double value, RankOneUpdate& update) const;                   // метод получения изменения системы при новом значении элемента
+    size_t size() const;                                                                // геттер количества уравнений
+    size_t getNodeEquationCount() const;                                                // геттер количества уравнений по I закону Кирхгофа
+    size_t getBranchCount() const;                                                      // геттер количества ветвей (длины вектора токов)
+    std::ostream& print(std::ostream& os, const Elements& elements) const;              // метод вывода системы в поток при значениях элементов
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер (узла или дополнительного неизвестного)
+
+    SparseMatrix leftPart;                                                              // разреженная матрица коэффициентов левой части системы
+    SparseMatrix rightPart;                                                             // разреженная матрица коэффициентов правой части системы
+    Assembly leftAssembly;                                                              // плоские массивы для вычисления коэффициентов левой части
+    SizeVect sourceIndices;                                                             // номера столбцов правой части для источников (по номеру элемента)
+    SizeVect sourceElements;                                                            // номера элементов-источников (по номеру столбца правой части)
+    size_t nodeEquationCount = 0;                                                       // счетчик уравнений по I закону Кирхгофа (небазисных узлов)
+    size_t unknownCurrentCount = 0;                                                     // счетчик ветвей с неизвестными токами
+
+    SizeVect branchFrom;                                                                // номер узла, из которого вытекает ток ветви
+    SizeVect branchTo;                                                                  // номер узла, в который втекает ток ветви
+    SizeVect extraIndices;                                                              // номер дополнительного неизвестного тока ветви без сопротивлений (или NONE)
+    SizeVect extraBranches;                                                             // ветвь каждого дополнительного неизвестного
+    SizeVect resistorStarts;                                                            // сопротивления каждой ветви (номера элементов; участки ветвей
+    SizeVect resistorEnds;                                                              // в одном массиве заданы началом и концом)
+    SizeVect resistors;                                                                 //
+    SizeVect sourceStarts;                                                              // источники каждой ветви (номера элементов и знаки: для источника
+    SizeVect sourceEnds;                                                                // напряжения - по направлению ветви, для источника тока - единичный)
+    SizeVect sources;                                                                   //
+    IntVect sourceSigns;                                                                //
+    SizeMatr nodeBranches;                                                              // ветви, инцидентные каждому узлу (без ветвей, замкнутых на узел)
+    size_t basisPin = NONE;                                                             // первый пин базисного узла (относительно него отсчитываются потенциалы)
+    SizeVect changedUnknowns;                                                           // номера неизвестных, измененных последним patch (по возрастанию)
+    bool patternChanged = true;                                                         // признак расширения структуры левой части последним patch
+
+    void updateBranches(const Branches& branches, const IncMatrix& matrix,
+                        const Elements& elements);                                      // метод сбора сведений о ветвях
+    void updateBranch(size_t branch, const Branches& branches, const IncMatrix& matrix,
+                      const Elements& elements);                                        // метод сбора сведений об одной ветви
+    void updateNodeBranches(size_t node, const IncMatrix& matrix);                      // метод построения списка ветвей узла
+    void compactBranchElements();                                                       // метод удаления прежних участков ветвей из массивов элементов
+    void updateSourceIndices(const Elements& elements);                                 // метод нумерации источников в правой части системы
+    bool hasSameSources(const Elements& elements) const;                                // метод проверки, что источники и их нумерация не изменились
+    void updateBasisPin(const Nodes& nodes);                                            // метод запоминания пина базисного узла
+    void addNodeEquation(size_t node, SparseMatrix& left, SparseMatrix& right) const;   // метод добавления уравнения по I закону Кирхгофа для узла
+    void addBranchEquation(size_t branch, SparseMatrix& left,
+                           SparseMatrix& right) const;                                  // метод добавления уравнения для ветви без сопротивлений
+    void addPotential(size_t node, int sign, size_t valueIndex,
+                      SparseMatrix& left) const;                                        // метод добавления коэффициента при потенциале узла
+    DoubleVect getConductances(const DoubleVect& elementValues) const;                  // метод вычисления проводимостей ветвей
+    double getPotential(const DoubleVect& solution, size_t node) const;                 // метод получения потенциала узла из решения системы
+    void addUpdateWeight(RankOneUpdate& update, size_t node, double weight) const;      // метод добавления потенциала узла в изменение системы
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод обновления уравнений:
+// выполняет построение уравнений путем заполнения разреженных матриц leftPart и rightPart
+// принимает на вход:
+// 1) объект nodes для информации об узлах схемы
+// 2) список ветвей для определения состава ветвей
+// 3) матрицу инцидентности для определения направлений токов ветвей
+// 4) список элементов для определения типов элементов ветвей
+inline void MnaEquations::update(const Nodes& nodes, const Branches& branches,
+                                 const IncMatrix& matrix, const Elements& elements)
+{
+    nodeEquationCount = nodes.size() ? nodes.size() - 1 : 0;                            // последний узел - базисный (его потенциал равен нулю)
+    unknownCurrentCount = matrix.getUnknownCurrentCount();                              //
+
+    updateSourceIndices(elements);                                                      // нумеруем источники в правой части системы
+    updateBranches(branches, matrix, elements);                                         // собираем направления и состав ветвей
+
+    extraBranches.clear();                                                              // нумеруем ветви без сопротивлений - их токи
+                                                                                        // становятся дополнительными неизвестными
+    for (size_t i = 0; i < unknownCurrentCount; i++)
+    {
+        if (resistorStarts[i] == resistorEnds[i])
+        {
+            extraIndices[i] = extraBranches.size();
+            extraBranches.push_back(i);
+        }
+    }
+
+    leftPart.clear(nodeEquationCount + extraBranches.size());                           // очищаем разреженные матрицы: в левой части столбцов столько же,
+    rightPart.clear(elements.getCurrentSourceCount() +                                  // сколько неизвестных, в правой - сколько источников
+                    elements.getVoltageSourceCount());                                  //
+
+    for (size_t i = 0; i < nodeEquationCount; i++)                                      // строим уравнения по I з. Кирхгофа для небазисных узлов
+    {
+        addNodeEquation(i, leftPart, rightPart);
+    }
+
+    for (size_t branch : extraBranches)                                                 // строим уравнения для ветвей без сопротивлений
+    {
+        addBranchEquation(branch, leftPart, rightPart);
+    }
+
+    leftAssembly.update(leftPart);                                                      // готовим вычисление коэффициентов левой части
+    updateBasisPin(nodes);
+    changedUnknowns.clear();
+    patternChanged = true;
+}
+
+// метод частичного обновления уравнений после частичного обновления узлов, ветвей
+// и матрицы инцидентности: сведения о ветвях пересчитываются для ветвей, которые
+// пересчитала IncMatrix::patch, списки ветвей - для узлов, столбцы которых она
+// пересчитала; дополнительные неизвестные сохраняют номера, освободившиеся номера
+// занимают новые ветви без сопротивлений, оставшиеся - последние из них
+// заново строятся строки измененных узлов, узлов на концах ветвей с измененными
+// номерами дополнительных неизвестных и уравнения этих ветвей (если количество узлов
+// изменилось, сдвигаются все дополнительные неизвестные - тогда строки всех ветвей
+// без сопротивлений и их узлов); остальные строки переносятся
+// если набор источников изменился (их столбцы в правой части перенумерованы),
+// система строится заново (update), но признак расширения структуры левой части
+// вычисляется так же - сравнением с прежней
+// принимает на вход:
+// 1) объект nodes после patch
+// 2) объект branches после patch
+// 3) матрицу инцидентности после patch
+// 4) список элементов схемы
+inline void MnaEquations::patch(const Nodes& nodes, const Branches& branches,
+                                const IncMatrix& matrix, const Elements& elements)
+{
+    size_t oldNodeEquationCount = nodeEquationCount;
+    size_t oldExtraCount = extraBranches.size();
+    size_t oldSize = branchFrom.size();
+    const SizeVect& changedBranches = matrix.getChangedBranches();
+    bool basisChanged = basisPin >= nodes.getNodesForPin().size() ||                    // потенциалы отсчитываются от другого узла
+                        nodes.getNodesForPin()[basisPin] != static_cast<int>(nodes.size()) - 1;
+
+    if (!hasSameSources(elements))                                                      // столбцы правой части перенумерованы - строим заново
+    {
+        SparseMatrix previous = std::move(leftPart);
+
+        update(nodes, branches, matrix, elements);
+        SizeVect rowSources(leftPart.rows(), SparseMatrix::NONE);
+        patternChanged = previous.patch(leftPart.columns(), rowSources, leftPart);      // сравниваем с прежней структурой
+        changedUnknowns.resize(size());                                                 // номера дополнительных неизвестных не сохранены
+        std::iota(changedUnknowns.begin(), changedUnknowns.end(), 0);
+        return;
+    }
+
+    nodeEquationCount = nodes.size() ? nodes.size() - 1 : 0;
+    unknownCurrentCount = matrix.getUnknownCurrentCount();
+    sourceIndices.resize(elements.size(), 0);                                           // новые элементы - не источники
+
+    SizeVect freeExtras;                                                                // освободившиеся номера дополнительных неизвестных
+    SizeVect releasedBy;                                                                // ветви, освободившие номера (по возрастанию)
+    SizeVect changedExtras;                                                             // номера, уравнения которых строятся заново
+    SizeVect newExtras;                                                                 // ветви, которым нужен номер
+
+    for (size_t branch : changedBranches)                                               // освобождаем номера измененных ветвей
+    {
+        if (branch < oldSize && extraIndices[branch] != NONE)
+        {
+            freeExtras.push_back(extraIndices[branch]);
+            releasedBy.push_back(branch);
+            extraBranches[extraIndices[branch]] = NONE;
+            extraIndices[branch] = NONE;
+        }
+    }
+
+    branchFrom.resize(branches.size(), NONE);
+    branchTo.resize(branches.size(), NONE);
+    extraIndices.resize(branches.size(), NONE);
+    resistorStarts.resize(branches.size(), 0);
+    resistorEnds.resize(branches.size(), 0);
+    sourceStarts.resize(branches.size(), 0);
+    sourceEnds.resize(branches.size(), 0);
+    nodeBranches.resize(nodes.size());
+
+    for (size_t branch : changedBranches)                                               // пересчитываем сведения о ветвях
+    {
+        if (branch < branches.size())
+        {
+            updateBranch(branch, branches, matrix, elements);
+
+            if (branch < unknownCurrentCount && resistorStarts[branch] == resistorEnds[branch])
+            {
+                newExtras.push_back(branch);
+            }
+        }
+    }
+
+    for (size_t branch : newExtras)                                                     // ветвь, оставшаяся без сопротивлений, сохраняет номер
+    {
+        auto released = std::lower_bound(releasedBy.begin(), releasedBy.end(), branch);
+
+        if (released != releasedBy.end() && *released == branch)
+        {
+            size_t extra = freeExtras[released - releasedBy.begin()];
+            extraIndices[branch] = extra;
+            extraBranches[extra] = branch;
+        }
+    }
+
+    changedExtras = freeExtras;
+    freeExtras.erase(std::remove_if(freeExtras.begin(), freeExtras.end(),
+                                    [this](size_t extra) { return extraBranches[extra] != NONE; }),
+                     freeExtras.end());
+    std::sort(freeExtras.begin(), freeExtras.end());
+    size_t hole = 0;
+
+    for (size_t branch : newExtras)                                                     // остальные занимают освободившиеся номера или новые
+    {
+        if (extraIndices[branch] != NONE)
+        {
+            continue;
+        }
+
+        size_t extra = extraBranches.size();
+
+        if (hole < freeExtras.size())
+        {
+            extra = freeExtras[hole++];
+        }
+        else
+        {
+            extraBranches.push_back(NONE);
+        }
+
+        extraIndices[branch] = extra;
+        extraBranches[extra] = branch;
+        changedExtras.push_back(extra);
+    }
+
+    size_t extraCount = extraBranches.size() - (freeExtras.size() - hole);              // количество дополнительных неизвестных после patch
+
+    for (size_t j = hole, from = extraBranches.size(); j < freeExtras.size() && freeExtras[j] < extraCount; j++)
+    {                                                                                   // оставшиеся номера занимают последние неизвестные
+        do
+        {
+            from--;
+        } while (extraBranches[from] == NONE);
+
+        extraBranches[freeExtras[j]] = extraBranches[from];
+        extraIndices[extraBranches[from]] = freeExtras[j];
+        extraBranches[from] = NONE;
+    }
+
+    extraBranches.resize(extraCount);
+
+    SizeVect rows;                                                                      // строки, которые строятся заново
+    SizeVect changedNodes = matrix.getChangedNodes();
+
+    for (size_t node : changedNodes)                                                    // ветви измененных узлов
+    {
+        if (node < nodes.size())
+        {
+            updateNodeBranches(node, matrix);
+        }
+    }
+
+    for (size_t extra : changedExtras)                                                  // уравнения ветвей с новыми номерами и узлы их концов
+    {
+        if (extra < extraCount)
+        {
+            changedNodes.push_back(branchFrom[extraBranches[extra]]);
+            changedNodes.push_back(branchTo[extraBranches[extra]]);
+            rows.push_back(nodeEquationCount + extra);
+        }
+    }
+
+    if (nodeEquationCount != oldNodeEquationCount)                                      // сдвинулись все дополнительные неизвестные
+    {
+        for (size_t extra = 0; extra < extraCount; extra++)
+        {
+            changedNodes.push_back(branchFrom[extraBranches[extra]]);
+            changedNodes.push_back(branchTo[extraBranches[extra]]);
+            rows.push_back(nodeEquationCount + extra);
+        }
+    }
+
+    for (size_t node : changedNodes)
+    {
+        if (node < nodeEquationCount)
+        {
+            rows.push_back(node);
+        }
+    }
+
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    size_t equationCount = nodeEquationCount + extraCount;                              // количество уравнений после patch
+    SizeVect rowSources(equationCount, SparseMatrix::NONE);                             // прежняя строка для каждой новой (NONE - строится заново)
+    SparseMatrix left;                                                                  // новые строки по порядку
+    SparseMatrix right;                                                                 //
+
+    for (size_t i = 0; i < nodeEquationCount && i < oldNodeEquationCount; i++)          // строки узлов и ветвей сохраняются, кроме измененных
+    {
+        rowSources[i] = i;
+    }
+
+    for (size_t extra = 0; extra < extraCount && extra < oldExtraCount; extra++)
+    {
+        rowSources[nodeEquationCount + extra] = oldNodeEquationCount + extra;
+    }
+
+    for (size_t row : rows)
+    {
+        rowSources[row] = SparseMatrix::NONE;
+    }
+
+    left.clear(equationCount);
+    right.clear(sourceElements.size());
+
+    for (size_t i = 0; i < equationCount; i++)                                          // строим новые строки по порядку
+    {
+        if (rowSources[i] != SparseMatrix::NONE)
+        {
+            continue;
+        }
+
+        if (i < nodeEquationCount)
+        {
+            addNodeEquation(i, left, right);
+        }
+        else
+        {
+            addBranchEquation(extraBranches[i - nodeEquationCount], left, right);
+        }
+    }
+
+    patternChanged = leftPart.patch(equationCount, rowSources, left);
+    rightPart.patch(sourceElements.size(), rowSources, right);
+    leftAssembly.update(leftPart);
+
+    if (resistors.size() + sources.size() > 4 * elements.size())                        // прежние участки занимают больше половины массивов
+    {
+        compactBranchElements();
+    }
+
+    changedUnknowns.clear();                                                            // потенциалы измененных узлов
+
+    if (basisChanged)
+    {
+        changedUnknowns.resize(nodeEquationCount);
+        std::iota(changedUnknowns.begin(), changedUnknowns.end(), 0);
+    }
+    else
+    {
+        for (size_t node : nodes.getChangedNodes())
+        {
+            if (node < nodeEquationCount)
+            {
+                changedUnknowns.push_back(node);
+            }
+        }
+    }
+
+    for (size_t row : rows)                                                             // токи ветвей с новыми номерами
+    {
+        if (row >= nodeEquationCount)
+        {
+            changedUnknowns.push_back(row);
+        }
+    }
+
+    std::sort(changedUnknowns.begin(), changedUnknowns.end());
+    changedUnknowns.erase(std::unique(changedUnknowns.begin(), changedUnknowns.end()), changedUnknowns.end());
+    updateBasisPin(nodes);
+}
+
+// геттер номеров неизвестных, смысл которых изменил последний patch: потенциалы
+// узлов с измененным составом или номером (всех узлов, если сменился базисный) и
+// токи ветвей без сопротивлений, уравнения которых построены заново (после
+// update - пустой)
+inline const SizeVect& MnaEquations::getChangedUnknowns() const
+{
+    return changedUnknowns;
+}
+
+// геттер признака расширения структуры левой части последним patch (см.
+// SparseMatrix::patch); при false символьный анализ разложения можно сохранить
+// (после update - true)
+inline bool MnaEquations::isPatternChanged() const
+{
+    return patternChanged;
+}
+
+// константный геттер левой части системы уравнений
+inline const SparseMatrix& MnaEquations::left() const
+{
+    return leftPart;
+}
+
+// константный геттер правой части системы уравнений
+inline const SparseMatrix& MnaEquations::right() const
+{
+    return rightPart;
+}
+
+// метод вычисления численных значений системы при текущих значениях элементов
+// принимает на вход:
+// 1) список элементов схемы
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+// 3) вектор для правой части системы (размер приводится к количеству уравнений)
+inline void MnaEquations::evaluate(const Elements& elements, DoubleVect& leftValues,
+                                   DoubleVect& rightPart) const
+{
+    evaluateLeft(elements, leftValues);                                                 // коэффициенты левой части
+    evaluateRight(elements, getSourceValues(elements), rightPart);                      // правая часть
+}
+
+// метод вычисления коэффициентов левой части при текущих значениях элементов
+// принимает на вход:
+// 1) список элементов схемы
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+inline void MnaEquations::evaluateLeft(const Elements& elements, DoubleVect& leftValues) const
+{
+    evaluateLeft(elements.getValues(), leftValues);
+}
+
+// метод вычисления коэффициентов левой части по массиву значений элементов (перегрузка)
+// принимает на вход:
+// 1) значения элементов схемы подряд (см. Elements::getValues)
+// 2) вектор для значений коэффициентов левой части (в порядке их хранения в leftPart)
+inline void MnaEquations::evaluateLeft(const DoubleVect& elementValues, DoubleVect& leftValues) const
+{
+    DoubleVect conductances = getConductances(elementValues);                           // проводимости ветвей
+
+    leftAssembly.evaluate(conductances, leftValues);                                    // коэффициент левой части - проводимость ветви или единица со знаком
+}
+
+// метод вычисления правой части системы по значениям источников: сумма коэффициентов
+// (единица или проводимость ветви), умноженных на значения источников, поэтому правая
+// часть линейно зависит от значений источников
+// принимает на вход:
+// 1) список элементов схемы (для проводимостей ветвей)
+// 2) значения источников по столбцам правой части (см. getSourceValues)
+// 3) вектор для правой части системы (размер приводится к количеству уравнений)
+inline void MnaEquations::evaluateRight(const Elements& elements, const DoubleVect& sourceValues,
+                                        DoubleVect& rightPart) const
+{
+    evaluateRight(elements.getValues(), sourceValues, rightPart);
+}
+
+// метод вычисления правой части системы по массиву значений элементов (перегрузка)
+// принимает на вход:
+// 1) значения элементов схемы подряд (для проводимостей ветвей)
+// 2) значения источников по столбцам правой части (см. getSourceValues)
+// 3) вектор для правой части системы (размер приводится к количеству уравнений)
+inline void MnaEquations::evaluateRight(const DoubleVect& elementValues, const DoubleVect& sourceValues,
+                                        DoubleVect& rightPart) const
+{
+    DoubleVect conductances = getConductances(elementValues);                           // проводимости ветвей
+
+    const SizeVect& offsets = this->rightPart.getRowOffsets();                          // сохраняем массивы матрицы в отдельные переменные для краткости
+    const SizeVect& columns = this->rightPart.getColumns();                             //
+    const SizeVect& rightIndices = this->rightPart.getValueIndices();                   //
+    const IntVect& rightSigns = this->rightPart.getSigns();                             //
+
+    rightPart.assign(size(), 0.0);
+
+    for (size_t i = 0; i < size(); i++)                                                 // правая часть - сумма коэффициентов, умноженных на значения источников
+    {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            double coefficient = rightIndices[k] == SparseMatrix::UNIT ? 1.0 : conductances[rightIndices[k]];
+            rightPart[i] += rightSigns[k] * coefficient * sourceValues[columns[k]];
+        }
+    }
+}
+
+// метод получения значений источников схемы по столбцам правой части
+// (сначала источники тока, затем источники напряжения - в порядке списка элементов)
+// принимает на вход: список элементов схемы
+inline DoubleVect MnaEquations::getSourceValues(const Elements& elements) const
+{
+    return getSourceValues(elements.getValues());
+}
+
+// метод получения значений источников по столбцам правой части (перегрузка)
+// принимает на вход: значения элементов схемы подряд (см. Elements::getValues)
+inline DoubleVect MnaEquations::getSourceValues(const DoubleVect& elementValues) const
+{
+    DoubleVect sourceValues(sourceElements.size());
+
+    for (size_t j = 0; j < sourceElements.size(); j++)
+    {
+        sourceValues[j] = elementValues[sourceElements[j]];
+    }
+
+    return sourceValues;
+}
+
+// метод вычисления токов ветвей по решению системы
+// возвращает вектор токов всех ветвей в порядке списка ветвей (как Circuit::solve)
+// принимает на вход:
+// 1) решение системы (потенциалы небазисных узлов, затем дополнительные токи)
+// 2) список элементов схемы
+inline DoubleVect MnaEquations::getBranchCurrents(const DoubleVect& solution,
+                                                  const Elements& elements) const
+{
+    return getBranchCurrents(solution, elements, getSourceValues(elements));
+}
+
+// метод вычисления токов ветвей по решению системы при заданных значениях источников
+// (ток ветви линейно зависит от решения и значений источников)
+// принимает на вход:
+// 1) решение системы (потенциалы небазисных узлов, затем дополнительные токи)
+// 2) список элементов схемы (для проводимостей ветвей)
+// 3) значения источников по столбцам правой части (см. getSourceValues)
+inline DoubleVect MnaEquations::getBranchCurrents(const DoubleVect& solution, const Elements& elements,
+                                                  const DoubleVect& sourceValues) const
+{
+    return getBranchCurrents(solution, elements.getValues(), sourceValues);
+}
+
+// метод вычисления токов ветвей по массиву значений элементов (перегрузка)
+// принимает на вход:
+// 1) решение системы (потенциалы небазисных узлов, затем дополнительные токи)
+// 2) значения элементов схемы подряд (для проводимостей ветвей)
+// 3) значения источников по столбцам правой части (см. getSourceValues)
+inline DoubleVect MnaEquations::getBranchCurrents(const DoubleVect& solution, const DoubleVect& elementValues,
+                                                  const DoubleVect& sourceValues) const
+{
+    DoubleVect conductances = getConductances(elementValues);
+    DoubleVect currents(branchFrom.size(), 0.0);
+
+    for (size_t i = 0; i < branchFrom.size(); i++)                                      // перебираем ветви
+    {
+        if (i >= unknownCurrentCount)                                                   // ток ветви с источником тока равен его значению
+        {
+            currents[i] = sourceValues[sourceIndices[sources[sourceStarts[i]]]];
+        }
+        else if (extraIndices[i] != NONE)                                               // ток ветви без сопротивлений найден как неизвестное
+        {
+            currents[i] = solution[nodeEquationCount + extraIndices[i]];
+        }
+        else                                                                            // иначе I = G * (Vнач - Vкон + E)
+        {
+            double voltage = getPotential(solution, branchFrom[i]) - getPotential(solution, branchTo[i]);
+
+            for (size_t k = sourceStarts[i]; k < sourceEnds[i]; k++)
+            {
+                voltage += sourceSigns[k] * sourceValues[sourceIndices[sources[k]]];
+            }
+
+            currents[i] = conductances[i] * voltage;
+        }
+    }
+
+    return currents;
+}
+
+// метод вычисления производных тока ветви (см. getBranchCurrents) по решению системы
+// и по значениям элементов при неизменном решении: для I = G * (Vнач - Vкон + E)
+// dI/dVнач = G, dI/dVкон = -G, dI/dE = G * знак, dI/dR = -G^2 * (Vнач - Vкон + E)
+// для каждого сопротивления ветви (G = 1 / сумма сопротивлений)
+// принимает на вход:
+// 1) номер ветви
+// 2) решение системы
+// 3) значения элементов схемы подряд
+// 4) вектор для производных по решению (размер приводится к количеству неизвестных)
+// 5) вектор для производных по значениям элементов (размер - количество элементов)
+inline void MnaEquations::getCurrentGradient(size_t branch, const DoubleVect& solution,
+                                             const DoubleVect& elementValues, DoubleVect& bySolution,
+                                             DoubleVect& byElements) const
+{
+    bySolution.assign(size(), 0.0);
+    byElements.assign(byElements.size(), 0.0);
+
+    if (branch >= unknownCurrentCount)                                                  // ток ветви с источником тока равен его значению
+    {
+        byElements[sources[sourceStarts[branch]]] = 1.0;
+        return;
+    }
+
+    if (extraIndices[branch] != NONE)                                                   // ток ветви без сопротивлений найден как неизвестное
+    {
+        bySolution[nodeEquationCount + extraIndices[branch]] = 1.0;
+        return;
+    }
+
+    double resistance = 0.0;
+
+    for (size_t k = resistorStarts[branch]; k < resistorEnds[branch]; k++)
+    {
+        resistance += elementValues[resistors[k]];
+    }
+
+    double conductance = 1.0 / resistance;
+    double voltage = getPotential(solution, branchFrom[branch]) - getPotential(solution, branchTo[branch]);
+
+    for (size_t k = sourceStarts[branch]; k < sourceEnds[branch]; k++)
+    {
+        voltage += sourceSigns[k] * elementValues[sources[k]];
+        byElements[sources[k]] += sourceSigns[k] * conductance;
+    }
+
+    for (size_t k = resistorStarts[branch]; k < resistorEnds[branch]; k++)
+    {
+        byElements[resistors[k]] -= conductance * conductance * voltage;
+    }
+
+    if (branchFrom[branch] < nodeEquationCount)                                         // потенциал базисного узла от решения не зависит
+    {
+        bySolution[branchFrom[branch]] += conductance;
+    }
+
+    if (branchTo[branch] < nodeEquationCount)
+    {
+        bySolution[branchTo[branch]] -= conductance;
+    }
+}
+
+// метод добавления производной невязки системы по значению элемента:
+// d(right - left * x) / dp при неизменном решении x; сопротивление входит в систему
+// через проводимость своей ветви (dG/dR = -G^2), источник - через свой столбец правой
+// части
+// принимает на вход:
+// 1) номер элемента
+// 2) значения элементов схемы подряд
+// 3) решение системы
+// 4) вектор, к которому добавляется производная (по строкам системы)
+inline void MnaEquations::addElementResidual(size_t element, const DoubleVect& elementValues,
+                                             const DoubleVect& solution, DoubleVect& residual) const
+{
+    DoubleVect conductances = getConductances(elementValues);
+    DoubleVect sourceValues = getSourceValues(elementValues);
+
+    size_t branch = NONE;                                                               // ветвь сопротивления (или NONE для источника)
+
+    for (size_t i = 0; i < unknownCurrentCount && branch == NONE; i++)
+    {
+        for (size_t k = resistorStarts[i]; k < resistorEnds[i]; k++)
+        {
+            if (resistors[k] == element)
+            {
+                branch = i;
+            }
+        }
+    }
+
+    double derivative = branch == NONE ? 0.0 : -conductances[branch] * conductances[branch];
+    size_t column = NONE;                                                               // столбец источника в правой части
+
+    if (!sourceElements.empty() && sourceElements[sourceIndices[element]] == element)   // у сопротивлений номер столбца не используется
+    {
+        column = sourceIndices[element];
+    }
+
+    const SizeVect& leftOffsets = leftPart.getRowOffsets();
+    const SizeVect& leftColumns = leftPart.getColumns();
+    const SizeVect& leftIndices = leftPart.getValueIndices();
+    const IntVect& leftSigns = leftPart.getSigns();
+    const SizeVect& rightOffsets = rightPart.getRowOffsets();
+    const SizeVect& rightColumns = rightPart.getColumns();
+    const SizeVect& rightIndices = rightPart.getValueIndices();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        for (size_t k = leftOffsets[i]; k < leftOffsets[i + 1]; k++)                    // проводимость ветви в левой части
+        {
+            if (leftIndices[k] == branch && branch != NONE)
+            {
+                residual[i] -= leftSigns[k] * derivative * solution[leftColumns[k]];
+            }
+        }
+
+        for (size_t k = rightOffsets[i]; k < rightOffsets[i + 1]; k++)
+        {
+            if (branch != NONE && rightIndices[k] == branch)                            // проводимость ветви в правой части
+            {
+                residual[i] += rightSigns[k] * derivative * sourceValues[rightColumns[k]];
+            }
+            else if (rightColumns[k] == column)                                         // вхождение источника
+            {
+                double coefficient = rightIndices[k] == SparseMatrix::UNIT ? 1.0 : conductances[rightIndices[k]];
+                residual[i] += rightSigns[k] * coefficient;
+            }
+        }
+    }
+}
+
+// метод добавления производных по значениям всех элементов для сопряженного решения:
+// для каждого элемента p к derivatives[p] добавляется adjoint^T * d(right - left * x) / dp;
+// за один проход по коэффициентам накапливаются производные по проводимостям ветвей,
+// которые затем переводятся в производные по сопротивлениям (dG/dR = -G^2)
+// принимает на вход:
+// 1) решение сопряженной системы left^T * adjoint = c
+// 2) значения элементов схемы подряд
+// 3) решение системы
+// 4) вектор производных по элементам (размер - количество элементов)
+inline void MnaEquations::addAdjointDerivatives(const DoubleVect& adjoint, const DoubleVect& elementValues,
+                                                const DoubleVect& solution,
+                                                DoubleVect& derivatives) const
+{
+    DoubleVect conductances = getConductances(elementValues);
+    DoubleVect sourceValues = getSourceValues(elementValues);
+    DoubleVect byConductances(branchFrom.size(), 0.0);                                  // производные по проводимостям ветвей
+
+    const SizeVect& leftOffsets = leftPart.getRowOffsets();
+    const SizeVect& leftColumns = leftPart.getColumns();
+    const SizeVect& leftIndices = leftPart.getValueIndices();
+    const IntVect& leftSigns = leftPart.getSigns();
+    const SizeVect& rightOffsets = rightPart.getRowOffsets();
+    const SizeVect& rightColumns = rightPart.getColumns();
+    const SizeVect& rightIndices = rightPart.getValueIndices();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (adjoint[i] == 0.0)
+        {
+            continue;
+        }
+
+        for (size_t k = leftOffsets[i]; k < leftOffsets[i + 1]; k++)
+        {
+            if (leftIndices[k] != SparseMatrix::UNIT)
+            {
+                byConductances[leftIndices[k]] -= adjoint[i] * leftSigns[k] * solution[leftColumns[k]];
+            }
+        }
+
+        for (size_t k = rightOffsets[i]; k < rightOffsets[i + 1]; k++)
+        {
+            double coefficient = 1.0;
+
+            if (rightIndices[k] != SparseMatrix::UNIT)
+            {
+                coefficient = conductances[rightIndices[k]];
+                byConductances[rightIndices[k]] += adjoint[i] * rightSigns[k] * sourceValues[rightColumns[k]];
+            }
+
+            derivatives[sourceElements[rightColumns[k]]] += adjoint[i] * rightSigns[k] * coefficient;
+        }
+    }
+
+    for (size_t i = 0; i < unknownCurrentCount; i++)                                    // переводим в производные по сопротивлениям ветвей
+    {
+        for (size_t k = resistorStarts[i]; k < resistorEnds[i]; k++)
+        {
+            derivatives[resistors[k]] -= byConductances[i] * conductances[i] * conductances[i];
+        }
+    }
+}
+
+// метод получения изменения системы при новом значении элемента: сопротивление
+// меняет проводимость своей ветви G на G', а ток ветви G * (Vнач - Vкон + E) входит
+// в уравнения узлов ее концов, поэтому изменение - (G' - G) * w * (w^T * x + E), где
+// w - столбец +1 (начало) и -1 (конец); источник меняет только правую часть
+// нулевое сопротивление ветви дает бесконечную проводимость (закорачивание),
+// бесконечное - нулевую (обрыв)
+// принимает на вход:
+// 1) номер элемента
+// 2) текущие значения элементов
+// 3) новое значение элемента
+// 4) структура для изменения системы (см. RankOneUpdate)
+inline void MnaEquations::getRankOneUpdate(size_t element, const DoubleVect& elementValues,
+                                           double value, RankOneUpdate& update) const
+{
+    update = RankOneUpdate();
+    DoubleVect conductances = getConductances(elementValues);
+
+    for (size_t i = 0; i < unknownCurrentCount; i++)                                    // ищем ветвь сопротивления
+    {
+        for (size_t k = resistorStarts[i]; k < resistorEnds[i]; k++)
+        {
+            if (resistors[k] == element)
+            {
+                update.branch = i;
+            }
+        }
+    }
+
+    if (update.branch != RankOneUpdate::NONE)
+    {
+        size_t branch = update.branch;
+        double resistance = value;                                                      // сумма сопротивлений ветви с новым значением
+
+        for (size_t k = resistorStarts[branch]; k < resistorEnds[branch]; k++)
+        {
+            resistance += resistors[k] == element ? 0.0 : elementValues[resistors[k]];
+        }
+
+        update.scale = 1.0 / resistance - conductances[branch];                         // 1 / 0 и 1 / inf дают предельные проводимости
+
+        for (size_t k = sourceStarts[branch]; k < sourceEnds[branch]; k++)
+        {
+            update.offset += sourceSigns[k] * elementValues[sources[k]];
+        }
+
+        if (branchFrom[branch] != branchTo[branch])                                     // ветвь, замкнутая на узел, в уравнения не входит
+        {
+            update.column.assign(size(), 0.0);
+            addUpdateWeight(update, branchFrom[branch], 1.0);
+            addUpdateWeight(update, branchTo[branch], -1.0);
+        }
+
+        return;
+    }
+
+    if (sourceElements.empty() || sourceElements[sourceIndices[element]] != element)    // сопротивление ветви с источником тока на токи не влияет
+    {
+        return;
+    }
+
+    double change = value - elementValues[element];
+
+    const SizeVect& offsets = rightPart.getRowOffsets();
+    const SizeVect& columns = rightPart.getColumns();
+    const SizeVect& rightIndices = rightPart.getValueIndices();
+    const IntVect& rightSigns = rightPart.getSigns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            if (columns[k] == sourceIndices[element])
+            {
+                double coefficient = rightIndices[k] == SparseMatrix::UNIT ? 1.0 : conductances[rightIndices[k]];
+
+                update.rightChange.resize(size(), 0.0);
+                update.rightChange[i] += rightSigns[k] * coefficient * change;
+            }
+        }
+    }
+}
+
+// геттер количества уравнений (узловых и для ветвей без сопротивлений)
+inline size_t MnaEquations::size() const
+{
+    return leftPart.rows();
+}
+
+// геттер количества уравнений по I закону Кирхгофа
+inline size_t MnaEquations::getNodeEquationCount() const
+{
+    return nodeEquationCount;
+}
+
+// геттер количества ветвей (длины вектора токов, см. getBranchCurrents)
+inline size_t MnaEquations::getBranchCount() const
+{
+    return branchFrom.size();
+}
+
+// метод вывода системы в поток при текущих значениях элементов
+// принимает на вход:
+// 1) поток вывода
+// 2) список элементов, по которому построена система
+inline std::ostream& MnaEquations::print(std::ostream& os, const Elements& elements) const
+{
+    auto precision = os.precision();
+    using namespace std;
+
+    os << "Система узловых уравнений:\n\n" << setw(9) << ' ';
+
+    os << std::left << fixed << setprecision(precision);
+
+    for (size_t i = 0; i < leftPart.columns(); i++)
+    {
+        os << (i < nodeEquationCount ? "V" : "I")
+           << setw(precision + 9) << (i < nodeEquationCount ? i : i - nodeEquationCount) << ' ';
+    }
+    os << setw(precision + 10) << ' ' << "B" << "\n\n";
+
+    DoubleVect leftValues, rightValues;
+    evaluate(elements, leftValues, rightValues);
+
+    const SizeVect& offsets = leftPart.getRowOffsets();
+    const SizeVect& columns = leftPart.getColumns();
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        DoubleVect row(leftPart.columns(), 0.0);
+
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            row[columns[k]] += leftValues[k];
+        }
+
+        os << setw(4) << i << ":    ";
+
+        for (size_t j = 0; j < row.size(); j++)
+        {
+            os << setw(precision + 10) << row[j] << ' ';
+        }
+
+        os << setw(precision + 10) << ' ' << setw(precision + 10) << rightValues[i] << "\n\n";
+    }
+
+    os << std::right;
+    os.unsetf(ios_base::floatfield);
+
+    return os;
+}
+
+// метод сбора сведений о ветвях: направления токов (по матрице инцидентности),
+// сопротивления и источники каждой ветви, ветви, инцидентные узлам
+inline void MnaEquations::updateBranches(const Branches& branches, const IncMatrix& matrix,
+                                         const Elements& elements)
+{
+    branchFrom = SizeVect(branches.size(), NONE);
+    branchTo = SizeVect(branches.size(), NONE);
+    extraIndices = SizeVect(branches.size(), NONE);
+    resistorStarts = SizeVect(branches.size(), 0);
+    resistorEnds = SizeVect(branches.size(), 0);
+    resistors.clear();
+    sourceStarts = SizeVect(branches.size(), 0);
+    sourceEnds = SizeVect(branches.size(), 0);
+    sources.clear();
+    sourceSigns.clear();
+    nodeBranches = SizeMatr(nodeEquationCount + 1);
+
+    for (size_t i = 0; i < branches.size(); i++)                                        // перебираем ветви
+    {
+        updateBranch(i, branches, matrix, elements);
+
+        if (branchTo[i] != branchFrom[i])                                               // ветвь, замкнутая на один узел, в уравнения узлов не входит
+        {
+            nodeBranches[branchFrom[i]].push_back(i);
+            nodeBranches[branchTo[i]].push_back(i);
+        }
+    }
+}
+
+// метод сбора сведений об одной ветви: направление тока, сопротивления и источники
+// (дописываются в конец массивов resistors и sources)
+// принимает на вход:
+// 1) номер ветви
+// 2) список ветвей
+// 3) матрицу инцидентности
+// 4) список элементов схемы
+inline void MnaEquations::updateBranch(size_t branch, const Branches& branches,
+                                       const IncMatrix& matrix, const Elements& elements)
+{
+    branchFrom[branch] = matrix.getFrom(branch);                                        // узлы начала и конца ветви
+    branchTo[branch] = matrix.getTo(branch);                                            //
+    resistorStarts[branch] = resistors.size();
+    sourceStarts[branch] = sources.size();
+
+    for (size_t k = 0; k < branches[branch].size(); k += 2)                             // перебираем ветвь по элементам
+    {
+        size_t elemIndex = branches[branch][k] / 2;
+
+        switch (elements[elemIndex].getType())
+        {
+        case Element::Type::R:                                                          // сопротивления ветви суммируются
+            resistors.push_back(elemIndex);
+            break;
+        case Element::Type::E:                                                          // источник напряжения: знак по направлению ветви (как в Equations)
+            if (branch < matrix.getUnknownCurrentCount())                               // в ветви с источником тока напряжение на ток не влияет
+            {
+                sources.push_back(elemIndex);
+                sourceSigns.push_back(branches[branch][k] % 2 ? -1 : 1);
+            }
+            break;
+        case Element::Type::J:                                                          // источник тока задает ток ветви, направленной по его полярности
+            sources.push_back(elemIndex);
+            sourceSigns.push_back(1);
+        }
+    }
+
+    resistorEnds[branch] = resistors.size();
+    sourceEnds[branch] = sources.size();
+}
+
+// метод построения списка ветвей узла (по возрастанию номеров, без ветвей,
+// замкнутых на узел) по списку матрицы инцидентности
+// принимает на вход:
+// 1) номер узла
+// 2) матрицу инцидентности
+inline void MnaEquations::updateNodeBranches(size_t node, const IncMatrix& matrix)
+{
+    nodeBranches[node].clear();
+
+    for (size_t branch : matrix.getNodeBranches(node))
+    {
+        if (branchFrom[branch] != branchTo[branch])
+        {
+            nodeBranches[node].push_back(branch);
+        }
+    }
+}
+
+// метод удаления из массивов сопротивлений и источников прежних участков ветвей,
+// пересчитанных при patch: участки переписываются подряд в порядке номеров ветвей
+// (за линейное время, но только когда прежние участки занимают больше половины
+// массивов)
+inline void MnaEquations::compactBranchElements()
+{
+    SizeVect compactedResistors;
+    SizeVect compactedSources;
+    IntVect compactedSigns;
+
+    for (size_t i = 0; i < branchFrom.size(); i++)
+    {
+        size_t resistorStart = compactedResistors.size();
+        size_t sourceStart = compactedSources.size();
+
+        compactedResistors.insert(compactedResistors.end(), resistors.begin() + resistorStarts[i],
+                                  resistors.begin() + resistorEnds[i]);
+        compactedSources.insert(compactedSources.end(), sources.begin() + sourceStarts[i],
+                                sources.begin() + sourceEnds[i]);
+        compactedSigns.insert(compactedSigns.end(), sourceSigns.begin() + sourceStarts[i],
+                              sourceSigns.begin() + sourceEnds[i]);
+        resistorStarts[i] = resistorStart;
+        resistorEnds[i] = compactedResistors.size();
+        sourceStarts[i] = sourceStart;
+        sourceEnds[i] = compactedSources.size();
+    }
+
+    resistors.swap(compactedResistors);
+    sources.swap(compactedSources);
+    sourceSigns.swap(compactedSigns);
+}
+
+// метод нумерации источников в правой части системы уравнений:
+// сначала по порядку следования в списке элементов идут источники тока,
+// затем - источники напряжения; для сопротивлений номер не используется
+inline void MnaEquations::updateSourceIndices(const Elements& elements)
+{
+    sourceIndices = SizeVect(elements.size(), 0);
+    sourceElements = SizeVect(elements.getCurrentSourceCount() + elements.getVoltageSourceCount(), 0);
+    size_t currentSourceIndex = 0;
+    size_t voltageSourceIndex = elements.getCurrentSourceCount();
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        switch (elements[i].getType())
+        {
+        case Element::Type::J:
+            sourceElements[currentSourceIndex] = i;
+            sourceIndices[i] = currentSourceIndex++;
+            break;
+        case Element::Type::E:
+            sourceElements[voltageSourceIndex] = i;
+            sourceIndices[i] = voltageSourceIndex++;
+            break;
+        case Element::Type::R:
+            break;
+        }
+    }
+}
+
+// метод проверки, что набор источников не изменился с последнего построения системы
+// (см. Equations::hasSameSources); время - по количеству источников
+// принимает на вход: список элементов схемы
+inline bool MnaEquations::hasSameSources(const Elements& elements) const
+{
+    size_t currentSourceCount = elements.getCurrentSourceCount();
+
+    if (currentSourceCount + elements.getVoltageSourceCount() != sourceElements.size())
+    {
+        return false;
+    }
+
+    for (size_t j = 0; j < sourceElements.size(); j++)
+    {
+        Element::Type type = j < currentSourceCount ? Element::Type::J : Element::Type::E;
+
+        if (sourceElements[j] >= elements.size() || elements[sourceElements[j]].getType() != type)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// метод запоминания первого пина базисного (последнего) узла: по нему следующий
+// patch определяет, отсчитываются ли потенциалы от того же узла
+// принимает на вход: объект nodes
+inline void MnaEquations::updateBasisPin(const Nodes& nodes)
+{
+    basisPin = nodes.size() ? nodes[nodes.size() - 1][0] : NONE;
+}
+
+// метод добавления уравнения по I закону Кирхгофа для узла node:
+// сумма токов, вытекающих из узла, равна нулю; ток ветви с сопротивлением
+// I = G * (Vнач - Vкон + E) дает проводимости в левой части и G * E в правой,
+// ток ветви без сопротивлений - дополнительное неизвестное,
+// ток ветви с источником тока - значение источника в правой части
+// принимает на вход:
+// 1) номер узла
+// 2) левую и правую части, в которые добавляются строки
+inline void MnaEquations::addNodeEquation(size_t node, SparseMatrix& left, SparseMatrix& right) const
+{
+    for (size_t branch : nodeBranches[node])                                            // перебираем ветви, инцидентные узлу
+    {
+        int sign = branchFrom[branch] == node ? 1 : -1;                                 // ток вытекает из узла (+1) или втекает в него (-1)
+
+        if (branch >= unknownCurrentCount)                                              // ветвь с источником тока: известный ток переносится вправо
+        {
+            size_t index = sources[sourceStarts[branch]];
+            right.add(sourceIndices[index], -sign, SparseMatrix::UNIT);
+        }
+        else if (extraIndices[branch] != NONE)                                          // ветвь без сопротивлений: ток - дополнительное неизвестное
+        {
+            left.add(nodeEquationCount + extraIndices[branch], sign, SparseMatrix::UNIT);
+        }
+        else                                                                            // ветвь с сопротивлением: ток через потенциалы
+        {
+            addPotential(branchFrom[branch], sign, branch, left);
+            addPotential(branchTo[branch], -sign, branch, left);
+
+            for (size_t k = sourceStarts[branch]; k < sourceEnds[branch]; k++)          // источники напряжения ветви переносятся вправо
+            {
+                size_t index = sources[k];
+                right.add(sourceIndices[index], -sign * sourceSigns[k], branch);
+            }
+        }
+    }
+
+    left.finishRow();                                                                   // завершаем строки уравнения узла
+    right.finishRow();                                                                  //
+}
+
+// метод добавления уравнения Vнач - Vкон = -E для ветви без сопротивлений
+// принимает на вход:
+// 1) номер ветви в списке ветвей
+// 2) левую и правую части, в которые добавляются строки
+inline void MnaEquations::addBranchEquation(size_t branch, SparseMatrix& left,
+                                            SparseMatrix& right) const
+{
+    addPotential(branchFrom[branch], 1, SparseMatrix::UNIT, left);
+    addPotential(branchTo[branch], -1, SparseMatrix::UNIT, left);
+
+    for (size_t k = sourceStarts[branch]; k < sourceEnds[branch]; k++)
+    {
+        right.add(sourceIndices[sources[k]], -sourceSigns[k], SparseMatrix::UNIT);
+    }
+
+    left.finishRow();
+    right.finishRow();
+}
+
+// метод добавления в текущую строку коэффициента при потенциале узла
+// (потенциал базисного узла равен нулю - коэффициент не добавляется)
+// принимает на вход:
+// 1) номер узла
+// 2) знак коэффициента
+// 3) индекс значения (номер ветви или UNIT)
+// 4) левую часть, в которую добавляется коэффициент
+inline void MnaEquations::addPotential(size_t node, int sign, size_t valueIndex,
+                                       SparseMatrix& left) const
+{
+    if (node < nodeEquationCount)
+    {
+        left.add(node, sign, valueIndex);
+    }
+}
+
+// метод вычисления проводимостей ветвей (величин, обратных сумме сопротивлений)
+// принимает на вход: значения элементов схемы подряд
+inline DoubleVect MnaEquations::getConductances(const DoubleVect& elementValues) const
+{
+    DoubleVect conductances(branchFrom.size(), 0.0);
+
+    for (size_t i = 0; i < unknownCurrentCount; i++)
+    {
+        double resistance = 0.0;
+
+        for (size_t k = resistorStarts[i]; k < resistorEnds[i]; k++)
+        {
+            resistance += elementValues[resistors[k]];
+        }
+
+        conductances[i] = resistorStarts[i] == resistorEnds[i] ? 0.0 : 1.0 / resistance;
+    }
+
+    return conductances;
+}
+
+// метод получения потенциала узла из решения системы
+// принимает на вход:
+// 1) решение системы
+// 2) номер узла (потенциал базисного узла равен нулю)
+inline double MnaEquations::getPotential(const DoubleVect& solution, size_t node) const
+{
+    return node < nodeEquationCount ? solution[node] : 0.0;
+}
+
+// метод добавления потенциала узла в изменение системы ранга один (столбец и веса
+// совпадают - изменение симметрично; базисный узел не добавляется)
+// принимает на вход:
+// 1) изменение системы
+// 2) номер узла
+// 3) вес (+1 для начала ветви, -1 для конца)
+inline void MnaEquations::addUpdateWeight(RankOneUpdate& update, size_t node, double weight) const
+{
+    if (node < nodeEquationCount)
+    {
+        update.column[node] += weight;
+        update.rows.push_back(node);
+        update.weights.push_back(weight);
+    }
+}
+
+// метод записи структуры системы узловых уравнений в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void MnaEquations::save(BinaryWriter& writer) const
+{
+    leftPart.save(writer);
+    rightPart.save(writer);
+    writer.write(nodeEquationCount);
+    writer.write(unknownCurrentCount);
+    writer.write(sourceIndices);
+    writer.write(sourceElements);
+    writer.write(branchFrom);
+    writer.write(branchTo);
+    writer.write(extraIndices);
+    writer.write(extraBranches);
+    writer.write(resistorStarts);
+    writer.write(resistorEnds);
+    writer.write(resistors);
+    writer.write(sourceStarts);
+    writer.write(sourceEnds);
+    writer.write(sources);
+    writer.write(sourceSigns);
+    writer.write(nodeBranches);
+    writer.write(basisPin);
+}
+
+// метод чтения структуры системы узловых уравнений из двоичного
+// буфера, записанного методом save (плоские массивы сборки строятся по прочитанной
+// левой части)
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void MnaEquations::load(BinaryReader& reader)
+{
+    leftPart.load(reader);
+    rightPart.load(reader);
+    reader.read(nodeEquationCount);
+    reader.read(unknownCurrentCount);
+    reader.read(sourceIndices);
+    reader.read(sourceElements);
+    reader.read(branchFrom);
+    reader.read(branchTo);
+    reader.read(extraIndices);
+    reader.read(extraBranches);
+    reader.read(resistorStarts);
+    reader.read(resistorEnds);
+    reader.read(resistors);
+    reader.read(sourceStarts);
+    reader.read(sourceEnds);
+    reader.read(sources);
+    reader.read(sourceSigns);
+    reader.read(nodeBranches);
+    reader.read(basisPin);
+    leftAssembly.update(leftPart);
+    changedUnknowns.clear();
+    patternChanged = true;
+}
+
+} // namespace CS
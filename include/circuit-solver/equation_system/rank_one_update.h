@@ -0,0 +1,30 @@
+#pragma once
+
+#include "circuit-solver/common.h"
+
+namespace CS
+{
+// структура для представления изменения системы уравнений при изменении значения
+// одного элемента: система A * x = b переходит в
+// A * x + scale * column * (weights^T * x[rows] + offset) = b + rightChange,
+// т.е. левая часть меняется на матрицу ранга один scale * column * weights^T
+// (например, сопротивление входит в один столбец системы по законам Кирхгофа, а
+// проводимость ветви - в блок узлов ее концов в узловой системе)
+// scale может быть бесконечным (обрыв в системе по законам Кирхгофа, закорачивание в
+// узловой системе) - тогда решение находится как предел (см. Contingency)
+//////////////////////////////////////////////////////////////////////////////////////////
+struct RankOneUpdate
+{
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер ветви
+
+    double scale = 0.0;                                                                 // множитель изменения (изменение сопротивления или проводимости)
+    DoubleVect column;                                                                  // столбец изменения по строкам системы (пустой - левая часть не меняется)
+    SizeVect rows;                                                                      // номера неизвестных, входящих в изменение
+    DoubleVect weights;                                                                 // и их веса
+    double offset = 0.0;                                                                // постоянное слагаемое (напряжение источников ветви)
+    DoubleVect rightChange;                                                             // изменение правой части (пустой - не меняется)
+    size_t branch = NONE;                                                               // ветвь, ток которой равен проводимости, умноженной на
+                                                                                        // weights^T * x[rows] + offset (или NONE)
+};
+
+} // namespace CS
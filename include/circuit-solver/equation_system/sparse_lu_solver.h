@@ -0,0 +1,861 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/equation_system/sparse_matrix.h"
+#include "circuit-solver/equation_system/minimum_degree.h"
+
+namespace CS
+{
+// класс для решения разреженной системы линейных уравнений методом LU-разложения
+// (левостороннее разложение Гилберта-Пирлса с частичным выбором ведущего элемента)
+// работа разделена на этапы:
+// 1) analyze - символьный анализ: структура матрицы и упорядочение столбцов,
+//    уменьшающее заполнение; зависит только от расположения коэффициентов
+// 2) factorize - численное разложение с выбором ведущих строк
+// 3) refactorize - повторное численное разложение при тех же структуре L, U
+//    и перестановке строк (если значения коэффициентов изменились, а схема - нет)
+//    если коэффициенты переставлены или часть их исчезла, но новых позиций нет,
+//    анализ и структура разложения сохраняются: remap сопоставляет коэффициенты
+//    прежним позициям
+// 4) solve - прямой и обратный ход по готовому разложению (solveTransposed - для
+//    транспонированной матрицы)
+// значения коэффициентов передаются в порядке их хранения в SparseMatrix
+// (повторяющиеся позиции суммируются)
+// результат анализа (Symbolic) и структура L, U с выбором ведущих строк (Pivoting)
+// не изменяются после построения и хранятся через std::shared_ptr, поэтому копия
+// разложения разделяет их с оригиналом и копирует только численную часть (значения
+// L, U, диагональ и рабочий вектор); повторное разложение копии меняет только ее
+// значения, а полное разложение строит для копии собственную структуру
+//////////////////////////////////////////////////////////////////////////////////////////
+class SparseLUSolver
+{
+public:
+    enum class Ordering                                                                 // способ упорядочения столбцов
+    {
+        Natural,                                                                        // исходный порядок
+        Column,                                                                         // минимальная степень по графу A^T * A (аналог COLAMD)
+        Symmetric                                                                       // минимальная степень по графу A + A^T (аналог AMD), ведущий элемент
+                                                                                        // по возможности выбирается на диагонали
+    };
+
+    struct Report                                                                       // сведения о разложении
+    {
+        Ordering ordering = Ordering::Natural;                                          // способ упорядочения
+        size_t size = 0;                                                                // размер системы
+        size_t matrixNonZeros = 0;                                                      // количество ненулевых позиций матрицы
+        size_t lowerNonZeros = 0;                                                       // количество ненулевых позиций L (без единичной диагонали)
+        size_t upperNonZeros = 0;                                                       // количество ненулевых позиций U (с диагональю)
+        double flops = 0;                                                               // количество операций с плавающей точкой при разложении
+        size_t refactorizations = 0;                                                    // количество повторных разложений после анализа
+    };
+
+    void setOrdering(Ordering ordering);                                                // метод выбора способа упорядочения
+    Ordering getOrdering() const;                                                       // геттер способа упорядочения
+    void analyze(const SparseMatrix& matrix);                                           // метод символьного анализа
+    bool remap(const SparseMatrix& matrix);                                             // метод сопоставления коэффициентов измененной матрицы прежнему анализу
+    void factorize(const DoubleVect& values);                                           // метод численного разложения
+    void refactorize(const DoubleVect& values);                                         // метод повторного численного разложения
+    void solve(DoubleVect& rightPart) const;                                            // метод решения системы (правая часть заменяется решением)
+    void solveTransposed(DoubleVect& rightPart) const;                                  // метод решения транспонированной системы по тому же разложению
+    size_t size() const;                                                                // геттер размера системы
+    bool isAnalyzed() const;                                                            // геттер признака выполненного символьного анализа
+    bool isFactorized() const;                                                          // геттер признака наличия разложения
+    const Report& getReport() const;                                                    // геттер сведений о разложении
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер строки или шага
+    static constexpr double PIVOT_TOLERANCE = 1e-3;                                     // допустимое отношение диагонального элемента к максимальному
+    static constexpr double REFACTOR_TOLERANCE = 1e-10;                                 // отношение, при котором повторное разложение выполняется заново
+
+    struct Symbolic                                                                     // результат символьного анализа
+    {
+        Ordering ordering = Ordering::Natural;                                          // способ упорядочения
+        size_t dimension = 0;                                                           // размер системы
+        SizeVect columnOffsets;                                                         // структура матрицы по столбцам (CSC) без повторов
+        SizeVect rowIndices;                                                            //
+        SizeVect entrySlots;                                                            // номер позиции CSC для каждого коэффициента SparseMatrix
+        SizeVect columnOrder;                                                           // номера столбцов в порядке исключения
+        BoolVect denseRows;                                                             // плотные строки, не учтенные упорядочением по столбцам
+    };
+
+    struct Pivoting                                                                     // структура L, U и выбор ведущих строк полного разложения
+    {
+        SizeVect lowerOffsets;                                                          // столбцы L: номера исходных строк
+        SizeVect lowerRows;                                                             //
+        SizeVect upperOffsets;                                                          // столбцы U: номера шагов (в топологическом порядке)
+        SizeVect upperSteps;                                                            //
+        SizeVect pivotRows;                                                             // номер исходной строки, выбранной на каждом шаге
+        SizeVect rowSteps;                                                              // номер шага, на котором выбрана исходная строка
+    };
+
+    struct Traversal                                                                    // рабочие массивы обхода графа L при полном разложении
+    {
+        SizeVect rowMarks;                                                              // метки строк и шагов для обхода без повторов
+        SizeVect stepMarks;                                                             //
+        SizeVect stack;                                                                 // стек обхода в глубину и позиции в столбцах L
+        SizeVect positions;                                                             //
+        SizeVect topological;                                                           // достижимые шаги в топологическом порядке
+        SizeVect candidates;                                                            // строки-кандидаты в ведущие
+    };
+
+    Ordering ordering = Ordering::Column;                                               // способ упорядочения для следующего анализа
+    std::shared_ptr<const Symbolic> symbolic;                                           // символьный анализ (общий для копий)
+    std::shared_ptr<const Pivoting> pivoting;                                           // структура разложения (общая для копий)
+    bool factorized = false;                                                            // признак наличия разложения
+
+    DoubleVect matrixValues;                                                            // значения матрицы по позициям CSC
+    DoubleVect lowerValues;                                                             // множители L (по позициям Pivoting::lowerRows)
+    DoubleVect upperValues;                                                             // значения U (по позициям Pivoting::upperSteps)
+    DoubleVect diagonal;                                                                // диагональ U (ведущие элементы)
+    DoubleVect work;                                                                    // рабочий плотный вектор (по исходным строкам)
+
+    Report report;                                                                      // сведения о разложении
+
+    static void orderColumns(Symbolic& symbolic, const SizeVect& rowOffsets,
+                             const SizeVect& columns);                                  // метод вычисления упорядочения столбцов
+    void keepDenseRow(size_t row);                                                      // метод повторного упорядочения с учетом плотной строки
+    bool eliminateColumns();                                                            // метод исключения столбцов при численном разложении
+    void scatterValues(const DoubleVect& values);                                       // метод суммирования коэффициентов по позициям CSC
+    static void reach(const Symbolic& symbolic, const Pivoting& pivoting,
+                      Traversal& traversal, size_t column, size_t step);                // метод поиска шагов, влияющих на столбец
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод выбора способа упорядочения (действует со следующего символьного анализа)
+inline void SparseLUSolver::setOrdering(Ordering ordering)
+{
+    this->ordering = ordering;
+}
+
+// геттер способа упорядочения (выбранного для следующего символьного анализа)
+inline SparseLUSolver::Ordering SparseLUSolver::getOrdering() const
+{
+    return ordering;
+}
+
+// метод символьного анализа:
+// строит структуру матрицы по столбцам без повторов, сопоставляет ей коэффициенты
+// SparseMatrix и вычисляет упорядочение столбцов
+// принимает на вход: квадратную разреженную матрицу (используется только структура)
+inline void SparseLUSolver::analyze(const SparseMatrix& matrix)
+{
+    if (matrix.rows() != matrix.columns())                                              // разложение определено только для квадратной матрицы
+    {
+        throw std::runtime_error("Equation count " + std::to_string(matrix.rows()) +
+                                 " does not match unknown count " + std::to_string(matrix.columns()));
+    }
+
+    size_t dimension = matrix.rows();
+    symbolic.reset();
+    pivoting.reset();
+    factorized = false;
+
+    std::shared_ptr<Symbolic> result = std::make_shared<Symbolic>();                    // новый анализ не затрагивает копии разложения
+    result->ordering = ordering;
+    result->dimension = dimension;
+    SizeVect& columnOffsets = result->columnOffsets;                                    // сохраняем массивы анализа в отдельные переменные для краткости
+    SizeVect& rowIndices = result->rowIndices;                                          //
+    SizeVect& entrySlots = result->entrySlots;                                          //
+    result->denseRows = BoolVect(dimension, false);
+
+    const SizeVect& offsets = matrix.getRowOffsets();                                   // сохраняем массивы матрицы в отдельные переменные для краткости
+    const SizeVect& columns = matrix.getColumns();                                      //
+
+    SizeVect uniqueOffsets(1, 0);                                                       // структура по строкам без повторов
+    SizeVect uniqueColumns;                                                             //
+    SizeVect entryUnique(matrix.nonZeros());                                            // номер позиции без повторов для каждого коэффициента
+    SizeVect lastSlot(dimension, NONE);                                                 // последняя позиция столбца в текущей строке
+
+    for (size_t i = 0; i < dimension; i++)                                              // перебираем строки
+    {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            size_t column = columns[k];
+
+            if (lastSlot[column] == NONE || lastSlot[column] < uniqueOffsets[i])        // столбец в этой строке еще не встречался
+            {
+                lastSlot[column] = uniqueColumns.size();
+                uniqueColumns.push_back(column);
+            }
+
+            entryUnique[k] = lastSlot[column];
+        }
+
+        uniqueOffsets.push_back(uniqueColumns.size());
+    }
+
+    columnOffsets = SizeVect(dimension + 1, 0);                                         // транспонируем структуру: считаем позиции в столбцах
+    for (size_t column : uniqueColumns)
+    {
+        columnOffsets[column + 1]++;
+    }
+
+    for (size_t j = 0; j < dimension; j++)                                              // смещения начала столбцов
+    {
+        columnOffsets[j + 1] += columnOffsets[j];
+    }
+
+    rowIndices = SizeVect(uniqueColumns.size());                                        // раскладываем позиции по столбцам
+    SizeVect uniqueSlots(uniqueColumns.size());                                         //
+    SizeVect next(columnOffsets.begin(), columnOffsets.end() - 1);
+
+    for (size_t i = 0; i < dimension; i++)
+    {
+        for (size_t k = uniqueOffsets[i]; k < uniqueOffsets[i + 1]; k++)
+        {
+            size_t slot = next[uniqueColumns[k]]++;
+            rowIndices[slot] = i;
+            uniqueSlots[k] = slot;
+        }
+    }
+
+    entrySlots = SizeVect(matrix.nonZeros());                                           // позиция CSC каждого коэффициента
+    for (size_t k = 0; k < entrySlots.size(); k++)
+    {
+        entrySlots[k] = uniqueSlots[entryUnique[k]];
+    }
+
+    if (ordering == Ordering::Column)                                                   // плотные строки упорядочение по столбцам не учитывает
+    {                                                                                   // (как COLAMD), а разложение выбирает их ведущими последними
+        for (size_t i = 0; i < dimension; i++)
+        {
+            result->denseRows[i] = uniqueOffsets[i + 1] - uniqueOffsets[i] > MinimumDegree::denseThreshold(dimension);
+        }
+    }
+
+    orderColumns(*result, uniqueOffsets, uniqueColumns);                                // вычисляем упорядочение столбцов
+
+    report = Report();                                                                  // сведения о разложении заполняются по мере выполнения этапов
+    report.ordering = ordering;
+    report.size = dimension;
+    report.matrixNonZeros = rowIndices.size();
+
+    symbolic = std::move(result);
+}
+
+// метод сопоставления коэффициентов матрицы позициям прежнего символьного анализа:
+// подходит матрица того же размера, все позиции которой были в проанализированной
+// (отсутствующие позиции считаются нулевыми), поэтому упорядочение, структура L, U
+// и выбор ведущих строк сохраняются, и следующим может быть refactorize
+// время - поиск позиции каждого коэффициента в своем столбце (двоичный)
+// принимает на вход: разреженную матрицу (используется только структура)
+// возвращает false (анализ не меняется), если анализа нет, размер другой или
+// какой-то позиции в анализе нет
+inline bool SparseLUSolver::remap(const SparseMatrix& matrix)
+{
+    if (!symbolic || matrix.rows() != symbolic->dimension || matrix.columns() != symbolic->dimension)
+    {
+        return false;
+    }
+
+    const SizeVect& offsets = matrix.getRowOffsets();                                   // сохраняем массивы в отдельные переменные для краткости
+    const SizeVect& columns = matrix.getColumns();                                      //
+    const SizeVect& columnOffsets = symbolic->columnOffsets;                            //
+    const SizeVect& rowIndices = symbolic->rowIndices;                                  //
+    SizeVect entrySlots(matrix.nonZeros());
+
+    for (size_t i = 0; i < matrix.rows(); i++)
+    {
+        for (size_t k = offsets[i]; k < offsets[i + 1]; k++)
+        {
+            auto first = rowIndices.begin() + columnOffsets[columns[k]];                // строки столбца идут по возрастанию
+            auto last = rowIndices.begin() + columnOffsets[columns[k] + 1];
+            auto slot = std::lower_bound(first, last, i);
+
+            if (slot == last || *slot != i)                                             // новая позиция
+            {
+                return false;
+            }
+
+            entrySlots[k] = slot - rowIndices.begin();
+        }
+    }
+
+    std::shared_ptr<Symbolic> result = std::make_shared<Symbolic>(*symbolic);           // копии разложения сохраняют прежнее сопоставление
+    result->entrySlots = std::move(entrySlots);
+    symbolic = std::move(result);
+    return true;
+}
+
+// метод численного разложения с частичным выбором ведущего элемента (см. eliminateColumns)
+// принимает на вход: значения коэффициентов в порядке хранения в SparseMatrix
+// при вырожденной матрице выбрасывает исключение std::runtime_error
+inline void SparseLUSolver::factorize(const DoubleVect& values)
+{
+    scatterValues(values);
+    factorized = false;
+
+    while (!eliminateColumns())                                                         // упорядочение перестраивается не больше раза на плотную строку
+    {
+    }
+}
+
+// метод исключения столбцов при численном разложении:
+// для каждого столбца (в порядке columnOrder) решается треугольная система с уже
+// найденными столбцами L, затем среди оставшихся строк выбирается ведущая
+// плотные строки, не учтенные упорядочением по столбцам, становятся ведущими в
+// последнюю очередь: выбранная рано, такая строка заполнила бы все последующие
+// столбцы. если отложить плотную строку нельзя (значения остальных кандидатов
+// меньше допустимого), а до конца разложения остается больше denseThreshold шагов,
+// упорядочение перестраивается с учетом этой строки (см. keepDenseRow) и исключение
+// начинается заново; ближе к концу заполнение от плотной строки уже невелико
+// возвращает false, если упорядочение перестроено и разложение не выполнено
+// при вырожденной матрице выбрасывает исключение std::runtime_error
+inline bool SparseLUSolver::eliminateColumns()
+{
+    const size_t dimension = symbolic->dimension;                                       // сохраняем массивы анализа в отдельные переменные для краткости
+    const SizeVect& columnOffsets = symbolic->columnOffsets;                            //
+    const SizeVect& rowIndices = symbolic->rowIndices;                                  //
+    const SizeVect& columnOrder = symbolic->columnOrder;                                //
+
+    std::shared_ptr<Pivoting> result = std::make_shared<Pivoting>();                    // новая структура (прежнюю могут использовать копии)
+    SizeVect& lowerOffsets = result->lowerOffsets;                                      //
+    SizeVect& lowerRows = result->lowerRows;                                            //
+    SizeVect& upperOffsets = result->upperOffsets;                                      //
+    SizeVect& upperSteps = result->upperSteps;                                          //
+    SizeVect& pivotRows = result->pivotRows;                                            //
+    SizeVect& rowSteps = result->rowSteps;                                              //
+
+    lowerOffsets.assign(1, 0);                                                          // очищаем разложение
+    lowerValues.clear();                                                                //
+    upperOffsets.assign(1, 0);                                                          //
+    upperValues.clear();                                                                //
+    diagonal = DoubleVect(dimension);                                                   //
+    pivotRows = SizeVect(dimension, NONE);                                              //
+    rowSteps = SizeVect(dimension, NONE);                                               //
+
+    work = DoubleVect(dimension, 0.0);                                                  // рабочие массивы
+    Traversal traversal;                                                                //
+    traversal.rowMarks = SizeVect(dimension, NONE);                                     //
+    traversal.stepMarks = SizeVect(dimension, NONE);                                    //
+    const SizeVect& topological = traversal.topological;                                //
+    const SizeVect& candidates = traversal.candidates;                                  //
+    const SizeVect& rowMarks = traversal.rowMarks;                                      //
+    report.flops = 0;
+
+    for (size_t k = 0; k < dimension; k++)                                              // перебираем шаги разложения
+    {
+        size_t column = columnOrder[k];                                                 // исходный столбец k-го шага
+
+        reach(*symbolic, *result, traversal, column, k);                                // находим влияющие шаги и строки-кандидаты
+
+        for (size_t p = columnOffsets[column]; p < columnOffsets[column + 1]; p++)      // переносим столбец матрицы в рабочий вектор
+        {
+            work[rowIndices[p]] = matrixValues[p];
+        }
+
+        for (size_t step : topological)                                                 // решаем треугольную систему с L в топологическом порядке
+        {
+            double value = work[pivotRows[step]];
+
+            for (size_t p = lowerOffsets[step]; p < lowerOffsets[step + 1]; p++)
+            {
+                work[lowerRows[p]] -= lowerValues[p] * value;
+            }
+
+            report.flops += 2.0 * (lowerOffsets[step + 1] - lowerOffsets[step]);
+        }
+
+        for (size_t step : topological)                                                 // переносим найденные значения в столбец U
+        {
+            upperSteps.push_back(step);
+            upperValues.push_back(work[pivotRows[step]]);
+            work[pivotRows[step]] = 0.0;
+        }
+
+        upperOffsets.push_back(upperSteps.size());
+
+        size_t pivotRow = NONE;                                                         // выбираем ведущую строку среди кандидатов
+        double maximum = 0.0;                                                           // по максимуму модуля
+        size_t sparseRow = NONE;                                                        // и лучшую среди неплотных строк
+        double sparseMaximum = 0.0;                                                     //
+
+        for (size_t row : candidates)
+        {
+            if (std::abs(work[row]) > maximum)
+            {
+                maximum = std::abs(work[row]);
+                pivotRow = row;
+            }
+
+            if (!symbolic->denseRows[row] && std::abs(work[row]) > sparseMaximum)
+            {
+                sparseMaximum = std::abs(work[row]);
+                sparseRow = row;
+            }
+        }
+
+        if (maximum == 0.0)                                                             // если все кандидаты нулевые - матрица вырождена
+        {
+            for (size_t row : candidates)
+            {
+                work[row] = 0.0;
+            }
+
+            throw std::runtime_error("Equation system is singular at column: " + std::to_string(column));
+        }
+
+        if (symbolic->denseRows[pivotRow] && sparseRow != NONE &&                       // плотную строку откладываем, если неплотная не намного меньше
+            sparseMaximum >= PIVOT_TOLERANCE * maximum)
+        {
+            pivotRow = sparseRow;
+        }
+        else if (symbolic->denseRows[pivotRow] &&                                       // иначе, если до конца разложения далеко, упорядочение
+                 dimension - k > MinimumDegree::denseThreshold(dimension))              // должно учитывать плотную строку
+        {
+            for (size_t row : candidates)
+            {
+                work[row] = 0.0;
+            }
+
+            keepDenseRow(pivotRow);
+            return false;
+        }
+
+        if (symbolic->ordering == Ordering::Symmetric && rowSteps[column] == NONE &&    // при симметричном упорядочении предпочитаем диагональ,
+            rowMarks[column] == k && std::abs(work[column]) >= PIVOT_TOLERANCE * maximum) // если она не намного меньше максимума
+        {
+            pivotRow = column;
+        }
+
+        double pivot = work[pivotRow];                                                  // ведущий элемент
+        diagonal[k] = pivot;
+        pivotRows[k] = pivotRow;
+        rowSteps[pivotRow] = k;
+        work[pivotRow] = 0.0;
+
+        for (size_t row : candidates)                                                   // остальные кандидаты образуют столбец L
+        {
+            if (row != pivotRow)
+            {
+                lowerRows.push_back(row);
+                lowerValues.push_back(work[row] / pivot);
+                work[row] = 0.0;
+            }
+        }
+
+        lowerOffsets.push_back(lowerRows.size());
+        report.flops += static_cast<double>(candidates.size() - 1);
+    }
+
+    report.lowerNonZeros = lowerRows.size();
+    report.upperNonZeros = upperSteps.size() + dimension;
+    pivoting = std::move(result);
+    factorized = true;
+    return true;
+}
+
+// метод повторного численного разложения:
+// структура L и U, а также выбор ведущих строк берутся из предыдущего разложения,
+// поэтому обход графа и выбор ведущих элементов не выполняются
+// если какой-либо ведущий элемент стал слишком мал, выполняется полное разложение
+// принимает на вход: значения коэффициентов в порядке хранения в SparseMatrix
+inline void SparseLUSolver::refactorize(const DoubleVect& values)
+{
+    if (!factorized)                                                                    // если разложения еще нет, повторять нечего
+    {
+        factorize(values);
+        return;
+    }
+
+    scatterValues(values);
+    report.refactorizations++;
+
+    const SizeVect& columnOffsets = symbolic->columnOffsets;                            // сохраняем массивы структуры в отдельные переменные для краткости
+    const SizeVect& rowIndices = symbolic->rowIndices;                                  //
+    const SizeVect& lowerOffsets = pivoting->lowerOffsets;                              //
+    const SizeVect& lowerRows = pivoting->lowerRows;                                    //
+    const SizeVect& upperOffsets = pivoting->upperOffsets;                              //
+    const SizeVect& upperSteps = pivoting->upperSteps;                                  //
+    const SizeVect& pivotRows = pivoting->pivotRows;                                    //
+
+    for (size_t k = 0; k < symbolic->dimension; k++)                                    // перебираем шаги разложения
+    {
+        size_t column = symbolic->columnOrder[k];
+
+        for (size_t p = columnOffsets[column]; p < columnOffsets[column + 1]; p++)      // переносим столбец матрицы в рабочий вектор
+        {
+            work[rowIndices[p]] = matrixValues[p];
+        }
+
+        for (size_t u = upperOffsets[k]; u < upperOffsets[k + 1]; u++)                  // решаем треугольную систему по сохраненной структуре U
+        {
+            size_t step = upperSteps[u];
+            double value = work[pivotRows[step]];
+
+            upperValues[u] = value;
+            work[pivotRows[step]] = 0.0;
+
+            for (size_t p = lowerOffsets[step]; p < lowerOffsets[step + 1]; p++)
+            {
+                work[lowerRows[p]] -= lowerValues[p] * value;
+            }
+        }
+
+        double pivot = work[pivotRows[k]];                                              // ведущий элемент на прежней строке
+        double maximum = std::abs(pivot);
+        work[pivotRows[k]] = 0.0;
+
+        for (size_t p = lowerOffsets[k]; p < lowerOffsets[k + 1]; p++)
+        {
+            maximum = std::max(maximum, std::abs(work[lowerRows[p]]));
+        }
+
+        if (pivot == 0.0 || std::abs(pivot) < REFACTOR_TOLERANCE * maximum)             // прежний выбор строки стал неустойчивым
+        {
+            for (size_t p = lowerOffsets[k]; p < lowerOffsets[k + 1]; p++)              // очищаем рабочий вектор и раскладываем заново
+            {
+                work[lowerRows[p]] = 0.0;
+            }
+
+            factorize(values);
+            return;
+        }
+
+        diagonal[k] = pivot;
+
+        for (size_t p = lowerOffsets[k]; p < lowerOffsets[k + 1]; p++)
+        {
+            lowerValues[p] = work[lowerRows[p]] / pivot;
+            work[lowerRows[p]] = 0.0;
+        }
+    }
+}
+
+// метод решения системы по готовому разложению
+// принимает на вход: правую часть системы, которая заменяется найденным решением
+inline void SparseLUSolver::solve(DoubleVect& rightPart) const
+{
+    if (!factorized || rightPart.size() != symbolic->dimension)                         // если разложения нет или размер правой части не совпадает
+    {
+        throw std::logic_error("Right part does not match factorized matrix");
+    }
+
+    const size_t dimension = symbolic->dimension;                                       // сохраняем массивы структуры в отдельные переменные для краткости
+    const SizeVect& columnOrder = symbolic->columnOrder;                                //
+    const SizeVect& lowerOffsets = pivoting->lowerOffsets;                              //
+    const SizeVect& lowerRows = pivoting->lowerRows;                                    //
+    const SizeVect& upperOffsets = pivoting->upperOffsets;                              //
+    const SizeVect& upperSteps = pivoting->upperSteps;                                  //
+    const SizeVect& pivotRows = pivoting->pivotRows;                                    //
+    DoubleVect solution(dimension);                                                     // решение по шагам разложения
+
+    for (size_t k = 0; k < dimension; k++)                                              // прямой ход с L (по исходным номерам строк)
+    {
+        double value = rightPart[pivotRows[k]];
+        solution[k] = value;
+
+        if (value != 0.0)
+        {
+            for (size_t p = lowerOffsets[k]; p < lowerOffsets[k + 1]; p++)
+            {
+                rightPart[lowerRows[p]] -= lowerValues[p] * value;
+            }
+        }
+    }
+
+    for (size_t k = dimension; k-- > 0; )                                               // обратный ход с U (по столбцам)
+    {
+        double value = solution[k] /= diagonal[k];
+
+        if (value != 0.0)
+        {
+            for (size_t u = upperOffsets[k]; u < upperOffsets[k + 1]; u++)
+            {
+                solution[upperSteps[u]] -= upperValues[u] * value;
+            }
+        }
+    }
+
+    for (size_t k = 0; k < dimension; k++)                                              // возвращаем решение в исходном порядке неизвестных
+    {
+        rightPart[columnOrder[k]] = solution[k];
+    }
+}
+
+// метод решения транспонированной системы A^T * z = c по готовому разложению
+// (нужен для сопряженного анализа чувствительности: одно решение дает производные
+// одной величины по всем параметрам)
+// так как P * A * Q = L * U, то A^T = Q * U^T * L^T * P: сначала прямой ход с U^T
+// (строки U^T - это хранимые столбцы U), затем обратный ход с L^T (строки L^T -
+// хранимые столбцы L, номера исходных строк указывают на уже найденные неизвестные)
+// принимает на вход: правую часть (заменяется решением)
+// если разложения нет или размер правой части не совпадает, выбрасывает исключение
+// std::logic_error
+inline void SparseLUSolver::solveTransposed(DoubleVect& rightPart) const
+{
+    if (!factorized || rightPart.size() != symbolic->dimension)                         // если разложения нет или размер правой части не совпадает
+    {
+        throw std::logic_error("Right part does not match factorized matrix");
+    }
+
+    const size_t dimension = symbolic->dimension;                                       // сохраняем массивы структуры в отдельные переменные для краткости
+    const SizeVect& columnOrder = symbolic->columnOrder;                                //
+    const SizeVect& lowerOffsets = pivoting->lowerOffsets;                              //
+    const SizeVect& lowerRows = pivoting->lowerRows;                                    //
+    const SizeVect& upperOffsets = pivoting->upperOffsets;                              //
+    const SizeVect& upperSteps = pivoting->upperSteps;                                  //
+    const SizeVect& pivotRows = pivoting->pivotRows;                                    //
+    DoubleVect solution(dimension);                                                     // промежуточное решение по шагам разложения
+
+    for (size_t k = 0; k < dimension; k++)                                              // прямой ход с U^T (по столбцам U)
+    {
+        double value = rightPart[columnOrder[k]];
+
+        for (size_t u = upperOffsets[k]; u < upperOffsets[k + 1]; u++)
+        {
+            value -= upperValues[u] * solution[upperSteps[u]];
+        }
+
+        solution[k] = value / diagonal[k];
+    }
+
+    for (size_t k = dimension; k-- > 0; )                                               // обратный ход с L^T (решение - по исходным номерам строк)
+    {
+        double value = solution[k];
+
+        for (size_t p = lowerOffsets[k]; p < lowerOffsets[k + 1]; p++)                  // строки L ниже шага k уже найдены
+        {
+            value -= lowerValues[p] * rightPart[lowerRows[p]];
+        }
+
+        rightPart[pivotRows[k]] = value;
+    }
+}
+
+// геттер размера системы
+inline size_t SparseLUSolver::size() const
+{
+    return symbolic ? symbolic->dimension : 0;
+}
+
+// геттер признака выполненного символьного анализа
+inline bool SparseLUSolver::isAnalyzed() const
+{
+    return symbolic != nullptr;
+}
+
+// геттер признака наличия разложения
+inline bool SparseLUSolver::isFactorized() const
+{
+    return factorized;
+}
+
+// геттер сведений о разложении
+inline const SparseLUSolver::Report& SparseLUSolver::getReport() const
+{
+    return report;
+}
+
+// метод вычисления упорядочения столбцов выбранным в анализе способом
+// принимает на вход:
+// 1) символьный анализ (заполняется columnOrder)
+// 2) смещения начала строк матрицы (строк + 1)
+// 3) номера столбцов коэффициентов (без повторов в строке)
+inline void SparseLUSolver::orderColumns(Symbolic& symbolic, const SizeVect& rowOffsets,
+                                         const SizeVect& columns)
+{
+    MinimumDegree minimumDegree;
+
+    switch (symbolic.ordering)
+    {
+    case Ordering::Natural:
+        symbolic.columnOrder = SizeVect(symbolic.dimension);
+        for (size_t j = 0; j < symbolic.dimension; j++)
+        {
+            symbolic.columnOrder[j] = j;
+        }
+        break;
+    case Ordering::Column:
+        minimumDegree.updateColumns(rowOffsets, columns, symbolic.dimension, symbolic.denseRows);
+        symbolic.columnOrder = minimumDegree.get();
+        break;
+    case Ordering::Symmetric:
+        minimumDegree.updateSymmetric(rowOffsets, columns, symbolic.dimension);
+        symbolic.columnOrder = minimumDegree.get();
+        break;
+    }
+}
+
+// метод повторного упорядочения столбцов, в котором плотная строка учитывается как
+// обычная (нужен, когда разложению пришлось рано выбрать ее ведущей); строится
+// новый символьный анализ, поэтому копии разложения сохраняют прежний
+// принимает на вход: номер плотной строки
+inline void SparseLUSolver::keepDenseRow(size_t row)
+{
+    std::shared_ptr<Symbolic> result = std::make_shared<Symbolic>(*symbolic);
+    result->denseRows[row] = false;
+
+    const size_t dimension = result->dimension;                                         // восстанавливаем структуру по строкам из CSC
+    SizeVect rowOffsets(dimension + 1, 0);                                              //
+    SizeVect columns(result->rowIndices.size());                                        //
+
+    for (size_t i : result->rowIndices)
+    {
+        rowOffsets[i + 1]++;
+    }
+
+    for (size_t i = 0; i < dimension; i++)
+    {
+        rowOffsets[i + 1] += rowOffsets[i];
+    }
+
+    SizeVect next(rowOffsets.begin(), rowOffsets.end() - 1);
+
+    for (size_t j = 0; j < dimension; j++)
+    {
+        for (size_t p = result->columnOffsets[j]; p < result->columnOffsets[j + 1]; p++)
+        {
+            columns[next[result->rowIndices[p]]++] = j;
+        }
+    }
+
+    orderColumns(*result, rowOffsets, columns);
+    symbolic = std::move(result);
+}
+
+// метод суммирования значений коэффициентов по позициям структуры CSC
+// принимает на вход: значения коэффициентов в порядке хранения в SparseMatrix
+inline void SparseLUSolver::scatterValues(const DoubleVect& values)
+{
+    if (!symbolic)                                                                      // без символьного анализа позиции неизвестны
+    {
+        throw std::logic_error("Sparse matrix is not analyzed");
+    }
+
+    const SizeVect& entrySlots = symbolic->entrySlots;
+
+    if (values.size() != entrySlots.size())                                             // количество значений должно совпадать с количеством коэффициентов
+    {
+        throw std::invalid_argument("Value count does not match analyzed matrix");
+    }
+
+    matrixValues.assign(symbolic->rowIndices.size(), 0.0);
+
+    for (size_t k = 0; k < values.size(); k++)
+    {
+        matrixValues[entrySlots[k]] += values[k];
+    }
+}
+
+// метод поиска шагов разложения, влияющих на столбец (обход графа L в глубину),
+// и строк-кандидатов в ведущие для шага step
+// результат: topological - шаги в топологическом порядке, candidates - строки,
+// еще не выбранные ведущими, в которых у столбца после исключения будут ненулевые значения
+// принимает на вход:
+// 1) символьный анализ
+// 2) уже построенная часть структуры L
+// 3) рабочие массивы обхода (результат записывается в них же)
+// 4) номер исходного столбца
+// 5) номер текущего шага (используется как метка)
+inline void SparseLUSolver::reach(const Symbolic& symbolic, const Pivoting& pivoting,
+                                  Traversal& traversal, size_t column, size_t step)
+{
+    const SizeVect& columnOffsets = symbolic.columnOffsets;                             // сохраняем массивы в отдельные переменные для краткости
+    const SizeVect& rowIndices = symbolic.rowIndices;                                   //
+    const SizeVect& lowerOffsets = pivoting.lowerOffsets;                               //
+    const SizeVect& lowerRows = pivoting.lowerRows;                                     //
+    const SizeVect& rowSteps = pivoting.rowSteps;                                       //
+    SizeVect& rowMarks = traversal.rowMarks;                                            //
+    SizeVect& stepMarks = traversal.stepMarks;                                          //
+    SizeVect& stack = traversal.stack;                                                  //
+    SizeVect& positions = traversal.positions;                                          //
+    SizeVect& topological = traversal.topological;                                      //
+    SizeVect& candidates = traversal.candidates;                                        //
+
+    topological.clear();
+    candidates.clear();
+
+    for (size_t p = columnOffsets[column]; p < columnOffsets[column + 1]; p++)          // перебираем строки столбца матрицы
+    {
+        size_t row = rowIndices[p];
+
+        if (rowSteps[row] == NONE)                                                      // строка еще не ведущая - сразу кандидат
+        {
+            if (rowMarks[row] != step)
+            {
+                rowMarks[row] = step;
+                candidates.push_back(row);
+            }
+            continue;
+        }
+
+        size_t start = rowSteps[row];                                                   // строка ведущая - обходим граф L от ее шага
+
+        if (stepMarks[start] == step)
+        {
+            continue;
+        }
+
+        stack.clear();
+        positions.clear();
+        stack.push_back(start);
+        positions.push_back(lowerOffsets[start]);
+        stepMarks[start] = step;
+
+        while (!stack.empty())                                                          // обход в глубину без рекурсии
+        {
+            size_t current = stack.back();
+            size_t& position = positions.back();
+            bool descended = false;
+
+            while (position < lowerOffsets[current + 1])                                // перебираем строки столбца L текущего шага
+            {
+                size_t next = lowerRows[position++];
+
+                if (rowSteps[next] == NONE)                                             // не ведущая строка - кандидат
+                {
+                    if (rowMarks[next] != step)
+                    {
+                        rowMarks[next] = step;
+                        candidates.push_back(next);
+                    }
+                }
+                else if (stepMarks[rowSteps[next]] != step)                             // ведущая строка еще не посещенного шага - спускаемся
+                {
+                    stepMarks[rowSteps[next]] = step;
+                    stack.push_back(rowSteps[next]);
+                    positions.push_back(lowerOffsets[rowSteps[next]]);
+                    descended = true;
+                    break;
+                }
+            }
+
+            if (!descended)                                                             // все потомки обработаны - шаг завершен
+            {
+                topological.push_back(current);
+                stack.pop_back();
+                positions.pop_back();
+            }
+        }
+    }
+
+    std::reverse(topological.begin(), topological.end());                               // обратный порядок завершения - топологический
+}
+
+// перегрузка оператора вывода сведений о разложении в поток
+inline std::ostream& operator<<(std::ostream& os, const SparseLUSolver::Report& report)
+{
+    const char* orderings[] = { "исходное", "по столбцам (A^T * A)", "симметричное (A + A^T)" };
+    size_t factorNonZeros = report.lowerNonZeros + report.upperNonZeros;
+
+    os << "Разреженное LU-разложение:\n\n";
+    os << "Упорядочение:              " << orderings[static_cast<int>(report.ordering)] << "\n";
+    os << "Размер системы:            " << report.size << "\n";
+    os << "Ненулевых в матрице:       " << report.matrixNonZeros << "\n";
+    os << "Ненулевых в L:             " << report.lowerNonZeros << "\n";
+    os << "Ненулевых в U:             " << report.upperNonZeros << "\n";
+    os << "Заполнение:                "
+       << (factorNonZeros > report.matrixNonZeros ? factorNonZeros - report.matrixNonZeros : 0) << "\n";
+    os << "Операций при разложении:   " << report.flops << "\n\n";
+
+    return os;
+}
+
+} // namespace CS
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/elements.h"
+#include "circuit-solver/structure_units/serialization.h"
+
+namespace CS
+{
+// класс для представления разреженной матрицы коэффициентов системы уравнений
+// в сжатом построчном формате (CSR)
+// каждый ненулевой коэффициент хранится как тройка: номер столбца, знак (+-1)
+// и индекс значения в списке элементов схемы (значение UNIT - коэффициент равен
+// единице, например, в уравнениях по I закону Кирхгофа)
+// в одной строке номер столбца может повторяться (например, при нескольких
+// сопротивлениях в одной ветви) - такие коэффициенты суммируются при вычислении
+// значений матрицы
+// часть строк можно заменить, не строя матрицу заново (patch): остальные строки
+// переносятся блоками
+//////////////////////////////////////////////////////////////////////////////////////////
+class SparseMatrix
+{
+public:
+    static constexpr size_t UNIT = static_cast<size_t>(-1);                             // индекс значения для единичного коэффициента
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий номер прежней строки (см. patch)
+
+    void clear(size_t columnCount);                                                     // метод очистки матрицы с заданием количества столбцов
+    void add(size_t column, int sign, size_t valueIndex);                               // метод добавления коэффициента в текущую строку
+    void finishRow();                                                                   // метод завершения текущей строки
+    bool patch(size_t columnCount, const SizeVect& rowSources,
+               const SparseMatrix& replacement);                                        // метод замены части строк
+    size_t rows() const;                                                                // геттер количества строк
+    size_t columns() const;                                                             // геттер количества столбцов
+    size_t nonZeros() const;                                                            // геттер количества хранимых коэффициентов
+    const SizeVect& getRowOffsets() const;                                              // геттер смещений начала строк
+    const SizeVect& getColumns() const;                                                 // геттер номеров столбцов коэффициентов
+    const IntVect& getSigns() const;                                                    // геттер знаков коэффициентов
+    const SizeVect& getValueIndices() const;                                            // геттер индексов значений коэффициентов
+    double value(size_t entry, const Elements& elements) const;                         // метод вычисления значения коэффициента
+    double value(size_t entry, const DoubleVect& elementValues) const;                  // метод вычисления значения коэффициента (по массиву значений)
+    void evaluate(const Elements& elements, DoubleVect& values) const;                  // метод вычисления значений всех коэффициентов
+    void evaluate(const DoubleVect& elementValues, DoubleVect& values) const;           // метод вычисления значений всех коэффициентов (по массиву значений)
+    CoeffMatr toDense(const Elements& elements) const;                                  // метод построения плотной матрицы коэффициентов (для отладки)
+    void save(BinaryWriter& writer) const;                                              // метод записи в двоичный буфер (для кэша топологии)
+    void load(BinaryReader& reader);                                                    // метод чтения из двоичного буфера (для кэша топологии)
+
+private:
+    SizeVect rowOffsets = { 0 };                                                        // смещения начала строк в массивах коэффициентов (строк + 1)
+    SizeVect columnIndices;                                                             // номера столбцов коэффициентов
+    IntVect signs;                                                                      // знаки коэффициентов
+    SizeVect valueIndices;                                                              // индексы значений коэффициентов в списке элементов
+    size_t columnCount = 0;                                                             // количество столбцов
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод очистки матрицы
+// принимает на вход: количество столбцов новой матрицы
+inline void SparseMatrix::clear(size_t columnCount)
+{
+    rowOffsets.assign(1, 0);
+    columnIndices.clear();
+    signs.clear();
+    valueIndices.clear();
+    this->columnCount = columnCount;
+}
+
+// метод добавления коэффициента в текущую (еще не завершенную) строку
+// принимает на вход:
+// 1) номер столбца коэффициента
+// 2) знак коэффициента
+// 3) индекс значения в списке элементов схемы (UNIT - единичный коэффициент)
+inline void SparseMatrix::add(size_t column, int sign, size_t valueIndex)
+{
+    columnIndices.push_back(column);
+    signs.push_back(sign);
+    valueIndices.push_back(valueIndex);
+}
+
+// метод завершения текущей строки: все добавленные после этого коэффициенты
+// относятся к следующей строке
+inline void SparseMatrix::finishRow()
+{
+    rowOffsets.push_back(columnIndices.size());
+}
+
+// метод замены части строк матрицы: строка i новой матрицы - прежняя строка
+// rowSources[i] или (если rowSources[i] == NONE) очередная строка replacement
+// прежние строки переносятся блоками подряд идущих строк, поэтому время - копирование
+// коэффициентов без их разбора плюс построение замененных и перемещенных строк
+// возвращает true, если структура матрицы расширилась: изменилось количество строк
+// или столбцов либо в какой-то строке появился столбец, которого в строке с тем же
+// номером раньше не было (при false расположение коэффициентов - подмножество
+// прежнего, и символьный анализ разложения можно сохранить, см. SparseLUSolver::remap)
+// принимает на вход:
+// 1) количество столбцов новой матрицы
+// 2) источник каждой строки новой матрицы
+// 3) матрицу с новыми строками (по порядку их появления)
+inline bool SparseMatrix::patch(size_t columnCount, const SizeVect& rowSources,
+                                const SparseMatrix& replacement)
+{
+    SparseMatrix result;
+    result.clear(columnCount);
+    result.rowOffsets.reserve(rowSources.size() + 1);
+    result.columnIndices.reserve(nonZeros() + replacement.nonZeros());
+    result.signs.reserve(nonZeros() + replacement.nonZeros());
+    result.valueIndices.reserve(nonZeros() + replacement.nonZeros());
+
+    bool grown = columnCount != this->columnCount || rowSources.size() != rows();
+    size_t next = 0;                                                                    // очередная строка replacement
+    SizeVect previous;                                                                  // столбцы прежней строки с тем же номером
+
+    for (size_t i = 0; i < rowSources.size(); )
+    {
+        const SparseMatrix& source = rowSources[i] == NONE ? replacement : *this;
+        size_t first = rowSources[i] == NONE ? next++ : rowSources[i];
+        size_t last = first + 1;                                                        // блок подряд идущих прежних строк
+        size_t count = 1;
+
+        while (rowSources[i] != NONE && i + count < rowSources.size() &&
+               rowSources[i + count] == last)
+        {
+            last++;
+            count++;
+        }
+
+        size_t begin = source.rowOffsets[first];
+        size_t end = source.rowOffsets[last];
+        size_t shift = result.nonZeros() - begin;
+
+        result.columnIndices.insert(result.columnIndices.end(), source.columnIndices.begin() + begin,
+                                    source.columnIndices.begin() + end);
+        result.signs.insert(result.signs.end(), source.signs.begin() + begin, source.signs.begin() + end);
+        result.valueIndices.insert(result.valueIndices.end(), source.valueIndices.begin() + begin,
+                                   source.valueIndices.begin() + end);
+
+        for (size_t row = first; row < last; row++)
+        {
+            result.rowOffsets.push_back(source.rowOffsets[row + 1] + shift);
+        }
+
+        if (!grown && rowSources[i] != i)                                               // строка заменена или перемещена - сравниваем столбцы
+        {
+            for (size_t j = 0; j < count && !grown; j++)
+            {
+                previous.assign(columnIndices.begin() + rowOffsets[i + j],
+                                columnIndices.begin() + rowOffsets[i + j + 1]);
+                std::sort(previous.begin(), previous.end());
+
+                for (size_t k = source.rowOffsets[first + j]; k < source.rowOffsets[first + j + 1]; k++)
+                {
+                    if (!std::binary_search(previous.begin(), previous.end(), source.columnIndices[k]))
+                    {
+                        grown = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        i += count;
+    }
+
+    *this = std::move(result);
+    return grown;
+}
+
+// геттер количества строк
+inline size_t SparseMatrix::rows() const
+{
+    return rowOffsets.size() - 1;
+}
+
+// геттер количества столбцов
+inline size_t SparseMatrix::columns() const
+{
+    return columnCount;
+}
+
+// геттер количества хранимых коэффициентов
+inline size_t SparseMatrix::nonZeros() const
+{
+    return columnIndices.size();
+}
+
+// геттер смещений начала строк
+inline const SizeVect& SparseMatrix::getRowOffsets() const
+{
+    return rowOffsets;
+}
+
+// геттер номеров столбцов коэффициентов
+inline const SizeVect& SparseMatrix::getColumns() const
+{
+    return columnIndices;
+}
+
+// геттер знаков коэффициентов
+inline const IntVect& SparseMatrix::getSigns() const
+{
+    return signs;
+}
+
+// геттер индексов значений коэффициентов
+inline const SizeVect& SparseMatrix::getValueIndices() const
+{
+    return valueIndices;
+}
+
+// метод вычисления значения коэффициента с номером entry
+// принимает на вход: список элементов схемы, в который указывают индексы значений
+inline double SparseMatrix::value(size_t entry, const Elements& elements) const
+{
+    if (valueIndices[entry] == UNIT)                                                    // единичный коэффициент
+    {
+        return signs[entry];
+    }
+
+    return signs[entry] * elements[valueIndices[entry]].getValue();                     // значение параметра элемента со знаком
+}
+
+// метод вычисления значения коэффициента с номером entry (перегрузка)
+// принимает на вход: значения элементов схемы подряд (см. Elements::getValues)
+inline double SparseMatrix::value(size_t entry, const DoubleVect& elementValues) const
+{
+    if (valueIndices[entry] == UNIT)                                                    // единичный коэффициент
+    {
+        return signs[entry];
+    }
+
+    return signs[entry] * elementValues[valueIndices[entry]];                           // значение параметра элемента со знаком
+}
+
+// метод вычисления значений всех коэффициентов в порядке их хранения
+// принимает на вход:
+// 1) список элементов схемы, в который указывают индексы значений
+// 2) вектор, в который записываются значения (размер приводится к nonZeros())
+inline void SparseMatrix::evaluate(const Elements& elements, DoubleVect& values) const
+{
+    evaluate(elements.getValues(), values);
+}
+
+// метод вычисления значений всех коэффициентов в порядке их хранения (перегрузка)
+// не обращается к объектам элементов, поэтому позволяет вычислять систему для
+// произвольных наборов значений (например, в нескольких потоках одновременно)
+// принимает на вход:
+// 1) значения элементов схемы подряд (см. Elements::getValues)
+// 2) вектор, в который записываются значения (размер приводится к nonZeros())
+inline void SparseMatrix::evaluate(const DoubleVect& elementValues, DoubleVect& values) const
+{
+    values.resize(nonZeros());
+
+    for (size_t k = 0; k < nonZeros(); k++)
+    {
+        values[k] = value(k, elementValues);
+    }
+}
+
+// метод построения плотной матрицы коэффициентов (отладочное представление)
+// коэффициенты ссылаются на значения элементов, как и раньше; если в одной позиции
+// оказалось несколько коэффициентов, первый хранится как указатель, а значения
+// остальных прибавляются к нему в виде слагаемого (на момент построения)
+inline CoeffMatr SparseMatrix::toDense(const Elements& elements) const
+{
+    CoeffMatr dense(rows(), CoeffVect(columnCount, Coefficient(ZERO_PTR)));             // нулевая матрица размера rows() x columnCount
+
+    for (size_t i = 0; i < rows(); i++)                                                 // перебираем строки
+    {
+        BoolVect occupied(columnCount, false);                                          // отметки о занятых позициях строки
+
+        for (size_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)                      // перебираем коэффициенты строки
+        {
+            Coefficient& coefficient = dense[i][columnIndices[k]];
+            const double* pointer = valueIndices[k] == UNIT ? ONE_PTR :
+                                    elements[valueIndices[k]].getValuePointer();
+
+            if (!occupied[columnIndices[k]])                                            // позиция еще не занята
+            {
+                coefficient = Coefficient(pointer, signs[k]);
+                occupied[columnIndices[k]] = true;
+            }
+            else                                                                        // позиция уже занята - добавляем значение слагаемым
+            {
+                coefficient += value(k, elements);
+            }
+        }
+    }
+
+    return dense;
+}
+
+// метод записи структуры матрицы в двоичный буфер (для кэша топологии)
+// принимает на вход: буфер для записи
+inline void SparseMatrix::save(BinaryWriter& writer) const
+{
+    writer.write(rowOffsets);
+    writer.write(columnIndices);
+    writer.write(signs);
+    writer.write(valueIndices);
+    writer.write(columnCount);
+}
+
+// метод чтения структуры матрицы из двоичного буфера, записанного методом save
+// принимает на вход: буфер для чтения
+// при нехватке данных выбрасывает исключение std::runtime_error
+inline void SparseMatrix::load(BinaryReader& reader)
+{
+    reader.read(rowOffsets);
+    reader.read(columnIndices);
+    reader.read(signs);
+    reader.read(valueIndices);
+    reader.read(columnCount);
+}
+
+} // namespace CS
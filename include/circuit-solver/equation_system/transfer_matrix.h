@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "circuit-solver/common.h"
+
+namespace CS
+{
+// класс для представления матрицы передачи от источников к токам ветвей
+// токи ветвей линейно зависят от значений источников (принцип наложения): I = T * s,
+// где s - значения источников по столбцам правой части системы (сначала источники
+// тока, затем источники напряжения), а столбец T - токи ветвей при единичном значении
+// одного источника и нулевых значениях остальных
+// столбцы хранятся подряд в одном массиве, поэтому умножение на вектор источников -
+// последовательные проходы по памяти без ветвлений
+//////////////////////////////////////////////////////////////////////////////////////////
+class TransferMatrix
+{
+public:
+    void update(DoubleVect values, size_t rows, size_t columns);                        // метод задания матрицы (по столбцам)
+    size_t rows() const;                                                                // геттер количества строк (ветвей)
+    size_t columns() const;                                                             // геттер количества столбцов (источников)
+    double operator() (size_t row, size_t column) const;                                // геттер элемента матрицы
+    void apply(const double* sourceValues, double* currents) const;                     // метод вычисления токов ветвей по значениям источников
+    DoubleVect apply(const DoubleVect& sourceValues) const;                             // метод вычисления токов ветвей по значениям источников (перегрузка)
+    size_t stream(std::istream& input, std::ostream& output) const;                     // метод потокового расчета токов по строкам значений источников
+    friend std::ostream& operator<<(std::ostream& os, const TransferMatrix& matrix);    // перегрузка оператора вывода в поток
+
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;                                      // размер блоков чтения и записи при потоковом расчете
+
+    DoubleVect values;                                                                  // элементы матрицы (по столбцам)
+    size_t rowCount = 0;                                                                // количество строк (ветвей)
+    size_t columnCount = 0;                                                             // количество столбцов (источников)
+
+    void parseLine(const char* first, const char* last, size_t lineCount,
+                   DoubleVect& sourceValues) const;                                     // метод разбора строки значений источников
+    void writeLine(const DoubleVect& currents, std::string& buffer) const;              // метод записи строки токов в буфер вывода
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод задания матрицы
+// принимает на вход:
+// 1) элементы матрицы, хранимые по столбцам в непрерывном массиве
+// 2) количество строк (ветвей)
+// 3) количество столбцов (источников)
+inline void TransferMatrix::update(DoubleVect values, size_t rows, size_t columns)
+{
+    if (values.size() != rows * columns)                                                // если размер массива не соответствует размеру матрицы
+    {
+        throw std::invalid_argument("Matrix storage does not match its size");
+    }
+
+    this->values = std::move(values);
+    rowCount = rows;
+    columnCount = columns;
+}
+
+// геттер количества строк (ветвей)
+inline size_t TransferMatrix::rows() const
+{
+    return rowCount;
+}
+
+// геттер количества столбцов (источников)
+inline size_t TransferMatrix::columns() const
+{
+    return columnCount;
+}
+
+// геттер элемента матрицы: ток ветви row при единичном значении источника column
+inline double TransferMatrix::operator()(size_t row, size_t column) const
+{
+    return values[column * rowCount + row];
+}
+
+// метод вычисления токов ветвей по значениям источников: к вектору токов прибавляются
+// столбцы матрицы, умноженные на значения источников
+// принимает на вход:
+// 1) значения источников (columns() значений)
+// 2) массив для токов ветвей (rows() значений)
+inline void TransferMatrix::apply(const double* sourceValues, double* currents) const
+{
+    std::fill(currents, currents + rowCount, 0.0);
+
+    for (size_t j = 0; j < columnCount; j++)                                            // перебираем источники
+    {
+        const double* column = &values[j * rowCount];
+        double value = sourceValues[j];
+
+        if (value == 0.0)                                                               // отключенный источник не дает тока
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < rowCount; i++)                                           // непрерывный проход по столбцу
+        {
+            currents[i] += column[i] * value;
+        }
+    }
+}
+
+// метод вычисления токов ветвей по значениям источников (перегрузка)
+// принимает на вход: значения источников по столбцам правой части системы
+// возвращает вектор токов ветвей в порядке списка ветвей
+inline DoubleVect TransferMatrix::apply(const DoubleVect& sourceValues) const
+{
+    if (sourceValues.size() != columnCount)
+    {
+        throw std::invalid_argument("Source value count does not match transfer matrix");
+    }
+
+    DoubleVect currents(rowCount);
+    apply(sourceValues.data(), currents.data());
+
+    return currents;
+}
+
+// метод потокового расчета токов ветвей: каждая строка ввода - значения источников
+// через запятую (columns() чисел), для нее в вывод записывается строка токов ветвей
+// через запятую (rows() чисел); пустые строки и строки, начинающиеся с '#', пропускаются
+// ввод читается, а вывод записывается блоками, числа разбираются и форматируются без
+// обращения к локали (std::from_chars, std::to_chars - кратчайшее точное представление)
+// принимает на вход:
+// 1) поток ввода значений источников
+// 2) поток вывода токов ветвей
+// возвращает количество обработанных строк значений источников
+// при ошибке разбора выбрасывает исключение std::runtime_error
+inline size_t TransferMatrix::stream(std::istream& input, std::ostream& output) const
+{
+    std::string chunk(BUFFER_SIZE, '\0');                                               // блок ввода
+    std::string line;                                                                   // начало строки, не поместившейся в предыдущий блок
+    std::string buffer;                                                                 // блок вывода
+    DoubleVect sourceValues(columnCount);                                               //
+    DoubleVect currents(rowCount);                                                      //
+    size_t lineCount = 0;                                                               // номер текущей строки ввода
+    size_t sampleCount = 0;                                                             // количество обработанных строк значений
+
+    auto processLine = [&](const char* first, const char* last)                         // обработка одной строки ввода
+    {
+        lineCount++;
+
+        if (last != first && last[-1] == '\r')                                          // окончание строки в стиле Windows
+        {
+            last--;
+        }
+
+        if (first == last || *first == '#')                                             // пустая строка или комментарий
+        {
+            return;
+        }
+
+        parseLine(first, last, lineCount, sourceValues);
+        apply(sourceValues.data(), currents.data());
+        writeLine(currents, buffer);
+        sampleCount++;
+
+        if (buffer.size() >= BUFFER_SIZE)                                               // блок вывода заполнен
+        {
+            output.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    };
+
+    while (input.read(&chunk[0], chunk.size()) || input.gcount())                       // читаем ввод блоками
+    {
+        const char* first = chunk.data();
+        const char* last = first + input.gcount();
+
+        for (const char* end; (end = std::find(first, last, '\n')) != last; first = end + 1)
+        {
+            if (line.empty())                                                           // строка целиком в блоке - разбираем на месте
+            {
+                processLine(first, end);
+            }
+            else                                                                        // продолжение строки из предыдущего блока
+            {
+                line.append(first, end);
+                processLine(line.data(), line.data() + line.size());
+                line.clear();
+            }
+        }
+
+        line.append(first, last);                                                       // остаток блока - начало следующей строки
+    }
+
+    if (!line.empty())                                                                  // последняя строка без перевода строки
+    {
+        processLine(line.data(), line.data() + line.size());
+    }
+
+    output.write(buffer.data(), buffer.size());
+
+    return sampleCount;
+}
+
+// перегрузка оператора вывода в поток
+inline std::ostream& operator<<(std::ostream& os, const TransferMatrix& matrix)
+{
+    os << "Матрица передачи:\n\n";
+
+    if (matrix.rows() && matrix.columns())
+    {
+        os << std::setw(6) << ' ';
+
+        for (size_t j = 0; j < matrix.columns(); j++)
+        {
+            os << std::setw(12) << j << ' ';
+        }
+
+        os << "\n\n";
+
+        for (size_t i = 0; i < matrix.rows(); i++)
+        {
+            os << std::left << std::setw(4) << i << std::right << ": ";
+
+            for (size_t j = 0; j < matrix.columns(); j++)
+            {
+                os << std::setw(12) << matrix(i, j) << ' ';
+            }
+
+            os << "\n\n";
+        }
+    }
+
+    return os;
+}
+
+// метод разбора строки значений источников
+// принимает на вход:
+// 1) указатель на начало строки
+// 2) указатель за концом строки
+// 3) номер строки (для сообщения об ошибке)
+// 4) вектор для значений источников (columns() значений)
+inline void TransferMatrix::parseLine(const char* first, const char* last, size_t lineCount,
+                                      DoubleVect& sourceValues) const
+{
+    for (size_t j = 0; j < columnCount; j++)                                            // разбираем значения по порядку
+    {
+        while (first != last && (*first == ' ' || *first == '\t'))                      // пропускаем пробелы перед числом
+        {
+            first++;
+        }
+
+        if (first != last && *first == '+')                                             // std::from_chars не принимает явный плюс
+        {
+            first++;
+        }
+
+        std::from_chars_result result = std::from_chars(first, last, sourceValues[j]);
+
+        if (result.ec != std::errc())
+        {
+            throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+        }
+
+        first = result.ptr;
+
+        while (first != last && (*first == ' ' || *first == '\t'))                      // пропускаем пробелы после числа
+        {
+            first++;
+        }
+
+        if (j + 1 < columnCount)                                                        // значения разделяются запятыми
+        {
+            if (first == last || *first != ',')
+            {
+                throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+            }
+
+            first++;
+        }
+    }
+
+    if (first != last)                                                                  // лишние значения в строке
+    {
+        throw std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+    }
+}
+
+// метод записи строки токов ветвей через запятую в буфер вывода
+// принимает на вход:
+// 1) токи ветвей
+// 2) буфер вывода, в конец которого дописывается строка
+inline void TransferMatrix::writeLine(const DoubleVect& currents, std::string& buffer) const
+{
+    char number[32];                                                                    // кратчайшее представление double занимает не больше 24 символов
+
+    for (size_t i = 0; i < currents.size(); i++)
+    {
+        std::to_chars_result result = std::to_chars(number, number + sizeof(number), currents[i]);
+
+        if (i)
+        {
+            buffer.push_back(',');
+        }
+
+        buffer.append(number, result.ptr);
+    }
+
+    buffer.push_back('\n');
+}
+
+} // namespace CS
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/elements.h"
+
+namespace CS
+{
+// класс для построения синтетических схем стандартных семейств прямо в памяти
+// (для замеров и нагрузочных проверок без записи и разбора текста)
+// схема задается ребрами между узлами: элемент ребра соединяет пин 2 * i (сторона 0)
+// с одним узлом и пин 2 * i + 1 (сторона 1) с другим; пины одного узла связываются в
+// цепочку - каждый пин соединяется с предыдущим пином узла, поэтому каждый элемент
+// строится за O(1) без поиска
+// семейства:
+// - grid: прямоугольная сетка сопротивлений с источником напряжения между углами
+// - ladder: лестница из последовательных и поперечных сопротивлений
+// - planar: случайная планарная сетка (прямоугольная сетка со случайными диагоналями
+//   ячеек), в которую внедрены источники: источник напряжения - последовательно с
+//   сопротивлением ребра, источник тока - параллельно ему (так источники не образуют
+//   контуров из одних источников напряжения и сечений из одних источников тока)
+// - power: схема наподобие энергосистемы: кольцо магистральных шин с хордами,
+//   распределительные фидеры (деревья с редкими перемычками), генераторы (источники
+//   напряжения с внутренним сопротивлением) на магистральных шинах и нагрузки
+//   (источники тока или шунтирующие сопротивления) на распределительных шинах
+// случайные числа берутся из собственного генератора (splitmix64), поэтому при одном
+// и том же seed схемы совпадают на всех платформах
+//////////////////////////////////////////////////////////////////////////////////////////
+class CircuitGenerator
+{
+public:
+    explicit CircuitGenerator(uint64_t seed = 1);                                       // конструктор с параметрами
+    void setSourceShare(double share);                                                  // сеттер доли ребер с источниками (planar)
+    void grid(size_t rows, size_t columns, ElemVect& elements);                         // метод построения прямоугольной сетки
+    void ladder(size_t rungs, ElemVect& elements);                                      // метод построения лестницы
+    void planar(size_t rows, size_t columns, ElemVect& elements);                       // метод построения случайной планарной сетки с источниками
+    void power(size_t busCount, ElemVect& elements);                                    // метод построения схемы наподобие энергосистемы
+    void generate(const std::string& family, size_t size, ElemVect& elements);          // метод построения схемы семейства по примерному размеру
+    void generate(const std::string& family, size_t size, Elements& elements);          // метод построения схемы семейства в списке элементов
+
+private:
+    uint64_t state;                                                                     // состояние генератора случайных чисел
+    double sourceShare = 0.1;                                                           // доля ребер планарной сетки с источниками
+    std::vector<int> lastPins;                                                          // последний пин каждого узла (-1 - у узла нет пинов)
+
+    uint64_t next();                                                                    // метод получения следующего случайного числа
+    double uniform(double first, double last);                                          // метод получения случайного числа из диапазона
+    size_t below(size_t bound);                                                         // метод получения случайного номера меньше bound
+    void reset(size_t nodeCount, size_t elementCount, ElemVect& elements);              // метод подготовки узлов и списка элементов
+    size_t addNode();                                                                   // метод добавления узла
+    void connect(size_t from, size_t to, Element::Type type, double value,
+                 ElemVect& elements);                                                   // метод добавления элемента между узлами
+    void connectBranch(size_t from, size_t to, ElemVect& elements);                     // метод добавления ребра планарной сетки (с источником)
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами
+// принимает на вход: начальное значение генератора случайных чисел
+inline CircuitGenerator::CircuitGenerator(uint64_t seed) :
+    state{ seed } {}
+
+// сеттер доли ребер планарной сетки, в которые внедряются источники (поровну
+// источников напряжения и тока)
+// принимает на вход: доля от 0 до 1
+inline void CircuitGenerator::setSourceShare(double share)
+{
+    if (!(share >= 0.0 && share <= 1.0))
+    {
+        throw std::invalid_argument("Source share must be in [0, 1]");
+    }
+
+    sourceShare = share;
+}
+
+// метод построения прямоугольной сетки узлов rows x columns: сопротивления между
+// соседними узлами и источник напряжения между противоположными углами
+// (2 * rows * columns - rows - columns + 1 элементов)
+// принимает на вход:
+// 1) количество строк узлов
+// 2) количество столбцов узлов
+// 3) список, в который добавляются элементы
+inline void CircuitGenerator::grid(size_t rows, size_t columns, ElemVect& elements)
+{
+    rows = std::max<size_t>(rows, 2);
+    columns = std::max<size_t>(columns, 2);
+    reset(rows * columns, 2 * rows * columns, elements);
+
+    connect(0, rows * columns - 1, Element::Type::E, uniform(1.0, 10.0), elements);
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        for (size_t column = 0; column < columns; column++)
+        {
+            size_t node = row * columns + column;
+
+            if (column + 1 < columns)
+            {
+                connect(node, node + 1, Element::Type::R, uniform(1.0, 10.0), elements);
+            }
+
+            if (row + 1 < rows)
+            {
+                connect(node, node + columns, Element::Type::R, uniform(1.0, 10.0), elements);
+            }
+        }
+    }
+}
+
+// метод построения лестницы: узлы 1 ... rungs + 1 соединены последовательными
+// сопротивлениями, каждый узел после первого - поперечным сопротивлением с общим
+// узлом 0, источник напряжения - между узлами 0 и 1 (2 * rungs + 1 элементов)
+// принимает на вход:
+// 1) количество звеньев
+// 2) список, в который добавляются элементы
+inline void CircuitGenerator::ladder(size_t rungs, ElemVect& elements)
+{
+    rungs = std::max<size_t>(rungs, 1);
+    reset(rungs + 2, 2 * rungs + 1, elements);
+
+    connect(0, 1, Element::Type::E, uniform(1.0, 10.0), elements);
+
+    for (size_t i = 1; i <= rungs; i++)
+    {
+        connect(i, i + 1, Element::Type::R, uniform(1.0, 10.0), elements);
+        connect(i + 1, 0, Element::Type::R, uniform(1.0, 10.0), elements);
+    }
+}
+
+// метод построения случайной планарной сетки: прямоугольная сетка узлов, в каждой
+// ячейке которой с вероятностью 1/2 проводится одна из двух диагоналей; в долю
+// sourceShare ребер внедряются источники (см. connectBranch)
+// принимает на вход:
+// 1) количество строк узлов
+// 2) количество столбцов узлов
+// 3) список, в который добавляются элементы
+inline void CircuitGenerator::planar(size_t rows, size_t columns, ElemVect& elements)
+{
+    rows = std::max<size_t>(rows, 2);
+    columns = std::max<size_t>(columns, 2);
+    reset(rows * columns, 3 * rows * columns, elements);
+
+    connect(0, rows * columns - 1, Element::Type::E, uniform(1.0, 10.0), elements);
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        for (size_t column = 0; column < columns; column++)
+        {
+            size_t node = row * columns + column;
+
+            if (column + 1 < columns)
+            {
+                connectBranch(node, node + 1, elements);
+            }
+
+            if (row + 1 < rows)
+            {
+                connectBranch(node, node + columns, elements);
+            }
+
+            if (row + 1 < rows && column + 1 < columns && next() % 2)                   // диагональ ячейки (диагонали ячеек не пересекаются)
+            {
+                next() % 2 ? connectBranch(node, node + columns + 1, elements) :
+                             connectBranch(node + 1, node + columns, elements);
+            }
+        }
+    }
+}
+
+// метод построения схемы наподобие энергосистемы из busCount шин и общего узла 0:
+// - магистральные шины (около 1% шин, не меньше трех) соединены в кольцо линиями с
+//   малым сопротивлением и несколькими хордами; на каждой второй (и на первой)
+//   магистральной шине - генератор: источник напряжения с внутренним сопротивлением
+//   между общим узлом и шиной
+// - остальные шины образуют фидеры: каждая присоединяется линией к одной из
+//   недавних шин (или, реже, к магистральной), а с вероятностью 5% - еще и
+//   перемычкой к случайной более ранней шине
+// - на каждой распределительной шине нагрузка: источник тока к общему узлу (60%)
+//   или шунтирующее сопротивление
+// принимает на вход:
+// 1) количество шин
+// 2) список, в который добавляются элементы
+inline void CircuitGenerator::power(size_t busCount, ElemVect& elements)
+{
+    busCount = std::max<size_t>(busCount, 3);
+    size_t trunkCount = std::max<size_t>(busCount / 100, 3);                            // магистральные шины: узлы 1 ... trunkCount
+    reset(busCount + 1, 2 * busCount + trunkCount, elements);
+
+    for (size_t bus = 1; bus <= trunkCount; bus++)
+    {
+        connect(bus, bus % trunkCount + 1, Element::Type::R, uniform(0.01, 0.1), elements);
+
+        if (bus == 1 || bus % 2 == 0)                                                   // генератор с внутренним сопротивлением
+        {
+            size_t internal = addNode();
+            connect(0, internal, Element::Type::E, uniform(100.0, 110.0), elements);
+            connect(internal, bus, Element::Type::R, uniform(0.01, 0.05), elements);
+        }
+    }
+
+    for (size_t chord = 0; chord < trunkCount / 4; chord++)                             // хорды кольца
+    {
+        size_t from = 1 + below(trunkCount);
+        size_t to = 1 + below(trunkCount);
+
+        if (from != to)
+        {
+            connect(from, to, Element::Type::R, uniform(0.05, 0.2), elements);
+        }
+    }
+
+    for (size_t bus = trunkCount + 1; bus <= busCount; bus++)
+    {
+        size_t recent = std::min<size_t>(bus - 1, 8);                                   // недавние шины - продолжение фидера
+        size_t parent = next() % 10 ? bus - 1 - below(recent) : 1 + below(trunkCount);  // или (реже) отвод от магистрали
+        connect(parent, bus, Element::Type::R, uniform(0.1, 1.0), elements);
+
+        if (next() % 20 == 0)                                                           // перемычка
+        {
+            connect(1 + below(bus - 1), bus, Element::Type::R, uniform(0.5, 2.0), elements);
+        }
+
+        if (next() % 5 < 3)                                                             // нагрузка
+        {
+            connect(bus, 0, Element::Type::J, uniform(0.1, 1.0), elements);
+        }
+        else
+        {
+            connect(bus, 0, Element::Type::R, uniform(100.0, 1000.0), elements);
+        }
+    }
+}
+
+// метод построения схемы семейства по примерному количеству элементов
+// принимает на вход:
+// 1) название семейства ("grid", "ladder", "planar" или "power")
+// 2) примерное количество элементов
+// 3) список, в который добавляются элементы
+// при неизвестном семействе выбрасывает исключение std::invalid_argument
+inline void CircuitGenerator::generate(const std::string& family, size_t size, ElemVect& elements)
+{
+    if (family == "grid")                                                               // 2 элемента на узел
+    {
+        size_t side = static_cast<size_t>(std::sqrt(size / 2.0));
+        grid(side, side, elements);
+    }
+    else if (family == "ladder")
+    {
+        ladder(size / 2, elements);
+    }
+    else if (family == "planar")                                                        // 2.5 ребра на узел и источники
+    {
+        size_t side = static_cast<size_t>(std::sqrt(size / (2.5 * (1.0 + sourceShare * 0.5))));
+        planar(side, side, elements);
+    }
+    else if (family == "power")                                                         // линия, нагрузка и перемычки на шину
+    {
+        power(static_cast<size_t>(size / 2.05), elements);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown circuit family: " + family);
+    }
+}
+
+// метод построения схемы семейства в списке элементов (см. generate для ElemVect)
+// принимает на вход:
+// 1) название семейства
+// 2) примерное количество элементов
+// 3) список элементов, в конец которого добавляются элементы (номера пинов схемы
+//    считаются от начала списка)
+inline void CircuitGenerator::generate(const std::string& family, size_t size, Elements& elements)
+{
+    ElemVect generated;
+    generate(family, size, generated);
+
+    size_t offset = 2 * elements.size();                                                // пины новых элементов идут после существующих
+
+    for (Element& element : generated)
+    {
+        for (size_t side = 0; side < 2; side++)
+        {
+            if (element.getLinkedPin(side) >= 0)
+            {
+                element.setLinkedPin(side, element.getLinkedPin(side) + static_cast<int>(offset));
+            }
+        }
+    }
+
+    elements.add(generated);
+}
+
+// метод получения следующего случайного числа (splitmix64)
+inline uint64_t CircuitGenerator::next()
+{
+    uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+    return value ^ (value >> 31);
+}
+
+// метод получения случайного числа из диапазона [first, last)
+inline double CircuitGenerator::uniform(double first, double last)
+{
+    return first + (last - first) * static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+// метод получения случайного номера из [0, bound) (bound > 0)
+inline size_t CircuitGenerator::below(size_t bound)
+{
+    return static_cast<size_t>(next() % bound);
+}
+
+// метод подготовки построения: узлы без пинов и резерв списка элементов
+// принимает на вход:
+// 1) начальное количество узлов
+// 2) примерное количество добавляемых элементов
+// 3) список, в который добавляются элементы (элементы до построения сохраняются, но
+//    номера пинов новых элементов считаются от начала списка)
+inline void CircuitGenerator::reset(size_t nodeCount, size_t elementCount, ElemVect& elements)
+{
+    lastPins.assign(nodeCount, -1);
+    elements.reserve(elements.size() + elementCount);
+}
+
+// метод добавления узла без пинов
+// возвращает номер узла
+inline size_t CircuitGenerator::addNode()
+{
+    lastPins.push_back(-1);
+    return lastPins.size() - 1;
+}
+
+// метод добавления элемента между узлами: пин стороны 0 присоединяется к узлу from,
+// пин стороны 1 - к узлу to (каждый - к предыдущему пину своего узла)
+// принимает на вход:
+// 1) узел пина стороны 0
+// 2) узел пина стороны 1
+// 3) тип элемента
+// 4) значение элемента
+// 5) список, в который добавляется элемент
+// если номер пина не помещается в int, выбрасывает исключение std::length_error
+inline void CircuitGenerator::connect(size_t from, size_t to, Element::Type type, double value,
+                                      ElemVect& elements)
+{
+    if (elements.size() >= static_cast<size_t>(INT_MAX / 2))
+    {
+        throw std::length_error("Too many elements for pin numbering");
+    }
+
+    int pin = static_cast<int>(2 * elements.size());
+    elements.emplace_back(type, value, lastPins[from], lastPins[to]);
+    lastPins[from] = pin;
+    lastPins[to] = pin + 1;
+}
+
+// метод добавления ребра планарной сетки: сопротивление, а с вероятностью sourceShare
+// еще и источник - поровну напряжения (последовательно с сопротивлением, через
+// промежуточный узел) и тока (параллельно сопротивлению)
+// принимает на вход:
+// 1) первый узел ребра
+// 2) второй узел ребра
+// 3) список, в который добавляются элементы
+inline void CircuitGenerator::connectBranch(size_t from, size_t to, ElemVect& elements)
+{
+    if (uniform(0.0, 1.0) >= sourceShare)
+    {
+        connect(from, to, Element::Type::R, uniform(1.0, 10.0), elements);
+    }
+    else if (next() % 2)
+    {
+        size_t middle = addNode();
+        connect(from, middle, Element::Type::E, uniform(1.0, 10.0), elements);
+        connect(middle, to, Element::Type::R, uniform(1.0, 10.0), elements);
+    }
+    else
+    {
+        connect(from, to, Element::Type::R, uniform(1.0, 10.0), elements);
+        connect(from, to, Element::Type::J, uniform(0.1, 1.0), elements);
+    }
+}
+
+} // namespace CS
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/structure_units/element.h"
+#include "circuit-solver/netlist/netlist_parser.h"
+
+namespace CS
+{
+// класс для двоичного описания схемы, отображенного в память
+// файл состоит из заголовка и трех массивов, каждый из которых начинается с
+// границы ALIGNMENT байт:
+// 1) типы элементов (по байту: 0 - сопротивление, 1 - источник напряжения,
+//    2 - источник тока)
+// 2) значения элементов (double)
+// 3) номера присоединенных пинов (по два int32_t на элемент, -1 - пин не соединен)
+// числа хранятся в порядке байтов записавшей машины, который отмечен в заголовке
+// (файл другой машины не принимается); версия формата меняется при любом изменении
+// расположения данных
+// массивы читаются прямо из отображения без разбора, проверяется только заголовок и
+// коды типов
+//////////////////////////////////////////////////////////////////////////////////////////
+class BinaryNetlist
+{
+public:
+    static constexpr uint32_t VERSION = 1;                                              // версия формата
+    static constexpr size_t ALIGNMENT = 64;                                             // выравнивание заголовка и массивов
+
+    explicit BinaryNetlist(const std::string& path);                                    // конструктор с параметрами (отображает файл)
+    ~BinaryNetlist();                                                                   // деструктор (снимает отображение)
+    BinaryNetlist(const BinaryNetlist&) = delete;                                       // отображение не копируется
+    BinaryNetlist& operator=(const BinaryNetlist&) = delete;                            //
+    size_t size() const;                                                                // геттер количества элементов
+    Element::Type getType(size_t index) const;                                          // геттер типа элемента
+    const double* getValues() const;                                                    // геттер массива значений
+    const int32_t* getLinkedPins() const;                                               // геттер массива номеров присоединенных пинов
+    static void write(const std::string& path, const ElemVect& elements);               // метод записи элементов в двоичный файл
+    static void convert(const std::string& textPath, const std::string& binaryPath);    // метод преобразования текстового описания в двоичное
+
+private:
+    struct Header                                                                       // заголовок файла
+    {
+        char magic[8];                                                                  // сигнатура формата
+        uint32_t version;                                                               // версия формата
+        uint32_t byteOrder;                                                             // ORDER_MARK в порядке байтов записавшей машины
+        uint64_t elementCount;                                                          // количество элементов
+        uint64_t typeOffset;                                                            // смещения массивов от начала файла
+        uint64_t valueOffset;                                                           //
+        uint64_t pinOffset;                                                             //
+        uint64_t fileSize;                                                              // размер файла
+        uint64_t reserved;                                                              // не используется (нули)
+    };
+
+    static_assert(sizeof(Header) == ALIGNMENT, "Header must fill one alignment block");
+    static_assert(sizeof(int) == sizeof(int32_t), "Pin numbers are stored as int32_t");
+
+    static constexpr char MAGIC[8] = { 'C', 'S', 'N', 'E', 'T', 'B', 'I', 'N' };        // сигнатура формата
+    static constexpr uint32_t ORDER_MARK = 0x01020304;                                  // метка порядка байтов
+
+    const char* data = nullptr;                                                         // содержимое файла
+    size_t fileSize = 0;                                                                // размер файла
+    bool mapped = false;                                                                // признак отображения (иначе файл прочитан в storage)
+    std::unique_ptr<uint64_t[]> storage;                                                // выровненный буфер файла без отображения
+    const uint8_t* types = nullptr;                                                     // массивы элементов внутри файла
+    const double* values = nullptr;                                                     //
+    const int32_t* linkedPins = nullptr;                                                //
+    size_t elementCount = 0;                                                            // количество элементов
+
+    void open(const std::string& path);                                                 // метод отображения (или чтения) файла
+    void check(const std::string& path);                                                // метод проверки заголовка и типов
+    static uint64_t align(uint64_t offset);                                             // метод выравнивания смещения
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами: отображает файл в память и проверяет его
+// принимает на вход: путь к файлу
+// если файл не открывается или не является двоичным описанием схемы этой версии,
+// выбрасывает исключение std::runtime_error
+inline BinaryNetlist::BinaryNetlist(const std::string& path)
+{
+    open(path);
+
+    try
+    {
+        check(path);
+    }
+    catch (...)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped)
+        {
+            ::munmap(const_cast<char*>(data), fileSize);
+        }
+#endif
+        throw;
+    }
+}
+
+// деструктор: снимает отображение файла
+inline BinaryNetlist::~BinaryNetlist()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped)
+    {
+        ::munmap(const_cast<char*>(data), fileSize);
+    }
+#endif
+}
+
+// геттер количества элементов
+inline size_t BinaryNetlist::size() const
+{
+    return elementCount;
+}
+
+// геттер типа элемента
+// принимает на вход: индекс элемента
+inline Element::Type BinaryNetlist::getType(size_t index) const
+{
+    static const Element::Type TYPES[] = { Element::Type::R, Element::Type::E, Element::Type::J };
+
+    return TYPES[types[index]];                                                         // коды типов проверены при открытии
+}
+
+// геттер массива значений элементов (size() значений)
+inline const double* BinaryNetlist::getValues() const
+{
+    return values;
+}
+
+// геттер массива номеров присоединенных пинов: пины элемента i - элементы 2 * i
+// и 2 * i + 1
+inline const int32_t* BinaryNetlist::getLinkedPins() const
+{
+    return linkedPins;
+}
+
+// метод записи элементов в двоичный файл (в текущей версии формата)
+// принимает на вход:
+// 1) путь к файлу
+// 2) элементы
+// если файл не записывается, выбрасывает исключение std::runtime_error
+inline void BinaryNetlist::write(const std::string& path, const ElemVect& elements)
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = ORDER_MARK;
+    header.elementCount = elements.size();
+    header.typeOffset = ALIGNMENT;
+    header.valueOffset = align(header.typeOffset + elements.size());
+    header.pinOffset = align(header.valueOffset + elements.size() * sizeof(double));
+    header.fileSize = header.pinOffset + elements.size() * 2 * sizeof(int32_t);
+
+    std::vector<uint8_t> typeArray(elements.size());
+    DoubleVect valueArray(elements.size());
+    std::vector<int32_t> pinArray(elements.size() * 2);
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        typeArray[i] = static_cast<uint8_t>(elements[i].getType() == Element::Type::R ? 0 :
+                                            elements[i].getType() == Element::Type::E ? 1 : 2);
+        valueArray[i] = elements[i].getValue();
+
+        pinArray[2 * i] = elements[i].getLinkedPin(0);
+        pinArray[2 * i + 1] = elements[i].getLinkedPin(1);
+    }
+
+    std::ofstream output(path, std::ios::binary);
+    const char padding[ALIGNMENT] = {};
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(typeArray.data()), typeArray.size());
+    output.write(padding, header.valueOffset - header.typeOffset - typeArray.size());
+    output.write(reinterpret_cast<const char*>(valueArray.data()), valueArray.size() * sizeof(double));
+    output.write(padding, header.pinOffset - header.valueOffset - valueArray.size() * sizeof(double));
+    output.write(reinterpret_cast<const char*>(pinArray.data()), pinArray.size() * sizeof(int32_t));
+
+    if (!output.flush())
+    {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+// метод преобразования текстового описания схемы (см. NetlistParser) в двоичное
+// принимает на вход:
+// 1) путь к текстовому файлу
+// 2) путь к двоичному файлу
+// при ошибке чтения, разбора или записи выбрасывает исключение std::runtime_error
+inline void BinaryNetlist::convert(const std::string& textPath, const std::string& binaryPath)
+{
+    ElemVect elements;
+    NetlistParser().parseFile(textPath, elements);
+    write(binaryPath, elements);
+}
+
+// метод отображения файла в память (в системах без mmap файл читается в выровненный
+// буфер целиком)
+// принимает на вход: путь к файлу
+// если файл не открывается, выбрасывает исключение std::runtime_error
+inline void BinaryNetlist::open(const std::string& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    int file = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (file < 0 || ::fstat(file, &status) != 0)
+    {
+        if (file >= 0)
+        {
+            ::close(file);
+        }
+
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    fileSize = static_cast<size_t>(status.st_size);
+
+    if (fileSize < sizeof(Header))                                                      // заголовок не поместился - проверка отвергнет файл
+    {
+        ::close(file);
+        return;
+    }
+
+    void* address = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);                                                                      // отображение остается действительным
+
+    if (address == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+
+    ::madvise(address, fileSize, MADV_WILLNEED);                                        // массивы читаются целиком - подкачиваем заранее
+    data = static_cast<const char*>(address);
+    mapped = true;
+#else
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+
+    if (!input)
+    {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    fileSize = static_cast<size_t>(input.tellg());
+    storage.reset(new uint64_t[(fileSize + sizeof(uint64_t) - 1) / sizeof(uint64_t)]);
+    input.seekg(0);
+    input.read(reinterpret_cast<char*>(storage.get()), fileSize);
+    data = reinterpret_cast<const char*>(storage.get());
+#endif
+}
+
+// метод проверки заголовка (сигнатуры, версии, порядка байтов и границ массивов) и
+// кодов типов элементов
+// принимает на вход: путь к файлу (для сообщений)
+// при несоответствии выбрасывает исключение std::runtime_error
+inline void BinaryNetlist::check(const std::string& path)
+{
+    Header header;
+
+    if (fileSize < sizeof(Header))
+    {
+        throw std::runtime_error("Invalid binary netlist: " + path);
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byteOrder != ORDER_MARK)
+    {
+        throw std::runtime_error("Invalid binary netlist: " + path);
+    }
+
+    if (header.version != VERSION)
+    {
+        throw std::runtime_error("Unsupported binary netlist version: " + std::to_string(header.version));
+    }
+
+    uint64_t count = header.elementCount;
+    bool valid = header.fileSize == fileSize &&
+                 count <= fileSize / (1 + sizeof(double) + 2 * sizeof(int32_t)) &&      // размеры массивов не переполняются
+                 header.typeOffset >= sizeof(Header) &&
+                 header.valueOffset >= header.typeOffset + count &&
+                 header.pinOffset >= header.valueOffset + count * sizeof(double) &&
+                 header.pinOffset + count * 2 * sizeof(int32_t) <= fileSize &&
+                 header.valueOffset % ALIGNMENT == 0 && header.pinOffset % ALIGNMENT == 0;
+
+    if (!valid)
+    {
+        throw std::runtime_error("Invalid binary netlist: " + path);
+    }
+
+    elementCount = static_cast<size_t>(count);
+    types = reinterpret_cast<const uint8_t*>(data + header.typeOffset);
+    values = reinterpret_cast<const double*>(data + header.valueOffset);
+    linkedPins = reinterpret_cast<const int32_t*>(data + header.pinOffset);
+
+    uint8_t maximum = 0;                                                                // коды типов проверяются одним проходом без ветвлений
+
+    for (size_t i = 0; i < elementCount; i++)
+    {
+        maximum = types[i] > maximum ? types[i] : maximum;
+    }
+
+    if (maximum > 2)
+    {
+        throw std::runtime_error("Invalid binary netlist: " + path);
+    }
+}
+
+// метод выравнивания смещения вверх до границы ALIGNMENT
+inline uint64_t BinaryNetlist::align(uint64_t offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+} // namespace CS
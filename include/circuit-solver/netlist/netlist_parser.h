@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/analysis/thread_pool.h"
+
+namespace CS
+{
+// класс для разбора текстового описания схемы (списка элементов)
+// каждая строка описывает один элемент: тип, значение и номера пинов, с которыми
+// соединены его пины (none - пин не соединен), например "R 2 1 none";
+// пустые строки и строки, начинающиеся с '#', пропускаются, лишние слова в конце
+// строки игнорируются
+// текст разбирается на месте, без копирования строк: строки и слова - участки
+// исходного буфера (std::string_view), числа читаются std::from_chars, а названия
+// типов и none сравниваются без учета регистра посимвольно
+// файл отображается в память (mmap), поток читается большими блоками
+// строки независимы, а номер элемента - порядковый номер его строки среди строк с
+// элементами, поэтому большой текст можно разбирать параллельно по частям (см. parse
+// с пулом потоков) с тем же результатом, что и последовательно
+//////////////////////////////////////////////////////////////////////////////////////////
+class NetlistParser
+{
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;                                      // размер блоков чтения из потока
+    static constexpr size_t CHUNK_SIZE = 1 << 22;                                       // наименьший размер части текста при параллельном разборе
+
+    void parse(std::string_view text, ElemVect& elements);                              // метод разбора текста (продолжает нумерацию строк)
+    void parse(std::string_view text, ElemVect& elements, ThreadPool& pool);            // метод параллельного разбора текста по частям
+    void parse(std::istream& input, ElemVect& elements);                                // метод разбора потока блоками
+    void parseFile(const std::string& path, ElemVect& elements);                        // метод разбора файла, отображенного в память
+    void parseFile(const std::string& path, ElemVect& elements, ThreadPool& pool);      // метод параллельного разбора файла
+    size_t getLineCount() const;                                                        // геттер количества разобранных строк
+
+private:
+    size_t lineCount = 0;                                                               // номер последней разобранной строки
+
+    using TextAction = std::function<void(std::string_view text)>;                      // действие над текстом файла
+
+    void parseLine(std::string_view line, ElemVect& elements) const;                    // метод разбора одной строки
+    static void mapFile(const std::string& path, const TextAction& action);             // метод отображения файла в память
+    static bool parseValue(std::string_view word, double& value);                       // метод чтения значения элемента
+    static std::string_view nextWord(std::string_view& line);                           // метод выделения следующего слова строки
+    static bool isSpace(char symbol);                                                   // метод проверки пробельного символа
+    static bool equalsLower(std::string_view word, std::string_view keyword);           // метод сравнения слова с ключевым словом без учета регистра
+    std::runtime_error error() const;                                                   // метод создания исключения с номером строки
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод разбора текста: элементы добавляются в конец списка, строки нумеруются
+// в продолжение предыдущих вызовов (последняя строка может не оканчиваться
+// переводом строки)
+// принимает на вход:
+// 1) текст (целое количество строк)
+// 2) список, в который добавляются элементы
+// при ошибке разбора выбрасывает исключение std::runtime_error с номером строки
+inline void NetlistParser::parse(std::string_view text, ElemVect& elements)
+{
+    while (!text.empty())
+    {
+        const void* end = std::memchr(text.data(), '\n', text.size());                  // конец строки
+        size_t length = end ? static_cast<const char*>(end) - text.data() : text.size();
+
+        lineCount++;
+        parseLine(text.substr(0, length), elements);
+        text.remove_prefix(end ? length + 1 : length);
+    }
+}
+
+// метод параллельного разбора текста: текст делится на части по границам строк,
+// части разбираются потоками пула в отдельные списки, которые затем добавляются в
+// конец списка по порядку частей; номера пинов в строках абсолютные, поэтому
+// номера элементов и пинов совпадают с последовательным разбором
+// при ошибке разбора номер строки считается от начала всего текста: строки частей
+// до первой ошибочной части известны после их разбора, и ошибочная часть
+// разбирается повторно с продолжением этой нумерации
+// принимает на вход:
+// 1) текст (целое количество строк)
+// 2) список, в который добавляются элементы
+// 3) пул потоков
+// при ошибке разбора выбрасывает исключение std::runtime_error с номером строки
+// (первой ошибочной строки текста, как и при последовательном разборе)
+inline void NetlistParser::parse(std::string_view text, ElemVect& elements, ThreadPool& pool)
+{
+    size_t chunkCount = std::min(std::max<size_t>(text.size() / CHUNK_SIZE, 1), pool.size() * 8);
+
+    if (chunkCount == 1)                                                                // мелкий текст делить невыгодно
+    {
+        parse(text, elements);
+        return;
+    }
+
+    std::vector<std::string_view> chunks;                                               // части текста из целых строк
+    size_t first = 0;
+
+    for (size_t i = 1; i <= chunkCount && first < text.size(); i++)
+    {
+        size_t position = std::max(first, text.size() * i / chunkCount);                // граница - за ближайшим переводом строки
+        const void* end = std::memchr(text.data() + position, '\n', text.size() - position);
+        size_t last = end ? static_cast<const char*>(end) - text.data() + 1 : text.size();
+
+        chunks.push_back(text.substr(first, last - first));
+        first = last;
+    }
+
+    std::vector<ElemVect> parsed(chunks.size());                                        // элементы частей
+    SizeVect lineCounts(chunks.size(), 0);                                              // количества строк частей
+    std::vector<std::exception_ptr> errors(chunks.size());                              // ошибки разбора частей
+    std::atomic<size_t> firstFailed{ chunks.size() };                                   // номер первой ошибочной части
+
+    pool.parallelFor(chunks.size(), 1, [&](size_t, size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            if (i > firstFailed.load(std::memory_order_relaxed))                        // после ошибки в предыдущей части результат не нужен
+            {
+                continue;
+            }
+
+            try
+            {
+                NetlistParser parser;
+                parser.parse(chunks[i], parsed[i]);
+                lineCounts[i] = parser.getLineCount();
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+                size_t failed = firstFailed.load();
+
+                while (i < failed && !firstFailed.compare_exchange_weak(failed, i)) {}
+            }
+        }
+    });
+
+    if (firstFailed < chunks.size())
+    {
+        for (size_t i = 0; i < firstFailed; i++)
+        {
+            lineCount += lineCounts[i];
+        }
+
+        parse(chunks[firstFailed], elements);                                           // выбрасывает ту же ошибку с номером строки всего текста
+        std::rethrow_exception(errors[firstFailed]);                                    // ошибка не повторилась (например, нехватка памяти)
+    }
+
+    size_t total = 0;
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        total += parsed[i].size();
+        lineCount += lineCounts[i];
+    }
+
+    elements.reserve(elements.size() + total);
+
+    for (ElemVect& chunk : parsed)
+    {
+        elements.insert(elements.end(), chunk.begin(), chunk.end());
+        ElemVect().swap(chunk);                                                         // освобождаем память части сразу
+    }
+}
+
+// метод разбора потока: поток читается блоками BUFFER_SIZE байт, полные строки
+// блока разбираются на месте, а незаконченная строка переносится в начало
+// следующего блока
+// принимает на вход:
+// 1) поток ввода
+// 2) список, в который добавляются элементы
+// при ошибке разбора выбрасывает исключение std::runtime_error с номером строки
+inline void NetlistParser::parse(std::istream& input, ElemVect& elements)
+{
+    std::string chunk(BUFFER_SIZE, '\0');                                               // блок ввода
+    size_t carried = 0;                                                                 // длина строки, перенесенной из предыдущего блока
+
+    while (input.read(&chunk[carried], chunk.size() - carried) || input.gcount())
+    {
+        size_t size = carried + input.gcount();
+        std::string_view block(chunk.data(), size);
+        size_t last = block.rfind('\n');                                                // конец последней полной строки
+
+        if (last == std::string_view::npos)                                             // строка длиннее блока - увеличиваем блок
+        {
+            carried = size;
+
+            if (carried == chunk.size())
+            {
+                chunk.resize(chunk.size() * 2);
+            }
+
+            continue;
+        }
+
+        parse(block.substr(0, last + 1), elements);
+        carried = size - last - 1;
+        std::memmove(&chunk[0], chunk.data() + last + 1, carried);
+    }
+
+    parse(std::string_view(chunk.data(), carried), elements);                           // последняя строка без перевода строки
+}
+
+// метод разбора файла: файл отображается в память и разбирается без копирования
+// принимает на вход:
+// 1) путь к файлу
+// 2) список, в который добавляются элементы
+// если файл не открывается, выбрасывает исключение std::runtime_error
+inline void NetlistParser::parseFile(const std::string& path, ElemVect& elements)
+{
+    mapFile(path, [&](std::string_view text) { parse(text, elements); });
+}
+
+// метод параллельного разбора файла, отображенного в память (см. parse с пулом)
+// принимает на вход:
+// 1) путь к файлу
+// 2) список, в который добавляются элементы
+// 3) пул потоков
+// если файл не открывается, выбрасывает исключение std::runtime_error
+inline void NetlistParser::parseFile(const std::string& path, ElemVect& elements, ThreadPool& pool)
+{
+    mapFile(path, [&](std::string_view text) { parse(text, elements, pool); });
+}
+
+// геттер количества разобранных строк
+inline size_t NetlistParser::getLineCount() const
+{
+    return lineCount;
+}
+
+// метод разбора одной строки: тип, значение и два номера пинов
+// принимает на вход:
+// 1) строка без перевода строки
+// 2) список, в который добавляется элемент
+inline void NetlistParser::parseLine(std::string_view line, ElemVect& elements) const
+{
+    std::string_view word = nextWord(line);
+
+    if (word.empty() || word.front() == '#')                                            // пустая строка или комментарий
+    {
+        return;
+    }
+
+    Element::Type type;
+
+    if (equalsLower(word, "resistance") || equalsLower(word, "r"))
+    {
+        type = Element::Type::R;
+    }
+    else if (equalsLower(word, "current_source") || equalsLower(word, "j"))
+    {
+        type = Element::Type::J;
+    }
+    else if (equalsLower(word, "voltage_source") || equalsLower(word, "e"))
+    {
+        type = Element::Type::E;
+    }
+    else
+    {
+        std::string typeString(word);                                                   // в сообщении - в нижнем регистре, как и раньше
+
+        for (char& symbol : typeString)
+        {
+            symbol = (symbol >= 'A' && symbol <= 'Z') ? symbol - 'A' + 'a' : symbol;
+        }
+
+        throw std::runtime_error("Unknown element type: " + typeString);
+    }
+
+    double value = 0.0;
+
+    if (!parseValue(nextWord(line), value))
+    {
+        throw error();
+    }
+
+    int linkedPins[2];
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        word = nextWord(line);
+
+        if (equalsLower(word, "none"))                                                  // пин не соединен
+        {
+            linkedPins[i] = -1;
+            continue;
+        }
+
+        std::from_chars_result result = std::from_chars(word.data(), word.data() + word.size(), linkedPins[i]);
+
+        if (word.empty() || result.ec != std::errc() || result.ptr != word.data() + word.size())
+        {
+            throw error();
+        }
+    }
+
+    elements.emplace_back(type, value, linkedPins[0], linkedPins[1]);
+}
+
+// метод отображения файла в память: действие выполняется над всем текстом файла,
+// после чего отображение снимается (в системах без mmap файл читается в память целиком)
+// принимает на вход:
+// 1) путь к файлу
+// 2) действие над текстом файла
+// если файл не открывается, выбрасывает исключение std::runtime_error
+inline void NetlistParser::mapFile(const std::string& path, const TextAction& action)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    int file = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (file < 0 || ::fstat(file, &status) != 0)
+    {
+        if (file >= 0)
+        {
+            ::close(file);
+        }
+
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    size_t size = static_cast<size_t>(status.st_size);
+
+    if (!size)                                                                          // пустой файл не отображается
+    {
+        ::close(file);
+        action(std::string_view());
+        return;
+    }
+
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);                                                                      // отображение остается действительным
+
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+
+    ::madvise(data, size, MADV_SEQUENTIAL);                                             // файл читается один раз подряд
+
+    try
+    {
+        action(std::string_view(static_cast<const char*>(data), size));
+    }
+    catch (...)
+    {
+        ::munmap(data, size);
+        throw;
+    }
+
+    ::munmap(data, size);
+#else
+    std::ifstream input(path, std::ios::binary);
+
+    if (!input)
+    {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    action(text);
+#endif
+}
+
+// метод чтения значения элемента (конечного числа с необязательными знаком, дробной
+// частью и порядком): обычные записи вида 12, -2.5, 1e3 читаются по быстрой схеме
+// Клингера - если мантисса (все цифры подряд) не больше 2^53, а десятичный порядок
+// по модулю не больше 22, то мантисса и степень десяти точно представимы в double,
+// и одно умножение или деление дает правильно округленный результат; остальные
+// записи читаются std::from_chars
+// принимает на вход:
+// 1) слово
+// 2) переменная для значения
+// возвращает false, если слово не является конечным числом
+inline bool NetlistParser::parseValue(std::string_view word, double& value)
+{
+    static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    if (!word.empty() && word.front() == '+')                                           // std::from_chars не принимает явный плюс
+    {
+        word.remove_prefix(1);
+    }
+
+    const char* first = word.data();
+    const char* last = first + word.size();
+    const char* current = first + (first != last && *first == '-');
+    uint64_t mantissa = 0;
+    int exponent = 0;                                                                   // десятичный порядок мантиссы
+    size_t digitCount = 0;
+
+    for (; current != last && *current >= '0' && *current <= '9'; current++, digitCount++)
+    {
+        mantissa = mantissa * 10 + (*current - '0');
+    }
+
+    if (current != last && *current == '.')
+    {
+        for (current++; current != last && *current >= '0' && *current <= '9'; current++, digitCount++)
+        {
+            mantissa = mantissa * 10 + (*current - '0');
+            exponent--;
+        }
+    }
+
+    if (current != last && (*current == 'e' || *current == 'E'))
+    {
+        const char* power = current + 1;
+        bool negative = power != last && *power == '-';
+        power += power != last && (*power == '-' || *power == '+');
+        int powerValue = 0;
+        const char* powerFirst = power;
+
+        for (; power != last && *power >= '0' && *power <= '9' && powerValue < 1000; power++)
+        {
+            powerValue = powerValue * 10 + (*power - '0');
+        }
+
+        if (power != powerFirst)                                                        // порядок без цифр оставляем std::from_chars
+        {
+            exponent += negative ? -powerValue : powerValue;
+            current = power;
+        }
+    }
+
+    if (current == last && digitCount && digitCount <= 15 && exponent >= -22 && exponent <= 22)
+    {                                                                                   // до 15 цифр мантисса заведомо меньше 2^53
+        value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / POWERS[-exponent] : value * POWERS[exponent];
+        value = *first == '-' ? -value : value;
+        return true;
+    }
+
+    std::from_chars_result result = std::from_chars(first, last, value);
+
+    return !word.empty() && result.ec == std::errc() && result.ptr == last && std::isfinite(value);
+}
+
+// метод выделения следующего слова строки (пробельные символы перед ним пропускаются)
+// принимает на вход: остаток строки (слово и пробелы перед ним отбрасываются)
+// возвращает слово (пустое в конце строки)
+inline std::string_view NetlistParser::nextWord(std::string_view& line)
+{
+    size_t first = 0;
+
+    while (first < line.size() && isSpace(line[first]))
+    {
+        first++;
+    }
+
+    size_t last = first;
+
+    while (last < line.size() && !isSpace(line[last]))
+    {
+        last++;
+    }
+
+    std::string_view word = line.substr(first, last - first);
+    line.remove_prefix(last);
+
+    return word;
+}
+
+// метод проверки пробельного символа (пробел, табуляция, возврат каретки и т.п.)
+inline bool NetlistParser::isSpace(char symbol)
+{
+    return symbol == ' ' || (symbol >= '\t' && symbol <= '\r');
+}
+
+// метод сравнения слова с ключевым словом без учета регистра (без копирования слова)
+// принимает на вход:
+// 1) слово
+// 2) ключевое слово в нижнем регистре
+inline bool NetlistParser::equalsLower(std::string_view word, std::string_view keyword)
+{
+    if (word.size() != keyword.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < word.size(); i++)
+    {
+        char symbol = word[i];
+
+        if (symbol >= 'A' && symbol <= 'Z')                                             // у латинских букв 0x20 - бит нижнего регистра
+        {
+            symbol |= 0x20;
+        }
+
+        if (symbol != keyword[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// метод создания исключения об ошибке разбора с номером текущей строки
+inline std::runtime_error NetlistParser::error() const
+{
+    return std::runtime_error("Parsing error at line: " + std::to_string(lineCount));
+}
+
+} // namespace CS
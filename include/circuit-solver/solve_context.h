@@ -0,0 +1,140 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/compiled_circuit.h"
+
+namespace CS
+{
+// класс для расчета скомпилированной схемы (CompiledCircuit) при своих значениях
+// элементов: хранит значения элементов и численное разложение левой части
+// контекст используется одним потоком, а скомпилированная схема - общая для всех
+// контекстов (владение ею разделяется через std::shared_ptr)
+// как и в Circuit, выполняются только устаревшие этапы: после изменения сопротивлений -
+// численное разложение с прежней структурой, после изменения только источников -
+// прямой и обратный ход
+//////////////////////////////////////////////////////////////////////////////////////////
+class SolveContext
+{
+public:
+    explicit SolveContext(std::shared_ptr<const CompiledCircuit> circuit);              // конструктор с параметрами
+    const CompiledCircuit& getCircuit() const;                                          // геттер скомпилированной схемы
+    const DoubleVect& getValues() const;                                                // геттер значений элементов
+    void setValues(const DoubleVect& values);                                           // метод задания значений всех элементов
+    void setElementValue(size_t index, double value);                                   // метод изменения значения элемента
+    DoubleVect solve();                                                                 // метод расчета токов ветвей
+    const DoubleVect& getSolution() const;                                              // геттер решения системы последнего расчета
+    const SparseLUSolver& getSolver() const;                                            // геттер численного разложения левой части
+
+private:
+    std::shared_ptr<const CompiledCircuit> circuit;                                     // скомпилированная схема
+    SparseLUSolver solver;                                                              // численное разложение левой части (структура общая со схемой)
+    DoubleVect values;                                                                  // значения элементов
+    DoubleVect leftValues;                                                              // коэффициенты левой части
+    DoubleVect rightPart;                                                               // правая часть, затем решение
+    bool valuesChanged = false;                                                         // признак устаревшего численного разложения
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// конструктор с параметрами: значения элементов - номинальные, численная часть
+// разложения (значения L, U) копируется из скомпилированной схемы, а символьный
+// анализ и структура L, U остаются общими с ней (см. SparseLUSolver), поэтому первый
+// расчет при номинальных значениях не требует разложения, а контекст не хранит
+// собственной копии структуры, пока полное разложение не выберет другие ведущие строки
+// принимает на вход: скомпилированную схему
+inline SolveContext::SolveContext(std::shared_ptr<const CompiledCircuit> circuit) :
+    circuit{ std::move(circuit) }
+{
+    if (!this->circuit)
+    {
+        throw std::invalid_argument("Compiled circuit is not set");
+    }
+
+    solver = this->circuit->getSolver();
+    values = this->circuit->getNominalValues();
+}
+
+// геттер скомпилированной схемы
+inline const CompiledCircuit& SolveContext::getCircuit() const
+{
+    return *circuit;
+}
+
+// геттер значений элементов
+inline const DoubleVect& SolveContext::getValues() const
+{
+    return values;
+}
+
+// метод задания значений всех элементов (в порядке списка элементов схемы)
+// при несовпадении количества значений с количеством элементов выбрасывает
+// исключение std::invalid_argument
+inline void SolveContext::setValues(const DoubleVect& values)
+{
+    if (values.size() != this->values.size())
+    {
+        throw std::invalid_argument("Value count does not match element count");
+    }
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        setElementValue(i, values[i]);
+    }
+}
+
+// метод изменения значения элемента с индексом index (индексы за пределами списка
+// игнорируются, как в Circuit::setElementValue)
+inline void SolveContext::setElementValue(size_t index, double value)
+{
+    if (index >= values.size() || values[index] == value)                               // индекс за пределами списка или значение не изменилось
+    {
+        return;
+    }
+
+    values[index] = value;
+
+    if (circuit->getElementType(index) == Element::Type::R)                             // сопротивление входит в левую часть системы
+    {
+        valuesChanged = true;
+    }
+}
+
+// метод расчета токов ветвей при текущих значениях элементов
+// возвращает вектор токов всех ветвей в порядке списка ветвей (как Circuit::solve)
+// при вырожденной системе выбрасывает исключение std::runtime_error (контекст
+// остается пригодным: следующий расчет разложит левую часть заново)
+inline DoubleVect SolveContext::solve()
+{
+    if (valuesChanged)                                                                  // сопротивления изменились - повторяем численное разложение
+    {
+        circuit->evaluateLeft(values, leftValues);
+        solver.refactorize(leftValues);
+        valuesChanged = false;
+    }
+
+    DoubleVect sourceValues = circuit->getSourceValues(values);
+    circuit->evaluateRight(values, sourceValues, rightPart);
+    solver.solve(rightPart);
+
+    return circuit->getBranchCurrents(rightPart, values, sourceValues);
+}
+
+// геттер решения системы последнего расчета (неизвестные выбранного способа
+// составления системы; пусто до первого расчета)
+inline const DoubleVect& SolveContext::getSolution() const
+{
+    return rightPart;
+}
+
+// геттер численного разложения левой части (соответствует текущим значениям
+// элементов после расчета)
+inline const SparseLUSolver& SolveContext::getSolver() const
+{
+    return solver;
+}
+
+} // namespace CS
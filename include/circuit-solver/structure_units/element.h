@@ -32,6 +32,7 @@ public:
     void setValue(double value);                                                        // сеттер значения
     const double* getValuePointer() const;                                              // геттер указателя на значение
     int getLinkedPin(size_t number) const;                                              // геттер номера присоединенного пина
+    void setLinkedPin(size_t number, int pin);                                          // сеттер номера присоединенного пина
 };
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -70,4 +71,10 @@ inline int Element::getLinkedPin(size_t number) const
     return linkedPin[number % 2];                                                       // фильтр 0 и 1
 }
 
+// сеттер номера присоединенного пина (-1 - пин ни с чем не соединен)
+inline void Element::setLinkedPin(size_t number, int pin)
+{
+    linkedPin[number % 2] = pin;                                                        // фильтр 0 и 1
+}
+
 } // namespace CS
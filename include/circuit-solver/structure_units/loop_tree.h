@@ -0,0 +1,148 @@
+#pragma once
+
+#include "circuit-solver/common.h"
+#include "circuit-solver/circuit_configuration/inc_matrix.h"
+
+namespace CS
+{
+// класс для представления дерева поиска контура схемы
+// узлы дерева хранятся в одном массиве (арене) и ссылаются на родителей по индексам;
+// массив очищается перед каждым поиском без освобождения памяти, поэтому при
+// повторных поисках выделений памяти нет
+// посещенные узлы схемы отмечаются номером текущего поиска (эпохой): проверка
+// выполняется за O(1), а сброс отметок перед новым поиском - увеличением эпохи
+//////////////////////////////////////////////////////////////////////////////////////////
+class LoopTree
+{
+public:
+    static constexpr size_t NONE = static_cast<size_t>(-1);                             // отсутствующий индекс узла дерева
+
+    struct Data                                                                         // структура для хранения данных в каждом узле
+    {
+        int branch;                                                                     // номер ветви схемы (увеличенный на единицу, со знаком)
+        size_t node;                                                                    // номер узла схемы
+    };
+
+    size_t createTree(const IncMatrix& matrix, const Data root);                        // метод построения дерева от корня до замыкания контура
+    size_t size() const;                                                                // геттер количества узлов дерева
+    const Data& getData(size_t index) const;                                            // геттер хранимых данных
+    size_t getParent(size_t index) const;                                               // геттер индекса родителя
+
+private:
+    std::vector<Data> data;                                                             // данные узлов дерева (корень - нулевой узел)
+    SizeVect parents;                                                                   // индексы родителей узлов дерева (у корня - NONE)
+    SizeVect visitEpochs;                                                               // номер поиска, в котором посещен узел схемы
+    size_t epoch = 0;                                                                   // номер текущего поиска
+
+    void reset(size_t nodeCount);                                                       // метод очистки дерева перед новым поиском
+    size_t addNode(const Data nodeData, size_t parent);                                 // метод добавления узла дерева
+    bool visit(size_t schemeNode);                                                      // метод отметки посещения узла схемы
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод построения дерева ветвей для выделения контура схемы:
+// обход в ширину от узла схемы корня по ветвям с неизвестными токами; каждый узел
+// схемы входит в дерево не более одного раза, поэтому первый найденный путь
+// до противоположного конца ветви корня - кратчайший
+// возвращает индекс узла дерева, замыкающего контур (его ветвь совпадает с ветвью
+// корня), или NONE, если ветвь корня не входит ни в один контур
+inline size_t LoopTree::createTree(const IncMatrix& matrix, const Data root)
+{
+    reset(matrix.getNodeCount());                                                       // очищаем арену и отметки предыдущего поиска
+    addNode(root, NONE);                                                                // корень - первый узел дерева
+    visit(root.node);                                                                   //
+
+    for (size_t head = 0; head < data.size(); head++)                                   // узлы добавляются в арену в порядке обхода в ширину - она же очередь
+    {
+        Data current = data[head];                                                      // копия: при добавлении узлов арена может переместиться
+
+        for (size_t i : matrix.getNodeBranches(current.node))                           // перебираем ветви, инцидентные узлу схемы, номер которого хранится в текущем узле
+        {
+            if (i >= matrix.getUnknownCurrentCount())                                   // ветви с источниками тока идут в конце списка - в контуры они не входят
+            {
+                break;
+            }
+
+            if (i == abs(current.branch) - 1u)                                          // если номер текущей ветви соответствует хранимому в узле номеру ветви
+            {
+                continue;                                                               // пропускаем эту ветвь
+            }
+
+            size_t j = matrix.getFrom(i) == current.node ?                              // узел на противоположном конце i-ой ветви относительно узла схемы,
+                       matrix.getTo(i) : matrix.getFrom(i);                             // номер которого хранится в текущем узле
+
+            int branch = static_cast<int>(i + 1u) * matrix(i, j);                       // инкрементируем номер ветви (чтобы избежать номера +-0) и берем со знаком
+                                                                                        // соответствующей позиции матрицы инцидентности
+            if (branch == root.branch && j == root.node)                                // ветвь корня привела обратно в корень - контур замкнут
+            {
+                return addNode({ branch, j }, head);
+            }
+
+            if (visit(j))                                                               // если узел схемы j еще не входит в дерево
+            {
+                addNode({ branch, j }, head);                                           // добавляем потомка текущего узла
+            }
+        }
+    }
+
+    return NONE;                                                                        // контур не найден
+}
+
+// геттер количества узлов дерева
+inline size_t LoopTree::size() const
+{
+    return data.size();
+}
+
+// геттер хранимых данных узла дерева
+inline const LoopTree::Data& LoopTree::getData(size_t index) const
+{
+    return data[index];
+}
+
+// геттер индекса родителя узла дерева (для корня - NONE)
+inline size_t LoopTree::getParent(size_t index) const
+{
+    return parents[index];
+}
+
+// метод очистки дерева перед новым поиском:
+// память арены сохраняется, отметки посещения сбрасываются сменой эпохи
+// принимает на вход: количество узлов схемы
+inline void LoopTree::reset(size_t nodeCount)
+{
+    data.clear();
+    parents.clear();
+
+    if (visitEpochs.size() < nodeCount)                                                 // массив отметок растет вместе со схемой
+    {
+        visitEpochs.resize(nodeCount, 0);
+    }
+
+    epoch++;                                                                            // отметки прошлых поисков становятся недействительными
+}
+
+// метод добавления узла дерева
+// возвращает индекс нового узла
+inline size_t LoopTree::addNode(const Data nodeData, size_t parent)
+{
+    data.push_back(nodeData);
+    parents.push_back(parent);
+    return data.size() - 1;
+}
+
+// метод отметки посещения узла схемы
+// возвращает истину, если узел не был посещен в текущем поиске
+inline bool LoopTree::visit(size_t schemeNode)
+{
+    if (visitEpochs[schemeNode] == epoch)
+    {
+        return false;
+    }
+
+    visitEpochs[schemeNode] = epoch;
+    return true;
+}
+
+} // namespace CS
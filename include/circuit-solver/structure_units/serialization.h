@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace CS
+{
+// классы для записи структур схемы в двоичный буфер и чтения из него (для кэша
+// топологии, см. TopologyCache)
+// числа и векторы из простых типов записываются байтами как есть (буфер читается
+// только той же сборкой на той же машине), перед вектором - его длина
+// при чтении за концом буфера выбрасывается исключение std::runtime_error
+//////////////////////////////////////////////////////////////////////////////////////////
+class BinaryWriter
+{
+public:
+    template <typename T>
+    void write(const T& value);                                                         // метод записи значения
+    template <typename T>
+    void write(const std::vector<T>& vector);                                           // метод записи вектора
+    template <typename T>
+    void write(const std::vector<std::vector<T>>& matrix);                              // метод записи вектора векторов
+    const std::string& getBuffer() const;                                               // геттер буфера
+
+private:
+    std::string buffer;                                                                 // записанные байты
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////
+class BinaryReader
+{
+public:
+    explicit BinaryReader(std::string_view buffer);                                     // конструктор с параметрами
+    template <typename T>
+    void read(T& value);                                                                // метод чтения значения
+    template <typename T>
+    void read(std::vector<T>& vector);                                                  // метод чтения вектора
+    template <typename T>
+    void read(std::vector<std::vector<T>>& matrix);                                     // метод чтения вектора векторов
+    bool atEnd() const;                                                                 // метод проверки, прочитан ли буфер целиком
+
+private:
+    std::string_view buffer;                                                            // читаемые байты
+    size_t position = 0;                                                                // позиция чтения
+
+    size_t readCount(size_t itemSize);                                                  // метод чтения длины вектора с проверкой
+};
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// метод вычисления 64-битного хэша участка памяти (не криптографического: для
+// ключей и контрольных сумм кэша) - по 8 байт за шаг
+// принимает на вход:
+// 1) указатель на начало участка
+// 2) длина участка в байтах
+// 3) начальное значение (разные значения дают независимые хэши)
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+    const char* bytes = static_cast<const char*>(data);
+    uint64_t hash = seed ^ (size * MULTIPLIER);
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t tail = 0;                                                                  // оставшиеся байты
+    std::memcpy(&tail, bytes + i, size - i);
+    hash = (hash ^ tail) * MULTIPLIER;
+
+    return hash ^ (hash >> 32);
+}
+
+// метод записи значения простого типа
+template <typename T>
+inline void BinaryWriter::write(const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are written");
+
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// метод записи вектора значений простого типа (длина, затем значения)
+template <typename T>
+inline void BinaryWriter::write(const std::vector<T>& vector)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are written");
+
+    write(static_cast<uint64_t>(vector.size()));
+    buffer.append(reinterpret_cast<const char*>(vector.data()), vector.size() * sizeof(T));
+}
+
+// метод записи вектора векторов (количество векторов, затем векторы)
+template <typename T>
+inline void BinaryWriter::write(const std::vector<std::vector<T>>& matrix)
+{
+    write(static_cast<uint64_t>(matrix.size()));
+
+    for (const std::vector<T>& row : matrix)
+    {
+        write(row);
+    }
+}
+
+// геттер буфера с записанными байтами
+inline const std::string& BinaryWriter::getBuffer() const
+{
+    return buffer;
+}
+
+// конструктор с параметрами
+// принимает на вход: читаемые байты (должны существовать, пока идет чтение)
+inline BinaryReader::BinaryReader(std::string_view buffer) :
+    buffer{ buffer } {}
+
+// метод чтения значения простого типа
+// при чтении за концом буфера выбрасывает исключение std::runtime_error
+template <typename T>
+inline void BinaryReader::read(T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are read");
+
+    if (buffer.size() - position < sizeof(T))
+    {
+        throw std::runtime_error("Unexpected end of binary data");
+    }
+
+    std::memcpy(&value, buffer.data() + position, sizeof(T));
+    position += sizeof(T);
+}
+
+// метод чтения вектора значений простого типа
+// при чтении за концом буфера выбрасывает исключение std::runtime_error
+template <typename T>
+inline void BinaryReader::read(std::vector<T>& vector)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are read");
+
+    size_t count = readCount(sizeof(T));
+    vector.resize(count);
+
+    if (count)
+    {
+        std::memcpy(vector.data(), buffer.data() + position, count * sizeof(T));
+        position += count * sizeof(T);
+    }
+}
+
+// метод чтения вектора векторов
+// при чтении за концом буфера выбрасывает исключение std::runtime_error
+template <typename T>
+inline void BinaryReader::read(std::vector<std::vector<T>>& matrix)
+{
+    matrix.resize(readCount(sizeof(uint64_t)));                                         // каждый вектор занимает хотя бы свою длину
+
+    for (std::vector<T>& row : matrix)
+    {
+        read(row);
+    }
+}
+
+// метод проверки, прочитан ли буфер целиком
+inline bool BinaryReader::atEnd() const
+{
+    return position == buffer.size();
+}
+
+// метод чтения длины вектора: длина проверяется по остатку буфера до выделения памяти
+// принимает на вход: размер одного значения вектора в байтах
+// если значения не помещаются в остаток буфера, выбрасывает исключение std::runtime_error
+inline size_t BinaryReader::readCount(size_t itemSize)
+{
+    uint64_t count;
+    read(count);
+
+    if (count > (buffer.size() - position) / itemSize)
+    {
+        throw std::runtime_error("Unexpected end of binary data");
+    }
+
+    return static_cast<size_t>(count);
+}
+
+} // namespace CS
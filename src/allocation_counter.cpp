@@ -0,0 +1,6 @@
+// единственная единица трансляции с считающими заменами глобальных operator new и
+// operator delete (см. CS_PROFILING_ALLOCATIONS в analysis/profiler.h); собирается
+// один раз и подключается к программам при CIRCUIT_SOLVER_PROFILING
+#define CS_PROFILING_ALLOCATIONS
+
+#include "circuit-solver/analysis/profiler.h"
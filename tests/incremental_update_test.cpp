@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "circuit-solver/circuit.h"
+#include "circuit-solver/generators/circuit_generator.h"
+
+using namespace std;
+
+// проверка частичного обновления схемы: после серии случайных правок (добавление,
+// удаление элементов, изменение соединений пинов) токи схемы совпадают с токами
+// такой же схемы, построенной заново через add; номера ветвей и их направления у
+// двух схем могут различаться, поэтому сравниваются упорядоченные модули токов
+// отдельно проверяется, что правка, не меняющая структуру системы (замена элемента
+// другим с теми же соединениями), сохраняет символьный анализ разложения, а
+// добавление элемента сообщает только часть неизвестных
+
+namespace
+{
+const size_t SIZE = 200;                                                                // количество элементов схемы
+const size_t ROUNDS = 30;                                                               // количество серий правок
+const size_t MAX_EDITS = 3;                                                             // наибольшее количество правок в серии
+
+size_t failures = 0;
+
+void check(const string& name, bool condition)
+{
+    if (!condition)
+    {
+        cerr << "FAILED: " << name << endl;
+        failures++;
+    }
+}
+
+// токи схемы (признак успеха - false, если расчет выбросил исключение)
+bool solve(CS::Circuit& circuit, CS::DoubleVect& currents)
+{
+    try
+    {
+        currents = circuit.solve();
+    }
+    catch (const exception&)
+    {
+        return false;
+    }
+
+    for (double& current : currents)
+    {
+        current = fabs(current);
+    }
+
+    sort(currents.begin(), currents.end());
+    return true;
+}
+
+// сравнение с той же схемой, построенной заново
+void compare(const string& name, CS::Circuit& tested, const string& formulation)
+{
+    CS::Circuit reference;
+    reference.setFormulation(formulation);
+
+    for (size_t i = 0; i < tested.getElements().size(); i++)                           // удаленные элементы остаются заглушками
+    {
+        reference.add(tested.getElements()[i]);
+    }
+
+    CS::DoubleVect actual, expected;
+    bool solved = solve(tested, actual);
+
+    if (solved != solve(reference, expected))
+    {
+        check(name + " (only one circuit is solvable)", false);
+        return;
+    }
+
+    bool same = actual.size() == expected.size();
+
+    for (size_t i = 0; same && i < actual.size(); i++)
+    {
+        same = fabs(actual[i] - expected[i]) <= 1e-6 * (1.0 + fabs(expected[i]));
+    }
+
+    check(name + " (" + to_string(actual.size()) + " currents, expected " +
+          to_string(expected.size()) + ")", same);
+}
+
+size_t unknownCount(const CS::Circuit& circuit)
+{
+    return circuit.getFormulation() == CS::Circuit::Formulation::Branch ? circuit.getEquations().size() :
+                                                                          circuit.getMnaEquations().size();
+}
+
+// случайные правки схемы: в основном добавляются сопротивления между пинами схемы
+// и удаляются или переподключаются добавленные (так схема чаще остается
+// разрешимой), изредка удаляется исходный элемент
+void edit(CS::Circuit& circuit, mt19937& random, CS::SizeVect& added)
+{
+    size_t pinCount = circuit.getElements().size() * 2;
+    size_t operation = random() % 10;
+
+    if (operation < 5 || added.empty())
+    {
+        int first = static_cast<int>(random() % pinCount);
+        int second = static_cast<int>(random() % pinCount);
+
+        if (first / 2 != second / 2 && !circuit.getElements().isRemoved(first / 2) &&
+            !circuit.getElements().isRemoved(second / 2))
+        {
+            added.push_back(circuit.addElement(CS::Element(CS::Element::Type::R, 1.0 + random() % 9,
+                                                           first, second)));
+        }
+    }
+    else if (operation < 8)
+    {
+        size_t position = random() % added.size();
+        circuit.removeElement(added[position]);
+        added.erase(added.begin() + position);
+    }
+    else if (operation < 9)
+    {
+        size_t pin = added[random() % added.size()] * 2 + random() % 2;
+        int linkedPin = static_cast<int>(random() % pinCount);
+
+        if (linkedPin / 2 != static_cast<int>(pin / 2) && !circuit.getElements().isRemoved(linkedPin / 2))
+        {
+            circuit.reconnectPin(pin, linkedPin);
+        }
+    }
+    else
+    {
+        size_t index = random() % circuit.getElements().size();
+
+        if (!circuit.getElements().isRemoved(index) &&
+            find(added.begin(), added.end(), index) == added.end())
+        {
+            circuit.removeElement(index);
+        }
+    }
+}
+
+// схема семейства с двумя параллельными сопротивлениями между пинами двух элементов
+// (возвращает номер второго сопротивления)
+size_t build(CS::Circuit& circuit, const string& family, const string& formulation)
+{
+    CS::ElemVect elements;
+    CS::CircuitGenerator(1).generate(family, SIZE, elements);
+    circuit.setFormulation(formulation);
+    circuit.add(elements);
+
+    int first = 0, second = static_cast<int>(elements.size());
+    circuit.addElement(CS::Element(CS::Element::Type::R, 2.0, first, second));
+    size_t index = circuit.addElement(CS::Element(CS::Element::Type::R, 3.0, first, second));
+    circuit.solve();
+    return index;
+}
+
+// замена параллельного сопротивления другим на том же месте: структура системы и
+// неизвестные не меняются, разложение повторяется без символьного анализа
+void checkSamePattern(const string& name, const string& family, const string& formulation)
+{
+    CS::Circuit circuit;
+    size_t index = build(circuit, family, formulation);
+    CS::Element element = circuit.getElements()[index];
+    size_t refactorizations = circuit.getSparseSolver().getReport().refactorizations;
+
+    circuit.removeElement(index);
+    circuit.addElement(CS::Element(CS::Element::Type::R, 5.0, element.getLinkedPin(0),  // занимает место удаленного
+                                   element.getLinkedPin(1)));
+    compare(name + " replaced element", circuit, formulation);
+
+    check(name + " keeps symbolic analysis",
+          circuit.getSparseSolver().getReport().refactorizations == refactorizations + 1);
+    check(name + " reports no changed unknowns", circuit.getChangedUnknowns().empty());
+}
+
+// добавление сопротивления: изменившиеся неизвестные - только в окрестности правки
+void checkChangedUnknowns(const string& name, const string& family, const string& formulation)
+{
+    CS::Circuit circuit;
+    size_t index = build(circuit, family, formulation);
+
+    circuit.addElement(CS::Element(CS::Element::Type::R, 7.0, static_cast<int>(index * 2),
+                                   static_cast<int>(circuit.getElements().size())));
+    compare(name + " added element", circuit, formulation);
+
+    size_t changed = circuit.getChangedUnknowns().size();
+    check(name + " reports changed unknowns (" + to_string(changed) + " of " +
+          to_string(unknownCount(circuit)) + ")",
+          changed && changed < unknownCount(circuit) / 4);
+}
+} // namespace
+
+int main()
+{
+    for (const string formulation : { "branch", "mna" })
+    {
+        for (const string family : { "ladder", "grid", "planar" })
+        {
+            for (uint64_t seed = 1; seed <= 3; seed++)
+            {
+                string name = formulation + " " + family + " " + to_string(seed);
+                CS::Circuit circuit;
+                CS::ElemVect elements;
+                CS::CircuitGenerator(seed).generate(family, SIZE, elements);
+                circuit.setFormulation(formulation);
+                circuit.add(elements);
+                circuit.update();
+
+                mt19937 random(static_cast<unsigned>(seed));
+                CS::SizeVect added;
+
+                for (size_t round = 0; round < ROUNDS; round++)
+                {
+                    size_t count = 1 + random() % MAX_EDITS;
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        edit(circuit, random, added);
+                    }
+
+                    compare(name + " round " + to_string(round), circuit, formulation);
+                }
+            }
+
+            checkSamePattern(formulation + " " + family, family, formulation);
+            checkChangedUnknowns(formulation + " " + family, family, formulation);
+        }
+    }
+
+    if (failures)
+    {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "all checks passed" << endl;
+    return 0;
+}
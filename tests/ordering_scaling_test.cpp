@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "circuit-solver/circuit.h"
+#include "circuit-solver/generators/circuit_generator.h"
+
+using namespace std;
+
+// проверка масштабирования упорядочения столбцов: время символьного анализа (и
+// заполнение разложения узловой системы) при увеличении схемы в SCALE раз должно
+// расти почти линейно; квадратичный рост дает отношение около SCALE^2, поэтому
+// допустимое отношение MAX_RATIO выбрано между SCALE * log и SCALE^2 с запасом
+// на погрешность замеров
+// проверяются схемы, у которых количество коэффициентов системы растет линейно (в
+// системе по законам Кирхгофа для сеток длина контуров растет вместе со схемой, и
+// сама матрица растет быстрее); заполнение - у планарных схем (у схем энергосистем
+// случайные перемычки делают его сверхлинейным при любом упорядочении)
+
+namespace
+{
+const size_t SMALL = 20000;                                                             // количество элементов меньшей схемы
+const size_t SCALE = 4;                                                                 // во сколько раз больше вторая схема
+const double MAX_RATIO = 10.0;                                                          // допустимое отношение времени и заполнения
+const double MIN_TIME = 1e-3;                                                           // время, до которого округляются короткие замеры (с)
+const size_t REPEAT = 3;                                                                // количество повторов замера (берется наименьший)
+
+size_t failures = 0;
+
+struct Measurement                                                                      // результат разложения одной схемы
+{
+    double seconds = 0.0;                                                               // время символьного анализа (с)
+    size_t factorNonZeros = 0;                                                          // количество ненулевых позиций L и U
+};
+
+Measurement measure(const string& family, size_t size, const string& formulation,
+                    CS::SparseLUSolver::Ordering ordering, bool factorize)
+{
+    CS::Circuit circuit;
+    CS::ElemVect elements;
+    CS::CircuitGenerator(1).generate(family, size, elements);
+    circuit.setFormulation(formulation);
+    circuit.add(elements);
+    circuit.update();
+
+    const CS::SparseMatrix& left = formulation == "branch" ? circuit.getEquations().left() :
+                                                             circuit.getMnaEquations().left();
+    CS::SparseLUSolver solver;
+    solver.setOrdering(ordering);
+    Measurement result;
+    result.seconds = 1e30;
+
+    for (size_t i = 0; i < REPEAT; i++)
+    {
+        auto start = chrono::steady_clock::now();
+        solver.analyze(left);
+        result.seconds = min(result.seconds, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+    if (factorize)
+    {
+        CS::DoubleVect values;
+        formulation == "branch" ? circuit.getEquations().evaluateLeft(circuit.getElements(), values) :
+                                  circuit.getMnaEquations().evaluateLeft(circuit.getElements(), values);
+        solver.factorize(values);
+        result.factorNonZeros = solver.getReport().lowerNonZeros + solver.getReport().upperNonZeros;
+    }
+
+    return result;
+}
+
+void check(const string& name, double small, double large)
+{
+    double ratio = large / small;
+
+    if (ratio > MAX_RATIO)
+    {
+        cerr << "FAILED: " << name << " grows " << ratio << " times for " << SCALE
+             << " times larger circuit" << endl;
+        failures++;
+    }
+}
+} // namespace
+
+int main()
+{
+    const pair<CS::SparseLUSolver::Ordering, string> orderings[] = {
+        { CS::SparseLUSolver::Ordering::Column, "column" },
+        { CS::SparseLUSolver::Ordering::Symmetric, "symmetric" }
+    };
+
+    const pair<string, string> circuits[] = {                                           // (способ составления уравнений, семейство)
+        { "branch", "ladder" }, { "branch", "power" },
+        { "mna", "ladder" }, { "mna", "grid" }, { "mna", "planar" }, { "mna", "power" }
+    };
+
+    for (const auto& [formulation, family] : circuits)
+    {
+        for (const auto& [ordering, orderingName] : orderings)
+        {
+            string name = formulation + " " + family + " " + orderingName;
+            bool factorize = formulation == "mna" && family != "power" &&               // заполнение узловой системы (упорядочение по умолчанию)
+                             ordering == CS::SparseLUSolver::Ordering::Symmetric;
+
+            Measurement small = measure(family, SMALL, formulation, ordering, factorize);
+            Measurement large = measure(family, SMALL * SCALE, formulation, ordering, factorize);
+            check(name + " ordering time", max(small.seconds, MIN_TIME), max(large.seconds, MIN_TIME));
+
+            if (factorize)
+            {
+                check(name + " fill", static_cast<double>(small.factorNonZeros),
+                      static_cast<double>(large.factorNonZeros));
+            }
+        }
+    }
+
+    if (failures)
+    {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "all checks passed" << endl;
+    return 0;
+}
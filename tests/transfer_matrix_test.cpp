@@ -0,0 +1,129 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "circuit-solver/circuit.h"
+#include "circuit-solver/generators/circuit_generator.h"
+
+using namespace std;
+
+// проверка: solve после getTransferMatrix возвращает токи измененной схемы, а не
+// найденные до изменения (изменение сопротивления, источника, добавление элемента)
+// каждая схема сравнивается с такой же схемой, измененной так же, но без
+// getTransferMatrix перед solve
+
+namespace
+{
+size_t failures = 0;
+
+void check(const string& name, const CS::DoubleVect& actual, const CS::DoubleVect& expected)
+{
+    bool same = actual.size() == expected.size();
+
+    for (size_t i = 0; same && i < actual.size(); i++)
+    {
+        same = fabs(actual[i] - expected[i]) <= 1e-9 * (1.0 + fabs(expected[i]));
+    }
+
+    if (!same)
+    {
+        cerr << "FAILED: " << name << " (" << actual.size() << " currents, expected "
+             << expected.size() << ")" << endl;
+        failures++;
+    }
+}
+
+// схема из семейства генератора в двух одинаковых экземплярах
+void build(const string& family, uint64_t seed, const string& formulation,
+           CS::Circuit& tested, CS::Circuit& reference)
+{
+    CS::ElemVect elements;
+    CS::CircuitGenerator(seed).generate(family, 40, elements);
+
+    for (CS::Circuit* circuit : { &tested, &reference })
+    {
+        circuit->setFormulation(formulation);
+        circuit->add(elements);
+        circuit->solve();
+    }
+}
+
+size_t findElement(const CS::Circuit& circuit, CS::Element::Type type)
+{
+    for (size_t i = 0; i < circuit.getElements().size(); i++)
+    {
+        if (circuit.getElements()[i].getType() == type)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+} // namespace
+
+int main()
+{
+    for (const string formulation : { "branch", "mna" })
+    {
+        for (const string family : { "ladder", "grid", "planar" })
+        {
+            for (uint64_t seed = 1; seed <= 5; seed++)
+            {
+                string name = formulation + " " + family + " " + to_string(seed);
+
+                {
+                    CS::Circuit tested, reference;
+                    build(family, seed, formulation, tested, reference);
+                    size_t index = findElement(tested, CS::Element::Type::R);
+                    tested.getTransferMatrix();
+
+                    for (CS::Circuit* circuit : { &tested, &reference })
+                    {
+                        circuit->setElementValue(index, circuit->getElements()[index].getValue() * 3.0);
+                    }
+
+                    tested.getTransferMatrix();
+                    check(name + " resistance", tested.solve(), reference.solve());
+                }
+
+                {
+                    CS::Circuit tested, reference;
+                    build(family, seed, formulation, tested, reference);
+                    size_t index = findElement(tested, CS::Element::Type::E);
+                    tested.getTransferMatrix();
+
+                    for (CS::Circuit* circuit : { &tested, &reference })
+                    {
+                        circuit->setElementValue(index, circuit->getElements()[index].getValue() + 1.0);
+                    }
+
+                    check(name + " source", tested.solve(), reference.solve());
+                }
+
+                {
+                    CS::Circuit tested, reference;
+                    build(family, seed, formulation, tested, reference);
+                    tested.getTransferMatrix();
+
+                    for (CS::Circuit* circuit : { &tested, &reference })
+                    {
+                        circuit->addElement(CS::Element(CS::Element::Type::R, 4.0, 3, 6));
+                    }
+
+                    tested.getTransferMatrix();
+                    check(name + " add element", tested.solve(), reference.solve());
+                }
+            }
+        }
+    }
+
+    if (failures)
+    {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "all checks passed" << endl;
+    return 0;
+}
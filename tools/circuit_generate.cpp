@@ -0,0 +1,129 @@
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "circuit-solver/generators/circuit_generator.h"
+#include "circuit-solver/netlist/binary_netlist.h"
+
+using namespace std;
+
+// построение синтетической схемы (см. CS::CircuitGenerator) и запись ее в файл в
+// текстовом формате Circuit или в двоичном (см. CS::BinaryNetlist)
+// запуск: circuit_generate <семейство> <количество элементов> <файл>
+//                          [--seed 1] [--sources 0.1] [--format text|binary]
+// семейства: grid, ladder, planar, power
+
+namespace
+{
+// запись элементов в текстовом формате: строки собираются в буфер через to_chars
+// (кратчайшее точное представление значений) и пишутся крупными блоками
+void writeText(const CS::ElemVect& elements, const string& path)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+
+    if (!file)
+    {
+        throw runtime_error("Cannot open file: " + path);
+    }
+
+    const size_t BUFFER_SIZE = 1 << 20;
+    const size_t LINE_SIZE = 64;                                                        // длина строки с запасом
+    string buffer(BUFFER_SIZE + LINE_SIZE, '\0');
+    size_t length = 0;
+    bool failed = false;
+
+    for (const CS::Element& element : elements)
+    {
+        char* first = &buffer[length];
+        char* last = &buffer[length + LINE_SIZE];
+        *first++ = element.getType() == CS::Element::Type::R ? 'R' :
+                   element.getType() == CS::Element::Type::E ? 'E' : 'J';
+        *first++ = ' ';
+        first = to_chars(first, last, element.getValue()).ptr;
+
+        for (size_t side = 0; side < 2; side++)
+        {
+            *first++ = ' ';
+            first = element.getLinkedPin(side) < 0 ? copy_n("none", 4, first) :
+                                                      to_chars(first, last, element.getLinkedPin(side)).ptr;
+        }
+
+        *first++ = '\n';
+        length = first - buffer.data();
+
+        if (length >= BUFFER_SIZE)
+        {
+            failed |= fwrite(buffer.data(), 1, length, file) != length;
+            length = 0;
+        }
+    }
+
+    failed |= fwrite(buffer.data(), 1, length, file) != length;
+    failed |= fclose(file) != 0;
+
+    if (failed)
+    {
+        throw runtime_error("Cannot write file: " + path);
+    }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4 || argc % 2)
+    {
+        cerr << "Usage: " << argv[0] << " <grid|ladder|planar|power> <element count> <output>"
+             << " [--seed N] [--sources share] [--format text|binary]" << endl;
+        return 2;
+    }
+
+    try
+    {
+        uint64_t seed = 1;
+        double sources = 0.1;
+        string format = "text";
+
+        for (int i = 4; i < argc; i += 2)
+        {
+            string name = argv[i];
+
+            if (name == "--seed")
+            {
+                seed = stoull(argv[i + 1]);
+            }
+            else if (name == "--sources")
+            {
+                sources = stod(argv[i + 1]);
+            }
+            else if (name == "--format" && (string(argv[i + 1]) == "text" || string(argv[i + 1]) == "binary"))
+            {
+                format = argv[i + 1];
+            }
+            else
+            {
+                throw invalid_argument("Unknown option: " + name + " " + argv[i + 1]);
+            }
+        }
+
+        CS::CircuitGenerator generator(seed);
+        generator.setSourceShare(sources);
+
+        CS::ElemVect elements;
+        generator.generate(argv[1], stoull(argv[2]), elements);
+
+        format == "binary" ? CS::BinaryNetlist::write(argv[3], elements) :
+                             writeText(elements, argv[3]);
+
+        cerr << elements.size() << " elements written to " << argv[3] << endl;
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <iostream>
+#include <exception>
+
+#include "circuit-solver/netlist/binary_netlist.h"
+
+using namespace std;
+
+// преобразование текстового описания схемы в двоичное (см. CS::BinaryNetlist)
+// запуск: netlist_convert <текстовый файл> <двоичный файл>
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        cerr << "Usage: " << argv[0] << " <text netlist> <binary netlist>" << endl;
+        return 2;
+    }
+
+    try
+    {
+        CS::BinaryNetlist::convert(argv[1], argv[2]);
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}